@@ -51,6 +51,7 @@ namespace EventGen{
     std::string fFilename;
     size_t fEvt_num;
     std::string fPedestalFile;
+    bool fUseIndex;
 
     std::vector< std::pair<double, double> > fPedMap; 
   }; // Class ImportSingle311Event    
@@ -95,12 +96,13 @@ namespace EventGen{
     fFilename = p.get<std::string>("Filename");
     fEvt_num = p.get<size_t>("Evt_num");
     fPedestalFile = p.get<std::string>("PedestalFile");
+    fUseIndex = p.get<bool>("UseIndex", false);
     produces< std::vector<raw::RawDigit> >();
   }
 
 
   void ImportSingle311Event::beginJob(){ 
-    DataDecode.Open(fFilename);
+    DataDecode.Open(fFilename, false, fUseIndex);
   }
 
 
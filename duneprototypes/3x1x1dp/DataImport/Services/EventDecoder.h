@@ -17,6 +17,9 @@
 // for compressed data
 #include "HuffDataCompressor.h"
 
+// for memory-mapped input
+#include "duneprototypes/Protodune/dualphase/RawDecoding/MappedRawFile.h"
+
 // max time to wait to receive data 
 #define TMAXWAIT 2
 
@@ -35,8 +38,27 @@ namespace dlardaq
     size_t GetNSample() const { return m_nsample; }
     
     // open input file
-    ssize_t Open(std::string finname);
+    // with usemmap the file is memory mapped and events are decoded 
+    // in place; if the file cannot be mapped it is read with m_file
+    // with useindex the event index is loaded from the sidecar file
+    // finname.idx, or built and saved there if it is missing or stale
+    ssize_t Open(std::string finname, bool usemmap = false, bool useindex = false);
     void Close();
+
+    // event index: the positions of all events in the file, so that
+    // GetEvent seeks straight to any event instead of walking the
+    // headers of all the events before it
+    size_t BuildIndex();
+    bool ReadIndex(std::string idxname);
+    bool WriteIndex(std::string idxname);
+    bool Indexed() const { return m_totev > 0 && m_events.size() == m_totev; }
+
+    bool IsOpen() const { return m_file.is_open() || m_map.IsOpen(); }
+    bool IsMapped() const { return m_map.IsOpen(); }
+
+    // current read position and file size
+    std::streampos Tell();
+    size_t FileSize() const { return m_filesz; }
     
     // get a given event from fil
     ssize_t GetEvent( size_t evnum, dlardaq::evheader_t &eh, 
@@ -74,6 +96,8 @@ namespace dlardaq
     
     // read a byte fector from current position
     void ReadBytes( std::vector<BYTE> &bytes );
+    void Seek( std::streampos pos );
+    void Skip( size_t nb );
     ssize_t Decode( const char *buf, size_t nb, bool cflag,
 		    std::vector<adc16_t> &adc);
     
@@ -102,9 +126,15 @@ namespace dlardaq
     std::streampos m_pstart;
     std::streampos m_pend;
     std::vector<std::streampos> m_events;
+    size_t m_nextev; // event at the current read position
     
     // total number of events in the file
     size_t m_totev;
+
+    // memory-mapped input file and read position in it
+    dune::MappedRawFile m_map;
+    size_t m_mappos;
+    size_t m_filesz;
     
     // basic data parameters
     short  m_nadc;
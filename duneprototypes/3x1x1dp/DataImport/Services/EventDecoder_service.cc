@@ -11,6 +11,11 @@
 #include <iomanip>
 #include <sstream>
 #include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+
+#include <unistd.h>
 
 #include "EventDecoder.h"
 #include "LogMsg.h"
@@ -37,6 +42,10 @@ EventDecoder::EventDecoder(size_t nch, size_t nsample)
   
   //
   m_bytes_left = 0;
+  m_totev      = 0;
+  m_mappos     = 0;
+  m_filesz     = 0;
+  m_nextev     = 0;
 
   // data mutex initialization
   pthread_mutex_init(&m_data_mutex, NULL);
@@ -63,8 +72,15 @@ void EventDecoder::Close()
 
   if(m_file.is_open())
     m_file.close();  
+  m_map.Close();
   
-  m_totev = 0;
+  m_totev  = 0;
+  m_mappos = 0;
+  m_filesz = 0;
+
+  // event bookmarks belong to the file
+  m_events.clear();
+  m_nextev = 0;
   
   // unlock mutex
   unlock( m_data_mutex );
@@ -75,7 +91,7 @@ void EventDecoder::Close()
 //
 //
 //
-ssize_t EventDecoder::Open(std::string finname)
+ssize_t EventDecoder::Open(std::string finname, bool usemmap, bool useindex)
 {
   // attempt to close any previously opened files
   Close();
@@ -88,32 +104,52 @@ ssize_t EventDecoder::Open(std::string finname)
   m_events.clear();
 
   //
-  m_file.open(finname.c_str(), ios::in | ios::binary);
+  if( usemmap && !m_map.Open( finname ) )
+    msg_warn<<"Could not map "<<finname<<", reading it with ifstream"<<endl;
+
+  if( m_map.IsOpen() )
+    {
+      m_filesz = m_map.Size();
+    }
+  else
+    {
+      m_file.open(finname.c_str(), ios::in | ios::binary | ios::ate);
+      m_filesz = m_file.is_open() ? (size_t)m_file.tellg() : 0;
+      m_file.seekg( 0 );
+    }
   
-  if( !m_file.is_open() )
+  if( !IsOpen() )
     {
       msg_err<<"Could not open "<<finname<<" for reading"<<endl;
       unlock( m_data_mutex );
       return -1;
     }
+
+  if( m_filesz < dlardaq::RunHeadSz + dlardaq::FileFootSz )
+    {
+      msg_err<<"File "<<finname<<" is too short"<<endl;
+      unlock(m_data_mutex);
+      Close();
+      return 0;
+    }
   
   // read run header bytes
   ReadBytes( m_RunHeadBuf );
   dlardaq::decode_runhead(&m_RunHeadBuf[0], m_rnh);
   
   
-  m_pstart = m_file.tellg();
+  m_pstart = Tell();
   
   // read footer
   // fast forward to the end
-  m_file.seekg(-dlardaq::FileFootSz, m_file.end );
-  m_pend = m_file.tellg();
+  Seek( m_filesz - dlardaq::FileFootSz );
+  m_pend = Tell();
   
   ReadBytes( m_EndFootBuf );
   dlardaq::decode_filefoot(&m_EndFootBuf[0], m_flf);
 
   // rewind back to the begining
-  m_file.seekg( m_pstart );
+  Seek( m_pstart );
 
   
   // 
@@ -129,18 +165,192 @@ ssize_t EventDecoder::Open(std::string finname)
     }
 
   unlock( m_data_mutex );
+
+  if( useindex )
+    {
+      std::string idxname = finname + ".idx";
+      if( !ReadIndex( idxname ) )
+	{
+	  BuildIndex();
+	  if( Indexed() && !WriteIndex( idxname ) )
+	    msg_warn<<"Could not write event index "<<idxname<<endl;
+	}
+    }
   
   return m_totev;
 }
 
+//
+// walk the headers of the events not yet bookmarked
+//
+size_t EventDecoder::BuildIndex()
+{
+  lock( m_data_mutex );
+
+  std::vector<adc16_t> dummy;
+  if( m_events.empty() )
+    Seek( m_pstart );
+  else
+    {
+      // skip to the end of the last bookmarked event
+      Seek( m_events.back() );
+      ReadEvent( dummy, true );
+    }
+
+  while( m_events.size() < m_totev )
+    {
+      streampos pos = Tell();
+      if( pos + (streamoff)dlardaq::EveHeadSz > m_pend ) break;
+      m_events.push_back( pos );
+      ReadEvent( dummy, true );
+      if( !( ((m_EveHeadBuf[0] & 0xFF) == EVSKEY) && ((m_EveHeadBuf[1] & 0xFF) == EVSKEY) ) )
+	{
+	  // not an event header: the file is corrupted from here on
+	  m_events.pop_back();
+	  Seek( pos );
+	  break;
+	}
+    }
+  m_nextev = m_events.size();
+
+  if( m_events.size() < m_totev )
+    msg_err<<"Found only "<<m_events.size()<<" of "<<m_totev<<" events"<<endl;
+
+  size_t rval = m_events.size();
+  unlock( m_data_mutex );
+  return rval;
+}
+
+//
+// event index file layout (host byte order):
+//   8 byte key, file size, number of events, position of each event
+//
+namespace
+{
+  const char IdxKey[8] = { 'D', 'L', 'A', 'R', 'I', 'D', 'X', '1' };
+}
+
+bool EventDecoder::ReadIndex(std::string idxname)
+{
+  ifstream fin( idxname.c_str(), ios::in | ios::binary );
+  if( !fin.is_open() ) return false;
+
+  char key[8];
+  uint64_t filesz = 0, nev = 0;
+  fin.read( key, sizeof(key) );
+  fin.read( (char*)&filesz, sizeof(filesz) );
+  fin.read( (char*)&nev, sizeof(nev) );
+  if( !fin || !std::equal( key, key + 8, IdxKey ) || 
+      filesz != m_filesz || nev != m_totev || nev == 0 ) 
+    return false;
+
+  std::vector<uint64_t> pos( nev );
+  fin.read( (char*)&pos[0], nev * sizeof(uint64_t) );
+  if( !fin ) return false;
+  
+  // the index must match the file: positions in order between the 
+  // run header and the footer, the last event ending at the footer
+  if( (streamoff)pos[0] != m_pstart ) return false;
+  for( size_t i=1;i<nev;i++ )
+    if( pos[i] <= pos[i-1] ) return false;
+  if( (streamoff)pos.back() + (streamoff)dlardaq::EveHeadSz > m_pend ) return false;
+
+  lock( m_data_mutex );
+  Seek( (streamoff)pos.back() );
+  ReadBytes( m_EveHeadBuf );
+  bool good = ( ((m_EveHeadBuf[0] & 0xFF) == EVSKEY) && ((m_EveHeadBuf[1] & 0xFF) == EVSKEY) );
+  if( good )
+    {
+      dlardaq::evheader_t eh;
+      decode_evehead( &m_EveHeadBuf[0], eh );
+      good = ( (streamoff)pos.back() + (streamoff)dlardaq::EveHeadSz + (streamoff)eh.ev_size == m_pend );
+    }
+  if( good )
+    {
+      m_events.assign( pos.begin(), pos.end() );
+      m_nextev = nev;
+    }
+  else 
+    {
+      // back to where the bookmarks say we are
+      Seek( m_events.empty() ? m_pstart : m_events.back() );
+      m_nextev = m_events.empty() ? 0 : m_events.size() - 1;
+    }
+  unlock( m_data_mutex );
+
+  return good;
+}
+
+bool EventDecoder::WriteIndex(std::string idxname)
+{
+  lock( m_data_mutex );
+  std::vector<uint64_t> pos( m_events.begin(), m_events.end() );
+  unlock( m_data_mutex );
+
+  uint64_t filesz = m_filesz;
+  uint64_t nev    = pos.size();
+
+  // write to a temporary file and rename it, so that concurrent jobs
+  // never read a partial index
+  std::string tmpname = idxname + ".tmp" + std::to_string( getpid() );
+  {
+    ofstream fout( tmpname.c_str(), ios::out | ios::binary | ios::trunc );
+    if( !fout.is_open() ) return false;
+    fout.write( IdxKey, sizeof(IdxKey) );
+    fout.write( (const char*)&filesz, sizeof(filesz) );
+    fout.write( (const char*)&nev, sizeof(nev) );
+    fout.write( (const char*)&pos[0], nev * sizeof(uint64_t) );
+    if( !fout ) 
+      {
+	fout.close();
+	std::remove( tmpname.c_str() );
+	return false;
+      }
+  }
+  if( std::rename( tmpname.c_str(), idxname.c_str() ) != 0 )
+    {
+      std::remove( tmpname.c_str() );
+      return false;
+    }
+  return true;
+}
+
 //
 // read a given number of bytes from file
 //
 void EventDecoder::ReadBytes( std::vector<BYTE> &bytes )
 {
+  if( m_map.IsOpen() )
+    {
+      size_t nb = m_map.Available( m_mappos, bytes.size() );
+      std::copy( m_map.Data() + m_mappos, m_map.Data() + m_mappos + nb, bytes.begin() );
+      m_mappos += nb;
+      return;
+    }
   m_file.read( &bytes[0], bytes.size() );
 }
 
+//
+// position in the file in either input mode
+//
+std::streampos EventDecoder::Tell()
+{
+  if( m_map.IsOpen() ) return std::streamoff( m_mappos );
+  return m_file.tellg();
+}
+
+void EventDecoder::Seek( std::streampos pos )
+{
+  if( m_map.IsOpen() ) m_mappos = std::streamoff( pos );
+  else m_file.seekg( pos );
+}
+
+void EventDecoder::Skip( size_t nb )
+{
+  if( m_map.IsOpen() ) m_mappos += nb;
+  else m_file.seekg( nb, std::ios::cur );
+}
+
 
 //
 //
@@ -164,7 +374,18 @@ void EventDecoder::ReadEvent( std::vector<adc16_t> &adc, bool headonly )
       size_t evsz = m_evh.ev_size;
 
       // move to next event
-      m_file.seekg(evsz, std::ios::cur);
+      Skip( evsz );
+      return;
+    }
+
+  if( m_map.IsOpen() ) // decode in place
+    {
+      size_t nb = m_map.Available( m_mappos, m_evh.ev_size );
+      const char *data = m_map.Data() + m_mappos;
+      m_mappos += nb;
+      Decode( data, nb, GETDCFLAG(m_evh.dq_flag), adc );
+      // the data have been copied into adc
+      m_map.Release( m_mappos );
       return;
     }
 
@@ -186,23 +407,36 @@ ssize_t EventDecoder::GetEvent(size_t evnum, dlardaq::evheader_t &eh,
 			       std::vector<adc16_t> &adc) 
 {
   adc.clear();
-  if(!m_file.is_open()) return -1;
+  if(!IsOpen()) return -1;
   //if(evnum >= m_totev)  return -1; //no-can-do
   lock(m_data_mutex);
 
+  if( Indexed() && evnum >= m_totev ) // no such event
+    {
+      unlock(m_data_mutex);
+      return -1;
+    }
+
   if(evnum < m_events.size())  // already know where it is
     {
-      m_file.seekg(m_events[evnum]);
+      Seek(m_events[evnum]);
       ReadEvent( adc );
       eh = m_evh;
     }
   else
     {
+      // continue from the end of the last bookmarked event
+      if( m_nextev != m_events.size() )
+	{
+	  Seek( m_events.back() );
+	  ReadEvent( adc, true );
+	}
+
       size_t curev = m_events.size();
       while( curev <= evnum )
 	{
 	  // our event begins at this position
-	  streampos pos = m_file.tellg();
+	  streampos pos = Tell();
 	  m_events.push_back( pos );
 	  
 	  // readonly header to get event data size
@@ -217,6 +451,7 @@ ssize_t EventDecoder::GetEvent(size_t evnum, dlardaq::evheader_t &eh,
       // last event is the one with want ...
       eh = m_evh;
     }
+  m_nextev = evnum + 1;
 
   unlock(m_data_mutex);
 
@@ -229,7 +464,7 @@ ssize_t EventDecoder::GetEvent(size_t evnum, dlardaq::evheader_t &eh,
 ssize_t EventDecoder::GetEvent( dlardaq::evheader_t &eh,
 				std::vector<adc16_t> &adc )
 {
-  if(m_file.is_open())
+  if(IsOpen())
     {
       // return first event
       return GetEvent( 0, eh, adc);
@@ -285,7 +520,7 @@ ssize_t EventDecoder::Decode( const char *buf, size_t nb, bool cflag,
 //
 void EventDecoder::ReadBuffer(const char *buf, size_t nb)
 {
-  if(m_file.is_open())
+  if(IsOpen())
     {
       msg_err<<"Cannot use this function while reading data from a file"<<endl;
       return;
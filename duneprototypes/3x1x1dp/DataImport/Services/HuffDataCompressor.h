@@ -8,8 +8,11 @@
 //
 //  The Huffman encoding scheme used here is the one developed by uBooNE
 //
-//  The basic idea is to handle binnary codes as strings --> maybe not 
-//  the most performant, but hopefully easier to understand ;-)
+//  The codes are defined as strings in SetEncoding and converted to
+//  bit patterns: compression packs them with a 64 bit bit-writer and
+//  decompression reads the stream with a 64 bit bit-reader, decoding
+//  each code with a single lookup in a table indexed by the next
+//  m_MaxCodeSize bits
 //
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
@@ -19,10 +22,10 @@
 
 #include <map>
 #include <vector>
-#include <deque>
-#include <bitset>
+#include <string>
 #include <fstream>
 #include <utility>
+#include <cstdint>
 
 #include "dlardaq.h"
 
@@ -98,45 +101,30 @@ namespace dlardaq
     // define encoding scheme
     void SetEncoding();
 
-    // structure to collect Huffman codes
-    struct HuffAccum_t
+    // code as bit pattern: the low len bits of bits, MSB first
+    struct HuffCode_t
     {
-      std::string codestr;  // binary code; leave empty for raw data
-      short value;            // value: diff / or raw adc
-      short nrep;           // number of repetitions of this code
-    };  
+      uint32_t bits;
+      short    len;    // 0 if there is no code
+      short    value;  // diff or m_NSeqRepVal
+    };
 
-    //
-    std::vector<HuffAccum_t> HuffBuffer;  // buffer for Huffman codes
+    // write the codes for a run of nrep+1 identical diffs
+    template <class Writer>
+    void WriteRun(Writer &packets, short delta, size_t nrep) const;
 
-    // add to buffer
-    void AddToHuffBuffer(short val, bool rawadc);
-    
-    
-    //
-    bool SetNbitsAdc( short nbadc );
+    // compress one sequence and append it to bin_out
+    void CompressSequence( const adc16_t *raw_in, size_t nsample,
+			   std::vector<BYTE> &bin_out ) const;
+
+    // decode nch channels of seqlen samples from a bit reader
+    template <class Reader>
+    void DecodeChannels(Reader &reader, size_t nch, size_t seqlen,
+			std::vector<adc16_t> &adc) const;
 
     //
-    void AddWordsToByteBuffer(std::string words, 
-			      std::vector<BYTE> &buf, 
-			      std::string &partbyte);
-    
-    //
-    void ReadNextByte( size_t &byteidx, const char *buf,
-		       std::deque< std::bitset<1> > &bits );
+    bool SetNbitsAdc( short nbadc );
 
-    // read next byte from file stream
-    void ReadNextByte( std::ifstream &fin, std::deque< std::bitset<1> > &bits, bool &status );
-    
-    
-    // get code from value
-    std::string GetCodeFromValue(short val); 
-    
-    // get value from code
-    //short GetValueFromCode(std::string code, bool &ok);
-    
-    std::string GetBinaryString(short val, size_t strsize);
-        
     //
     //
     std::map<short, std::string> m_CmMap;     // map to compresss
@@ -145,6 +133,10 @@ namespace dlardaq
     // map to decompress is in the sorted vector of codes
     std::vector< std::pair<std::string, short> >  m_UCmMap;    
 
+    std::vector<HuffCode_t> m_EncTable;       // codes for diffs -m_MaxDiff .. m_MaxDiff
+    HuffCode_t              m_RepCode;        // code for m_NSeqRep repetitions
+    std::vector<HuffCode_t> m_DecTable;       // code starting each m_MaxCodeSize bit pattern
+
     int    m_Verbosity;                       //
 
     short  m_MaxAdcBits;                      // max ADC bits
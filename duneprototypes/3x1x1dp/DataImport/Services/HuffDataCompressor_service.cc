@@ -8,15 +8,18 @@
 //
 //  The Huffman encoding scheme used here is the one developed by uBooNE
 //
-//  The basic idea is to handle binnary codes as strings --> maybe not 
-//  the most performant, but maybe easier to understand
+//  The codes are defined as strings in SetEncoding and converted to
+//  bit patterns: compression packs them with a 64 bit bit-writer and
+//  decompression reads the stream with a 64 bit bit-reader, decoding
+//  each code with a single lookup in a table indexed by the next
+//  m_MaxCodeSize bits
 //
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
 #include <iostream>
 #include <iomanip>
-#include <sstream>
 #include <cstdlib>
+#include <algorithm>
 
 #include "LogMsg.h"
 #include "HuffDataCompressor.h"
@@ -25,6 +28,171 @@
 using namespace std;
 using namespace dlardaq;
 
+namespace
+{
+  //
+  // append bits MSB first to a byte vector
+  //
+  class BitWriter
+  {
+  public:
+    BitWriter(std::vector<BYTE> &out) : m_Out(out), m_Acc(0), m_Nbits(0){;}
+
+    // write the low n bits of val, n <= 32
+    void Write(uint64_t val, unsigned n)
+    {
+      m_Acc    = (m_Acc << n) | (val & ((1ULL << n) - 1));
+      m_Nbits += n;
+      while(m_Nbits >= 8)
+	{
+	  m_Nbits -= 8;
+	  m_Out.push_back( (BYTE)(m_Acc >> m_Nbits) );
+	}
+    }
+
+    // pad with 0 to the next byte boundary
+    void Flush()
+    {
+      if(m_Nbits > 0)
+	m_Out.push_back( (BYTE)(m_Acc << (8 - m_Nbits)) );
+      m_Acc   = 0;
+      m_Nbits = 0;
+    }
+
+  private:
+    std::vector<BYTE> &m_Out;
+    uint64_t m_Acc;
+    unsigned m_Nbits;
+  };
+
+  //
+  // build packets of packetsize bits: a 0 header bit followed by a raw adc
+  // or a 1 header bit followed by Huffman codes. Codes that do not fit in
+  // a packet continue in the next one
+  //
+  class PacketWriter
+  {
+  public:
+    PacketWriter(BitWriter &bits, unsigned packetsize) : 
+      m_Bits(bits), m_Size(packetsize), m_Word(0), m_Len(0){;}
+
+    void AddCode(uint32_t code, unsigned len)
+    {
+      m_Word = (m_Word << len) | code;
+      m_Len += len;
+      while(m_Len >= m_Size)
+	{
+	  // write out one packet and carry the rest over to the next one
+	  unsigned rest = m_Len - m_Size;
+	  m_Bits.Write( m_Word >> rest, m_Size );
+	  m_Word = (1ULL << rest) | (m_Word & ((1ULL << rest) - 1));
+	  m_Len  = rest + 1;
+	}
+    }
+
+    void AddRaw(uint32_t adc)
+    {
+      // pad the pending compressed packet with 0s to the packet size
+      if(m_Len > 1)
+	m_Bits.Write( m_Word << (m_Size - m_Len), m_Size );
+      m_Bits.Write( adc, m_Size );
+      m_Word = 1;
+      m_Len  = 1;
+    }
+
+    // write whatever is left and pad to the byte boundary
+    void Finish()
+    {
+      if(m_Len > 1)
+	m_Bits.Write( m_Word, m_Len );
+      m_Word = 0;
+      m_Len  = 0;
+      m_Bits.Flush();
+    }
+
+  private:
+    BitWriter &m_Bits;
+    unsigned  m_Size;
+    uint64_t  m_Word;   // current packet including the header bit
+    unsigned  m_Len;
+  };
+
+  //
+  // byte sources for the bit reader
+  //
+  class BufferSource
+  {
+  public:
+    BufferSource(const char *buf, size_t size) : m_Buf(buf), m_Size(size), m_Idx(0){;}
+    int Next(){ return m_Idx < m_Size ? (unsigned char)m_Buf[m_Idx++] : -1; }
+    size_t Position() const { return m_Idx; }
+
+  private:
+    const char *m_Buf;
+    size_t m_Size;
+    size_t m_Idx;
+  };
+
+  class StreamSource
+  {
+  public:
+    StreamSource(std::ifstream &fin) : m_Fin(fin){;}
+    int Next()
+    {
+      char byteword;
+      if(!m_Fin.get(byteword)) return -1;
+      return (unsigned char)byteword;
+    }
+
+  private:
+    std::ifstream &m_Fin;
+  };
+
+  //
+  // read bits MSB first through a 64 bit cache
+  //
+  template <class Source>
+  class BitReader
+  {
+  public:
+    BitReader(Source &src) : m_Src(src), m_Cache(0), m_Ncache(0){;}
+
+    // make at least n <= 56 bits available if the source has them
+    // returns the number of bits available
+    unsigned Fill(unsigned n)
+    {
+      while(m_Ncache < n)
+	{
+	  int byte = m_Src.Next();
+	  if(byte < 0) break;
+	  m_Cache   = (m_Cache << 8) | (unsigned)byte;
+	  m_Ncache += 8;
+	}
+      return m_Ncache;
+    }
+
+    // n must be available
+    uint32_t Peek(unsigned n) const { return (m_Cache >> (m_Ncache - n)) & ((1ULL << n) - 1); }
+    uint32_t Take(unsigned n)
+    {
+      uint32_t val = Peek(n);
+      m_Ncache -= n;
+      return val;
+    }
+
+    // drop bits up to the next byte boundary
+    void Align(){ m_Ncache -= m_Ncache % 8; }
+
+    // bits read from the source but not taken yet
+    unsigned Cached() const { return m_Ncache; }
+
+  private:
+    Source  &m_Src;
+    uint64_t m_Cache;
+    unsigned m_Ncache;
+  };
+}
+
 //
 //
 //
@@ -126,6 +294,30 @@ void HuffDataCompressor::SetEncoding()
       string bincode = it->second;
       m_UCmMap[bincode.size()-1] = std::make_pair(bincode, deltaval);
     }
+
+  // bit patterns: one entry per diff to compress and one entry per 
+  // m_MaxCodeSize bit pattern to decompress, holding the code the 
+  // pattern starts with
+  HuffCode_t nocode = {0, 0, 0};
+  m_EncTable.assign(2*m_MaxDiff + 1, nocode);
+  m_DecTable.assign(1UL << m_MaxCodeSize, nocode);
+  m_RepCode = nocode;
+  for(it = m_CmMap.begin();it!=m_CmMap.end();it++)
+    {
+      HuffCode_t code;
+      code.bits  = strtoul(it->second.c_str(), 0, 2);
+      code.len   = it->second.size();
+      code.value = it->first;
+
+      if(m_SeqEnable && code.value == m_NSeqRepVal)
+	m_RepCode = code;
+      else
+	m_EncTable[code.value + m_MaxDiff] = code;
+
+      size_t nfree = m_MaxCodeSize - code.len;
+      for(size_t i=0;i<(1UL << nfree);i++)
+	m_DecTable[(code.bits << nfree) | i] = code;
+    }
 }
 
 //
@@ -158,140 +350,99 @@ void HuffDataCompressor::PrintEncoding()
 }
 
 
-
-
 //
 //
 //
-// access map to compress
-std::string HuffDataCompressor::GetCodeFromValue(short val)
+// set number of ADC bits
+bool HuffDataCompressor::SetNbitsAdc( short nbadc )
 {
-  string emptystr = "";
+  if( nbadc > m_MaxAdcBits ) return false;
   
-  if(std::abs(val) > m_MaxDiff && val != m_NSeqRepVal)
-    {
-      msg_err<<__FILE__<<", "<<__LINE__<<" the value '"<<val<<"' exceeds range"<<endl;
-      return emptystr;
-    }
-
-  std::map<short, std::string>::iterator it;
-  it = m_CmMap.find( val );
-  if(it != m_CmMap.end())
-    return it->second;
+  // this is max bits that can be occupied by data
+  m_NbitsHC    = nbadc;
   
-  //
-  msg_err<<__FILE__<<", "<<__LINE__<<" the value '"<<val<<"' could not be found"<<endl;
-  return emptystr;
+  // our basic packet size (should not exceed m_MaxAdcBits)
+  m_PacketSize = m_NbitsHC + m_NbitsHead;
+
+  return true;
 }
 
 
 //
-// Internal buffer to store raw adc / adc differences
 //
-// Add to huff buffer
-void HuffDataCompressor::AddToHuffBuffer(short val, bool rawadc)
+//
+// write the codes for a diff repeated nrep+1 times
+// the repetition code is used as long as it leaves at least one 
+// repetition to be written with the diff code itself
+template <class Writer>
+void HuffDataCompressor::WriteRun(Writer &packets, short delta, size_t nrep) const
 {
-  HuffAccum_t tmp;
-  tmp.value   = val;
-  tmp.nrep    = 0;
-  tmp.codestr = "";
-
-  if(!rawadc) 
-    tmp.codestr = GetCodeFromValue(val);
-  else
-    {
-      HuffBuffer.push_back( tmp );
-      return;
-    }
+  const HuffCode_t &code = m_EncTable[delta + m_MaxDiff];
+  packets.AddCode( code.bits, code.len );
   
-  // check if the last value was the same
-  if( HuffBuffer.back().value == tmp.value && 
-      !HuffBuffer.back().codestr.empty() )
+  while(nrep > 0)
     {
-      // just increment repetition counter
-      HuffBuffer.back().nrep += 1;
-    }
-  else
-    {
-      // add new entry
-      HuffBuffer.push_back( tmp );
+      if(m_SeqEnable && nrep > (size_t)m_NSeqRep)
+	{
+	  packets.AddCode( m_RepCode.bits, m_RepCode.len );
+	  nrep -= m_NSeqRep;
+	}
+      else
+	{
+	  packets.AddCode( code.bits, code.len );
+	  nrep--;
+	}
     }
 }
 
-//
-//
-//
-// get binary string
-std::string HuffDataCompressor::GetBinaryString(short val, size_t strsize)
-{
-  std::string s = bitset<16> ( val ).to_string();
-
-  if(strsize < 16)
-    return s.substr(s.size() - strsize); //crop to required size
-    
-  // ok we have a long string. Why?
-  msg_warn<<__FILE__<<", "<<__LINE__<<" the string looks too long"<<endl;
-  while(s.size() < strsize) s = "0" + s; //pad 0 to front
-  return s;
-}
 
 //
 //
 //
-// set number of ADC bits
-bool HuffDataCompressor::SetNbitsAdc( short nbadc )
+// compress one sequence and append it to bin_out
+void HuffDataCompressor::CompressSequence( const adc16_t *raw_in, size_t nsample,
+					   std::vector<BYTE> &bin_out ) const
 {
-  if( nbadc > m_MaxAdcBits ) return false;
-  
-  // this is max bits that can be occupied by data
-  m_NbitsHC    = nbadc;
-  
-  // our basic packet size (should not exceed m_MaxAdcBits)
-  m_PacketSize = m_NbitsHC + m_NbitsHead;
+  if(nsample == 0) return;
 
-  return true;
-}
+  BitWriter bits( bin_out );
+  PacketWriter packets( bits, m_PacketSize );
+  const uint32_t adcmask = (1U << m_NbitsHC) - 1;
 
-//
-//
-//
-// add words to byte buffer keeping track of the remainder
-// partbyte ("partial byte") contains the remainder string
-void HuffDataCompressor::AddWordsToByteBuffer(std::string words, 
-					      std::vector<BYTE> &buf, 
-					      std::string &partbyte)
-{
-  if( words.empty() && partbyte.empty() ) return;
+  // runs of identical differences
+  bool   inrun    = false;
+  short  rundelta = 0;
+  size_t nrep     = 0;
 
-  // nothing to add yet
-  if( words.size() < m_NbitsByte && partbyte.empty() )
+  for(size_t i=0;i<nsample;i++)
     {
-      partbyte = words;
-      return;
-    }
-  
-  // just pad with 0 and finish
-  if(words.empty() && !partbyte.empty())
-    {
-      // pad partial byte until we get to a full byte
-      while(partbyte.size() < m_NbitsByte) partbyte += "0";
-      buf.push_back( (strtoul(partbyte.c_str(), 0, 2) & 0xff) );
-      partbyte.clear();
-      return;
-    }
-  
-  for(size_t i=0;i<words.size();i++)
-    {
-      if(partbyte.size() == m_NbitsByte)
+      short delta;
+      if(i==0) delta = m_MaxDiff + 1;
+      else delta = raw_in[i] - raw_in[i-1];
+
+      if(std::abs(delta) > m_MaxDiff)  // store uncompressed raw data
 	{
-	  buf.push_back( (strtoul(partbyte.c_str(), 0, 2) & 0xff) );
-	  partbyte.clear();
+	  if(inrun) WriteRun( packets, rundelta, nrep );
+	  inrun = false;
+	  packets.AddRaw( raw_in[i] & adcmask );
+	}
+      else if(inrun && delta == rundelta)
+	{
+	  nrep++;
+	}
+      else
+	{
+	  if(inrun) WriteRun( packets, rundelta, nrep );
+	  inrun    = true;
+	  rundelta = delta;
+	  nrep     = 0;
 	}
-      
-      partbyte += words[i];
     }
-}
+  if(inrun) WriteRun( packets, rundelta, nrep );
 
+  // write what is left padded with 0s to the next byte boundary
+  packets.Finish();
+}
 
 
 //
@@ -308,123 +459,7 @@ void HuffDataCompressor::CompressChData( short nbadc, std::vector<adc16_t> &raw_
       return;
     }
   
-  
-  HuffBuffer.clear();
-  
-  // calculate differences and fill our HC buffer
-  short delta;
-  for(size_t i=0;i<raw_in.size();i++)
-    {
-      if(i==0) delta = m_MaxDiff + 1;
-      else delta = raw_in[i] - raw_in[i-1];
-      
-      if(std::abs(delta) > m_MaxDiff)  // store uncompressed raw data
-	AddToHuffBuffer( (short)raw_in[i], true );
-      else
-	AddToHuffBuffer( delta, false );
-    }
-  
-  
-  // not defined unless SeqEnable is set
-  string bitrepcode = "";
-  if(m_SeqEnable) 
-    {
-      bitrepcode = GetCodeFromValue( m_NSeqRepVal ); //NSeqRep );
-      if(bitrepcode.empty())
-	{
-	  msg_err<<__FILE__<<", "<<__LINE__
-		 <<" encoding repetion failed. Aborting ..."<<endl;
-	  return;
-	}
-    }  
-  
-  // now compress stream
-  short nhcrep;  //repetition 
-  string bitword, bitcode, partbyte;
-  bitword  = "";
-  partbyte = ""; // string to hold ramainder of byte
-
-  for(size_t i=0;i<HuffBuffer.size();i++)
-    {
-      
-      //cout<<i
-      //<<" "<<HuffBuffer[i].value
-      //<<" "<<HuffBuffer[i].nrep;
-      //if( !HuffBuffer[i].codestr.empty() ) cout<<" "<<HuffBuffer[i].codestr<<endl;
-      //else cout<<" rawadc "<<endl;
-	
-      if(HuffBuffer[i].codestr.empty()) //raw adc
-	{
-	  // write out whatever we have in the buffer
-	  if(bitword.size() > m_NbitsHead) // more than just a header
-	    {
-	      // pad with zero's to buffer length
-	      while(bitword.size() < m_PacketSize) bitword += "0"; 
-	      AddWordsToByteBuffer( bitword, bin_out, partbyte );
-	    }
-	  
-	  // uncompressed data
-	  bitword = "0" + GetBinaryString( HuffBuffer[i].value, m_NbitsHC );
-	  
-	  //
-	  AddWordsToByteBuffer( bitword, bin_out, partbyte );
-	  bitword = "1";
-	  continue;
-	}
-
-      // compress data
-      bitcode  = HuffBuffer[i].codestr;
-      nhcrep   = HuffBuffer[i].nrep;
-
-      for(short jj=0;jj<=nhcrep;jj++)
-	{
-	  //
-	  if(jj==0)
-	    bitword += bitcode;
-	  else if(jj+m_NSeqRep <= nhcrep && m_SeqEnable)
-	    {
-	      bitword += bitrepcode;
-	      jj += (m_NSeqRep-1);
-	    }
-	  else
-	    bitword += bitcode;
-	  
-	  
-	  // attempt to write to compresssed stream
-	  if(bitword.size() >= m_PacketSize) // check the size
-	    {
-	      if(bitword.size() == m_PacketSize) //write it out
-		{
-		  AddWordsToByteBuffer( bitword, bin_out, partbyte );
-		  bitword = "1"; //next iteration of compression
-		}
-	      else
-		{
-		  // too large for one packet 
-		  string towrite = bitword.substr(0, m_PacketSize);
-		  string tosave  = bitword.substr(m_PacketSize);
-		  
-		  // write out
-		  AddWordsToByteBuffer( towrite, bin_out, partbyte );
-		  
-		  // carry over for next iteration
-		  bitword = "1" + tosave; 
-		}
-	    }
-	} // end for
-
-    } // end i-loop
-  
-  //cout<<"Last bitword and partial byte"<<bitword<<" "<<partbyte<<endl;
-  
-  // write whatever is left
-  if(bitword.size() > m_NbitsHead) // more than just a header
-    AddWordsToByteBuffer( bitword, bin_out, partbyte );
-  
-  //cout<<"Last partial byte word "<<partbyte<<endl;
-  
-  // write out remaning byte padded with 0s to next byte boundary
-  AddWordsToByteBuffer( "", bin_out, partbyte );
+  CompressSequence( raw_in.data(), raw_in.size(), bin_out );
 }
 
 
@@ -450,12 +485,7 @@ void HuffDataCompressor::CompressEventData( short nbadc, size_t nch, size_t seql
     }
   
   for(size_t i=0;i<nch;i++)
-    {
-      size_t istart = i*seqlen;
-      // get ch data
-      std::vector<adc16_t> chdata(&raw_in[istart], &raw_in[istart+seqlen]);
-      CompressChData( nbadc, chdata, bin_out );
-    }
+    CompressSequence( &raw_in[i*seqlen], seqlen, bin_out );
 }
 
 
@@ -488,7 +518,7 @@ void HuffDataCompressor::CompressEventData( short nbadc, size_t nch, size_t seql
 	  return;
 	}
 
-      CompressChData( nbadc, raw_in[i], bin_out );
+      CompressSequence( raw_in[i].data(), seqlen, bin_out );
     }
 }
 
@@ -496,41 +526,162 @@ void HuffDataCompressor::CompressEventData( short nbadc, size_t nch, size_t seql
 //
 //
 //
-// decode individual bits from a byte
-void HuffDataCompressor::ReadNextByte(size_t &byteidx, const char *buf,
-				      std::deque<bitset<1> > &bits)
+// decode nch sequences of seqlen samples
+// each sequence starts on a byte boundary with an uncompressed packet.
+// A code can be split between two compressed packets, so the bits of 
+// an incomplete code are kept until the next packet
+template <class Reader>
+void HuffDataCompressor::DecodeChannels( Reader &reader, size_t nch, size_t seqlen,
+					 std::vector<adc16_t> &adc ) const
 {
-  unsigned short bitmask = 1 << (m_NbitsByte - 1);
+  const unsigned nbhc    = m_NbitsHC;
+  const unsigned maxcode = m_MaxCodeSize;
+  const uint32_t lookmask = (1U << maxcode) - 1;
   
-  // decode individual bits
-  for(size_t i=0;i<m_NbitsByte;i++)
-    bits.push_back( bitset<1>( (buf[byteidx] & (bitmask >> i)) != 0) );
+  short lastdelta = -999;
   
-  byteidx++;
-}
+  adc.resize( nch*seqlen );
+  for(size_t ch=0;ch<nch;ch++)
+    {
+      adc16_t *chdata  = adc.data() + ch*seqlen;
+      size_t   nsample = 0;
+      size_t   bitsread = 0;
 
+      uint64_t pending  = 0;      // bits of an incomplete code
+      unsigned npending = 0;
+      bool     nocode   = false;  // bits do not start with a code
 
-//
-//
-//
-// decode individual bits from a byte
-void HuffDataCompressor::ReadNextByte(std::ifstream &fin, std::deque< std::bitset<1> > &bits, 
-				      bool &status)
-{
-  status = true;
-  char byteword;
-  
-  if(!fin.get(byteword))
+      while( nsample < seqlen )
+	{
+	  if(reader.Fill( m_PacketSize ) == 0)
+	    {
+	      msg_err<<"There seems to be a problem with decoding"<<endl
+		     <<"Samples accumulated in this channel "<<nsample<<endl;
+	      adc.resize( ch*seqlen );
+	      return;
+	    }
+	  
+	  bool iscomp = reader.Take(1);
+	  bitsread++;
+
+	  if(!iscomp) // uncompressed
+	    {
+	      if( reader.Cached() < nbhc )
+		{
+		  msg_err<<"Fatal decoding error has been encountered : "<<endl
+			 <<" Number of bits in the uncompressed stream should be at least "
+			 <<m_NbitsHC<<" the current value is "<<reader.Cached()<<endl;
+		  abort();
+		}
+	      chdata[nsample++] = reader.Take( nbhc ) & 0x7FFF;
+	      bitsread += nbhc;
+	      
+	      // clear our code (could carry over from compressed)
+	      pending  = 0;
+	      npending = 0;
+	      nocode   = false;
+	      continue;
+	    }
+
+	  // handle compressed bits
+	  unsigned nbits = std::min( nbhc, reader.Cached() );
+	  if(nocode)
+	    {
+	      reader.Take( nbits );
+	      bitsread += nbits;
+	      continue;
+	    }
+	  
+	  uint64_t bits  = (pending << nbits) | reader.Peek( nbits );
+	  unsigned nb    = npending + nbits;
+	  unsigned used  = 0;
+	  while( used < nb && nsample < seqlen )
+	    {
+	      unsigned left = nb - used;
+	      uint32_t look = (left >= maxcode) ? (bits >> (left - maxcode)) : (bits << (maxcode - left));
+	      const HuffCode_t &code = m_DecTable[look & lookmask];
+	      if(code.len == 0 || (unsigned)code.len > left)
+		{
+		  // no code can start with maxcode bits that do not match one
+		  if(left >= maxcode) nocode = true;
+		  break;
+		}
+	      used += code.len;
+	      
+	      if( nsample == 0 )
+		{
+		  msg_err<<"Fatal decoding error has been encountered : "<<endl
+			 <<" The sequence does not start with an uncompressed value"<<endl;
+		  abort();
+		}
+	      
+	      // add to our adc vector
+	      if( std::abs(code.value) <= m_MaxDiff )
+		{
+		  chdata[nsample] = chdata[nsample-1] + code.value;
+		  nsample++;
+		  lastdelta = code.value;
+		}
+	      else if( code.value == m_NSeqRepVal )
+		{
+		  if( nsample + m_NSeqRep > seqlen )
+		    {
+		      msg_err<<"Fatal decoding error has been encountered : "<<endl
+			     <<" Repeated values run past the end of the sequence"<<endl;
+		      abort();
+		    }
+		  for(short j=0;j<m_NSeqRep;j++)
+		    {
+		      chdata[nsample] = chdata[nsample-1] + lastdelta; //add same value
+		      nsample++;
+		    }
+		}
+	    }
+
+	  if( nsample == seqlen )
+	    {
+	      // the sequence ends with this code: the rest is padding
+	      reader.Take( used - npending );
+	      bitsread += used - npending;
+	    }
+	  else
+	    {
+	      reader.Take( nbits );
+	      bitsread += nbits;
+	      npending = nocode ? 0 : nb - used;
+	      pending  = bits & ((1ULL << npending) - 1);
+	    }
+	} // end while nsample
+      
+      // remove padded bits to the byte boundary
+      size_t padbits = reader.Cached() % m_NbitsByte;
+      reader.Align();
+      
+      if(m_Verbosity > 1)
+	{
+	  msg_info<<"Bits read  : "<<bitsread<<endl
+		  <<"Bits to boundary : "<<padbits<<endl
+		  <<"Last value : "<<chdata[seqlen-1]<<" ADC "<<endl;
+	}
+      
+      // some basic check
+      if( ch+1 < nch && reader.Fill(1) > 0 && reader.Peek(1) )
+	{
+	  msg_err<<"Fatal decoding error had been encounter : "<<endl
+		 <<"The first bit of the next ch sequence should always be 0 and not 1"<<endl;
+	  abort();
+	}
+      
+      if(m_Verbosity > 1)
+	msg_info<<"Decoded "<<(ch+1)*seqlen<<" samples"<<endl<<endl;
+    } // end ch loop
+
+  if(m_Verbosity > 0)
     {
-      status = false;
-      return;
+      if(m_Verbosity > 1) 	      
+	msg_info<<"Bits remaning in the queue "<<reader.Cached()<<endl;
+      msg_info<<"DECOMPRESSED EVENT STATUS: OK "<<endl;
     }
-
-  unsigned short bitmask = 1 << (m_NbitsByte - 1);
-  
-  // decode individual bits
-  for(size_t i=0;i<m_NbitsByte;i++)
-    bits.push_back( bitset<1>( (byteword & (bitmask >> i)) != 0) );
 }
 
 
@@ -552,192 +703,12 @@ void HuffDataCompressor::DecompressEventData( short nbadc,
     }
   adc.clear();
 
-  vector< adc16_t > chdata;
-  deque< bitset<1> > bitqueue;
-
-  stringstream ss;
-  short lastdelta  = -999;
-  size_t bitsread  = 0;
-  int noread       = 0;
+  BufferSource src( buf, bufsize );
+  BitReader<BufferSource> reader( src );
+  DecodeChannels( reader, nch, seqlen, adc );
 
-  size_t chread  = 0;
-
-  byteidx   = 0;
-  // basic idea is to read bits one byte at a time from the input buffer
-  // the first entry in the bitqueue deck should always be aligned on the 
-  // compressed / raw flag and the deck should contain at least m_PacketSize bits
-  while( adc.size() != nch*seqlen )
-    {
-      if(byteidx<bufsize) ReadNextByte(byteidx, buf, bitqueue);
-      else noread++;
-      
-      if(noread > 1) //loopcounter == 1, we process last bits but not read new byte
-	{
-	  msg_err<<"There seems to be a problem with decoding"<<endl
-		 <<"Bytes read "<<byteidx<<" out of "<<bufsize<<endl
-		 <<"Samples accumulated in this channel "<<chdata.size()<<endl
-		 <<"Remaining bits are "<<bitqueue.size()<<" "<<bitqueue.empty()<<endl;
-	  break;
-	}
-      
-      //read more bytes if possible
-      if( bitqueue.size() < m_PacketSize && byteidx != bufsize) 
-	continue;
-
-      bool iscomp = bitqueue.front().test(0);
-      bitsread++;
-      bitqueue.pop_front(); // compressed / raw flag      
-
-      if(!iscomp) // uncompressed
-	{
-	  ss.str(""); //clear our code string (could carry over from compressed)
-	  
-	  if( bitqueue.size() < m_NbitsHC ) 
-	    {
-	      msg_err<<"Fatal decoding error has been encountered : "<<endl
-		     <<" Number of bits in the uncompressed stream should be at least "
-		     <<m_NbitsHC<<" the current value is "<<bitqueue.size()<<endl;
-	      abort();
-	    }
-	  
-	  size_t bitcounter = 0;
-	  while(bitcounter < m_NbitsHC) 
-	    {
-	      ss << bitqueue.front();
-	      bitqueue.pop_front();
-	      bitcounter++;
-	    }
-	  bitsread += bitcounter;
-
-	  adc16_t val = ( strtoul(ss.str().c_str(), 0, 2) & 0x7FFF );
-	  chdata.push_back( val );
-	  ss.str("");
-	}
-      else // handle compressed bits
-	{
-	  size_t bitcounter = 0;
-	  size_t bitstoread = m_NbitsHC;
-	  if( bitqueue.size() < m_NbitsHC ) 
-	    bitstoread = bitqueue.size();
-	  
-	  while( bitcounter < bitstoread )
-	    {	      
-	      ss << bitqueue.front();
-	      bitqueue.pop_front();
-	      bitcounter++;
-	      bitsread++;
-	      // check if we have a good code
-	      size_t strsize = ss.str().size();
-	      if( strsize >= m_MinCodeSize && strsize <= m_MaxCodeSize ) 
-		{
-		  bool ok = (m_UCmMap[strsize-1].first == ss.str());
-		  if(!ok) continue; //not a good code
-		  short val = m_UCmMap[strsize-1].second;
-		  
-		  ss.str(""); //reset string code
-
-		  
-		  // add to our adc vector
-		  if( std::abs(val) <= m_MaxDiff)
-		    {
-		      adc16_t newval = chdata.back() + val;
-		      chdata.push_back( newval );
-		      lastdelta = val;
-		    }
-		  else if(val == m_NSeqRepVal)
-		    {
-		      for(short j=0;j<m_NSeqRep;j++)
-			{
-			  adc16_t newval = chdata.back() + lastdelta; //add same value
-			  chdata.push_back( newval );
-			}
-		    }		
-		}// end of if
-	      
-	      // we got the whole sequence now
-	      if(chdata.size() == seqlen) break;
-
-	    } // end while bitcounter
-	} // end else 
-      
-      // check if we finished decoding data for a given channel
-      if(chdata.size() == seqlen)
-	{
-	  
-	  // calculate number of padded bits to the byte boundary
-	  size_t padbits = bitsread % m_NbitsByte;
-	  if(padbits > 0) padbits = m_NbitsByte - padbits;
-	  
-	  if(m_Verbosity > 1)
-	    {
-	      msg_info<<"Bytes read : "<<byteidx<<endl
-		      <<"Bits read  : "<<bitsread<<endl
-		      <<"Bits to boundary : "<<padbits<<endl
-		      <<"Last value : "<<chdata.back()<<" ADC "<<endl;
-	    }
-	  
-	  // error checking
-	  if( bitqueue.size() < padbits )
-	    {
-	      msg_err<<"Fatal decoding error has been encountered : "<<endl
-		     <<"Byte boundary does not appear to be valid"<<endl
-		     <<"Check that the codes are padded with 0 to the next byte boundary"<<endl;
-	      abort();
-	    }
-	  
-	  // remove padded bits
-	  while(padbits > 0)
-	    {
-	      bitqueue.pop_front();
-	      padbits--;
-	    }
-	  
-	  // some basic check
-	  if(!bitqueue.empty())
-	    {
-	      if(bitqueue.front().test(0) && chread <= (nch-1) )
-		{
-		  msg_err<<"Fatal decoding error had been encounter : "<<endl
-			 <<"The first bit of the next ch sequence should always be 0 and not "
-			 <<bitqueue.front()<<endl;
-		  abort();
-		}
-	    }
-
-	  // reset the bitsread counter
-	  bitsread = 0;
-	  
-	  // save channel data
-	  adc.insert(adc.end(), chdata.begin(), chdata.end() );
-	  chread++;
-	  chdata.clear();
-	  
-	  if(m_Verbosity > 1)
-	    cout<<"Decoded "<<adc.size()<<" samples"<<endl<<endl;
-	}
-      
-      // basic consistency check
-      if(chread == nch)
-	{
-	  // let's see if we grabbed more bytes than needed
-	  if(bitqueue.size() > 0) // should be no more than 8
-	    {
-	      msg_info<<"Bits remaning in the queue "<<bitqueue.size()<<endl;
-	      byteidx--;
-	    }
-	  
-	  
-	  if(m_Verbosity > 0)
-	    {
-	      if(m_Verbosity > 1) 	      
-		msg_info<<"Bits remaning in the queue "<<bitqueue.size()<<endl;
-	      msg_info<<"DECOMPRESSED EVENT STATUS: OK "<<endl;
-	    }
-
-	  // ok we are done
-	  break;
-	}
-    } // end while loop
+  // bytes read ahead but not decoded are not counted
+  byteidx = src.Position() - reader.Cached() / m_NbitsByte;
 }
 
 //
@@ -760,194 +731,15 @@ void HuffDataCompressor::DecompressEventData( std::ifstream &fin,
     }
   adc.clear();
   
-  vector< adc16_t > chdata;
-  deque< bitset<1> > bitqueue;
+  StreamSource src( fin );
+  BitReader<StreamSource> reader( src );
+  DecodeChannels( reader, nch, seqlen, adc );
 
-  stringstream ss;
-  short lastdelta  = -999;
-  size_t byteidx   = 0;
-  size_t bitsread  = 0;
-
-  int noread = 0;  
-  bool flag;
-  
-  size_t chread  = 0;
-  
-  // basic idea is to read bits one byte at a time from the input buffer
-  // the first entry in the bitqueue deck should always be aligned on the 
-  // compressed / raw flag and the deck should contain at least m_PacketSize bits
-  while( adc.size() != nch*seqlen )
+  // leave the file at the end of the event data
+  size_t nback = reader.Cached() / m_NbitsByte;
+  if(nback > 0)
     {
-      ReadNextByte(fin, bitqueue, flag);
-      if(!flag) noread++;
-      
-      if(noread > 1) //noread == 1, we process last bits but not read new byte
-	{
-	  msg_err<<"There seems to be a problem with decoding"<<endl
-		 <<"Samples accumulated in this channel "<<chdata.size()<<endl
-		 <<"Remaining bits are "<<bitqueue.size()<<" "<<bitqueue.empty()<<endl;
-	  break;
-	}
-      
-      //read more bytes if possible
-      if( bitqueue.size() < m_PacketSize && noread < 1) 
-	continue;
-
-      bool iscomp = bitqueue.front().test(0);
-      bitsread++;
-      bitqueue.pop_front(); // compressed / raw flag      
-
-      if(!iscomp) // uncompressed
-	{
-	  ss.str(""); //clear our code string (could carry over from compressed)
-	  
-	  if( bitqueue.size() < m_NbitsHC ) 
-	    {
-	      msg_err<<"Fatal decoding error has been encountered : "<<endl
-		     <<"Number of bits in the uncompressed stream should be at least "
-		     <<m_NbitsHC<<" the current value is "<<bitqueue.size()<<endl;
-	      abort();
-	    }
-	  
-	  size_t bitcounter = 0;
-	  while(bitcounter < m_NbitsHC) 
-	    {
-	      ss << bitqueue.front();
-	      bitqueue.pop_front();
-	      bitcounter++;
-	    }
-	  bitsread += bitcounter;
-
-	  adc16_t val = ( strtoul(ss.str().c_str(), 0, 2) & 0x7FFF );
-	  chdata.push_back( val );
-	  ss.str("");
-	}
-      else // handle compressed bits
-	{
-	  size_t bitcounter = 0;
-	  size_t bitstoread = m_NbitsHC;
-	  if( bitqueue.size() < m_NbitsHC ) 
-	    bitstoread = bitqueue.size();
-	  
-	  while( bitcounter < bitstoread )
-	    {	      
-	      ss << bitqueue.front();
-	      bitqueue.pop_front();
-	      bitcounter++;
-	      bitsread++;
-	      // check if we have a good code
-	      size_t strsize = ss.str().size();
-	      if( strsize >= m_MinCodeSize && strsize <= m_MaxCodeSize ) 
-		{
-		  bool ok = (m_UCmMap[strsize-1].first == ss.str());
-		  if(!ok) continue; //not a good code
-		  short val = m_UCmMap[strsize-1].second;
-		  
-		  // otherwise reset the code
-		  ss.str(""); //reset string code
-		  
-		  // add to our adc vector
-		  if( std::abs(val) <= m_MaxDiff)
-		    {
-		      adc16_t newval = chdata.back() + val;
-		      chdata.push_back( newval );
-		      lastdelta = val;
-		    }
-		  else if(val == m_NSeqRepVal)
-		    {
-		      for(short j=0;j<m_NSeqRep;j++)
-			{
-			  adc16_t newval = chdata.back() + lastdelta; //add same value
-			  chdata.push_back( newval );
-			}
-		    }		
-		}// end of if
-	      
-	      // we got the whole sequence now
-	      if(chdata.size() == seqlen) break;
-
-	    } // end while bitcounter
-	} // end else 
-      
-      // check if we finished decoding data for a given channel
-      if(chdata.size() == seqlen)
-	{
-	  
-	  // calculate number of padded bits to the byte boundary
-	  size_t padbits = bitsread % m_NbitsByte;
-	  if(padbits > 0) padbits = m_NbitsByte - padbits;
-	  
-	  if(m_Verbosity > 1)
-	    {
-	      msg_info<<"Bytes read : "<<byteidx<<endl
-		      <<"Bits read  : "<<bitsread<<endl
-		      <<"Bits to boundary : "<<padbits<<endl
-		      <<"Last value : "<<chdata.back()<<" ADC "<<endl;
-	    }
-	  
-	  // error checking
-	  if( bitqueue.size() < padbits )
-	    {
-	      msg_err<<"Fatal decoding error has been encountered : "<<endl
-		     <<" Byte boundary does not appear to be valid"<<endl
-		     <<" Check that the codes are padded with 0 to the next byte boundary"<<endl;
-	      abort();
-	    }
-	  
-	  // remove padded bits
-	  while(padbits > 0)
-	    {
-	      bitqueue.pop_front();
-	      padbits--;
-	    }
-	  
-	  // some basic check
-	  if(!bitqueue.empty())
-	    {
-	      if(bitqueue.front().test(0) && chread <= (nch-1) )
-		{
-		  msg_err<<"Fatal decoding error had been encounter : "<<endl
-			 <<" The first bit of the next ch sequence should always be 0 and not "
-			 <<bitqueue.front()<<endl;
-		  abort();
-		}
-	    }
-
-	  // reset the bitsread counter
-	  bitsread = 0;
-	  
-	  // save channel data
-	  adc.insert(adc.end(), chdata.begin(), chdata.end() );
-	  chread++;
-	  chdata.clear();
-	  
-	  if(m_Verbosity > 1)
-	    msg_info<<"Decoded "<<adc.size()<<" samples"<<endl<<endl;
-	}
-      
-      // basic consistency check
-      if(chread == nch)
-	{
-	  // let's see if we grabbed more bytes than needed
-	  if(bitqueue.size() > 0) // should be no more than 8
-	    {
-	      msg_info<<"Bits remaning in the queue "<<bitqueue.size()<<endl;
-	      msg_info<<"Current position in file "<<fin.tellg();
-	      fin.seekg( -1, std::ios::cur );
-	      msg_info<<" Prv position in the file "<<fin.tellg()<<endl;
-	    }
-	  
-	  
-	  if(m_Verbosity > 0)
-	    {
-	      if(m_Verbosity > 1) 	      
-		msg_info<<"Bits remaning in the queue "<<bitqueue.size()<<endl;
-	      msg_info<<"DECOMPRESSED EVENT STATUS: OK "<<endl;
-	    }
-
-	  // ok we are done
-	  break;
-	}
-      
-    } // end while 
+      fin.clear();
+      fin.seekg( -(std::streamoff)nback, std::ios::cur );
+    }
 }
@@ -65,6 +65,10 @@ class RawData311InputDriver
 
     std::vector< std::pair<double, double> > fPedMap;
     std::string 		fPedestalFile;
+    bool 			fUseMmap;
+    bool 			fUseIndex;
+    std::vector<unsigned> 	fSelectEvents;   // events to read from each file, all if empty
+    std::vector<uint16_t> 	fEventList;      // events to read from the current file
 
     void process_Event311(std::vector<raw::RawDigit>& digitList,
 			     dlardaq::evheader_t &event_head,
@@ -23,6 +23,7 @@
 
 #include <iostream>
 #include <ios>
+#include <algorithm>
 
 // ---------------------------------------------------------------------------------------
 // 311 DAQ interface
@@ -161,6 +162,9 @@ namespace lris
     DataDecode(nchannels, nsamples)
   {
     fPedestalFile = p.get<std::string>("PedestalFile");
+    fUseMmap = p.get<bool>("UseMmap", false);
+    fUseIndex = p.get<bool>("UseIndex", false);
+    fSelectEvents = p.get<std::vector<unsigned>>("SelectEvents", std::vector<unsigned>());
     helper.reconstitutes<std::vector<raw::RawDigit>, art::InEvent>("daq");
   }
 
@@ -169,7 +173,7 @@ namespace lris
   void RawData311InputDriver::closeCurrentFile()
   {
     mf::LogInfo(__FUNCTION__)<<"File boundary: processed " <<fEventCounter <<" events out of " <<fNEvents <<"\n";
-    DataDecode.m_file.close();
+    DataDecode.Close();
   }
 
 
@@ -191,31 +195,47 @@ namespace lris
     //uint32_t nsamples = 1667;
     //DataDecode(nchannels, nsamples);
 
-    DataDecode.m_file.open(name.c_str(), std::ios_base::in | std::ios_base::binary);
-    if( !DataDecode.m_file.is_open() )
+    if(fUseMmap || fUseIndex)
     {
-      throw art::Exception( art::errors::FileReadError )
-	<< "failed to open input file " << name << "\n";
+      // The decoder opens the file and reads the header and footer itself.
+      // It falls back to ifstream if the file cannot be mapped, and builds
+      // the event index if there is no valid one next to the file.
+      if( DataDecode.Open(name, fUseMmap, fUseIndex) < 0 )
+      {
+	throw art::Exception( art::errors::FileReadError )
+	  << "failed to open input file " << name << "\n";
+      }
+      file_head = DataDecode.GetRunHeader();
+      file_foot = DataDecode.GetFileFooter();
     }
+    else
+    {
+      DataDecode.m_file.open(name.c_str(), std::ios_base::in | std::ios_base::binary);
+      if( !DataDecode.m_file.is_open() )
+      {
+	throw art::Exception( art::errors::FileReadError )
+	  << "failed to open input file " << name << "\n";
+      }
 
-    // Read in the file header.
-    std::vector<dlardaq::BYTE> head_buf;
-    head_buf.resize(dlardaq::RunHeadSz);
+      // Read in the file header.
+      std::vector<dlardaq::BYTE> head_buf;
+      head_buf.resize(dlardaq::RunHeadSz);
 
-    DataDecode.m_file.read(&head_buf[0], head_buf.size());
-    dlardaq::decode_runhead(&head_buf[0], file_head);
+      DataDecode.m_file.read(&head_buf[0], head_buf.size());
+      dlardaq::decode_runhead(&head_buf[0], file_head);
 
-    // Define start of event data.
-    std::streampos data_start = DataDecode.m_file.tellg();
+      // Define start of event data.
+      std::streampos data_start = DataDecode.m_file.tellg();
 
-    // Read in the file footer.
-    std::vector<dlardaq::BYTE> foot_buf;
-    foot_buf.resize(dlardaq::FileFootSz);
+      // Read in the file footer.
+      std::vector<dlardaq::BYTE> foot_buf;
+      foot_buf.resize(dlardaq::FileFootSz);
 
-    DataDecode.m_file.seekg(-dlardaq::FileFootSz, DataDecode.m_file.end);
-    DataDecode.m_file.read(&foot_buf[0], foot_buf.size());
-    dlardaq::decode_filefoot(&foot_buf[0], file_foot);
-    DataDecode.m_file.seekg(data_start);
+      DataDecode.m_file.seekg(-dlardaq::FileFootSz, DataDecode.m_file.end);
+      DataDecode.m_file.read(&foot_buf[0], foot_buf.size());
+      dlardaq::decode_filefoot(&foot_buf[0], file_foot);
+      DataDecode.m_file.seekg(data_start);
+    }
 
     fNEvents = file_foot.num_events;
     if(fNEvents > 0 && fNEvents < 1000) //There should be 335 events at most in one file.
@@ -226,6 +246,16 @@ namespace lris
       throw art::Exception( art::errors::FileReadError )
 	<<"File " <<name <<" seems to have too many events: " <<fNEvents <<"\n";
     }
+
+    // Events to read: all of them or the selected ones in this file.
+    fEventCounter = 0;
+    fEventList.clear();
+    for(unsigned evt = 0; evt < fNEvents; evt++)
+    {
+      if( fSelectEvents.empty() ||
+	  std::find(fSelectEvents.begin(), fSelectEvents.end(), evt) != fSelectEvents.end() )
+	fEventList.push_back(evt);
+    }
   }
 
 
@@ -236,12 +266,24 @@ namespace lris
 				     art::SubRunPrincipal* &outSR,
 				     art::EventPrincipal* &outE)
   {
+    if(fEventCounter == fEventList.size() && !fSelectEvents.empty())
+    {
+      mf::LogInfo(__FUNCTION__)<<"Read the " <<fEventCounter <<" selected events." <<"\n";
+      return false;
+    }
     if(fEventCounter == fNEvents)
     {
       mf::LogInfo(__FUNCTION__)<<"All the files have been read in. Checking end of file..." <<"\n";
-      std::streampos current_position = DataDecode.m_file.tellg();
-      DataDecode.m_file.seekg(0, std::ios::end);
-      std::streampos file_length = DataDecode.m_file.tellg();
+      std::streampos current_position = DataDecode.Tell();
+      std::streampos file_length;
+      if( DataDecode.IsMapped() )
+      {
+        file_length = DataDecode.FileSize();
+      } else
+      {
+        DataDecode.m_file.seekg(0, std::ios::end);
+        file_length = DataDecode.m_file.tellg();
+      }
       if( ((uint8_t)file_length - (uint8_t)current_position) > (uint8_t)100 )
       {
 	throw art::Exception( art::errors::FileReadError )
@@ -252,12 +294,13 @@ namespace lris
       return false; //Tells readNext that all events have been read.
     }
 
-    mf::LogInfo(__FUNCTION__)<<"Reading event " << fEventCounter << " from " << fNEvents <<"\n";
+    uint16_t evt = fEventList[fEventCounter++];
+    mf::LogInfo(__FUNCTION__)<<"Reading event " << evt << " from " << fNEvents <<"\n";
 
     // Create empty result, then fill it from current file
     dlardaq::evheader_t event_head;
     std::unique_ptr< std::vector<raw::RawDigit> > tpc_raw_digits( new std::vector<raw::RawDigit> );
-    process_Event311(*tpc_raw_digits, event_head, fEventCounter++);
+    process_Event311(*tpc_raw_digits, event_head, evt);
 
 
 
@@ -286,7 +329,7 @@ namespace lris
     }
 
     outE = fSourceHelper.makeEventPrincipal(fCurrentSubRunID.run(), fCurrentSubRunID.subRun(),
-					    fEventCounter - 1, tstamp);
+					    evt, tstamp);
 
     // Put products in the event.
     art::put_product_in_principal(std::move(tpc_raw_digits), *outE, "daq");
@@ -15,6 +15,7 @@
 #include <vector>
 #include <ctime>
 #include <stdint.h>
+#include <sys/types.h>
 
 // key for raw data
 #define EVSKEY 0xFF
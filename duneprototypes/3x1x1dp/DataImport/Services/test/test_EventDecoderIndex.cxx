@@ -0,0 +1,239 @@
+// test_EventDecoderIndex.cxx
+//
+// Test the EventDecoder event index on a synthetic 3x1x1 raw file:
+// events read in random order through the index, built or loaded from
+// the sidecar file, with ifstream and mmap input, must have the same
+// ADCs as events read in order without it.  A stale index must be
+// rejected.  Reports the time to open a file and read its last event,
+// and the time per random access, with and without the index.
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include "duneprototypes/3x1x1dp/DataImport/Services/EventDecoder.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dlardaq::adc16_t;
+using dlardaq::EventDecoder;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+const size_t nch = 1280;
+
+// Write a run header, nevt events of random uncompressed data and the
+// footer.
+void writeFile(string fname, size_t nevt, size_t nsa, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::ofstream fout(fname, std::ios::binary);
+  const char runhead[dlardaq::RunHeadSz] = {0, 0, 3, 1, 0};
+  fout.write(runhead, sizeof(runhead));
+  const uint32_t evsz = 3*nch*nsa/2;
+  vector<char> data(evsz);
+  for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+    char evhead[dlardaq::EveHeadSz] = {};
+    evhead[0] = evhead[1] = char(EVSKEY);
+    for ( int ibyte=0; ibyte<4; ++ibyte ) {
+      evhead[27 + ibyte] = char(ievt >> 8*(3 - ibyte));
+      evhead[31 + ibyte] = char(evsz >> 8*(3 - ibyte));
+    }
+    fout.write(evhead, sizeof(evhead));
+    for ( char& c : data ) c = char(rng());
+    fout.write(data.data(), data.size());
+  }
+  const char foot[dlardaq::FileFootSz] = {char(ENDKEY), char(ENDKEY), char(nevt >> 8), char(nevt)};
+  fout.write(foot, sizeof(foot));
+  assert( fout.good() );
+}
+
+uint64_t hashADCs(const vector<adc16_t>& adcs) {
+  uint64_t sum = adcs.size();
+  for ( adc16_t adc : adcs ) sum = 31*sum + adc;
+  return sum;
+}
+
+// Read the events in order, without an index.
+vector<uint64_t> readSequential(string fname, size_t nsa) {
+  EventDecoder dec(nch, nsa);
+  ssize_t nevt = dec.Open(fname);
+  assert( nevt > 0 );
+  assert( ! dec.Indexed() );
+  vector<uint64_t> hashes;
+  dlardaq::evheader_t eh;
+  vector<adc16_t> adcs;
+  for ( ssize_t ievt=0; ievt<nevt; ++ievt ) {
+    assert( dec.GetEvent(ievt, eh, adcs) == ievt );
+    assert( eh.ev_num == size_t(ievt) );
+    assert( adcs.size() == nch*nsa );
+    hashes.push_back(hashADCs(adcs));
+  }
+  return hashes;
+}
+
+// Read the events in random order and check them.
+void checkRandom(EventDecoder& dec, const vector<uint64_t>& hashes, std::mt19937& rng) {
+  vector<size_t> order(hashes.size());
+  for ( size_t ievt=0; ievt<order.size(); ++ievt ) order[ievt] = ievt;
+  std::shuffle(order.begin(), order.end(), rng);
+  dlardaq::evheader_t eh;
+  vector<adc16_t> adcs;
+  for ( size_t ievt : order ) {
+    assert( dec.GetEvent(ievt, eh, adcs) == ssize_t(ievt) );
+    assert( eh.ev_num == ievt );
+    assert( hashADCs(adcs) == hashes[ievt] );
+  }
+}
+
+bool fileExists(string fname) {
+  return std::ifstream(fname).good();
+}
+
+double msSince(Clock::time_point t0) {
+  return 1000.0*std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_EventDecoderIndex(size_t nevt, size_t nsa) {
+  const string myname = "test_EventDecoderIndex: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  const string fname = "test_EventDecoderIndex.dat";
+  const string iname = fname + ".idx";
+  const string fname2 = "test_EventDecoderIndex2.dat";
+  const string iname2 = fname2 + ".idx";
+  std::mt19937 rng(20170420);
+  for ( string name : {fname, iname, fname2, iname2} ) std::remove(name.c_str());
+
+  cout << myname << line << endl;
+  cout << myname << "Write " << nevt << " events of " << nch << " channels x " << nsa << " samples." << endl;
+  writeFile(fname, nevt, nsa, 1);
+  vector<uint64_t> hashes = readSequential(fname, nsa);
+  assert( hashes.size() == nevt );
+
+  cout << myname << line << endl;
+  cout << myname << "Check the index built on open." << endl;
+  {
+    EventDecoder dec(nch, nsa);
+    assert( dec.Open(fname, false, true) == ssize_t(nevt) );
+    assert( dec.Indexed() );
+    assert( fileExists(iname) );
+    checkRandom(dec, hashes, rng);
+    dlardaq::evheader_t eh;
+    vector<adc16_t> adcs;
+    assert( dec.GetEvent(nevt, eh, adcs) == -1 );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check the index read from file." << endl;
+  for ( bool usemmap : {false, true} ) {
+    EventDecoder dec(nch, nsa);
+    assert( dec.Open(fname, usemmap) == ssize_t(nevt) );
+    assert( dec.IsMapped() == usemmap );
+    assert( dec.ReadIndex(iname) );
+    assert( dec.Indexed() );
+    checkRandom(dec, hashes, rng);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check that a stale index is rebuilt." << endl;
+  writeFile(fname2, nevt/2 + 1, nsa, 2);
+  vector<uint64_t> hashes2 = readSequential(fname2, nsa);
+  {
+    std::ifstream src(iname, std::ios::binary);
+    std::ofstream dst(iname2, std::ios::binary);
+    dst << src.rdbuf();
+  }
+  {
+    EventDecoder dec(nch, nsa);
+    assert( dec.Open(fname2) > 0 );
+    assert( ! dec.ReadIndex(iname2) );
+    assert( ! dec.Indexed() );
+    // bookmarks made before a rejected index are kept
+    dlardaq::evheader_t eh;
+    vector<adc16_t> adcs;
+    assert( dec.GetEvent(1, eh, adcs) == 1 );
+    assert( ! dec.ReadIndex(iname2) );
+    assert( dec.BuildIndex() == hashes2.size() );
+    checkRandom(dec, hashes2, rng);
+  }
+  {
+    EventDecoder dec(nch, nsa);
+    assert( dec.Open(fname2, true, true) > 0 );
+    assert( dec.Indexed() );
+    checkRandom(dec, hashes2, rng);
+    EventDecoder dec2(nch, nsa);
+    assert( dec2.Open(fname2) > 0 );
+    assert( dec2.ReadIndex(iname2) );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Time random access." << endl;
+  for ( bool usemmap : {false, true} ) {
+    for ( bool useindex : {false, true} ) {
+      auto t0 = Clock::now();
+      EventDecoder dec(nch, nsa);
+      dec.Open(fname, usemmap, useindex);
+      dlardaq::evheader_t eh;
+      vector<adc16_t> adcs;
+      dec.GetEvent(nevt - 1, eh, adcs);
+      double mslast = msSince(t0);
+      assert( hashADCs(adcs) == hashes.back() );
+      std::uniform_int_distribution<size_t> dist(0, nevt - 1);
+      const size_t nrand = 2*nevt;
+      t0 = Clock::now();
+      for ( size_t irand=0; irand<nrand; ++irand ) {
+        size_t ievt = dist(rng);
+        dec.GetEvent(ievt, eh, adcs);
+        assert( hashADCs(adcs) == hashes[ievt] );
+      }
+      double msrand = msSince(t0)/nrand;
+      cout << myname << (usemmap ? "      mmap" : "  ifstream") << (useindex ? ", index: " : ",  walk: ")
+           << "open + last event " << mslast << " ms, random event " << msrand << " ms" << endl;
+    }
+  }
+
+  for ( string name : {fname, iname, fname2, iname2} ) std::remove(name.c_str());
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nevt = 20;
+  size_t nsa = 1000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NEVT [NSAMPLE]]" << endl;
+      cout << "  NEVT [20]: Number of events in the test file (at least 2)." << endl;
+      cout << "  NSAMPLE [1000]: Samples per channel (even)." << endl;
+      return 0;
+    }
+    nevt = std::max(size_t(2), size_t(std::stoul(sarg)));
+  }
+  if ( argc > 2 ) nsa = 2*(std::stoul(argv[2])/2);
+  return test_EventDecoderIndex(nevt, nsa);
+}
+
+//**********************************************************************
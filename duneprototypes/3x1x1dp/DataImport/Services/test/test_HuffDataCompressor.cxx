@@ -0,0 +1,339 @@
+// test_HuffDataCompressor.cxx
+//
+// Test HuffDataCompressor against the string-based Huffman codec it
+// replaced: the compressed bytes must be identical and each codec must
+// decode the other's output.  Covers noise, flat runs of every length
+// around the repetition code, pulses with uncompressed samples and all
+// supported ADC sizes, decoding from memory and from a file.  Reports
+// compression and decompression rates for both codecs.
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <deque>
+#include <bitset>
+#include <map>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "duneprototypes/3x1x1dp/DataImport/Services/HuffDataCompressor.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dlardaq::adc16_t;
+using dlardaq::BYTE;
+using dlardaq::HuffDataCompressor;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// The codec as it was before, with codes handled as strings and bits
+// read one at a time into a deque.
+class ReferenceCodec {
+public:
+  ReferenceCodec(short nbadc) : m_nbhc(nbadc), m_psize(nbadc + 1) {
+    m_codes = {{0, "01"}, {-1, "001"}, {1, "0001"}, {-2, "00001"}, {2, "000001"},
+               {-3, "0000001"}, {3, "00000001"}, {7, "1"}};
+    for ( const auto& ent : m_codes ) m_values[ent.second] = ent.first;
+  }
+
+  // Compress one channel and append it to out.
+  void compress(const adc16_t* raw, size_t n, vector<BYTE>& out) const {
+    struct Entry { string code; short value; short nrep; };
+    vector<Entry> buf;
+    for ( size_t i=0; i<n; ++i ) {
+      short delta = i == 0 ? 4 : short(raw[i] - raw[i-1]);
+      if ( std::abs(delta) > 3 ) {
+        buf.push_back({"", short(raw[i]), 0});
+      } else if ( buf.back().value == delta && !buf.back().code.empty() ) {
+        buf.back().nrep += 1;
+      } else {
+        buf.push_back({m_codes.at(delta), delta, 0});
+      }
+    }
+    string bits;
+    string word;
+    for ( const Entry& ent : buf ) {
+      if ( ent.code.empty() ) {
+        if ( word.size() > 1 ) {
+          while ( word.size() < m_psize ) word += "0";
+          bits += word;
+        }
+        bits += "0" + std::bitset<16>(ent.value).to_string().substr(16 - m_nbhc);
+        word = "1";
+        continue;
+      }
+      for ( short jj=0; jj<=ent.nrep; ++jj ) {
+        if ( jj == 0 ) word += ent.code;
+        else if ( jj + 4 <= ent.nrep ) {
+          word += "1";
+          jj += 3;
+        } else word += ent.code;
+        if ( word.size() >= m_psize ) {
+          bits += word.substr(0, m_psize);
+          word = "1" + word.substr(m_psize);
+        }
+      }
+    }
+    if ( word.size() > 1 ) bits += word;
+    while ( bits.size() % 8 ) bits += "0";
+    for ( size_t i=0; i<bits.size(); i+=8 ) out.push_back(strtoul(bits.substr(i, 8).c_str(), 0, 2) & 0xff);
+  }
+
+  // Decompress nch channels of seqlen samples.
+  void decompress(const char* buf, size_t bufsize, size_t nch, size_t seqlen,
+                  vector<adc16_t>& adc) const {
+    adc.clear();
+    vector<adc16_t> chdata;
+    std::deque<bool> bits;
+    string ss;
+    short lastdelta = -999;
+    size_t bitsread = 0;
+    size_t byteidx = 0;
+    while ( adc.size() != nch*seqlen ) {
+      if ( byteidx < bufsize ) {
+        for ( int i=0; i<8; ++i ) bits.push_back((buf[byteidx] & (0x80 >> i)) != 0);
+        ++byteidx;
+      }
+      assert( !bits.empty() );
+      if ( bits.size() < m_psize && byteidx != bufsize ) continue;
+      bool iscomp = bits.front();
+      bits.pop_front();
+      ++bitsread;
+      if ( !iscomp ) {
+        ss.clear();
+        assert( bits.size() >= m_nbhc );
+        for ( size_t i=0; i<m_nbhc; ++i ) {
+          ss += bits.front() ? "1" : "0";
+          bits.pop_front();
+        }
+        bitsread += m_nbhc;
+        chdata.push_back(strtoul(ss.c_str(), 0, 2) & 0x7FFF);
+        ss.clear();
+      } else {
+        size_t bitstoread = std::min(m_nbhc, bits.size());
+        for ( size_t i=0; i<bitstoread; ++i ) {
+          ss += bits.front() ? "1" : "0";
+          bits.pop_front();
+          ++bitsread;
+          auto ival = m_values.find(ss);
+          if ( ss.size() <= 8 && ival != m_values.end() ) {
+            ss.clear();
+            if ( std::abs(ival->second) <= 3 ) {
+              chdata.push_back(chdata.back() + ival->second);
+              lastdelta = ival->second;
+            } else {
+              for ( int j=0; j<4; ++j ) chdata.push_back(chdata.back() + lastdelta);
+            }
+          }
+          if ( chdata.size() == seqlen ) break;
+        }
+      }
+      if ( chdata.size() == seqlen ) {
+        size_t padbits = bitsread % 8;
+        if ( padbits > 0 ) padbits = 8 - padbits;
+        assert( bits.size() >= padbits );
+        for ( ; padbits>0; --padbits ) bits.pop_front();
+        bitsread = 0;
+        adc.insert(adc.end(), chdata.begin(), chdata.end());
+        chdata.clear();
+      }
+    }
+  }
+
+private:
+  size_t m_nbhc;
+  size_t m_psize;
+  std::map<short, string> m_codes;
+  std::map<string, short> m_values;
+};
+
+// Channels of pedestal noise with flat runs and pulses.
+void makeEvent(vector<adc16_t>& adc, size_t nch, size_t seqlen, short nbadc, std::mt19937& rng) {
+  const int maxadc = (1 << nbadc) - 1;
+  std::normal_distribution<double> noisedist(0.0, 1.0);
+  std::uniform_int_distribution<int> peddist(maxadc/8, maxadc/2);
+  std::uniform_int_distribution<int> typedist(0, 9);
+  std::uniform_int_distribution<int> lendist(1, 13);
+  adc.resize(nch*seqlen);
+  for ( size_t ich=0; ich<nch; ++ich ) {
+    adc16_t* chdata = adc.data() + ich*seqlen;
+    int ped = peddist(rng);
+    size_t isam = 0;
+    while ( isam < seqlen ) {
+      int type = typedist(rng);
+      int len = lendist(rng);
+      int val = isam ? chdata[isam-1] : ped;
+      for ( int i=0; i<len && isam<seqlen; ++i, ++isam ) {
+        if ( type < 5 ) val = ped + std::lround(noisedist(rng));           // noise
+        else if ( type < 7 ) ;                                           // flat run
+        else if ( type < 8 ) val += (type%2 ? 1 : -1);                   // ramp
+        else if ( type < 9 ) val = ped + 60*i*std::exp(-i/3.0);          // pulse
+        else val = rng() & maxadc;                                       // random
+        val = std::max(0, std::min(maxadc, val));
+        chdata[isam] = val;
+      }
+    }
+  }
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_HuffDataCompressor(size_t nch =64, size_t seqlen =1667, size_t nrep =5) {
+  const string myname = "test_HuffDataCompressor: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(20160702);
+  HuffDataCompressor& huff = HuffDataCompressor::Instance();
+
+  cout << myname << line << endl;
+  cout << myname << "Check bytes and round trips against the reference codec." << endl;
+  for ( short nbadc : {8, 10, 12, 14, 15} ) {
+    ReferenceCodec ref(nbadc);
+    for ( size_t ievt=0; ievt<4; ++ievt ) {
+      vector<adc16_t> adc;
+      size_t lseq = ievt == 0 ? 1 : seqlen/(ievt*ievt) + ievt;
+      makeEvent(adc, nch, lseq, nbadc, rng);
+      vector<BYTE> refbytes;
+      for ( size_t ich=0; ich<nch; ++ich ) ref.compress(&adc[ich*lseq], lseq, refbytes);
+      vector<BYTE> bytes;
+      huff.CompressEventData(nbadc, nch, lseq, adc, bytes);
+      assert( bytes == refbytes );
+      vector<vector<adc16_t>> adc2d(nch);
+      for ( size_t ich=0; ich<nch; ++ich ) adc2d[ich].assign(&adc[ich*lseq], &adc[ich*lseq] + lseq);
+      vector<BYTE> bytes2d;
+      huff.CompressEventData(nbadc, nch, lseq, adc2d, bytes2d);
+      assert( bytes2d == refbytes );
+      vector<adc16_t> out;
+      size_t byteidx = 0;
+      huff.DecompressEventData(nbadc, nch, lseq, bytes.data(), bytes.size(), byteidx, out);
+      assert( out == adc );
+      assert( byteidx == bytes.size() );
+      vector<adc16_t> refout;
+      ref.decompress(bytes.data(), bytes.size(), nch, lseq, refout);
+      assert( refout == adc );
+    }
+    cout << myname << "  " << nbadc << " bit ADC: OK" << endl;
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check flat runs of each length." << endl;
+  {
+    ReferenceCodec ref(12);
+    for ( size_t nflat=1; nflat<40; ++nflat ) {
+      for ( int slope : {0, 1, -2, 3} ) {
+        vector<adc16_t> adc = {1000, 1100};
+        for ( size_t i=0; i<nflat; ++i ) adc.push_back(adc.back() + slope);
+        adc.push_back(900);
+        adc.push_back(adc.back() - 1);
+        vector<BYTE> refbytes;
+        ref.compress(adc.data(), adc.size(), refbytes);
+        vector<BYTE> bytes;
+        huff.CompressChData(12, adc, bytes);
+        assert( bytes == refbytes );
+        vector<adc16_t> out;
+        size_t byteidx = 0;
+        huff.DecompressEventData(12, 1, adc.size(), bytes.data(), bytes.size(), byteidx, out);
+        assert( out == adc );
+      }
+    }
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check decoding from a file." << endl;
+  {
+    string fname = "test_HuffDataCompressor.dat";
+    vector<adc16_t> adc1, adc2;
+    makeEvent(adc1, nch, seqlen, 12, rng);
+    makeEvent(adc2, nch, seqlen, 12, rng);
+    vector<BYTE> bytes1, bytes2;
+    huff.CompressEventData(12, nch, seqlen, adc1, bytes1);
+    huff.CompressEventData(12, nch, seqlen, adc2, bytes2);
+    {
+      std::ofstream fout(fname, std::ios::binary);
+      fout.write(bytes1.data(), bytes1.size());
+      fout.write(bytes2.data(), bytes2.size());
+    }
+    std::ifstream fin(fname, std::ios::binary);
+    vector<adc16_t> out;
+    huff.DecompressEventData(fin, 12, nch, seqlen, out);
+    assert( out == adc1 );
+    assert( size_t(fin.tellg()) == bytes1.size() );
+    huff.DecompressEventData(fin, 12, nch, seqlen, out);
+    assert( out == adc2 );
+    std::remove(fname.c_str());
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Time " << nrep << " events of " << nch << " x " << seqlen << " samples." << endl;
+  ReferenceCodec ref(12);
+  vector<adc16_t> adc;
+  makeEvent(adc, nch, seqlen, 12, rng);
+  double mbytes = nrep*adc.size()*sizeof(adc16_t)/1.e6;
+  vector<BYTE> bytes;
+  auto t0 = Clock::now();
+  for ( size_t irep=0; irep<nrep; ++irep ) {
+    bytes.clear();
+    for ( size_t ich=0; ich<nch; ++ich ) ref.compress(&adc[ich*seqlen], seqlen, bytes);
+  }
+  auto t1 = Clock::now();
+  for ( size_t irep=0; irep<nrep; ++irep ) huff.CompressEventData(12, nch, seqlen, adc, bytes);
+  auto t2 = Clock::now();
+  vector<adc16_t> out;
+  for ( size_t irep=0; irep<nrep; ++irep ) ref.decompress(bytes.data(), bytes.size(), nch, seqlen, out);
+  auto t3 = Clock::now();
+  size_t byteidx = 0;
+  for ( size_t irep=0; irep<nrep; ++irep ) huff.DecompressEventData(12, nch, seqlen, bytes.data(), bytes.size(), byteidx, out);
+  auto t4 = Clock::now();
+  assert( out == adc );
+  auto rate = [mbytes](Clock::time_point ta, Clock::time_point tb) {
+    return mbytes/std::chrono::duration<double>(tb - ta).count();
+  };
+  cout << myname << "  Compression factor: " << double(adc.size()*sizeof(adc16_t))/bytes.size() << endl;
+  cout << myname << "    Compress, reference: " << rate(t0, t1) << " MB/s" << endl;
+  cout << myname << "                    new: " << rate(t1, t2) << " MB/s" << endl;
+  cout << myname << "  Decompress, reference: " << rate(t2, t3) << " MB/s" << endl;
+  cout << myname << "                    new: " << rate(t3, t4) << " MB/s" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nch = 64;
+  size_t seqlen = 1667;
+  size_t nrep = 5;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NCH [SEQLEN [NREP]]]" << endl;
+      cout << "  NCH [64]: Number of channels per event." << endl;
+      cout << "  SEQLEN [1667]: Number of samples per channel." << endl;
+      cout << "  NREP [5]: Number of times the event is processed in the timing test." << endl;
+      return 0;
+    }
+    nch = std::stoul(sarg);
+  }
+  if ( argc > 2 ) seqlen = std::stoul(argv[2]);
+  if ( argc > 3 ) nrep = std::stoul(argv[3]);
+  return test_HuffDataCompressor(nch, seqlen, nrep);
+}
+
+//**********************************************************************
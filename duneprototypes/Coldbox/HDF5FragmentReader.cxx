@@ -0,0 +1,148 @@
+// HDF5FragmentReader.cxx
+
+#include "HDF5FragmentReader.h"
+
+namespace {
+
+  herr_t addName(hid_t, const char * name, const H5L_info_t *, void * names) {
+    static_cast<std::vector<std::string>*>(names)->emplace_back(name);
+    return 0;
+  }
+
+}
+
+//**********************************************************************
+
+dune::HDF5FragmentReader::~HDF5FragmentReader() {
+  Clear();
+}
+
+//**********************************************************************
+
+std::vector<char> & dune::HDF5FragmentReader::ThreadBuffer() {
+  thread_local std::vector<char> buf;
+  return buf;
+}
+
+//**********************************************************************
+
+bool dune::HDF5FragmentReader::SetRecord(hid_t file, const std::string & record) {
+  if (file == fFile && record == fRecord && fRecordGroup >= 0) return true;
+  Clear();
+  H5E_BEGIN_TRY {
+    fRecordGroup = H5Gopen(file, record.c_str(), H5P_DEFAULT);
+  } H5E_END_TRY;
+  if (fRecordGroup < 0) return false;
+  fFile = file;
+  fRecord = record;
+  return true;
+}
+
+//**********************************************************************
+
+void dune::HDF5FragmentReader::Clear() {
+  for (auto & ds : fDatasets) {
+    if (ds.second.id >= 0) H5Dclose(ds.second.id);
+  }
+  for (auto & grp : fGroups) {
+    if (grp.second >= 0) H5Gclose(grp.second);
+  }
+  if (fRecordGroup >= 0) H5Gclose(fRecordGroup);
+  fDatasets.clear();
+  fGroups.clear();
+  fNames.clear();
+  fRecordGroup = -1;
+  fFile = -1;
+  fRecord.clear();
+}
+
+//**********************************************************************
+
+hid_t dune::HDF5FragmentReader::group(const std::string & path) {
+  if (path.empty()) return fRecordGroup;
+  auto it = fGroups.find(path);
+  if (it != fGroups.end()) return it->second;
+  hid_t id = -1;
+  if (fRecordGroup >= 0) {
+    H5E_BEGIN_TRY {
+      id = H5Gopen(fRecordGroup, path.c_str(), H5P_DEFAULT);
+    } H5E_END_TRY;
+  }
+  fGroups[path] = id;
+  return id;
+}
+
+//**********************************************************************
+
+const dune::HDF5FragmentReader::Dataset &
+dune::HDF5FragmentReader::dataset(const std::string & path) {
+  auto it = fDatasets.find(path);
+  if (it != fDatasets.end()) return it->second;
+  Dataset ds{-1, 0};
+  if (fRecordGroup >= 0) {
+    H5E_BEGIN_TRY {
+      ds.id = H5Dopen(fRecordGroup, path.c_str(), H5P_DEFAULT);
+    } H5E_END_TRY;
+    if (ds.id >= 0) {
+      ds.size = H5Dget_storage_size(ds.id);
+      ++fNOpened;
+    }
+  }
+  return fDatasets[path] = ds;
+}
+
+//**********************************************************************
+
+const std::vector<std::string> & dune::HDF5FragmentReader::Names(const std::string & path) {
+  auto it = fNames.find(path);
+  if (it != fNames.end()) return it->second;
+  std::vector<std::string> & names = fNames[path];
+  hid_t id = group(path);
+  if (id >= 0) {
+    hsize_t idx = 0;
+    H5Literate(id, H5_INDEX_NAME, H5_ITER_INC, &idx, addName, &names);
+  }
+  return names;
+}
+
+//**********************************************************************
+
+size_t dune::HDF5FragmentReader::Size(const std::string & path) {
+  return dataset(path).size;
+}
+
+//**********************************************************************
+
+const char * dune::HDF5FragmentReader::Read(const std::string & path, size_t & nread, size_t nb) {
+  nread = 0;
+  const Dataset & ds = dataset(path);
+  if (ds.id < 0 || ds.size == 0) return nullptr;
+  if (nb == 0 || nb > ds.size) nb = ds.size;
+  std::vector<char> & buf = ThreadBuffer();
+  herr_t ecode = -1;
+  hid_t fspace = -1;
+  hsize_t count = 0;
+  // the fragment datasets are one-dimensional byte arrays
+  if (nb < ds.size) {
+    fspace = H5Dget_space(ds.id);
+    if (H5Sget_simple_extent_ndims(fspace) == 1) H5Sget_simple_extent_dims(fspace, &count, nullptr);
+  }
+  if (count > nb) {
+    hsize_t start = 0;
+    count = nb;
+    if (buf.size() < nb) buf.resize(nb);
+    H5Sselect_hyperslab(fspace, H5S_SELECT_SET, &start, nullptr, &count, nullptr);
+    hid_t mspace = H5Screate_simple(1, &count, nullptr);
+    ecode = H5Dread(ds.id, H5T_STD_I8LE, mspace, fspace, H5P_DEFAULT, buf.data());
+    H5Sclose(mspace);
+  } else {
+    if (buf.size() < ds.size) buf.resize(ds.size);
+    ecode = H5Dread(ds.id, H5T_STD_I8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf.data());
+    nb = ds.size;
+  }
+  if (fspace >= 0) H5Sclose(fspace);
+  if (ecode < 0) return nullptr;
+  nread = nb;
+  fNBytes += nb;
+  return buf.data();
+}
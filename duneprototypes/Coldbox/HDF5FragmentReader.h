@@ -0,0 +1,93 @@
+// HDF5FragmentReader.h
+//
+// Reads the DAQ fragment datasets of a trigger record in an HDF5 raw data
+// file for the coldbox data interface tools.  art-independent.
+//
+// Paths are relative to the trigger record group, e.g. "TPC/APA000/Link00";
+// "" is the record itself.  The group and dataset handles, the member names
+// of each group and the dataset sizes are kept until another record or
+// file is selected, so the tools, which DataPrep calls once per APA, open
+// each of them once per event and all are closed when the record changes.
+//
+// Datasets are read into a buffer owned by the calling thread that grows
+// to the largest fragment and is reused from event to event, instead of a
+// new allocation per dataset.  Read() can read just the first bytes of a
+// dataset with a hyperslab, e.g. the fragment header and the first frame,
+// so a link that will be dropped is not read in full.
+//
+// One reader is not thread safe; the read buffer is per thread.
+
+#ifndef HDF5FragmentReader_H
+#define HDF5FragmentReader_H
+
+#include <hdf5.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace dune {
+
+  class HDF5FragmentReader {
+
+  public:
+
+    HDF5FragmentReader() = default;
+    ~HDF5FragmentReader();
+    HDF5FragmentReader(const HDF5FragmentReader &) = delete;
+    HDF5FragmentReader & operator=(const HDF5FragmentReader &) = delete;
+
+    // Select the file and trigger record group.  The cached handles are
+    // closed if either changes.  Returns false if the group cannot be opened.
+    bool SetRecord(hid_t file, const std::string & record);
+
+    // Close all cached handles.  Call before the file is closed.
+    void Clear();
+
+    // Names of the members of a group, in name order.  Empty if the group
+    // cannot be opened.
+    const std::vector<std::string> & Names(const std::string & path);
+
+    // Storage size of a dataset in bytes, 0 if it cannot be opened.
+    size_t Size(const std::string & path);
+
+    // Read the first nb bytes of a dataset, or all of it if nb is 0 or
+    // larger, into the buffer of this thread.  Returns the start of the
+    // data and sets nread, or returns nullptr if the read fails.  The data
+    // stay valid until the next Read on this thread.
+    const char * Read(const std::string & path, size_t & nread, size_t nb = 0);
+
+    // Counters for the current reader.
+    size_t DatasetsOpened() const { return fNOpened; }
+    size_t BytesRead() const { return fNBytes; }
+
+    // Capacity of the read buffer of this thread.
+    static size_t BufferCapacity() { return ThreadBuffer().capacity(); }
+
+  private:
+
+    struct Dataset {
+      hid_t id;
+      size_t size;
+    };
+
+    static std::vector<char> & ThreadBuffer();
+
+    hid_t group(const std::string & path);
+    const Dataset & dataset(const std::string & path);
+
+    hid_t fFile = -1;
+    hid_t fRecordGroup = -1;
+    std::string fRecord;
+    std::map<std::string, hid_t> fGroups;
+    std::map<std::string, Dataset> fDatasets;
+    std::map<std::string, std::vector<std::string>> fNames;
+    size_t fNOpened = 0;
+    size_t fNBytes = 0;
+
+  };
+
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include "artdaq-core/Data/Fragment.hh"
 #include "dunecore/DuneObj/PDSPTPCDataInterfaceParent.h"
 #include "daqdataformats/v3_3_3/Fragment.hpp"
+#include "duneprototypes/Coldbox/HDF5FragmentReader.h"
 #include <hdf5.h>
 
 typedef dunedaq::daqdataformats::Fragment duneFragment;
@@ -25,6 +26,7 @@ class HDColdboxDataInterface : public PDSPTPCDataInterfaceParent {
 
   HDColdboxDataInterface(fhicl::ParameterSet const& ps);
   ~HDColdboxDataInterface() {
+    fReader.Clear();
     if (fForceOpen) {
       H5Fclose(fHDFFile);
     }
@@ -55,10 +57,10 @@ class HDColdboxDataInterface : public PDSPTPCDataInterfaceParent {
 
   std::map<int,std::vector<std::string>> _input_labels_by_apa;
   void _collectRDStatus (std::vector<raw::RDStatus> &rdstatuses){};
-  void getFragmentsForEvent (hid_t the_group, RawDigits& raw_digits,
+  void getFragmentsForEvent (RawDigits& raw_digits,
                              RDTimeStamps &timestamps, int apano,
                              unsigned int maxchan);
-  void getFragmentsForEvent (hid_t the_group, RawDigits& raw_digits,
+  void getFragmentsForEvent (RawDigits& raw_digits,
                              RDTimeStamps &timestamps, int apano);
   void getMedianSigma (const raw::RawDigit::ADCvector_t &v_adc, float &median,
                        float &sigma);
@@ -73,6 +75,7 @@ class HDColdboxDataInterface : public PDSPTPCDataInterfaceParent {
   unsigned int fMaxChan = 1000000;  // no maximum for now
   unsigned int fDefaultCrate = 3;
   int fDebugLevel = 0;   // switch to turn on debugging printout
+  dune::HDF5FragmentReader fReader;  // handles and read buffer for the current record
 
 };
 
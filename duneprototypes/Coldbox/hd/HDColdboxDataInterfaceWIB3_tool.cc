@@ -7,7 +7,9 @@
 #include <sstream>
 #include <cstring>
 #include <string>
-#include "TMath.h"
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
+#include "duneprototypes/Coldbox/HDF5FragmentReader.h"
 #include "TString.h"
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
@@ -52,7 +54,6 @@ int HDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
   const std::string & toplevel_groupname = infoHandle->GetEventGroupName();
   const std::string & file_name = infoHandle->GetFileName();
   hid_t file_id = infoHandle->GetHDF5FileHandle();
-  hid_t the_group = getGroupFromPath(file_id, toplevel_groupname);
 
   if (fDebugLevel > 0)
     {
@@ -64,6 +65,8 @@ int HDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
   // but only if we are on a new file -- identified by if the handle stored in the event is different.
   if (fForceOpen && (file_id != fPrevStoredHandle))
     {
+      fReader.Clear();
+      if (fHDFFile >= 0) H5Fclose(fHDFFile);
       fHDFFile = H5Fopen(file_name.data(), H5F_ACC_RDONLY, H5P_DEFAULT);
     } // If the handle is the same, fHDFFile won't change
   else if (!fForceOpen)
@@ -71,6 +74,12 @@ int HDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
       fHDFFile = file_id;
     }
   fPrevStoredHandle = file_id;
+
+  if (!fReader.SetRecord(file_id, toplevel_groupname))
+    {
+      MF_LOG_WARNING("HDColdboxDataInterfaceWIB3") << "Cannot open group " << toplevel_groupname;
+      return 0;
+    }
   
   if (fDebugLevel > 0)
     {
@@ -88,7 +97,7 @@ int HDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
 	  std::cout << "HDColdboxDataInterface :" << "apano: " << i << std::endl;
         }
 
-      getFragmentsForEvent(the_group, raw_digits, rd_timestamps, apano);
+      getFragmentsForEvent(raw_digits, rd_timestamps, apano);
 
       //Currently putting in dummy values for the RD Statuses
       rdstatuses.clear();
@@ -113,7 +122,7 @@ int HDColdboxDataInterface::retrieveDataAPAListWithLabels( art::Event &evt,
 
 // This is designed to read 1APA/CRU, only for VDColdBox data. The function uses "apano", handed by DataPrep,
 // as an argument.
-void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& raw_digits, RDTimeStamps &timestamps, int apano)
+void HDColdboxDataInterface::getFragmentsForEvent(RawDigits& raw_digits, RDTimeStamps &timestamps, int apano)
 {
   using namespace dune::HDF5Utils;
   using dunedaq::fddetdataformats::WIB2Frame;
@@ -121,8 +130,7 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
   // art::ServiceHandle<dune::PdspChannelMapService> channelMap;
   art::ServiceHandle<dune::PD2HDChannelMapService> channelMap;
 
-  std::deque<std::string> det_types
-    = getMidLevelGroupNames(the_group);
+  const std::vector<std::string> & det_types = fReader.Names("");
   
   for (const auto & det : det_types)
     {
@@ -132,9 +140,7 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
         {
 	  std::cout << "HDColdboxDataInterfaceWIB3 :"  << "Detector type:  " << det << std::endl;
         }
-      hid_t geoGroup = getGroupFromPath(the_group, det);
-      std::deque<std::string> apaNames
-        = getMidLevelGroupNames(geoGroup);
+      const std::vector<std::string> & apaNames = fReader.Names(det);
       
       if (fDebugLevel > 0)
         {
@@ -142,31 +148,61 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
 	  std::cout << "HDColdboxDataInterfaceWIB3 :" << "apaNames[0]: "  << apaNames[0] << std::endl;
         }
       // apaNames is a vector whose elements start at [0].
-      hid_t linkGroup = getGroupFromPath(geoGroup, apaNames[0]);
-      std::deque<std::string> linkNames = getMidLevelGroupNames(linkGroup);
+      std::string linkPath = det + "/" + apaNames[0];
+      const std::vector<std::string> & linkNames = fReader.Names(linkPath);
 
       for (const auto & t : linkNames)
         {
 	  // link below is calculated from the HDF5 group name. However,later a link is calculated from 
           // WIBFrameHeader and used in the rest of the code.
 	  unsigned int link = atoi(t.substr(4,2).c_str());
-	  hid_t dataset = H5Dopen(linkGroup, t.data(), H5P_DEFAULT);
-          hsize_t ds_size = H5Dget_storage_size(dataset);
+	  std::string dataSetPath = linkPath + "/" + t;
+          hsize_t ds_size = fReader.Size(dataSetPath);
           if (ds_size <= sizeof(FragmentHeader)) continue; //Too small
-
-	  std::vector<char> ds_data(ds_size);
-          H5Dread(dataset, H5T_STD_I8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, ds_data.data());
-          H5Dclose(dataset);
-
-	  //Each fragment is a collection of WIB Frames
-          Fragment frag(&ds_data[0], Fragment::BufferAdoptionMode::kReadOnlyMode);
           size_t n_frames = (ds_size - sizeof(FragmentHeader))/sizeof(WIB2Frame);
           if (fDebugLevel > 0)
             {
 	      std::cout << "n_frames calc.: " << ds_size << " " << sizeof(FragmentHeader) << " " << sizeof(WIB2Frame) << " " << n_frames << std::endl;
             }
-	  std::vector<raw::RawDigit::ADCvector_t> adc_vectors(256);
+
+	  // Read the fragment header and the first frame for the crate, slot and
+	  // link, and skip the rest if none of the channels is kept.
+	  size_t nread = 0;
+	  const char * ds_data = fReader.Read(dataSetPath, nread, sizeof(FragmentHeader) + sizeof(WIB2Frame));
+	  if (ds_data == nullptr) continue;
           unsigned int slot = 0, link_from_frameheader = 0, crate = 0;
+          if (n_frames > 0)
+            {
+              auto frame = reinterpret_cast<const WIB2Frame*>(ds_data + sizeof(FragmentHeader));
+              crate = frame->header.crate;
+              slot = frame->header.slot;
+              link_from_frameheader = frame->header.link;
+            }
+          if (fDebugLevel > 0)
+            {
+	      std::cout << "HDColdboxDataInterfaceToolWIB3: crate, slot, link(HDF5 group), link(WIB Header): "  << crate << ", " << slot << ", " << link << ", " << link_from_frameheader << std::endl;
+            }
+
+	  unsigned int offline_chans[256];
+	  bool keep = false;
+	  for (size_t iChan = 0; iChan < 256; ++iChan)
+            {
+              uint32_t slotloc = slot;
+	      slotloc &= 0x7;
+
+	      auto hdchaninfo = channelMap->GetChanInfoFromWIBElements (fDefaultCrate, slotloc, link_from_frameheader, iChan); 
+	      offline_chans[iChan] = hdchaninfo.offlchan;
+	      if (offline_chans[iChan] <= fMaxChan) keep = true;
+            }
+	  if (!keep) continue;
+
+	  ds_data = fReader.Read(dataSetPath, nread);
+	  if (ds_data == nullptr) continue;
+
+	  //Each fragment is a collection of WIB Frames
+          Fragment frag(const_cast<char*>(ds_data), Fragment::BufferAdoptionMode::kReadOnlyMode);
+	  std::vector<raw::RawDigit::ADCvector_t> adc_vectors(256);
+	  for (auto & v_adc : adc_vectors) v_adc.reserve(n_frames);
 	  
           for (size_t i = 0; i < n_frames; ++i)
             {
@@ -187,28 +223,12 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
                 {
 		  adc_vectors[j].push_back(frame->get_adc(j));
                 }
-	      
-              if (i == 0)
-                {
-                  crate = frame->header.crate;
-                  slot = frame->header.slot;
-                  link_from_frameheader = frame->header.link;
-                }
-            }
-          if (fDebugLevel > 0)
-            {
-	      std::cout << "HDColdboxDataInterfaceToolWIB3: crate, slot, link(HDF5 group), link(WIB Header): "  << crate << ", " << slot << ", " << link << ", " << link_from_frameheader << std::endl;
             }
 
 	  for (size_t iChan = 0; iChan < 256; ++iChan)
             {
               const raw::RawDigit::ADCvector_t & v_adc = adc_vectors[iChan];
-
-              uint32_t slotloc = slot;
-	      slotloc &= 0x7;
-
-	      auto hdchaninfo = channelMap->GetChanInfoFromWIBElements (fDefaultCrate, slotloc, link_from_frameheader, iChan); 
-	      unsigned int offline_chan = hdchaninfo.offlchan;
+	      unsigned int offline_chan = offline_chans[iChan];
 
               if (offline_chan > fMaxChan) continue;
 
@@ -223,7 +243,6 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
             }
 
         }
-      H5Gclose(linkGroup);
     }
 }
 
@@ -231,37 +250,19 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
 
 void HDColdboxDataInterface::getMedianSigma(const raw::RawDigit::ADCvector_t &v_adc, float &median,
                                             float &sigma) {
-  size_t asiz = v_adc.size();
-  int imed=0;
-  if (asiz == 0) {
-    median = 0;
-    sigma = 0;
-  }
-  else {
-    // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
-
-    imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-    median = imed;
-    sigma = TMath::RMS(asiz,v_adc.data());
-    
-    // add in a correction suggested by David Adams, May 6, 2019
-    
-    size_t s1 = 0;
-    size_t sm = 0;
-    for (size_t i = 0; i < asiz; ++i) {
-      if (v_adc.at(i) < imed) s1++;
-      if (v_adc.at(i) == imed) sm++;
-    }
-    if (sm > 0) {
-      float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-      if (fDebugLevel > 0)
-	{
-	  if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-	}
-      median += mcorr;
-    }
+  // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+
+  dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+  ped.Fill(v_adc);
+
+  // integer median plus a correction suggested by David Adams, May 6, 2019
+
+  median = ped.CorrectedMedian();
+  sigma = ped.RMS();
+  if (fDebugLevel > 0) {
+    float mcorr = ped.MedianCorrection();
+    if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
   }
-  
 }
 
 DEFINE_ART_CLASS_TOOL(HDColdboxDataInterface)
@@ -7,7 +7,9 @@
 #include <sstream>
 #include <cstring>
 #include <string>
-#include "TMath.h"
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
+#include "duneprototypes/Coldbox/HDF5FragmentReader.h"
 #include "TString.h"
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
@@ -61,6 +63,8 @@ int HDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
   // but only if we are on a new file -- identified by if the handle stored in the event is different.
   if (fForceOpen && (file_id != fPrevStoredHandle))
     {
+      fReader.Clear();
+      if (fHDFFile >= 0) H5Fclose(fHDFFile);
       fHDFFile = H5Fopen(file_name.data(), H5F_ACC_RDONLY, H5P_DEFAULT);
     } // If the handle is the same, fHDFFile won't change
   else if (!fForceOpen)
@@ -69,7 +73,11 @@ int HDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
     }
   fPrevStoredHandle = file_id;
   
-  hid_t the_group = getGroupFromPath(fHDFFile, toplevel_groupname);
+  if (!fReader.SetRecord(fHDFFile, toplevel_groupname))
+    {
+      MF_LOG_WARNING("HDColdboxDataInterface") << "Cannot open group " << toplevel_groupname;
+      return 0;
+    }
   
   if (fDebugLevel > 0)
     {
@@ -87,7 +95,7 @@ int HDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
 	  std::cout << "HDColdboxDataInterface :" << "apano: " << i << std::endl;
 	}
  
-      getFragmentsForEvent(the_group, raw_digits, rd_timestamps, apano, fMaxChan);
+      getFragmentsForEvent(raw_digits, rd_timestamps, apano, fMaxChan);
       
       //Currently putting in dummy values for the RD Statuses
       rdstatuses.clear();
@@ -112,7 +120,7 @@ int HDColdboxDataInterface::retrieveDataAPAListWithLabels( art::Event &evt,
 
 // This is designed to read 1APA/CRU, only for VDColdBox data. The function uses "apano", handed by DataPrep,
 // as an argument.
-void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& raw_digits, RDTimeStamps &timestamps,
+void HDColdboxDataInterface::getFragmentsForEvent(RawDigits& raw_digits, RDTimeStamps &timestamps,
 						  int apano, unsigned int maxchan) 
 {
   using namespace dune::HDF5Utils;
@@ -121,8 +129,7 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
   
   art::ServiceHandle<dune::PdspChannelMapService> channelMap;
 
-  std::deque<std::string> det_types
-    = getMidLevelGroupNames(the_group);
+  const std::vector<std::string> & det_types = fReader.Names("");
 
   for (const auto & det : det_types)
     {
@@ -131,9 +138,7 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
 	{
 	  std::cout << "HDColdboxDataInterface :"  << "Detector type:  " << det << std::endl;
 	}
-      hid_t geoGroup = getGroupFromPath(the_group, det);
-      std::deque<std::string> apaNames
-        = getMidLevelGroupNames(geoGroup);
+      const std::vector<std::string> & apaNames = fReader.Names(det);
       
       if (fDebugLevel > 0)
 	{
@@ -141,58 +146,41 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
 	  std::cout << "HDColdboxDataInterface :" << "apaNames[apano]: "  << apaNames[apano-1] << std::endl;
 	}
       // apaNames is a vector whose elements start at [0].
-      hid_t linkGroup = getGroupFromPath(geoGroup, apaNames[apano-1]);
-      std::deque<std::string> linkNames = getMidLevelGroupNames(linkGroup);
+      std::string linkPath = det + "/" + apaNames[apano-1];
+      const std::vector<std::string> & linkNames = fReader.Names(linkPath);
 
       for (const auto & t : linkNames)
         {
-          hid_t dataset = H5Dopen(linkGroup, t.data(), H5P_DEFAULT);
-          hsize_t ds_size = H5Dget_storage_size(dataset);
+          std::string dataSetPath = linkPath + "/" + t;
+          hsize_t ds_size = fReader.Size(dataSetPath);
           if (ds_size <= sizeof(FragmentHeader)) continue; //Too small
-          
-          std::vector<char> ds_data(ds_size);
-          H5Dread(dataset, H5T_STD_I8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, ds_data.data());
-          H5Dclose(dataset);
-          
-          //Each fragment is a collection of WIB Frames
-          Fragment frag(&ds_data[0], Fragment::BufferAdoptionMode::kReadOnlyMode);
           size_t n_frames = (ds_size - sizeof(FragmentHeader))/sizeof(WIBFrame);
 	  if (fDebugLevel > 0)
 	    {
 	      std::cout << "HDColdboxDataInterface :" << "n_frames : " << n_frames << std::endl;
 	    }
-	  std::vector<raw::RawDigit::ADCvector_t> adc_vectors(256);
-	  unsigned int slot = 0, fiber = 0;
 
-          for (size_t i = 0; i < n_frames; ++i)
-            {
-	      auto frame = reinterpret_cast<WIBFrame*>(static_cast<uint8_t*>(frag.get_data()) + i*sizeof(WIBFrame));
-	      if (fDebugLevel > 0)
-		{
-		  std::cout << "HDColdboxDataInterface :" << "frame : " << frame << std::endl;
-		}
-              for (size_t j = 0; j < adc_vectors.size(); ++j)
-                {
-                  adc_vectors[j].push_back(frame->get_channel(j));
-                }
-      	
-              if (i == 0)
-                {
-                  slot = frame->get_wib_header()->slot_no;
-                  fiber = frame->get_wib_header()->fiber_no;
-                }
-            }
+	  // Read the fragment header and the first frame for the slot and fiber,
+	  // and skip the rest of the link if none of its channels is kept.
+	  size_t nread = 0;
+	  const char * ds_data = fReader.Read(dataSetPath, nread, sizeof(FragmentHeader) + sizeof(WIBFrame));
+	  if (ds_data == nullptr) continue;
+	  unsigned int slot = 0, fiber = 0;
+	  if (n_frames > 0)
+	    {
+	      auto frame = reinterpret_cast<const WIBFrame*>(ds_data + sizeof(FragmentHeader));
+	      slot = frame->get_wib_header()->slot_no;
+	      fiber = frame->get_wib_header()->fiber_no;
+	    }
 	  if (fDebugLevel > 0)
 	    {
 	      std::cout << "HDColdboxDataInterface :" << "slot, fiber: "  << slot << ", " << fiber << std::endl;
 	    }
+
+	  unsigned int offline_chans[256];
+	  bool keep = false;
           for (size_t iChan = 0; iChan < 256; ++iChan)
             {
-              const raw::RawDigit::ADCvector_t & v_adc = adc_vectors[iChan];
-	      if (fDebugLevel > 0)
-		{
-		  std::cout << "HDColdboxDataInterface : " << "Channel: " << iChan << " N ticks: " << v_adc.size() << " Timestamp: " << frag.get_trigger_timestamp() << std::endl;
-		}
 	      // handle 256 channels on two fibers -- use the channel map that assumes 128 chans per fiber (=FEMB)
 	      // Channels 0-127 are on "fiberloc" 1 and channels 128-255 are on fiberloc 2.
 	      // Use separate variables, for example, "fiberloc" and "chloc" to keep track of the actual channel and fiber and to accommodate future needs.
@@ -226,7 +214,39 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
 		  std::cout << "HDColdboxDataInterface : " << "iChan : " << iChan << std::endl;
 		  std::cout << "HDColdboxDataInterface : " << "offline_chan  : " << offline_chan << std::endl;
 		}
-              if (offline_chan < 0) continue;
+	      offline_chans[iChan] = offline_chan;
+	      if (offline_chan <= maxchan) keep = true;
+	    }
+	  if (!keep) continue;
+
+	  ds_data = fReader.Read(dataSetPath, nread);
+	  if (ds_data == nullptr) continue;
+          
+          //Each fragment is a collection of WIB Frames
+          Fragment frag(const_cast<char*>(ds_data), Fragment::BufferAdoptionMode::kReadOnlyMode);
+	  std::vector<raw::RawDigit::ADCvector_t> adc_vectors(256);
+	  for (auto & v_adc : adc_vectors) v_adc.reserve(n_frames);
+
+          for (size_t i = 0; i < n_frames; ++i)
+            {
+	      auto frame = reinterpret_cast<WIBFrame*>(static_cast<uint8_t*>(frag.get_data()) + i*sizeof(WIBFrame));
+	      if (fDebugLevel > 0)
+		{
+		  std::cout << "HDColdboxDataInterface :" << "frame : " << frame << std::endl;
+		}
+              for (size_t j = 0; j < adc_vectors.size(); ++j)
+                {
+                  adc_vectors[j].push_back(frame->get_channel(j));
+                }
+            }
+          for (size_t iChan = 0; iChan < 256; ++iChan)
+            {
+              const raw::RawDigit::ADCvector_t & v_adc = adc_vectors[iChan];
+	      if (fDebugLevel > 0)
+		{
+		  std::cout << "HDColdboxDataInterface : " << "Channel: " << iChan << " N ticks: " << v_adc.size() << " Timestamp: " << frag.get_trigger_timestamp() << std::endl;
+		}
+	      unsigned int offline_chan = offline_chans[iChan];
 	      if (offline_chan > maxchan) continue;
 	      raw::RDTimeStamp rd_ts(frag.get_trigger_timestamp(), offline_chan);
               timestamps.push_back(rd_ts);
@@ -239,7 +259,6 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
             }
           
         }
-      H5Gclose(linkGroup);
     }
   
 }
@@ -248,37 +267,19 @@ void HDColdboxDataInterface::getFragmentsForEvent(hid_t the_group, RawDigits& ra
 void HDColdboxDataInterface::getMedianSigma(
 					    const raw::RawDigit::ADCvector_t &v_adc, float &median,
 					    float &sigma) {
-  size_t asiz = v_adc.size();
-  int imed=0;
-  if (asiz == 0) {
-    median = 0;
-    sigma = 0;
-  }
-  else {
-    // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+  // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
 
-    imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-    median = imed;
-    sigma = TMath::RMS(asiz,v_adc.data());
+  dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+  ped.Fill(v_adc);
 
-    // add in a correction suggested by David Adams, May 6, 2019
+  // integer median plus a correction suggested by David Adams, May 6, 2019
 
-    size_t s1 = 0;
-    size_t sm = 0;
-    for (size_t i = 0; i < asiz; ++i) {
-      if (v_adc.at(i) < imed) s1++;
-      if (v_adc.at(i) == imed) sm++;
-    }
-    if (sm > 0) {
-      float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-      if (fDebugLevel > 0)
-	{
-	  if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-	}
-      median += mcorr;
-    }
+  median = ped.CorrectedMedian();
+  sigma = ped.RMS();
+  if (fDebugLevel > 0) {
+    float mcorr = ped.MedianCorrection();
+    if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
   }
-  
 }
 
 DEFINE_ART_CLASS_TOOL(HDColdboxDataInterface)
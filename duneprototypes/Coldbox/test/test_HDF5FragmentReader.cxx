@@ -0,0 +1,283 @@
+// test_HDF5FragmentReader.cxx
+//
+// Test HDF5FragmentReader on a synthetic HDF5 raw data file with the
+// DAQ layout of the coldbox files: trigger records holding a header
+// dataset and TPC/APA000/LinkNN fragment datasets of bytes.  Compares the
+// data with what was written and reports the time per event and peak
+// resident size for reading the links the way the coldbox data interfaces
+// did (open every group and dataset, allocate a buffer per dataset, read
+// it all), with the reader, and with the reader reading only the headers.
+
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "duneprototypes/Coldbox/HDF5FragmentReader.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::HDF5FragmentReader;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+const size_t headsz = 72;     // fragment header
+const size_t framesz = 464;   // WIB frame
+
+string recordName(size_t irec) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "TriggerRecord%05zu.0000", irec + 1);
+  return buf;
+}
+
+string linkName(size_t ilnk) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "Link%02zu", ilnk);
+  return buf;
+}
+
+// Contents of a dataset.
+vector<char> linkData(size_t irec, size_t ilnk, size_t nframe) {
+  std::mt19937 rng(1000*irec + ilnk);
+  vector<char> data(headsz + nframe*framesz);
+  for ( char& c : data ) c = char(rng());
+  return data;
+}
+
+void writeDataset(hid_t grp, string name, const vector<char>& data) {
+  hsize_t dim = data.size();
+  hid_t space = H5Screate_simple(1, &dim, nullptr);
+  hid_t ds = H5Dcreate(grp, name.c_str(), H5T_STD_I8LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  H5Dwrite(ds, H5T_STD_I8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+  H5Dclose(ds);
+  H5Sclose(space);
+}
+
+void writeFile(string fname, size_t nrec, size_t nlnk, size_t nframe) {
+  hid_t file = H5Fcreate(fname.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  assert( file >= 0 );
+  for ( size_t irec=0; irec<nrec; ++irec ) {
+    hid_t rec = H5Gcreate(file, recordName(irec).c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    writeDataset(rec, "TriggerRecordHeader", vector<char>(48, 1));
+    hid_t tpc = H5Gcreate(rec, "TPC", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    hid_t apa = H5Gcreate(tpc, "APA000", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    for ( size_t ilnk=0; ilnk<nlnk; ++ilnk ) {
+      writeDataset(apa, linkName(ilnk), linkData(irec, ilnk, nframe));
+    }
+    // a link with only a header
+    writeDataset(apa, linkName(nlnk), vector<char>(headsz, 2));
+    H5Gclose(apa);
+    H5Gclose(tpc);
+    H5Gclose(rec);
+  }
+  H5Fclose(file);
+}
+
+herr_t addName(hid_t, const char* name, const H5L_info_t*, void* names) {
+  static_cast<std::deque<string>*>(names)->emplace_back(name);
+  return 0;
+}
+
+uint64_t hashBytes(const char* data, size_t nb) {
+  uint64_t sum = nb;
+  for ( size_t ib=0; ib<nb; ++ib ) sum = 31*sum + data[ib];
+  return sum;
+}
+
+// Read one record the way the data interface tools did.
+uint64_t readOld(hid_t file, string record) {
+  uint64_t sum = 0;
+  hid_t rec = H5Gopen(file, record.c_str(), H5P_DEFAULT);
+  hid_t tpc = H5Gopen(rec, "TPC", H5P_DEFAULT);
+  std::deque<string> apaNames;
+  hsize_t idx = 0;
+  H5Literate(tpc, H5_INDEX_NAME, H5_ITER_INC, &idx, addName, &apaNames);
+  hid_t apa = H5Gopen(tpc, apaNames[0].c_str(), H5P_DEFAULT);
+  std::deque<string> linkNames;
+  idx = 0;
+  H5Literate(apa, H5_INDEX_NAME, H5_ITER_INC, &idx, addName, &linkNames);
+  for ( const string& lnk : linkNames ) {
+    hid_t ds = H5Dopen(apa, lnk.c_str(), H5P_DEFAULT);
+    hsize_t ds_size = H5Dget_storage_size(ds);
+    if ( ds_size <= headsz ) {
+      H5Dclose(ds);
+      continue;
+    }
+    vector<char> ds_data(ds_size);
+    H5Dread(ds, H5T_STD_I8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, ds_data.data());
+    H5Dclose(ds);
+    sum += hashBytes(ds_data.data(), ds_data.size());
+  }
+  H5Gclose(apa);
+  H5Gclose(tpc);
+  H5Gclose(rec);
+  return sum;
+}
+
+// Read one record with the reader.  Reads only the headers if headonly.
+uint64_t readNew(HDF5FragmentReader& reader, hid_t file, string record, bool headonly) {
+  uint64_t sum = 0;
+  assert( reader.SetRecord(file, record) );
+  const vector<string>& apaNames = reader.Names("TPC");
+  string apaPath = "TPC/" + apaNames[0];
+  for ( const string& lnk : reader.Names(apaPath) ) {
+    string path = apaPath + "/" + lnk;
+    if ( reader.Size(path) <= headsz ) continue;
+    size_t nread = 0;
+    const char* data = reader.Read(path, nread, headonly ? headsz + framesz : 0);
+    assert( data != nullptr );
+    sum += hashBytes(data, nread);
+  }
+  return sum;
+}
+
+// Reset the peak resident size; false if the kernel does not support it.
+bool resetPeakRSS() {
+  std::ofstream fout("/proc/self/clear_refs");
+  fout << "5";
+  fout.close();
+  return fout.good();
+}
+
+// Peak resident size in MB.
+double peakRSS() {
+  std::ifstream fin("/proc/self/status");
+  string line;
+  while ( std::getline(fin, line) ) {
+    if ( line.compare(0, 6, "VmHWM:") == 0 ) return std::stod(line.substr(6))/1024.0;
+  }
+  return 0;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_HDF5FragmentReader(size_t nrec, size_t nlnk, size_t nframe) {
+  const string myname = "test_HDF5FragmentReader: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  const string fname = "test_HDF5FragmentReader.hdf5";
+
+  cout << myname << line << endl;
+  cout << myname << "Write " << nrec << " records of " << nlnk << " links x " << nframe << " frames." << endl;
+  writeFile(fname, nrec, nlnk, nframe);
+  hid_t file = H5Fopen(fname.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  assert( file >= 0 );
+
+  cout << myname << line << endl;
+  cout << myname << "Check names, sizes and data." << endl;
+  size_t linksz = headsz + nframe*framesz;
+  {
+    HDF5FragmentReader reader;
+    assert( ! reader.SetRecord(file, "NoSuchRecord") );
+    assert( reader.Names("").empty() );
+    size_t nread = 0;
+    assert( reader.Read("TPC/APA000/Link00", nread) == nullptr );
+    assert( reader.SetRecord(file, recordName(1)) );
+    assert( (reader.Names("") == vector<string>{"TPC", "TriggerRecordHeader"}) );
+    assert( reader.Names("TPC") == vector<string>{"APA000"} );
+    assert( reader.Names("TPC/APA000").size() == nlnk + 1 );
+    assert( reader.Names("TPC/APA001").empty() );
+    assert( reader.Size("TPC/APA000/NoSuchLink") == 0 );
+    assert( reader.Read("TPC/APA000/NoSuchLink", nread) == nullptr );
+    assert( nread == 0 );
+    for ( size_t ilnk=0; ilnk<nlnk; ++ilnk ) {
+      string path = "TPC/APA000/" + linkName(ilnk);
+      assert( reader.Size(path) == linksz );
+      vector<char> data = linkData(1, ilnk, nframe);
+      const char* head = reader.Read(path, nread, headsz);
+      assert( nread == headsz );
+      assert( std::memcmp(head, data.data(), headsz) == 0 );
+      const char* all = reader.Read(path, nread);
+      assert( nread == linksz );
+      assert( std::memcmp(all, data.data(), linksz) == 0 );
+      all = reader.Read(path, nread, 10*linksz);
+      assert( nread == linksz );
+    }
+    // handles are opened once per record
+    size_t nopen = reader.DatasetsOpened();
+    assert( nopen == nlnk );
+    for ( size_t ilnk=0; ilnk<nlnk; ++ilnk ) reader.Read("TPC/APA000/" + linkName(ilnk), nread);
+    assert( reader.DatasetsOpened() == nopen );
+    assert( reader.SetRecord(file, recordName(1)) );
+    reader.Read("TPC/APA000/Link00", nread);
+    assert( reader.DatasetsOpened() == nopen );
+    assert( reader.SetRecord(file, recordName(0)) );
+    const char* all = reader.Read("TPC/APA000/Link00", nread);
+    assert( reader.DatasetsOpened() == nopen + 1 );
+    vector<char> data = linkData(0, 0, nframe);
+    assert( std::memcmp(all, data.data(), linksz) == 0 );
+    assert( HDF5FragmentReader::BufferCapacity() >= linksz );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Time reading all records." << endl;
+  bool havepeak = resetPeakRSS();
+  if ( ! havepeak ) cout << myname << "  Peak RSS cannot be reset here: values are for the job so far." << endl;
+  vector<uint64_t> sumsold;
+  auto t0 = Clock::now();
+  for ( size_t irec=0; irec<nrec; ++irec ) sumsold.push_back(readOld(file, recordName(irec)));
+  double dtold = std::chrono::duration<double>(Clock::now() - t0).count();
+  double rssold = peakRSS();
+  cout << myname << "           old: " << 1000*dtold/nrec << " ms/event, peak RSS " << rssold << " MB" << endl;
+  for ( bool headonly : {false, true} ) {
+    resetPeakRSS();
+    HDF5FragmentReader reader;
+    t0 = Clock::now();
+    for ( size_t irec=0; irec<nrec; ++irec ) {
+      uint64_t sum = readNew(reader, file, recordName(irec), headonly);
+      if ( ! headonly ) assert( sum == sumsold[irec] );
+    }
+    double dt = std::chrono::duration<double>(Clock::now() - t0).count();
+    cout << myname << (headonly ? "  reader, head: " : "        reader: ") << 1000*dt/nrec
+         << " ms/event, peak RSS " << peakRSS() << " MB, "
+         << reader.BytesRead()/1.e6/nrec << " MB read/event" << endl;
+  }
+
+  H5Fclose(file);
+  std::remove(fname.c_str());
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nrec = 10;
+  size_t nlnk = 10;
+  size_t nframe = 2000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NREC [NLINK [NFRAME]]]" << endl;
+      cout << "  NREC [10]: Number of trigger records (at least 2)." << endl;
+      cout << "  NLINK [10]: Links per record." << endl;
+      cout << "  NFRAME [2000]: WIB frames per link." << endl;
+      return 0;
+    }
+    nrec = std::max(size_t(2), size_t(std::stoul(sarg)));
+  }
+  if ( argc > 2 ) nlnk = std::stoul(argv[2]);
+  if ( argc > 3 ) nframe = std::stoul(argv[3]);
+  return test_HDF5FragmentReader(nrec, nlnk, nframe);
+}
+
+//**********************************************************************
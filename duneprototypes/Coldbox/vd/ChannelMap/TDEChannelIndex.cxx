@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       ChannelIndex
+// File:        TDEChannelIndex.cxx
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "TDEChannelIndex.h"
+
+#include "cetlib_except/exception.h"
+
+#include <algorithm>
+
+namespace
+{
+  // largest dense table: the coldbox maps need a few thousand entries
+  const size_t max_table_size = 1 << 24;
+
+  size_t check_size( size_t n1, size_t n2, size_t n3, const char *name )
+  {
+    size_t n = n1 * n2 * n3;
+    if( n > max_table_size ) {
+      throw cet::exception("VDColdboxTDEChannelMap")
+	<<"Key range of "<<name<<" index is too large: "
+	<<n1<<" x "<<n2<<" x "<<n3<<"\n";
+    }
+    return n;
+  }
+}
+
+//
+// index the channel table
+void dune::tde::ChannelIndex::build( const ChannelTable &table )
+{
+  clear();
+  if( table.empty() ) return;
+
+  auto const &seqnidx = table.get<IndexRawSeqn>();
+  auto const &hwidx   = table.get<IndexCrateCardChan>();
+  auto const &crpidx  = table.get<IndexCrpViewChan>();
+  byseqn_.assign( seqnidx.begin(), seqnidx.end() );
+  byhw_.assign( hwidx.begin(), hwidx.end() );
+  bycrp_.assign( crpidx.begin(), crpidx.end() );
+
+  for( auto const &ch : byseqn_ ) {
+    ncrate_  = std::max( ncrate_,  ch.crate() + 1u );
+    ncard_   = std::max( ncard_,   ch.card() + 1u );
+    ncardch_ = std::max( ncardch_, ch.cardch() + 1u );
+    ncrp_    = std::max( ncrp_,    ch.crp() + 1u );
+    nview_   = std::max( nview_,   ch.view() + 1u );
+    nviewch_ = std::max( nviewch_, ch.viewch() + 1u );
+  }
+
+  seqnpos_.assign( check_size( byseqn_.back().seqn() + 1u, 1, 1, "seqn" ), -1 );
+  for( size_t i = 0; i < byseqn_.size(); ++i )
+    seqnpos_[ byseqn_[i].seqn() ] = i;
+
+  hwpos_.assign( check_size( ncrate_, ncard_, ncardch_, "crate/card/chan" ), -1 );
+  hwgrp_.assign( ncrate_ * ncard_ + 1, 0 );
+  for( size_t i = 0; i < byhw_.size(); ++i ) {
+    auto const &ch = byhw_[i];
+    unsigned igrp = ch.crate() * ncard_ + ch.card();
+    hwpos_[ igrp * ncardch_ + ch.cardch() ] = i;
+    hwgrp_[ igrp + 1 ] = i + 1;
+  }
+  // empty groups start where the previous one ends
+  for( size_t igrp = 1; igrp < hwgrp_.size(); ++igrp )
+    hwgrp_[igrp] = std::max( hwgrp_[igrp], hwgrp_[igrp - 1] );
+
+  crppos_.assign( check_size( ncrp_, nview_, nviewch_, "crp/view/chan" ), -1 );
+  crpgrp_.assign( ncrp_ * nview_ + 1, 0 );
+  for( size_t i = 0; i < bycrp_.size(); ++i ) {
+    auto const &ch = bycrp_[i];
+    unsigned igrp = ch.crp() * nview_ + ch.view();
+    crppos_[ igrp * nviewch_ + ch.viewch() ] = i;
+    crpgrp_[ igrp + 1 ] = i + 1;
+  }
+  for( size_t igrp = 1; igrp < crpgrp_.size(); ++igrp )
+    crpgrp_[igrp] = std::max( crpgrp_[igrp], crpgrp_[igrp - 1] );
+}
+
+//
+// drop the index
+void dune::tde::ChannelIndex::clear()
+{
+  byseqn_.clear();
+  byhw_.clear();
+  bycrp_.clear();
+  seqnpos_.clear();
+  hwpos_.clear();
+  crppos_.clear();
+  hwgrp_.clear();
+  crpgrp_.clear();
+  ncrate_ = ncard_ = ncardch_ = 0;
+  ncrp_   = nview_ = nviewch_ = 0;
+}
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       ChannelIndex
+// File:        TDEChannelIndex.h
+//
+// Frozen, array-backed index of a TDE ChannelTable for the queries made
+// per channel per event.  It is built once after the map is filled and
+// not changed after that.
+//
+// The channels are stored three times, sorted by
+//  - raw sequence number,
+//  - crate, card, card channel (same order as tag IndexCrateCardChan),
+//  - CRP, view, view channel (same order as tag IndexCrpViewChan).
+// Dense tables over the range of each key give the position of a channel
+// from (seqn), (crate, card, cardch) or (crp, view, viewch) with a single
+// array access, and the first/last position of each crate, card, CRP and
+// view.  Single lookups return a pointer to the channel, or nullptr if it
+// is not in the map; group lookups return an iterator range over the
+// sorted array.  Neither allocates.
+//
+// The pointers and ranges are valid until the index is rebuilt or
+// cleared.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef __VDCBTDE_CHANNEL_INDEX_H__
+#define __VDCBTDE_CHANNEL_INDEX_H__
+
+#include "TDEChannelTable.h"
+
+#include <boost/range/iterator_range.hpp>
+
+#include <vector>
+
+namespace dune
+{
+  namespace tde
+  {
+    class ChannelIndex
+    {
+    public:
+      typedef boost::iterator_range<const ChannelId*> Range;
+
+      ChannelIndex() {;}
+      explicit ChannelIndex( const ChannelTable &table ) { build( table ); }
+
+      // index a channel table; throws if the key ranges are too large
+      // for dense tables
+      void build( const ChannelTable &table );
+      void clear();
+
+      size_t size() const { return byseqn_.size(); }
+      bool empty() const { return byseqn_.empty(); }
+
+      // single channels
+      const ChannelId* find_by_seqn( unsigned seqn ) const
+      {
+	if( seqn >= seqnpos_.size() || seqnpos_[seqn] < 0 ) return nullptr;
+	return &byseqn_[ seqnpos_[seqn] ];
+      }
+
+      const ChannelId* find_by_crate_card_chan( unsigned crate, unsigned card,
+						unsigned chan ) const
+      {
+	if( crate >= ncrate_ || card >= ncard_ || chan >= ncardch_ ) return nullptr;
+	int pos = hwpos_[ (crate * ncard_ + card) * ncardch_ + chan ];
+	return (pos < 0) ? nullptr : &byhw_[pos];
+      }
+
+      const ChannelId* find_by_crp_view_chan( unsigned crp, unsigned view,
+					      unsigned chan ) const
+      {
+	if( crp >= ncrp_ || view >= nview_ || chan >= nviewch_ ) return nullptr;
+	int pos = crppos_[ (crp * nview_ + view) * nviewch_ + chan ];
+	return (pos < 0) ? nullptr : &bycrp_[pos];
+      }
+
+      // all channels ordered by seqn
+      Range all() const { return range( byseqn_, 0, byseqn_.size() ); }
+
+      // channels of a crate or card, ordered by card and card channel
+      Range find_by_crate( unsigned crate ) const
+      {
+	if( crate >= ncrate_ ) return Range();
+	return range( byhw_, hwgrp_[crate * ncard_], hwgrp_[(crate + 1) * ncard_] );
+      }
+
+      Range find_by_crate_card( unsigned crate, unsigned card ) const
+      {
+	if( crate >= ncrate_ || card >= ncard_ ) return Range();
+	unsigned igrp = crate * ncard_ + card;
+	return range( byhw_, hwgrp_[igrp], hwgrp_[igrp + 1] );
+      }
+
+      // channels of a CRP or view, ordered by view and view channel
+      Range find_by_crp( unsigned crp ) const
+      {
+	if( crp >= ncrp_ ) return Range();
+	return range( bycrp_, crpgrp_[crp * nview_], crpgrp_[(crp + 1) * nview_] );
+      }
+
+      Range find_by_crp_view( unsigned crp, unsigned view ) const
+      {
+	if( crp >= ncrp_ || view >= nview_ ) return Range();
+	unsigned igrp = crp * nview_ + view;
+	return range( bycrp_, crpgrp_[igrp], crpgrp_[igrp + 1] );
+      }
+
+    private:
+
+      static Range range( const std::vector<ChannelId> &vec, size_t first, size_t last )
+      {
+	return Range( vec.data() + first, vec.data() + last );
+      }
+
+      std::vector<ChannelId> byseqn_;
+      std::vector<ChannelId> byhw_;
+      std::vector<ChannelId> bycrp_;
+
+      // position in the sorted arrays, -1 if there is no such channel
+      std::vector<int> seqnpos_;
+      std::vector<int> hwpos_;
+      std::vector<int> crppos_;
+
+      // first position of each (crate, card) and (crp, view) group, with
+      // one entry past the last group
+      std::vector<unsigned> hwgrp_;
+      std::vector<unsigned> crpgrp_;
+
+      unsigned ncrate_  = 0;
+      unsigned ncard_   = 0;
+      unsigned ncardch_ = 0;
+      unsigned ncrp_    = 0;
+      unsigned nview_   = 0;
+      unsigned nviewch_ = 0;
+    };
+  }//tde
+} //namespace dune
+
+#endif
@@ -0,0 +1,97 @@
+// TDEChannelTable.h
+//
+// Channel identifier of the VD coldbox TDE channel map and the boost
+// multi_index_container that holds the map.  Split out of
+// VDColdboxTDEChannelMapService.h so that code without art, e.g.
+// TDEChannelIndex and its test, can use them.
+
+#ifndef __VDCBTDE_CHANNEL_TABLE_H__
+#define __VDCBTDE_CHANNEL_TABLE_H__
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/tuple/tuple.hpp>
+
+//
+using namespace boost::multi_index;
+
+//
+namespace dune
+{
+
+  namespace tde
+  {
+    //
+    class ChannelId
+    {
+    private:
+      unsigned seqn_;
+      unsigned short crate_, card_, cardch_;
+      unsigned short crp_, view_, viewch_;
+      //bool exists_;
+      unsigned short state_;
+    
+    public:
+    
+      ChannelId() {;}
+    ChannelId( unsigned seqn, 
+		  unsigned short crate, unsigned short card, unsigned short cardch, 
+		  unsigned short crp, unsigned short view, unsigned short viewch, 
+		  unsigned short state = 0 ) : 
+      seqn_(seqn), crate_(crate), card_(card), cardch_(cardch), crp_(crp), view_(view), viewch_(viewch), state_(state) {;}
+    
+      bool operator<(const ChannelId &rhs) const { return seqn_ < rhs.seqn_; }
+    
+      const unsigned seqn() const { return seqn_; }
+      const unsigned short crate() const { return crate_; }
+      const unsigned short card() const { return card_; }
+      const unsigned short cardch() const { return cardch_; }
+      const unsigned short crp() const { return crp_; }
+      const unsigned short view() const { return view_; }
+      const unsigned short viewch() const { return viewch_; }
+      const unsigned short state() const { return state_; }
+      const bool exists() const { return (state_ == 0); }
+    };
+
+
+    //
+    // define multi_index container to implement channel mapping
+    //
+
+    // container tags 
+    struct IndexRawSeqn{};
+    struct IndexRawSeqnHash{};   // hashed 
+    struct IndexCrate{};         // hashed
+    struct IndexCrateCard{};     // hashed
+    struct IndexCrateCardChan{}; // ordered
+    struct IndexCrateCardChanHash{}; 
+    struct IndexCrp{};           // hashed
+    struct IndexCrpView{};       // hashed 
+    struct IndexCrpViewChan{};   // ordered
+    struct IndexCrpViewChanHash{};
+  
+    // boost multi index container
+    typedef multi_index_container<
+      ChannelId,
+      indexed_by<
+      ordered_unique< tag<IndexRawSeqn>, const_mem_fun< ChannelId, const unsigned, &ChannelId::seqn > >,
+      hashed_unique< tag<IndexRawSeqnHash>, const_mem_fun< ChannelId, const unsigned, &ChannelId::seqn > >,
+      hashed_non_unique< tag<IndexCrate>, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate > >,
+      hashed_non_unique< tag<IndexCrateCard>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::card > > >,
+      ordered_unique< tag<IndexCrateCardChan>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::card >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::cardch > > >,
+      hashed_unique< tag<IndexCrateCardChanHash>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::card >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::cardch > > >,
+      hashed_non_unique< tag<IndexCrp>, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp > >,
+      hashed_non_unique< tag<IndexCrpView>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::view > > >,
+      ordered_unique< tag<IndexCrpViewChan>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::view >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::viewch > > >,
+      hashed_unique< tag<IndexCrpViewChanHash>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::view >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::viewch > > >
+      >
+      > ChannelTable; //
+
+  }//tde
+} //namespace dune
+
+#endif
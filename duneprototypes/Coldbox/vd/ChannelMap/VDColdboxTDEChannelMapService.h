@@ -32,6 +32,9 @@
 //  - CRP index, view index, and channel number, tag IndexCrpViewChan, to access 
 //    a given view channel in a given CRP
 // 
+// Once the map is filled it is frozen into an array-backed tde::ChannelIndex
+// (TDEChannelIndex.h), which answers the single channel and ordered queries.
+// 
 ////////////////////////////////////////////////////////////////////////
 
 #ifndef __VDCBTDE_CHANNEL_MAP_H__
@@ -41,97 +44,20 @@
 #include "art/Framework/Services/Registry/ServiceMacros.h"
 #include "fhiclcpp/ParameterSet.h"
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/mem_fun.hpp>
+#include "TDEChannelTable.h"
+#include "TDEChannelIndex.h"
+
 #include <boost/range/iterator_range.hpp>
-#include <boost/tuple/tuple.hpp>
 #include <boost/optional.hpp>
 
 #include <set>
 #include <vector>
 #include <string>
 
-//
-using namespace boost::multi_index;
-
 //
 namespace dune
 {
 
-  namespace tde
-  {
-    //
-    class ChannelId
-    {
-    private:
-      unsigned seqn_;
-      unsigned short crate_, card_, cardch_;
-      unsigned short crp_, view_, viewch_;
-      //bool exists_;
-      unsigned short state_;
-    
-    public:
-    
-      ChannelId() {;}
-    ChannelId( unsigned seqn, 
-		  unsigned short crate, unsigned short card, unsigned short cardch, 
-		  unsigned short crp, unsigned short view, unsigned short viewch, 
-		  unsigned short state = 0 ) : 
-      seqn_(seqn), crate_(crate), card_(card), cardch_(cardch), crp_(crp), view_(view), viewch_(viewch), state_(state) {;}
-    
-      bool operator<(const ChannelId &rhs) const { return seqn_ < rhs.seqn_; }
-    
-      const unsigned seqn() const { return seqn_; }
-      const unsigned short crate() const { return crate_; }
-      const unsigned short card() const { return card_; }
-      const unsigned short cardch() const { return cardch_; }
-      const unsigned short crp() const { return crp_; }
-      const unsigned short view() const { return view_; }
-      const unsigned short viewch() const { return viewch_; }
-      const unsigned short state() const { return state_; }
-      const bool exists() const { return (state_ == 0); }
-    };
-
-
-    //
-    // define multi_index container to implement channel mapping
-    //
-
-    // container tags 
-    struct IndexRawSeqn{};
-    struct IndexRawSeqnHash{};   // hashed 
-    struct IndexCrate{};         // hashed
-    struct IndexCrateCard{};     // hashed
-    struct IndexCrateCardChan{}; // ordered
-    struct IndexCrateCardChanHash{}; 
-    struct IndexCrp{};           // hashed
-    struct IndexCrpView{};       // hashed 
-    struct IndexCrpViewChan{};   // ordered
-    struct IndexCrpViewChanHash{};
-  
-    // boost multi index container
-    typedef multi_index_container<
-      ChannelId,
-      indexed_by<
-      ordered_unique< tag<IndexRawSeqn>, const_mem_fun< ChannelId, const unsigned, &ChannelId::seqn > >,
-      hashed_unique< tag<IndexRawSeqnHash>, const_mem_fun< ChannelId, const unsigned, &ChannelId::seqn > >,
-      hashed_non_unique< tag<IndexCrate>, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate > >,
-      hashed_non_unique< tag<IndexCrateCard>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::card > > >,
-      ordered_unique< tag<IndexCrateCardChan>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::card >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::cardch > > >,
-      hashed_unique< tag<IndexCrateCardChanHash>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crate >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::card >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::cardch > > >,
-      hashed_non_unique< tag<IndexCrp>, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp > >,
-      hashed_non_unique< tag<IndexCrpView>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::view > > >,
-      ordered_unique< tag<IndexCrpViewChan>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::view >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::viewch > > >,
-      hashed_unique< tag<IndexCrpViewChanHash>, composite_key< ChannelId, const_mem_fun< ChannelId, const unsigned short, &ChannelId::crp >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::view >, const_mem_fun< ChannelId, const unsigned short, &ChannelId::viewch > > >
-      >
-      > ChannelTable; //
-
-  }//tde
-
   //
   //
   //
@@ -179,6 +105,10 @@ namespace dune
 
     std::set< unsigned > get_crateidx(){ return crateidx_; }
     std::set< unsigned > get_crpidx(){ return crpidx_; }
+
+    // array-backed index built after the map is filled: O(1) lookups
+    // and group ranges without copies, for use per channel per event
+    const tde::ChannelIndex& get_index() const { return chanIndex_; }
     
   private:
     
@@ -225,6 +155,7 @@ namespace dune
     //
     int fLogLevel;
     tde::ChannelTable chanTable;
+    tde::ChannelIndex chanIndex_;
     std::string mapname_;
     std::set< unsigned > crateidx_;
     std::set< unsigned > crpidx_;
@@ -109,6 +109,9 @@ void dune::VDColdboxTDEChannelMapService::initMap( std::string mapname, unsigned
   else {
     simpleMap( ncrates, ncards, nviews );
   }
+
+  // freeze the map into the lookup index
+  chanIndex_.build( chanTable );
 }
 
 
@@ -117,6 +120,7 @@ void dune::VDColdboxTDEChannelMapService::initMap( std::string mapname, unsigned
 void dune::VDColdboxTDEChannelMapService::clearMap()
 {
   tde::ChannelTable().swap( chanTable );
+  chanIndex_.clear();
   ncrates_ = 0;
   ncrps_   = 0;
   ntot_    = 0;
@@ -177,9 +181,8 @@ void dune::VDColdboxTDEChannelMapService::add( unsigned seq, unsigned crate, uns
 //
 boost::optional<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_seqn( unsigned seqn ) const
 {
-  auto it = chanTable.get<dune::tde::IndexRawSeqnHash>().find( seqn );
-  if( it != chanTable.get<dune::tde::IndexRawSeqnHash>().end() )
-    return *it;
+  if( const ChannelId *id = chanIndex_.find_by_seqn( seqn ) )
+    return *id;
   
   return boost::optional<ChannelId>();
 }
@@ -221,8 +224,8 @@ std::vector<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crate( unsig
       return res;
     }
 
-  const auto r = chanTable.get<dune::tde::IndexCrateCardChan>().equal_range( boost::make_tuple(crate) );
-  std::vector<ChannelId> res(r.first, r.second);
+  const auto r = chanIndex_.find_by_crate( crate );
+  std::vector<ChannelId> res(r.begin(), r.end());
 
   return res;
 }
@@ -239,8 +242,8 @@ std::vector<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crate_card(
     }
   
   // ordered accodring to channel number
-  const auto r = chanTable.get<dune::tde::IndexCrateCardChan>().equal_range( boost::make_tuple( crate, card) );
-  std::vector<ChannelId> res(r.first, r.second);
+  const auto r = chanIndex_.find_by_crate_card( crate, card );
+  std::vector<ChannelId> res(r.begin(), r.end());
   
   return res;
 }
@@ -250,9 +253,8 @@ std::vector<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crate_card(
 boost::optional<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crate_card_chan( unsigned crate,
 								unsigned card, unsigned chan ) const
 {
-  auto it = chanTable.get<dune::tde::IndexCrateCardChanHash>().find( boost::make_tuple(crate, card, chan) );
-  if( it != chanTable.get<dune::tde::IndexCrateCardChanHash>().end() )
-    return *it;
+  if( const ChannelId *id = chanIndex_.find_by_crate_card_chan( crate, card, chan ) )
+    return *id;
   
   return boost::optional<ChannelId>();
 }
@@ -268,8 +270,8 @@ std::vector<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crp( unsigne
       return res;
     }
 
-  const auto r = chanTable.get<dune::tde::IndexCrpViewChan>().equal_range( crp );
-  std::vector<ChannelId> res(r.first, r.second);
+  const auto r = chanIndex_.find_by_crp( crp );
+  std::vector<ChannelId> res(r.begin(), r.end());
   //return res;
   return res;
 }
@@ -286,8 +288,8 @@ std::vector<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crp_view( un
     }
   
   // ordered accodring to channel number
-  const auto r = chanTable.get<dune::tde::IndexCrpViewChan>().equal_range( boost::make_tuple(crp, view) );
-  std::vector<ChannelId> res(r.first, r.second);
+  const auto r = chanIndex_.find_by_crp_view( crp, view );
+  std::vector<ChannelId> res(r.begin(), r.end());
   return res;
 }
 
@@ -296,9 +298,8 @@ std::vector<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crp_view( un
 boost::optional<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crp_view_chan( unsigned crp,
 											unsigned view, unsigned chan ) const
 {
-  auto it = chanTable.get<dune::tde::IndexCrpViewChanHash>().find( boost::make_tuple(crp, view, chan) );
-  if( it != chanTable.get<dune::tde::IndexCrpViewChanHash>().end() )
-    return *it;
+  if( const ChannelId *id = chanIndex_.find_by_crp_view_chan( crp, view, chan ) )
+    return *id;
   
   return boost::optional<ChannelId>();
 }
@@ -308,7 +309,7 @@ boost::optional<ChannelId> dune::VDColdboxTDEChannelMapService::find_by_crp_view
 int dune::VDColdboxTDEChannelMapService::MapToCRP(int seqch, int &crp, int &view, int &chv) const
 {
   crp = view = chv = -1;
-  if( boost::optional<ChannelId> id = find_by_seqn( (unsigned)seqch ) ) 
+  if( const ChannelId *id = chanIndex_.find_by_seqn( (unsigned)seqch ) )
     {
       if( !id->exists() ) return -1;
       crp  = id->crp();
@@ -325,7 +326,7 @@ int dune::VDColdboxTDEChannelMapService::MapToCRP(int seqch, int &crp, int &view
 int dune::VDColdboxTDEChannelMapService::MapToDAQ(int crp, int view, int chv, int &seqch) const
 {
   seqch = -1;
-  if( boost::optional<ChannelId> id = find_by_crp_view_chan( (unsigned)crp, (unsigned)view, (unsigned)chv ) )
+  if( const ChannelId *id = chanIndex_.find_by_crp_view_chan( (unsigned)crp, (unsigned)view, (unsigned)chv ) )
     {
       if( !id->exists() ) return -1;
       seqch = id->seqn();
@@ -0,0 +1,251 @@
+// test_TDEChannelIndex.cxx
+//
+// Test the array-backed TDE channel index against the multi_index
+// container it is built from, on a table laid out like the coldbox CRP2
+// map (crates of AMCs with 64 channels, three views plus one for the
+// unconnected channels) with one card missing.  Reports the time per
+// lookup for crate/card/chan and crp/view/chan queries and for a pass
+// over all channels of each CRP view, with each.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "duneprototypes/Coldbox/vd/ChannelMap/TDEChannelIndex.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::tde::ChannelId;
+using dune::tde::ChannelTable;
+using dune::tde::ChannelIndex;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+const unsigned ncrate = 5;
+const unsigned ncard = 10;
+const unsigned ncardch = 64;
+const unsigned nview = 3;
+
+// Fill the table: cards 8 and 9 of each crate are not connected and
+// their channels go to view 3; card 7 of crate 2 is absent.
+void fillTable(ChannelTable& tab) {
+  std::mt19937 rng(20220905);
+  vector<vector<unsigned>> viewchs(nview);
+  unsigned nconn = (ncrate*(ncard - 2) - 1)*ncardch;
+  for ( unsigned iview=0; iview<nview; ++iview ) {
+    for ( unsigned ich=0; ich<nconn/nview + 1; ++ich ) viewchs[iview].push_back(ich);
+    std::shuffle(viewchs[iview].begin(), viewchs[iview].end(), rng);
+  }
+  unsigned iconn = 0;
+  unsigned nachan = 0;
+  for ( unsigned crate=0; crate<ncrate; ++crate ) {
+    for ( unsigned card=0; card<ncard; ++card ) {
+      if ( crate == 2 && card == 7 ) continue;
+      for ( unsigned cch=0; cch<ncardch; ++cch ) {
+        unsigned seqn = (crate*ncard + card)*ncardch + cch;
+        if ( card >= ncard - 2 ) {
+          tab.insert(ChannelId(seqn, crate, card, cch, 0, nview, nachan++, 1));
+        } else {
+          unsigned view = iconn%nview;
+          tab.insert(ChannelId(seqn, crate, card, cch, 0, view, viewchs[view][iconn/nview], 0));
+          ++iconn;
+        }
+      }
+    }
+  }
+}
+
+bool same(const ChannelId& lhs, const ChannelId& rhs) {
+  return lhs.seqn() == rhs.seqn() && lhs.crate() == rhs.crate() && lhs.card() == rhs.card() &&
+         lhs.cardch() == rhs.cardch() && lhs.crp() == rhs.crp() && lhs.view() == rhs.view() &&
+         lhs.viewch() == rhs.viewch() && lhs.state() == rhs.state();
+}
+
+template<class Iter>
+bool sameRange(ChannelIndex::Range r, Iter first, Iter last) {
+  if ( size_t(std::distance(first, last)) != r.size() ) return false;
+  return std::equal(r.begin(), r.end(), first, same);
+}
+
+template<class Iter>
+bool samePtr(const ChannelId* pch, Iter it, Iter end) {
+  if ( it == end ) return pch == nullptr;
+  return pch != nullptr && same(*pch, *it);
+}
+
+double nsPer(Clock::time_point t0, size_t n) {
+  return 1.e9*std::chrono::duration<double>(Clock::now() - t0).count()/n;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_TDEChannelIndex(unsigned npass) {
+  const string myname = "test_TDEChannelIndex: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+
+  cout << myname << line << endl;
+  cout << myname << "Check an empty index." << endl;
+  ChannelTable tab;
+  ChannelIndex idx(tab);
+  assert( idx.empty() );
+  assert( idx.find_by_seqn(0) == nullptr );
+  assert( idx.find_by_crate_card_chan(0, 0, 0) == nullptr );
+  assert( idx.find_by_crp_view(0, 0).empty() );
+
+  cout << myname << line << endl;
+  cout << myname << "Build the index." << endl;
+  fillTable(tab);
+  idx.build(tab);
+  cout << myname << "  Channels: " << idx.size() << endl;
+  assert( idx.size() == tab.size() );
+  assert( sameRange(idx.all(), tab.get<dune::tde::IndexRawSeqn>().begin(),
+                    tab.get<dune::tde::IndexRawSeqn>().end()) );
+
+  cout << myname << line << endl;
+  cout << myname << "Check single channel lookups." << endl;
+  auto const& seqnidx = tab.get<dune::tde::IndexRawSeqnHash>();
+  auto const& hwidx = tab.get<dune::tde::IndexCrateCardChanHash>();
+  auto const& crpidx = tab.get<dune::tde::IndexCrpViewChanHash>();
+  for ( unsigned seqn=0; seqn<ncrate*ncard*ncardch + 10; ++seqn ) {
+    assert( samePtr(idx.find_by_seqn(seqn), seqnidx.find(seqn), seqnidx.end()) );
+  }
+  for ( unsigned crate=0; crate<=ncrate; ++crate ) {
+    for ( unsigned card=0; card<=ncard; ++card ) {
+      for ( unsigned cch=0; cch<=ncardch; ++cch ) {
+        assert( samePtr(idx.find_by_crate_card_chan(crate, card, cch),
+                        hwidx.find(boost::make_tuple(crate, card, cch)), hwidx.end()) );
+      }
+    }
+  }
+  for ( unsigned view=0; view<=nview + 1; ++view ) {
+    for ( unsigned vch=0; vch<2000; ++vch ) {
+      for ( unsigned crp : {0, 1} ) {
+        assert( samePtr(idx.find_by_crp_view_chan(crp, view, vch),
+                        crpidx.find(boost::make_tuple(crp, view, vch)), crpidx.end()) );
+      }
+    }
+  }
+  assert( idx.find_by_crate_card_chan(2, 7, 0) == nullptr );
+
+  cout << myname << line << endl;
+  cout << myname << "Check channel ranges." << endl;
+  auto const& hword = tab.get<dune::tde::IndexCrateCardChan>();
+  auto const& crpord = tab.get<dune::tde::IndexCrpViewChan>();
+  for ( unsigned crate=0; crate<=ncrate; ++crate ) {
+    auto r = hword.equal_range(boost::make_tuple(crate));
+    assert( sameRange(idx.find_by_crate(crate), r.first, r.second) );
+    for ( unsigned card=0; card<=ncard; ++card ) {
+      auto r = hword.equal_range(boost::make_tuple(crate, card));
+      assert( sameRange(idx.find_by_crate_card(crate, card), r.first, r.second) );
+    }
+  }
+  assert( idx.find_by_crate_card(2, 7).empty() );
+  for ( unsigned crp : {0, 1} ) {
+    auto r = crpord.equal_range(boost::make_tuple(crp));
+    assert( sameRange(idx.find_by_crp(crp), r.first, r.second) );
+    for ( unsigned view=0; view<=nview + 1; ++view ) {
+      auto r = crpord.equal_range(boost::make_tuple(crp, view));
+      assert( sameRange(idx.find_by_crp_view(crp, view), r.first, r.second) );
+    }
+  }
+  assert( idx.find_by_crp(0).size() == tab.size() );
+
+  cout << myname << line << endl;
+  cout << myname << "Time " << npass << " passes over all channels." << endl;
+  vector<ChannelId> chans(idx.all().begin(), idx.all().end());
+  size_t nlook = npass*chans.size();
+  unsigned long sum1 = 0;
+  unsigned long sum2 = 0;
+  auto t0 = Clock::now();
+  for ( unsigned ipass=0; ipass<npass; ++ipass ) {
+    for ( const ChannelId& ch : chans ) {
+      auto it = hwidx.find(boost::make_tuple(ch.crate(), ch.card(), ch.cardch()));
+      sum1 += it->seqn();
+    }
+  }
+  double nsmulti = nsPer(t0, nlook);
+  t0 = Clock::now();
+  for ( unsigned ipass=0; ipass<npass; ++ipass ) {
+    for ( const ChannelId& ch : chans ) {
+      sum2 += idx.find_by_crate_card_chan(ch.crate(), ch.card(), ch.cardch())->seqn();
+    }
+  }
+  double nsindex = nsPer(t0, nlook);
+  assert( sum1 == sum2 );
+  cout << myname << "   crate/card/chan: multi_index " << nsmulti << " ns, index " << nsindex << " ns" << endl;
+  t0 = Clock::now();
+  for ( unsigned ipass=0; ipass<npass; ++ipass ) {
+    for ( const ChannelId& ch : chans ) {
+      auto it = crpidx.find(boost::make_tuple(ch.crp(), ch.view(), ch.viewch()));
+      sum1 += it->seqn();
+    }
+  }
+  nsmulti = nsPer(t0, nlook);
+  t0 = Clock::now();
+  for ( unsigned ipass=0; ipass<npass; ++ipass ) {
+    for ( const ChannelId& ch : chans ) {
+      sum2 += idx.find_by_crp_view_chan(ch.crp(), ch.view(), ch.viewch())->seqn();
+    }
+  }
+  nsindex = nsPer(t0, nlook);
+  assert( sum1 == sum2 );
+  cout << myname << "     crp/view/chan: multi_index " << nsmulti << " ns, index " << nsindex << " ns" << endl;
+  // the service returned a vector copy of each view
+  t0 = Clock::now();
+  for ( unsigned ipass=0; ipass<npass; ++ipass ) {
+    for ( unsigned view=0; view<=nview; ++view ) {
+      auto r = crpord.equal_range(boost::make_tuple(0u, view));
+      vector<ChannelId> vchans(r.first, r.second);
+      for ( const ChannelId& ch : vchans ) sum1 += ch.seqn();
+    }
+  }
+  nsmulti = nsPer(t0, nlook);
+  t0 = Clock::now();
+  for ( unsigned ipass=0; ipass<npass; ++ipass ) {
+    for ( unsigned view=0; view<=nview; ++view ) {
+      for ( const ChannelId& ch : idx.find_by_crp_view(0, view) ) sum2 += ch.seqn();
+    }
+  }
+  nsindex = nsPer(t0, nlook);
+  assert( sum1 == sum2 );
+  cout << myname << "  CRP view ranges: multi_index " << nsmulti << " ns, index " << nsindex
+       << " ns per channel" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  unsigned npass = 200;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NPASS]" << endl;
+      cout << "  NPASS [200]: Number of timed passes over all channels." << endl;
+      return 0;
+    }
+    npass = std::stoul(sarg);
+  }
+  return test_TDEChannelIndex(npass);
+}
+
+//**********************************************************************
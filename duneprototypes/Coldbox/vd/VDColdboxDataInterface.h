@@ -11,6 +11,7 @@
 #include "artdaq-core/Data/Fragment.hh"
 #include "dunecore/DuneObj/PDSPTPCDataInterfaceParent.h"
 #include "daqdataformats/v3_3_3/Fragment.hpp"
+#include "duneprototypes/Coldbox/HDF5FragmentReader.h"
 #include <hdf5.h>
 
 typedef dunedaq::daqdataformats::Fragment duneFragment;
@@ -25,6 +26,7 @@ class VDColdboxDataInterface : public PDSPTPCDataInterfaceParent {
 
   VDColdboxDataInterface(fhicl::ParameterSet const& ps);
   ~VDColdboxDataInterface() {
+    fReader.Clear();
     if (fForceOpen) {
       H5Fclose(fHDFFile);
     }
@@ -55,7 +57,7 @@ class VDColdboxDataInterface : public PDSPTPCDataInterfaceParent {
 
   std::map<int,std::vector<std::string>> _input_labels_by_apa;
   void _collectRDStatus(std::vector<raw::RDStatus> &rdstatuses){};
-  void getFragmentsForEvent(hid_t the_group, RawDigits& raw_digits,
+  void getFragmentsForEvent(RawDigits& raw_digits,
                             RDTimeStamps &timestamps, int apano,
                             int maxchan);
   void getMedianSigma(const raw::RawDigit::ADCvector_t &v_adc, float &median,
@@ -69,6 +71,7 @@ class VDColdboxDataInterface : public PDSPTPCDataInterfaceParent {
   std::string fFileInfoLabel;
 
   int fMaxChan = 1000000;  // no maximum for now
+  dune::HDF5FragmentReader fReader;  // handles and read buffer for the current record
 
 };
 
@@ -7,7 +7,8 @@
 #include <sstream>
 #include <cstring>
 #include <string>
-#include "TMath.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
+#include "duneprototypes/Coldbox/HDF5FragmentReader.h"
 #include "TString.h"
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
@@ -37,49 +38,46 @@ void readFragmentsForEvent (art::Event &evt)
   std::cout << "HDF5 FileName: " << file_name << std::endl;
   
   // now look inside those "Top-Level Group Name" for "Detector type".
-  hid_t requestedGroup = getGroupFromPath(file_id, toplevel_groupname);
+  // Only the fragment headers are read.
+  dune::HDF5FragmentReader reader;
+  if (!reader.SetRecord(file_id, toplevel_groupname)) return;
 
-  std::deque<std::string> detectorTypeNames = getMidLevelGroupNames(requestedGroup);
+  const std::vector<std::string> & detectorTypeNames = reader.Names("");
   
   for (auto& detectorTypeName : detectorTypeNames)
     {
       if (detectorTypeName == "TPC" && detectorTypeName != "TriggerRecordHeader")
 	{
 	  std::cout << "  Detector type: " << detectorTypeName << std::endl;
-	  std::string geoPath = toplevel_groupname + "/" + detectorTypeName;
-	  hid_t geoGroup = getGroupFromPath(file_id,geoPath);
-	  std::deque<std::string> apaNames = getMidLevelGroupNames(geoGroup);
+	  const std::string & geoPath = detectorTypeName;
+	  const std::vector<std::string> & apaNames = reader.Names(geoPath);
 	  
 	  // loop over APAs
 	  for (auto& apaName : apaNames)
 	    {
 	      std::string apaGroupPath = geoPath + "/" + apaName;
 	      std::cout << "     Geo path: " << apaGroupPath << std::endl;
-	      hid_t linkGroup = getGroupFromPath(file_id,apaGroupPath);
-	      std::deque<std::string> linkNames = getMidLevelGroupNames(linkGroup);
+	      const std::vector<std::string> & linkNames = reader.Names(apaGroupPath);
 	      
 	      // loop over Links
 	      for (auto& linkName : linkNames)
 		{
 		  std::string dataSetPath = apaGroupPath + "/" + linkName;
 		  std::cout << "      Data Set Path: " << dataSetPath << std::endl;
-		  hid_t datasetid = H5Dopen(linkGroup,linkName.data(),H5P_DEFAULT);
-		  hsize_t ds_size = H5Dget_storage_size(datasetid);
+		  hsize_t ds_size = reader.Size(dataSetPath);
 		  std::cout << "      Data Set Size (bytes): " << ds_size << std::endl;
 		  
 		  if (ds_size < 80) continue;
 		  
-		  size_t narray = ds_size / sizeof(char);
-		  size_t rdr = ds_size % sizeof(char);
-		  if (rdr > 0 || narray == 0) narray++;
-		  char *ds_data = new char[narray];
-		  herr_t ecode = H5Dread(datasetid, H5T_STD_I8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, ds_data);
+		  size_t narray = 0;
+		  const char *ds_data = reader.Read(dataSetPath, narray, 80);
+		  if (ds_data == nullptr) continue;
 		  int firstbyte = ds_data[0];
 		  firstbyte &= 0xFF;
 		  int lastbyte = ds_data[narray-1];
 		  lastbyte &= 0xFF;
 		  
-		  std::cout << std::hex << "      Retrieved data: ecode: " << ecode << "  first byte: " << firstbyte
+		  std::cout << std::hex << "      Retrieved header: first byte: " << firstbyte
 			    << " last byte: " << lastbyte  << std::dec << std::endl;
 		  
 
@@ -147,8 +145,6 @@ void readFragmentsForEvent (art::Event &evt)
 		  memcpy(&geoidpadding, &ds_data[76], 4);
 		  std::cout << "   GeoID padding: " << std::dec << geoidpadding << std::endl;
 		  
-		  delete[] ds_data;  // free up memory
-
 		} 
 	    }
 	}
@@ -195,6 +191,8 @@ int VDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
   if (fForceOpen && (file_id != fPrevStoredHandle))
     {
       std::cout << "Opening" << std::endl;
+      fReader.Clear();
+      if (fHDFFile >= 0) H5Fclose(fHDFFile);
       fHDFFile = H5Fopen(file_name.data(), H5F_ACC_RDONLY, H5P_DEFAULT);
     }//If the handle is the same, fHDFFile won't change
   else if (!fForceOpen)
@@ -203,7 +201,11 @@ int VDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
     }
   fPrevStoredHandle = file_id;
   
-  hid_t the_group = getGroupFromPath(fHDFFile, toplevel_groupname);
+  if (!fReader.SetRecord(fHDFFile, toplevel_groupname))
+    {
+      std::cout << "Cannot open group " << toplevel_groupname << std::endl;
+      return 0;
+    }
   
   std::cout << "Retrieving Data for " << apalist.size() << " APA " << std::endl;
   
@@ -215,7 +217,7 @@ int VDColdboxDataInterface::retrieveDataForSpecifiedAPAs(art::Event &evt,
       int apano = i;
       std::cout << "apano: " << i << std::endl;
 
-      getFragmentsForEvent(the_group, raw_digits, rd_timestamps, apano, fMaxChan);
+      getFragmentsForEvent(raw_digits, rd_timestamps, apano, fMaxChan);
       
       //Currently putting in dummy values for the RD Statuses
       rdstatuses.clear();
@@ -241,7 +243,7 @@ int VDColdboxDataInterface::retrieveDataAPAListWithLabels(
 // This is designed to read 1APA/CRU, only for VDColdBox data. The function uses "apano", handed by DataPrep,
 // as an argument.
 void VDColdboxDataInterface::getFragmentsForEvent(
-    hid_t the_group, RawDigits& raw_digits, RDTimeStamps &timestamps,
+    RawDigits& raw_digits, RDTimeStamps &timestamps,
     int apano, int maxchan) {
 
   using namespace dune::HDF5Utils;
@@ -250,40 +252,58 @@ void VDColdboxDataInterface::getFragmentsForEvent(
 
   art::ServiceHandle<dune::VDColdboxChannelMapService> channelMap;
   
-  std::deque<std::string> det_types
-    = getMidLevelGroupNames(the_group);
+  const std::vector<std::string> & det_types = fReader.Names("");
 
   for (const auto & det : det_types)
     {
       if (det != "TPC") continue;
       //std::cout << "  Detector type:  " << det << std::endl;
-      hid_t geoGroup = getGroupFromPath(the_group, det);
-      std::deque<std::string> apaNames
-        = getMidLevelGroupNames(geoGroup);
+      const std::vector<std::string> & apaNames = fReader.Names(det);
       
       std::cout << "Size of apaNames: " << apaNames.size() << std::endl;
       std::cout << "apaNames[apano]: "  << apaNames[apano-1] << std::endl;
       
       // apaNames is a vector whose elements start at [0].
-      hid_t linkGroup = getGroupFromPath(geoGroup, apaNames[apano-1]);
-      std::deque<std::string> linkNames
-        = getMidLevelGroupNames(linkGroup);
+      std::string linkPath = det + "/" + apaNames[apano-1];
+      const std::vector<std::string> & linkNames = fReader.Names(linkPath);
       for (const auto & t : linkNames)
         {
-          hid_t dataset = H5Dopen(linkGroup, t.data(), H5P_DEFAULT);
-          hsize_t ds_size = H5Dget_storage_size(dataset);
+          std::string dataSetPath = linkPath + "/" + t;
+          hsize_t ds_size = fReader.Size(dataSetPath);
           if (ds_size <= sizeof(FragmentHeader)) continue; //Too small
-          
-          std::vector<char> ds_data(ds_size);
-          H5Dread(dataset, H5T_STD_I8LE, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                  ds_data.data());
-          H5Dclose(dataset);
+          size_t n_frames = (ds_size - sizeof(FragmentHeader))/sizeof(WIBFrame);
+
+          // read the fragment header and the first frame for the slot and
+          // fiber, and skip the rest if none of the channels is kept
+          size_t nread = 0;
+          const char * ds_data = fReader.Read(dataSetPath, nread, sizeof(FragmentHeader) + sizeof(WIBFrame));
+          if (ds_data == nullptr) continue;
+          uint32_t slot = 0, fiber = 0;
+          if (n_frames > 0)
+            {
+              auto frame = reinterpret_cast<const WIBFrame*>(ds_data + sizeof(FragmentHeader));
+              slot = frame->get_wib_header()->slot_no;
+              fiber = frame->get_wib_header()->fiber_no;
+            }
+          //std::cout << "slot, fiber: "  << slot << ", " << fiber << std::endl;
+          int offline_chans[256];
+          bool keep = false;
+          for (size_t iChan = 0; iChan < 256; ++iChan)
+            {
+              int offline_chan = channelMap->getOfflChanFromSlotFiberChan(slot, fiber, iChan);
+              if (offline_chan > maxchan) offline_chan = -1;
+              offline_chans[iChan] = offline_chan;
+              if (offline_chan >= 0) keep = true;
+            }
+          if (!keep) continue;
+
+          ds_data = fReader.Read(dataSetPath, nread);
+          if (ds_data == nullptr) continue;
           
           //Each fragment is a collection of WIB Frames
-          Fragment frag(&ds_data[0], Fragment::BufferAdoptionMode::kReadOnlyMode);
-          size_t n_frames = (ds_size - sizeof(FragmentHeader))/sizeof(WIBFrame);
+          Fragment frag(const_cast<char*>(ds_data), Fragment::BufferAdoptionMode::kReadOnlyMode);
           std::vector<raw::RawDigit::ADCvector_t> adc_vectors(256);
-          uint32_t slot = 0, fiber = 0;
+          for (auto & v_adc : adc_vectors) v_adc.reserve(n_frames);
           for (size_t i = 0; i < n_frames; ++i)
             {
               auto frame = reinterpret_cast<WIBFrame*>(static_cast<uint8_t*>(frag.get_data()) + i*sizeof(WIBFrame));
@@ -291,22 +311,14 @@ void VDColdboxDataInterface::getFragmentsForEvent(
                 {
                   adc_vectors[j].push_back(frame->get_channel(j));
                 }
-      	
-              if (i == 0)
-                {
-                  slot = frame->get_wib_header()->slot_no;
-                  fiber = frame->get_wib_header()->fiber_no;
-                }
             }
-          //std::cout << "slot, fiber: "  << slot << ", " << fiber << std::endl;
           for (size_t iChan = 0; iChan < 256; ++iChan)
             {
               const raw::RawDigit::ADCvector_t & v_adc = adc_vectors[iChan];
       	//std::cout << "Channel: " << iChan << " N ticks: " << v_adc.size() << " Timestamp: " << frag.get_trigger_timestamp() << std::endl;
 
-              int offline_chan = channelMap->getOfflChanFromSlotFiberChan(slot, fiber, iChan);
+              int offline_chan = offline_chans[iChan];
               if (offline_chan < 0) continue;
-	        if (offline_chan > maxchan) continue;
       	raw::RDTimeStamp rd_ts(frag.get_trigger_timestamp(), offline_chan);
               timestamps.push_back(rd_ts);
       	
@@ -318,7 +330,6 @@ void VDColdboxDataInterface::getFragmentsForEvent(
             }
           
         }
-      H5Gclose(linkGroup);
     }
   
 }
@@ -327,34 +338,15 @@ void VDColdboxDataInterface::getFragmentsForEvent(
 void VDColdboxDataInterface::getMedianSigma(
     const raw::RawDigit::ADCvector_t &v_adc, float &median,
     float &sigma) {
-  size_t asiz = v_adc.size();
-  int imed=0;
-  if (asiz == 0) {
-    median = 0;
-    sigma = 0;
-  }
-  else {
-    // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
-
-    imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-    median = imed;
-    sigma = TMath::RMS(asiz,v_adc.data());
-
-    // add in a correction suggested by David Adams, May 6, 2019
-
-    size_t s1 = 0;
-    size_t sm = 0;
-    for (size_t i = 0; i < asiz; ++i) {
-      if (v_adc.at(i) < imed) s1++;
-      if (v_adc.at(i) == imed) sm++;
-    }
-    if (sm > 0) {
-      float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-      //if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-      median += mcorr;
-    }
-  }
-  
+  // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+
+  dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+  ped.Fill(v_adc);
+
+  // integer median plus a correction suggested by David Adams, May 6, 2019
+
+  median = ped.CorrectedMedian();
+  sigma = ped.RMS();
 }
 
 DEFINE_ART_CLASS_TOOL(VDColdboxDataInterface)
@@ -10,7 +10,7 @@
 #include "lardataobj/RawData/RDTimeStamp.h"
 #include "canvas/Utilities/Exception.h"
 
-#include "TMath.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
 
 // DUNE includes
 #include "dunecore/DuneObj/RDStatus.h"
@@ -48,33 +48,15 @@ namespace
   void getMedianSigma(const raw::RawDigit::ADCvector_t &v_adc, 
 		      float &median,
 		      float &sigma) {
-    size_t asiz = v_adc.size();
-    int imed=0;
-    if (asiz == 0) {
-      median = 0;
-      sigma = 0;
-    }
-    else {
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+    // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
 
-      imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-      median = imed;
-      sigma = TMath::RMS(asiz,v_adc.data());
+    dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+    ped.Fill(v_adc);
 
-      // add in a correction suggested by David Adams, May 6, 2019
+    // integer median plus a correction suggested by David Adams, May 6, 2019
 
-      size_t s1 = 0;
-      size_t sm = 0;
-      for (size_t i = 0; i < asiz; ++i) {
-	if (v_adc.at(i) < imed) s1++;
-	if (v_adc.at(i) == imed) sm++;
-      }
-      if (sm > 0) {
-	float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-	//if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-	median += mcorr;
-      }
-    }
+    median = ped.CorrectedMedian();
+    sigma = ped.RMS();
   }
   
   void unpackData( const char *buf, size_t nb, bool cflag, 
@@ -222,7 +204,7 @@ namespace raw
     for( auto c: crpidx )
       {
 	// we take all channels in this CRP sorted by view and view channel
-	std::vector<dune::tde::ChannelId> chidx = channelMap->find_by_crp( c, true );
+	auto chidx = channelMap->get_index().find_by_crp( c );
 
 	// check if we want to keep only specific CRPs
 	bool keep = true;
@@ -249,7 +231,7 @@ namespace raw
 
 	
 	//std::cout<<chidx.size()<<std::endl;
-	for( auto id: chidx )
+	for( auto const &id: chidx )
 	  {
 	    // drop channels not connected to CRP
 	    if( !id.exists() ) continue;
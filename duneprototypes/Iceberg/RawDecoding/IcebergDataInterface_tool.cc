@@ -2,6 +2,7 @@
 
 #include "IcebergDataInterface.h"
 #include "TMath.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
 #include "TString.h"
 #include <iostream>
 #include <set>
@@ -1140,37 +1141,15 @@ bool IcebergDataInterface::_process_FELIX_AUX(art::Event &evt,
 
 void IcebergDataInterface::computeMedianSigma(raw::RawDigit::ADCvector_t &v_adc, float &median, float &sigma)
 {
-  size_t asiz = v_adc.size();
-  int imed=0;
-  if (asiz == 0)
-    {
-      median = 0;
-      sigma = 0;
-    }
-  else
-    {
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+  // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
 
-      imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-      median = imed;
-      sigma = TMath::RMS(asiz,v_adc.data());
+  dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+  ped.Fill(v_adc);
 
-      // add in a correction suggested by David Adams, May 6, 2019
+  // integer median plus a correction suggested by David Adams, May 6, 2019
 
-      size_t s1 = 0;
-      size_t sm = 0;
-      for (size_t i=0; i<asiz; ++i)
-        {
-          if (v_adc[i] < imed) s1++;
-          if (v_adc[i] == imed) sm++;
-        }
-      if (sm > 0)
-        {
-          float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-          //if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-          median += mcorr;
-        }
-    }
+  median = ped.CorrectedMedian();
+  sigma = ped.RMS();
 }
 
 DEFINE_ART_CLASS_TOOL(IcebergDataInterface)
@@ -24,7 +24,7 @@
 #include <cmath>
 
 // ROOT includes
-#include "TMath.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
 
 // artdaq and dunepdlegacy includes
 #include "dunepdlegacy/Services/ChannelMap/IcebergChannelMapService.h"
@@ -385,22 +385,12 @@ void IcebergFELIXBufferDecoderMarch2021::produce(art::Event &e)
 
 void IcebergFELIXBufferDecoderMarch2021::computeMedianSigma(raw::RawDigit::ADCvector_t &v_adc, float &median, float &sigma)
 {
-  size_t asiz = v_adc.size();
-  if (asiz == 0)
-    {
-      median = 0;
-      sigma = 0;
-    }
-  else
-    {
-      // this is actually faster than the code below by about one second per event.
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
-
-      median = TMath::Median(asiz,v_adc.data());
-      sigma = TMath::RMS(asiz,v_adc.data());
-    }
+  // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
 
-  //  std::cout << "sigma: " << sigma << std::endl;
+  dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+  ped.Fill(v_adc);
+  median = ped.Median();
+  sigma = ped.RMS();
 }
 
 void IcebergFELIXBufferDecoderMarch2021::unpack14(const uint32_t *packed, uint16_t *unpacked) {
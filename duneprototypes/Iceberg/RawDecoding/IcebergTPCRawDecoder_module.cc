@@ -25,7 +25,8 @@
 // ROOT includes
 #include "TH1.h"
 #include "TStyle.h"
-#include "TMath.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/RawDigitCompressor.h"
 
 // artdaq and dunepdlegacy includes
 #include "dunepdlegacy/Overlays/RceFragment.hh"
@@ -111,6 +112,7 @@ private:
   size_t        _felix_buffer_size_checklimit;
 
   bool          _compress_Huffman;
+  int           _max_concurrency;  // digits compressed in parallel: 1 = serial, 0 = no limit
   bool          _print_coldata_convert_count;
 
   //declare histogram data memebers
@@ -196,6 +198,7 @@ IcebergTPCRawDecoder::IcebergTPCRawDecoder(fhicl::ParameterSet const & p)
 
   _compress_Huffman = p.get<bool>("CompressHuffman",false);
   _print_coldata_convert_count = p.get<bool>("PrintColdataConvertCount",false);
+  _max_concurrency = p.get<int>("MaxConcurrency",1);
 
   produces<RawDigits>( _output_label ); //the strings in <> are the typedefs defined above
   produces<RDTimeStamps>( _output_label );
@@ -320,6 +323,12 @@ void IcebergTPCRawDecoder::produce(art::Event &e)
     }
   else
     {
+      // compress the kept digits together, on up to _max_concurrency threads
+      if (_compress_Huffman)
+        {
+          dune::RawDigitCompressor(raw::kHuffman,_max_concurrency).Compress(raw_digits);
+        }
+
       RDStatuses statuses;
       unsigned int statword=0;
       if (_DiscardedCorruptData) statword |= 1;
@@ -836,14 +845,8 @@ bool IcebergTPCRawDecoder::_process_RCE_AUX(
 
           auto uncompressed_nticks = v_adc.size();  // can be different from n_ticks due to padding of FEMB 302
 
-          raw::Compress_t cflag=raw::kNone;
-          if (_compress_Huffman)
-            {
-              cflag = raw::kHuffman;
-              raw::Compress(v_adc,cflag);
-            }
-          // here n_ticks is the uncompressed size as required by the constructor
-          raw::RawDigit raw_digit(offlineChannel, uncompressed_nticks, v_adc, cflag);
+          // compressed in produce if requested
+          raw::RawDigit raw_digit(offlineChannel, uncompressed_nticks, v_adc, raw::kNone);
           raw_digit.SetPedestal(median,sigma);
           raw_digits.push_back(raw_digit);  
 
@@ -1420,14 +1423,8 @@ bool IcebergTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawD
     computeMedianSigma(v_adc,median,sigma);
 
     auto n_ticks = v_adc.size();
-    raw::Compress_t cflag=raw::kNone;
-    if (_compress_Huffman)
-      {
-        cflag = raw::kHuffman;
-        raw::Compress(v_adc,cflag);
-      }
-    // here n_ticks is the uncompressed size as required by the constructor
-    raw::RawDigit raw_digit(offlineChannel, n_ticks, v_adc, cflag);
+    // compressed in produce if requested
+    raw::RawDigit raw_digit(offlineChannel, n_ticks, v_adc, raw::kNone);
     raw_digit.SetPedestal(median,sigma);
     raw_digits.push_back(raw_digit);
 
@@ -1470,22 +1467,12 @@ bool IcebergTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawD
 
 void IcebergTPCRawDecoder::computeMedianSigma(raw::RawDigit::ADCvector_t &v_adc, float &median, float &sigma)
 {
-  size_t asiz = v_adc.size();
-  if (asiz == 0)
-    {
-      median = 0;
-      sigma = 0;
-    }
-  else
-    {
-      // this is actually faster than the code below by about one second per event.
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
-
-      median = TMath::Median(asiz,v_adc.data());
-      sigma = TMath::RMS(asiz,v_adc.data());
-    }
+  // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
 
-  //  std::cout << "sigma: " << sigma << std::endl;
+  dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+  ped.Fill(v_adc);
+  median = ped.Median();
+  sigma = ped.RMS();
 }
 
 DEFINE_ART_MODULE(IcebergTPCRawDecoder)
@@ -0,0 +1,72 @@
+// MappedRawFile.cxx
+
+#include "MappedRawFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+  size_t pageSize() {
+    static const size_t sz = sysconf(_SC_PAGESIZE);
+    return sz;
+  }
+
+}
+
+//**********************************************************************
+
+dune::MappedRawFile::~MappedRawFile() {
+  Close();
+}
+
+//**********************************************************************
+
+void dune::MappedRawFile::Close() {
+  if (fMap != nullptr) munmap(fMap, fSize);
+  fMap = nullptr;
+  fSize = 0;
+  fReleased = 0;
+}
+
+//**********************************************************************
+
+bool dune::MappedRawFile::Open(const std::string & fname) {
+  Close();
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+  void * map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+  fMap = static_cast<char*>(map);
+  fSize = st.st_size;
+  madvise(fMap, fSize, MADV_SEQUENTIAL);
+  return true;
+}
+
+//**********************************************************************
+
+void dune::MappedRawFile::WillNeed(size_t offset, size_t nb) const {
+  nb = Available(offset, nb);
+  if (nb == 0) return;
+  size_t start = offset - offset%pageSize();
+  madvise(fMap + start, offset + nb - start, MADV_WILLNEED);
+}
+
+//**********************************************************************
+
+void dune::MappedRawFile::Release(size_t offset) {
+  if (fMap == nullptr) return;
+  if (offset > fSize) offset = fSize;
+  size_t end = offset - offset%pageSize();
+  if (end <= fReleased) return;
+  madvise(fMap + fReleased, end - fReleased, MADV_DONTNEED);
+  fReleased = end;
+}
@@ -0,0 +1,62 @@
+// MappedRawFile.h
+//
+// Read-only memory map of a dual-phase DAQ binary file.  The input
+// sources that read events through an event table (ProtoDUNE-DP and
+// 3x1x1) use it to decode each event in place from the mapped pages
+// instead of copying it into a buffer with ifstream::read.  art-independent.
+//
+// The whole file is mapped and the kernel is told it will be read
+// sequentially, so it reads ahead.  Release() drops the pages of events
+// that have been decoded, which keeps the resident size of a job near one
+// event rather than the whole file; released pages are read back from the
+// file if they are used again.
+
+#ifndef MappedRawFile_H
+#define MappedRawFile_H
+
+#include <cstddef>
+#include <string>
+
+namespace dune {
+
+  class MappedRawFile {
+
+  public:
+
+    MappedRawFile() = default;
+    ~MappedRawFile();
+    MappedRawFile(const MappedRawFile &) = delete;
+    MappedRawFile & operator=(const MappedRawFile &) = delete;
+
+    // Map a file.  Returns false, leaving nothing mapped, if the file
+    // cannot be opened or mapped, e.g. because it is empty.
+    bool Open(const std::string & fname);
+
+    void Close();
+
+    bool IsOpen() const { return fMap != nullptr; }
+    size_t Size() const { return fSize; }
+    const char * Data() const { return fMap; }
+
+    // Number of bytes that can be read at offset, at most nb.
+    size_t Available(size_t offset, size_t nb) const {
+      return offset >= fSize ? 0 : (nb < fSize - offset ? nb : fSize - offset);
+    }
+
+    // Ask the kernel to start reading [offset, offset + nb).
+    void WillNeed(size_t offset, size_t nb) const;
+
+    // Drop the pages entirely before offset from memory.
+    void Release(size_t offset);
+
+  private:
+
+    char * fMap = nullptr;
+    size_t fSize = 0;
+    size_t fReleased = 0;   // bytes before this offset have been released
+
+  };
+
+}
+
+#endif
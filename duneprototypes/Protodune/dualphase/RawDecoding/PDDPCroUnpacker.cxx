@@ -0,0 +1,113 @@
+// PDDPCroUnpacker.cxx
+
+#include "PDDPCroUnpacker.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PDDPCROUNPACKER_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  // First and second sample of the byte triplet at p.
+  inline short evenSample(const uint8_t * p) { return (p[0] << 4) | (p[1] >> 4); }
+  inline short oddSample(const uint8_t * p) { return ((p[1] & 0xf) << 8) | p[2]; }
+
+}
+
+//**********************************************************************
+
+void dune::PDDPCroUnpacker::UnpackChannels(const char * buf, size_t nb, size_t nsa,
+                                           size_t ich0, size_t ich1,
+                                           raw::RawDigit::ADCvector_t * out) {
+  const size_t ntot = NSamples(nb);
+  for (size_t ich = ich0; ich < ich1; ++ich) {
+    raw::RawDigit::ADCvector_t & adcs = out[ich - ich0];
+    adcs.resize(nsa);
+    size_t isam0 = std::min(ich*nsa, ntot);
+    size_t isam1 = std::min(isam0 + nsa, ntot);
+    UnpackSamples(buf, isam0, isam1, adcs.data());
+    std::fill(adcs.begin() + (isam1 - isam0), adcs.end(), 0);
+  }
+}
+
+//**********************************************************************
+
+void dune::PDDPCroUnpacker::UnpackSamples(const char * buf, size_t isam0, size_t isam1, short * out) {
+  static const auto kernel = HasAVX2() ? &Unpack12BitAVX2 : &Unpack12BitScalar;
+  if (isam1 <= isam0) return;
+  const uint8_t * bytes = reinterpret_cast<const uint8_t*>(buf);
+  size_t isam = isam0;
+  // a channel may start or end half way through a byte triplet
+  if (isam%2) {
+    *out++ = oddSample(bytes + 3*(isam/2));
+    ++isam;
+  }
+  size_t npair = (isam1 - isam)/2;
+  kernel(buf + 3*(isam/2), npair, out);
+  out += 2*npair;
+  isam += 2*npair;
+  if (isam < isam1) *out = evenSample(bytes + 3*(isam/2));
+}
+
+//**********************************************************************
+
+const char * dune::PDDPCroUnpacker::KernelName() {
+  return HasAVX2() ? "avx2" : "scalar";
+}
+
+//**********************************************************************
+
+void dune::PDDPCroUnpacker::Unpack12BitScalar(const char * buf, size_t npair, short * out) {
+  const uint8_t * p = reinterpret_cast<const uint8_t*>(buf);
+  for (size_t ipair = 0; ipair < npair; ++ipair, p += 3) {
+    *out++ = evenSample(p);
+    *out++ = oddSample(p);
+  }
+}
+
+//**********************************************************************
+
+#if defined(PDDPCROUNPACKER_HAVE_AVX2)
+
+bool dune::PDDPCroUnpacker::HasAVX2() {
+  static const bool has = __builtin_cpu_supports("avx2");
+  return has;
+}
+
+// Each 128-bit lane takes 12 bytes (4 triplets, 8 samples).  The bytes of
+// a triplet b0 b1 b2 are shuffled into two 16-bit words, b0b1 and b1b2;
+// the first sample is b0b1 >> 4 and the second b1b2 & 0xfff.  The two
+// lanes load 16 bytes each at offsets 0 and 12, so a step reads 28 bytes
+// and the last few pairs are left to the scalar loop.
+__attribute__((target("avx2")))
+void dune::PDDPCroUnpacker::Unpack12BitAVX2(const char * buf, size_t npair, short * out) {
+  const __m256i shuf = _mm256_setr_epi8(1, 0, 2, 1,  4, 3, 5, 4,  7, 6, 8, 7,  10, 9, 11, 10,
+                                        1, 0, 2, 1,  4, 3, 5, 4,  7, 6, 8, 7,  10, 9, 11, 10);
+  const __m256i mask = _mm256_set1_epi16(0xfff);
+  size_t ipair = 0;
+  for (; ipair + 10 <= npair; ipair += 8) {
+    const char * p = buf + 3*ipair;
+    __m256i raw = _mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    raw = _mm256_shuffle_epi8(raw, shuf);
+    __m256i first = _mm256_srli_epi16(raw, 4);
+    __m256i second = _mm256_and_si256(raw, mask);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2*ipair),
+                        _mm256_blend_epi16(first, second, 0xAA));
+  }
+  Unpack12BitScalar(buf + 3*ipair, npair - ipair, out + 2*ipair);
+}
+
+#else
+
+bool dune::PDDPCroUnpacker::HasAVX2() { return false; }
+
+void dune::PDDPCroUnpacker::Unpack12BitAVX2(const char * buf, size_t npair, short * out) {
+  Unpack12BitScalar(buf, npair, out);
+}
+
+#endif
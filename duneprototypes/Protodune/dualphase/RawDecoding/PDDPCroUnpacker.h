@@ -0,0 +1,60 @@
+// PDDPCroUnpacker.h
+//
+// Unpacker for the uncompressed ProtoDUNE-DP CRO data.  Each L1 event
+// builder fragment holds one continuous stream of 12-bit samples, two
+// samples in every three bytes (most significant bits first), with the
+// channels one after the other, nsa samples each.
+//
+// Channels are unpacked directly into per-channel ADC vectors, so a
+// fragment can be split into channel ranges that are decoded in
+// parallel.  The sample kernel has a portable scalar version and an AVX2
+// version; the AVX2 one is used when the CPU running the job supports
+// it.  The choice is made once, at first use.
+
+#ifndef PDDPCroUnpacker_H
+#define PDDPCroUnpacker_H
+
+#include <cstddef>
+
+#include "lardataobj/RawData/RawDigit.h"
+
+namespace dune {
+
+  class PDDPCroUnpacker {
+
+  public:
+
+    // Number of complete samples in nb bytes of packed data.
+    static size_t NSamples(size_t nb) { return 2*(nb/3); }
+
+    // Number of channels of nsa samples in nb bytes.  A trailing partial
+    // channel is counted; its missing samples are unpacked as zeros.
+    static size_t NChannels(size_t nb, size_t nsa) {
+      return nsa == 0 ? 0 : (NSamples(nb) + nsa - 1)/nsa;
+    }
+
+    // Unpack channels [ich0, ich1) of the nb bytes at buf.  Channel ich is
+    // written to out[ich - ich0], which is resized to nsa samples.
+    static void UnpackChannels(const char * buf, size_t nb, size_t nsa,
+                               size_t ich0, size_t ich1,
+                               raw::RawDigit::ADCvector_t * out);
+
+    // Unpack samples [isam0, isam1) of the stream at buf to out.
+    // Dispatches to the fastest kernel available on this CPU.
+    static void UnpackSamples(const char * buf, size_t isam0, size_t isam1, short * out);
+
+    // The pair kernels, exposed for testing: unpack npair byte triplets
+    // at buf into 2*npair samples.  Unpack12BitAVX2 must only be called
+    // if HasAVX2() is true.
+    static void Unpack12BitScalar(const char * buf, size_t npair, short * out);
+    static void Unpack12BitAVX2(const char * buf, size_t npair, short * out);
+    static bool HasAVX2();
+
+    // Name of the kernel UnpackSamples dispatches to: "avx2" or "scalar".
+    static const char * KernelName();
+
+  };
+
+}
+
+#endif
@@ -13,7 +13,11 @@
 
 #include "lardataobj/RawData/RawDigit.h"
 
+#include "PDDPWorkerPool.h"
+#include "MappedRawFile.h"
+
 #include <fstream>
+#include <memory>
 #include <string>
 
 
@@ -104,6 +108,17 @@ namespace lris
 
     // number of uncompressed samples per channel
     size_t __nsacro;
+
+    // threads unpacking the fragments of an event, kept for the whole job
+    unsigned __nthreads;
+    std::unique_ptr<dune::PDDPWorkerPool> __pool;
+
+    // event read buffer, reserved for the largest event in the file
+    std::vector<BYTE> __evbuf;
+
+    // time spent reading and unpacking events in the current file
+    double   __decodeTime;
+    uint32_t __decodedEvents;
     
     // close binary file
     void __close();
@@ -111,8 +126,12 @@ namespace lris
     // read a chunk of binary data
     void __readChunk( std::vector<BYTE> &bytes, size_t sz );
 
+    // position in the file and skip forward in either input mode
+    std::streampos __tell();
+    bool __skip( size_t sz );
+
     // unpack binary data written by each L1 evb builder
-    bool __unpackEvent( std::vector<BYTE> &buf, DaqEvent &event );
+    bool __unpackEvent( const BYTE *buf, size_t nb, DaqEvent &event );
 
     //
     std::string __getProducerLabel( std::string &lbl );
@@ -130,6 +149,11 @@ namespace lris
     // input file
     size_t __filesz;
     std::ifstream __file;
+
+    // memory-mapped input, used instead of __file if UseMmap is set
+    bool __useMmap;
+    dune::MappedRawFile __map;
+    size_t __mappos;
     unsigned __file_seqno;
 
     // header sizes
@@ -160,7 +184,8 @@ namespace lris
     {
       eveinfo_t ei;
       const BYTE* bytes;
-      adcbuf_t crodata;
+      size_t nch;   // number of CRO channels
+      size_t ich0;  // index of first channel in the event
       //adcbuf_t lrodata;
     } fragment_t;
 
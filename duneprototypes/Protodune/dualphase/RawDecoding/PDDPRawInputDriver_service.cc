@@ -20,10 +20,10 @@
 #include "PDDPRawInputDriver.h"
 
 #include "PDDPChannelMap.h"
+#include "PDDPCroUnpacker.h"
 
 #include <exception>
-#include <thread>
-#include <mutex>
+#include <chrono>
 #include <regex>
 #include <sstream>
 #include <iterator>
@@ -48,52 +48,6 @@ using UIntVec = std::vector<unsigned>;
 //
 namespace 
 {
-  void unpackCroData( const char *buf, size_t nb, bool cflag, 
-		      unsigned nsa, adcbuf_t &data )
-  {
-    //data.clear();
-    if( !cflag ) // unpack the uncompressed data into RawDigit
-      {
-	data.push_back( raw::RawDigit::ADCvector_t(nsa) );
-	size_t sz = 0;
-	const BYTE* start = buf;
-	const BYTE* stop  = start + nb;
-	while(start!=stop)
-	  {
-	    BYTE v1 = *start++;
-	    BYTE v2 = *start++;
-	    BYTE v3 = *start++;
-	    
-	    uint16_t tmp1 = ((v1 << 4) + ((v2 >> 4) & 0xf)) & 0xfff;
-	    uint16_t tmp2 = (((v2 & 0xf) << 8 ) + (v3 & 0xff)) & 0xfff;
-	    
-	    // if( offset > 0 ) // invert baseline: tmp fix for the signal inversion
-	    //   {
-	    // 	float ftmp1 = offset - tmp1;
-	    // 	if( ftmp1 < 0 ) ftmp1 = 0;
-	    // 	tmp1 = (uint16_t)(ftmp1);
-		
-	    // 	float ftmp2 = offset - tmp2;
-	    // 	if( ftmp2 < 0 ) ftmp2 = 0;
-	    // 	tmp2 = (uint16_t)(ftmp2);
-	    //   }
-	    
-	    if( sz == nsa ){ data.push_back(raw::RawDigit::ADCvector_t(nsa)); sz = 0; }
-	    data.back()[sz++] = (short)tmp1;
-	    
-	    if( sz == nsa ){ data.push_back(raw::RawDigit::ADCvector_t(nsa)); sz = 0; }
-	    data.back()[sz++] = (short)tmp2;
-	  }
-      }
-    else
-      //TODO finalize the format of compressed data
-      //     the data for each channel should be preceeded by size in words
-      {
-	// should not happen ...
-	mf::LogError(__FUNCTION__)<<"The format for the compressed data is to be defined";
-      }  
-  }
-
   // get byte content for a given data type
   // NOTE: cast assumes host byte order
   template<typename T> T ConvertToValue(const void *in)
@@ -127,7 +81,10 @@ namespace lris
     __sourceHelper( pm ),
     __currentSubRunID(),
     __eventCtr( 0 ),
-    __eventNum( 0 )
+    __eventNum( 0 ),
+    __decodeTime( 0 ),
+    __decodedEvents( 0 ),
+    __mappos( 0 )
   {
     const std::string myname = "PDDPRawInputDriver::ctor: ";
     
@@ -137,6 +94,8 @@ namespace lris
     __outlbl_status  = pset.get<std::string>("OutputLabelRDStatus", "daq");
     auto vecped_crps = pset.get<std::vector<UIntVec>>("InvertBaseline", std::vector<UIntVec>());
     auto select_crps = pset.get<std::vector<unsigned>>("SelectCRPs", std::vector<unsigned>());
+    __nthreads       = pset.get<unsigned>("UnpackThreads", 1);
+    __useMmap        = pset.get<bool>("UseMmap", false);
         
     std::map<unsigned, unsigned> invped_crps;
     if( !vecped_crps.empty() ){
@@ -175,6 +134,8 @@ namespace lris
 	    std::cout<< "[ "<<m.first<<", "<<m.second<<" ] ";
 	  std::cout<<std::endl;
 	}
+	std::cout << myname << "       UnpackThreads        : " << __nthreads << std::endl;
+	std::cout << myname << "       UseMmap              : " << __useMmap << std::endl;
       }
 
     __prodlbl_digits = __getProducerLabel( __outlbl_digits );
@@ -196,6 +157,12 @@ namespace lris
     __nsacro = 10000;
 
     // could also use pset if more parametres are needed (e.g., for LRO data)
+
+    // worker threads for the fragment unpacking
+    __pool.reset( new dune::PDDPWorkerPool( __nthreads ) );
+    if( __logLevel >= 1 )
+      std::cout << myname << "       Unpack pool size     : " << __pool->Size()
+		<< " (" << dune::PDDPCroUnpacker::KernelName() << " kernel)" << std::endl;
     
     //
     // channel map order by CRP View 
@@ -266,19 +233,30 @@ namespace lris
     fb = new art::FileBlock(art::FileFormatVersion(1, "DPPD RawInput 2019"), name);
     
     //
-    __file.open( name.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
-
-    if( !__file.is_open() )
+    if( __useMmap )
       {
-	throw art::Exception( art::errors::FileOpenError )
-	  << "Error opening binary file " << name << std::endl;
+	if( __map.Open( name ) )
+	  __filesz = __map.Size();
+	else
+	  mf::LogWarning(__FUNCTION__)<<"Could not map "<<name<<", reading it with ifstream";
       }
+
+    if( !__map.IsOpen() )
+      {
+	__file.open( name.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+
+	if( !__file.is_open() )
+	  {
+	    throw art::Exception( art::errors::FileOpenError )
+	      << "Error opening binary file " << name << std::endl;
+	  }
     
-    // get file size
-    __filesz = __file.tellg();
+	// get file size
+	__filesz = __file.tellg();
   
-    // move to beginning
-    __file.seekg(0, std::ios::beg);
+	// move to beginning
+	__file.seekg(0, std::ios::beg);
+      }
   
     // unpack event table
     if( __unpack_evtable() == 0 )
@@ -288,6 +266,10 @@ namespace lris
 	  << "File " << name << " does not have any events"<< std::endl;
       }
 
+    // one read buffer large enough for any event in the file
+    if( !__map.IsOpen() )
+      __evbuf.reserve( *std::max_element( __evsz.begin(), __evsz.end() ) );
+
     __currentSubRunID = art::SubRunID();
     __file_seqno      = __get_file_seqno( name );
   }
@@ -308,21 +290,45 @@ namespace lris
 	return false;
       }
     
-    // move to the next file position
-    if( __events[ __eventCtr ] != __file.tellg() )
-      __file.seekg( __events[ __eventCtr ], std::ios::beg );
+    auto t0 = std::chrono::steady_clock::now();
+
     size_t bsz = __evsz[ __eventCtr ];
+    const BYTE *evdata = nullptr;
+    if( __map.IsOpen() )
+      {
+	// decode straight from the mapped file
+	size_t pos = std::streamoff( __events[ __eventCtr ] );
+	bsz    = __map.Available( pos, bsz );
+	evdata = __map.Data() + pos;
+	// have the next event read in while this one is unpacked
+	if( __eventCtr + 1 < __eventNum )
+	  __map.WillNeed( std::streamoff( __events[ __eventCtr + 1 ] ), __evsz[ __eventCtr + 1 ] );
+      }
+    else
+      {
+	// move to the next file position
+	if( __events[ __eventCtr ] != __file.tellg() )
+	  __file.seekg( __events[ __eventCtr ], std::ios::beg );
     
-    std::vector<BYTE> buf;
-    __readChunk( buf, bsz );
-    
-    // increment our event counter
-    __eventCtr++;
+	__readChunk( __evbuf, bsz );
+	evdata = __evbuf.data();
+	bsz    = __evbuf.size();
+      }
     
     DaqEvent event;
     //bool ok = 
-    __unpackEvent( buf, event );
+    __unpackEvent( evdata, bsz, event );
     // not sure what art wants me to do here if this was not ok ???
+
+    // the event has been copied into the ADC vectors
+    if( __map.IsOpen() )
+      __map.Release( std::streamoff( __events[ __eventCtr ] ) + bsz );
+    
+    // increment our event counter
+    __eventCtr++;
+
+    __decodeTime += std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+    __decodedEvents++;
     
     art::RunNumber_t rn     = event.runnum;
     art::SubRunNumber_t srn = __file_seqno; // seq no from file name
@@ -446,14 +452,31 @@ namespace lris
   {
     if(__file.is_open())
       __file.close();  
+    __map.Close();
+    __mappos = 0;
   
     __filesz = 0;
+
+    if( __decodedEvents > 0 && __decodeTime > 0 )
+      mf::LogInfo(__FUNCTION__)<<"Read and unpacked "<<__decodedEvents<<" events in "
+			       <<__decodeTime<<" s: "<<__decodedEvents / __decodeTime
+			       <<" events/s with "<<__pool->Size()<<" threads";
+    __decodeTime    = 0;
+    __decodedEvents = 0;
   }
 
   //
   // read a chunk of bytes from file
   void PDDPRawInputDriver::__readChunk( std::vector<BYTE> &bytes, size_t sz )
   {
+    if( __map.IsOpen() )
+      {
+	size_t nb = __map.Available( __mappos, sz );
+	bytes.assign( __map.Data() + __mappos, __map.Data() + __mappos + nb );
+	__mappos += nb;
+	return;
+      }
+
     bytes.resize( sz );
     __file.read( &bytes[0], sz );
     if( !__file )
@@ -467,6 +490,34 @@ namespace lris
       }
   }
 
+  //
+  // current read position
+  std::streampos PDDPRawInputDriver::__tell()
+  {
+    if( __map.IsOpen() ) return std::streamoff( __mappos );
+    return __file.tellg();
+  }
+
+  //
+  // move the read position forward
+  bool PDDPRawInputDriver::__skip( size_t sz )
+  {
+    if( __map.IsOpen() )
+      {
+	if( __mappos + sz > __filesz ) return false;
+	__mappos += sz;
+	return true;
+      }
+
+    __file.seekg( sz, std::ios::cur );
+    if( !__file )
+      {
+	__file.clear();
+	return false;
+      }
+    return true;
+  }
+
   //
   // unpack the header with event table
   unsigned PDDPRawInputDriver::__unpack_evtable()
@@ -525,19 +576,17 @@ namespace lris
     __events.clear();
   
     // first event is at the current position
-    __events.push_back( __file.tellg() );
+    __events.push_back( __tell() );
     for(size_t i=0; i < __evsz.size()-1; i++)
       {
-	__file.seekg( __evsz[i], std::ios::cur );
-	if( !__file )
+	if( !__skip( __evsz[i] ) )
 	  {
 	    mf::LogError(__FUNCTION__)<<"Event table does not match file size";
-	    __file.clear();
 	    __evsz.resize( __events.size() );
 	    __eventNum = __events.size();
 	    break;
 	  }
-	__events.push_back( __file.tellg() );
+	__events.push_back( __tell() );
       }
   
     //for( auto e : __events ) std::cout<<e<<"\n";
@@ -605,22 +654,32 @@ namespace lris
   
   //
   //
-  bool PDDPRawInputDriver::__unpackEvent( std::vector<BYTE> &buf, DaqEvent &event )
+  bool PDDPRawInputDriver::__unpackEvent( const BYTE *buf, size_t nb, DaqEvent &event )
   {
     // fragments from each L1 builder
     std::vector<fragment_t> frags;
   
-    unsigned idx = 0;
+    size_t idx = 0;
     for(;;)
       {
 	fragment_t afrag;
-	if( idx >= buf.size() ) break;
+	if( idx >= nb ) break;
+	if( idx + evinfoSz > nb )
+	  {
+	    mf::LogError(__FUNCTION__)<<"Truncated fragment header";
+	    break;
+	  }
 	unsigned rval = __unpack_eve_info( &buf[idx], afrag.ei );
 	if( rval == 0 ) return false;
 	idx += rval;
 	// set point to the binary data
 	afrag.bytes = &buf[idx];
 	size_t dsz = afrag.ei.evszcro + afrag.ei.evszlro;
+	if( idx + dsz > nb )
+	  {
+	    mf::LogError(__FUNCTION__)<<"Fragment data exceeds the event size";
+	    break;
+	  }
 	idx += dsz;
 	idx += 1; // "Bruno byte"
       
@@ -645,29 +704,46 @@ namespace lris
 	frags.push_back( afrag );
       }
   
+    if( frags.empty() ) return false;
+
     //mf::LogDebug(__FUNCTION__)<<"number of fragments "<<frags.size()<<"\n";
     // 
-    std::mutex iomutex;
-    std::vector<std::thread> threads(frags.size() - 1);
-    unsigned nsa    = __nsacro;
-    //unsigned invped = __invped;
-    for (unsigned i = 1; i<frags.size(); ++i) 
+    // the channels of all fragments are allocated up front and unpacked
+    // in place, in blocks of channels shared out among the pool threads
+    size_t nsa   = __nsacro;
+    size_t nchtot = 0;
+    for( auto &f : frags )
       {
-	auto afrag = frags.begin() + i;
-	threads[i-1] = std::thread([&iomutex, i, nsa, afrag] {
-	    {
-	      std::lock_guard<std::mutex> iolock(iomutex);
-	      // make it look like we're using i so clang doesn't complain.  This had been commented out
-	      //msg_info << "Unpack thread #" << i << " is running\n";
-	      if (i==100000) std::cout << "Unpack thread #" << i << " is running\n";
-	    }
-	    //unpackLROData( f0->bytes, f0->ei.evszlro, ... );
-	    unpackCroData( afrag->bytes + afrag->ei.evszlro, afrag->ei.evszcro, 
-			   GETDCFLAG(afrag->ei.runflags), nsa, afrag->crodata);
-	  });
+	f.nch  = 0;
+	f.ich0 = nchtot;
+	if( GETDCFLAG(f.ei.runflags) )
+	  {
+	    //TODO finalize the format of compressed data
+	    //     the data for each channel should be preceeded by size in words
+	    // should not happen ...
+	    mf::LogError(__FUNCTION__)<<"The format for the compressed data is to be defined";
+	    continue;
+	  }
+	f.nch   = dune::PDDPCroUnpacker::NChannels( f.ei.evszcro, nsa );
+	nchtot += f.nch;
       }
+    event.crodata.resize( nchtot );
+
+    const size_t blocksz = 64;
+    std::vector<std::pair<const fragment_t*, size_t>> blocks;
+    for( auto const &f : frags )
+      for( size_t ich=0; ich<f.nch; ich+=blocksz )
+	blocks.emplace_back( &f, ich );
+
+    __pool->Run( blocks.size(), [&event, &blocks, nsa, blocksz]( size_t iblk ) {
+	const fragment_t &f = *blocks[iblk].first;
+	size_t ich0 = blocks[iblk].second;
+	size_t ich1 = std::min( ich0 + blocksz, f.nch );
+	//unpackLROData( f.bytes, f.ei.evszlro, ... );
+	dune::PDDPCroUnpacker::UnpackChannels( f.bytes + f.ei.evszlro, f.ei.evszcro, nsa,
+					       ich0, ich1, &event.crodata[f.ich0 + ich0] );
+      });
   
-    // unpack first fragment in the main thread
     auto f0 = frags.begin();
     event.good      = EVDQFLAG( f0->ei.evflag );
     event.runnum    = f0->ei.runnum;
@@ -680,30 +756,17 @@ namespace lris
     event.trignum   = f0->ei.ti.num;
     event.trigstamp = f0->ei.ti.ts;
   
-    //unpackLROData( f0->bytes, f0->ei.evszlro, ... );
-    unpackCroData( f0->bytes + f0->ei.evszlro, f0->ei.evszcro, GETDCFLAG(f0->ei.runflags),
-		   nsa, event.crodata );
-    
     event.compression = raw::kNone;
     // the compression should be set for all L1 event builders, 
     // since this depends on loaded AMC firmware
     if( GETDCFLAG(f0->ei.runflags) ) 
       event.compression = raw::kHuffman;
   
-    // wait for other threads to complete
-    for (auto& t : threads) t.join();
-  
-    // merge with other fragments
+    // merge flags of the other fragments
     for (auto it = frags.begin() + 1; it != frags.end(); ++it )
       {
 	event.good = ( event.good && EVDQFLAG( it->ei.evflag ) );
 	event.evflags.push_back( it->ei.evflag );
-	
-	// 
-	event.crodata.reserve(event.crodata.size() + it->crodata.size() );
-	std::move( std::begin( it->crodata ), std::end( it->crodata ), 
-		   std::back_inserter( event.crodata ));
-	it->crodata.clear();
       }
   
     return true;
@@ -0,0 +1,89 @@
+// PDDPWorkerPool.cxx
+
+#include "PDDPWorkerPool.h"
+
+#include <algorithm>
+
+//**********************************************************************
+
+dune::PDDPWorkerPool::PDDPWorkerPool(unsigned nthread)
+  : fGeneration(0), fBusy(0), fStop(false), fFunc(nullptr), fNTask(0), fNext(0) {
+  if (nthread == 0) nthread = std::max(1u, std::thread::hardware_concurrency());
+  fWorkers.reserve(nthread - 1);
+  for (unsigned ithr = 1; ithr < nthread; ++ithr) fWorkers.emplace_back(&PDDPWorkerPool::Work, this);
+}
+
+//**********************************************************************
+
+dune::PDDPWorkerPool::~PDDPWorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fStart.notify_all();
+  for (auto & thr : fWorkers) thr.join();
+}
+
+//**********************************************************************
+
+void dune::PDDPWorkerPool::Run(size_t ntask, const Task & func) {
+  if (ntask == 0) return;
+  const bool parallel = !fWorkers.empty() && ntask > 1;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fFunc = &func;
+    fNTask = ntask;
+    fNext = 0;
+    fError = nullptr;
+    if (parallel) {
+      fBusy = fWorkers.size();
+      ++fGeneration;
+    }
+  }
+  if (parallel) fStart.notify_all();
+  Drain();
+  std::exception_ptr err;
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fDone.wait(lock, [this] { return fBusy == 0; });
+    fFunc = nullptr;
+    err = fError;
+  }
+  if (err) std::rethrow_exception(err);
+}
+
+//**********************************************************************
+
+void dune::PDDPWorkerPool::Drain() {
+  for (;;) {
+    size_t itask = fNext++;
+    if (itask >= fNTask) return;
+    try {
+      (*fFunc)(itask);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(fMutex);
+      if (!fError) fError = std::current_exception();
+    }
+  }
+}
+
+//**********************************************************************
+
+void dune::PDDPWorkerPool::Work() {
+  unsigned long seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fStart.wait(lock, [this, seen] { return fStop || fGeneration != seen; });
+      if (fStop) return;
+      seen = fGeneration;
+    }
+    Drain();
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      last = --fBusy == 0;
+    }
+    if (last) fDone.notify_one();
+  }
+}
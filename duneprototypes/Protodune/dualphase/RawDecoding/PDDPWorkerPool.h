@@ -0,0 +1,69 @@
+// PDDPWorkerPool.h
+//
+// Fixed set of worker threads kept alive for the whole job, used by the
+// ProtoDUNE-DP raw input driver to unpack the L1 event builder fragments
+// of each event without creating threads per event.
+//
+// Run(ntask, func) calls func(i) for every i in [0, ntask) and returns
+// when all calls are done.  The calling thread takes tasks as well, so a
+// pool of size 1 has no worker threads and runs everything serially.  If
+// a task throws, the remaining tasks are still run and the first
+// exception is rethrown by Run.  Run must not be called from more than
+// one thread at a time.
+
+#ifndef PDDPWorkerPool_H
+#define PDDPWorkerPool_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dune {
+
+  class PDDPWorkerPool {
+
+  public:
+
+    using Task = std::function<void(size_t)>;
+
+    // Pool with nthread threads including the caller.  Zero means one per
+    // hardware thread.
+    explicit PDDPWorkerPool(unsigned nthread);
+    ~PDDPWorkerPool();
+
+    PDDPWorkerPool(const PDDPWorkerPool &) = delete;
+    PDDPWorkerPool & operator=(const PDDPWorkerPool &) = delete;
+
+    unsigned Size() const { return fWorkers.size() + 1; }
+
+    void Run(size_t ntask, const Task & func);
+
+  private:
+
+    void Work();
+    void Drain();
+
+    std::vector<std::thread> fWorkers;
+    std::mutex fMutex;
+    std::condition_variable fStart;
+    std::condition_variable fDone;
+    unsigned long fGeneration;   // incremented for every Run
+    unsigned fBusy;              // workers still in the current Run
+    bool fStop;
+
+    // current job
+    const Task * fFunc;
+    size_t fNTask;
+    std::atomic<size_t> fNext;
+    std::exception_ptr fError;
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,215 @@
+// test_MappedRawFile.cxx
+//
+// Test MappedRawFile and compare converting a whole file through the
+// ifstream path of the dual-phase input sources (seek, read each event
+// into a buffer, unpack) with the mmap path (unpack each event in place,
+// release it).  The file is synthetic, with the ProtoDUNE-DP layout: a
+// header with the number of events, an event table and the events.
+// Reports the conversion time and the peak resident size of each path.
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "duneprototypes/Protodune/dualphase/RawDecoding/MappedRawFile.h"
+#include "duneprototypes/Protodune/dualphase/RawDecoding/PDDPCroUnpacker.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::MappedRawFile;
+using dune::PDDPCroUnpacker;
+using ADCs = raw::RawDigit::ADCvector_t;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+const size_t nsa = 10000;
+
+// Write nevt events of nchan channels.  Returns the offsets and sizes of
+// the events.
+void writeFile(string fname, size_t nevt, size_t nchan,
+               vector<size_t>& offsets, vector<size_t>& sizes) {
+  std::mt19937 rng(20190420);
+  std::uniform_int_distribution<uint32_t> dist;
+  std::ofstream fout(fname, std::ios::binary);
+  uint32_t head[2] = {0, uint32_t(nevt)};
+  fout.write(reinterpret_cast<const char*>(head), sizeof(head));
+  for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+    uint32_t entry[4] = {uint32_t(ievt), uint32_t(3*nchan*nsa/2), 0, 0};
+    fout.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+  }
+  size_t offset = sizeof(head) + 16*nevt;
+  vector<uint32_t> words(3*nchan*nsa/8);
+  for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+    for ( uint32_t& w : words ) w = dist(rng);
+    fout.write(reinterpret_cast<const char*>(words.data()), 4*words.size());
+    offsets.push_back(offset);
+    sizes.push_back(4*words.size());
+    offset += 4*words.size();
+  }
+  assert( fout.good() );
+}
+
+// Reset the peak resident size; false if the kernel does not support it.
+bool resetPeakRSS() {
+  std::ofstream fout("/proc/self/clear_refs");
+  fout << "5";
+  fout.close();
+  return fout.good();
+}
+
+// Peak resident size in MB.
+double peakRSS() {
+  std::ifstream fin("/proc/self/status");
+  string line;
+  while ( std::getline(fin, line) ) {
+    if ( line.compare(0, 6, "VmHWM:") == 0 ) return std::stod(line.substr(6))/1024.0;
+  }
+  return 0;
+}
+
+// Unpack one event, the way the input driver does.
+uint64_t convert(const char* data, size_t nb, vector<ADCs>& chans) {
+  size_t nch = PDDPCroUnpacker::NChannels(nb, nsa);
+  chans.clear();
+  chans.resize(nch);
+  PDDPCroUnpacker::UnpackChannels(data, nb, nsa, 0, nch, chans.data());
+  uint64_t sum = 0;
+  for ( const ADCs& adcs : chans ) for ( short adc : adcs ) sum = 31*sum + adc;
+  return sum;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_MappedRawFile(size_t nevt, size_t nchan) {
+  const string myname = "test_MappedRawFile: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  const string fname = "test_MappedRawFile.dat";
+  const string ename = "test_MappedRawFile_empty.dat";
+
+  cout << myname << line << endl;
+  cout << myname << "Check open failures." << endl;
+  MappedRawFile map;
+  assert( ! map.Open("test_MappedRawFile_missing.dat") );
+  std::ofstream(ename).close();
+  assert( ! map.Open(ename) );
+  assert( ! map.IsOpen() );
+  assert( map.Available(0, 10) == 0 );
+  std::remove(ename.c_str());
+
+  cout << myname << line << endl;
+  cout << myname << "Write " << nevt << " events of " << nchan << " channels." << endl;
+  vector<size_t> offsets;
+  vector<size_t> sizes;
+  writeFile(fname, nevt, nchan, offsets, sizes);
+  size_t fsize = offsets.back() + sizes.back();
+  cout << myname << "  File size: " << fsize/1.e6 << " MB" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Check the mapped contents." << endl;
+  assert( map.Open(fname) );
+  assert( map.Size() == fsize );
+  assert( map.Available(fsize - 5, 10) == 5 );
+  assert( map.Available(fsize + 5, 10) == 0 );
+  uint32_t nevtfile = 0;
+  std::memcpy(&nevtfile, map.Data() + 4, 4);
+  assert( nevtfile == nevt );
+  vector<char> bytes(sizes[0]);
+  std::ifstream fin(fname, std::ios::binary);
+  fin.seekg(offsets[0]);
+  fin.read(bytes.data(), bytes.size());
+  assert( std::memcmp(bytes.data(), map.Data() + offsets[0], sizes[0]) == 0 );
+  // released pages are read back from the file
+  map.WillNeed(offsets[0], sizes[0]);
+  map.Release(offsets[0] + sizes[0]);
+  assert( std::memcmp(bytes.data(), map.Data() + offsets[0], sizes[0]) == 0 );
+  map.Close();
+  assert( ! map.IsOpen() );
+
+  cout << myname << line << endl;
+  cout << myname << "Convert the file with ifstream and with mmap." << endl;
+  bool havepeak = resetPeakRSS();
+  if ( ! havepeak ) cout << myname << "  Peak RSS cannot be reset here: values are for the job so far." << endl;
+  vector<ADCs> chans;
+  vector<uint64_t> sumsref;
+  auto t0 = Clock::now();
+  {
+    vector<char> buf;
+    buf.reserve(sizes[0]);
+    std::ifstream fin(fname, std::ios::binary);
+    for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+      fin.seekg(offsets[ievt]);
+      buf.resize(sizes[ievt]);
+      fin.read(buf.data(), buf.size());
+      sumsref.push_back(convert(buf.data(), buf.size(), chans));
+    }
+  }
+  double dtstream = std::chrono::duration<double>(Clock::now() - t0).count();
+  double rssstream = peakRSS();
+  chans = vector<ADCs>();
+  for ( bool release : {true, false} ) {
+    resetPeakRSS();
+    t0 = Clock::now();
+    assert( map.Open(fname) );
+    for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+      if ( ievt + 1 < nevt ) map.WillNeed(offsets[ievt + 1], sizes[ievt + 1]);
+      uint64_t sum = convert(map.Data() + offsets[ievt], map.Available(offsets[ievt], sizes[ievt]), chans);
+      assert( sum == sumsref[ievt] );
+      if ( release ) map.Release(offsets[ievt] + sizes[ievt]);
+    }
+    double dt = std::chrono::duration<double>(Clock::now() - t0).count();
+    double rss = peakRSS();
+    map.Close();
+    chans = vector<ADCs>();
+    if ( release ) {
+      cout << myname << "  ifstream: " << dtstream << " s, " << nevt/dtstream << " events/s, peak RSS "
+           << rssstream << " MB" << endl;
+    }
+    cout << myname << (release ? "      mmap: " : "  mmap, no release: ") << dt << " s, "
+         << nevt/dt << " events/s, peak RSS " << rss << " MB" << endl;
+  }
+  std::remove(fname.c_str());
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nevt = 20;
+  size_t nchan = 256;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NEVT [NCHAN]]" << endl;
+      cout << "  NEVT [20]: Number of events in the test file." << endl;
+      cout << "  NCHAN [256]: Channels per event (multiple of 4)." << endl;
+      return 0;
+    }
+    nevt = std::stoul(sarg);
+  }
+  if ( argc > 2 ) nchan = 4*(std::stoul(argv[2])/4);
+  return test_MappedRawFile(nevt, nchan);
+}
+
+//**********************************************************************
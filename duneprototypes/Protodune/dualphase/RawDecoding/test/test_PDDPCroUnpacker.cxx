@@ -0,0 +1,201 @@
+// test_PDDPCroUnpacker.cxx
+//
+// Test PDDPCroUnpacker against the byte-by-byte unpacking the ProtoDUNE-DP
+// input driver used before, for both sample kernels and for channel
+// lengths that split byte triplets.  Test PDDPWorkerPool and report the
+// events/s for unpacking a synthetic event with the old code and with
+// pools of several sizes.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <stdexcept>
+#include "duneprototypes/Protodune/dualphase/RawDecoding/PDDPCroUnpacker.h"
+#include "duneprototypes/Protodune/dualphase/RawDecoding/PDDPWorkerPool.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::PDDPCroUnpacker;
+using dune::PDDPWorkerPool;
+using ADCs = raw::RawDigit::ADCvector_t;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// The driver code this replaces.
+void referenceUnpack(const char* buf, size_t nb, unsigned nsa, vector<ADCs>& data) {
+  data.push_back(ADCs(nsa));
+  size_t sz = 0;
+  const char* start = buf;
+  const char* stop  = start + nb;
+  while ( start != stop ) {
+    char v1 = *start++;
+    char v2 = *start++;
+    char v3 = *start++;
+    uint16_t tmp1 = ((v1 << 4) + ((v2 >> 4) & 0xf)) & 0xfff;
+    uint16_t tmp2 = (((v2 & 0xf) << 8 ) + (v3 & 0xff)) & 0xfff;
+    if ( sz == nsa ) { data.push_back(ADCs(nsa)); sz = 0; }
+    data.back()[sz++] = (short)tmp1;
+    if ( sz == nsa ) { data.push_back(ADCs(nsa)); sz = 0; }
+    data.back()[sz++] = (short)tmp2;
+  }
+}
+
+vector<char> randomBytes(size_t nb, std::mt19937& rng) {
+  std::uniform_int_distribution<int> dist(0, 255);
+  vector<char> bytes(nb);
+  for ( char& b : bytes ) b = char(dist(rng));
+  return bytes;
+}
+
+void checkChannels(const vector<char>& bytes, size_t nsa) {
+  vector<ADCs> ref;
+  referenceUnpack(bytes.data(), bytes.size(), nsa, ref);
+  size_t nch = PDDPCroUnpacker::NChannels(bytes.size(), nsa);
+  assert( nch == ref.size() );
+  // unpack in uneven blocks into vectors that already hold data
+  vector<ADCs> chans(nch, ADCs(3, 77));
+  for ( size_t ich0=0; ich0<nch; ich0+=3 ) {
+    size_t ich1 = std::min(ich0 + 3, nch);
+    PDDPCroUnpacker::UnpackChannels(bytes.data(), bytes.size(), nsa, ich0, ich1, &chans[ich0]);
+  }
+  assert( chans == ref );
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_PDDPCroUnpacker(size_t nchan, size_t nevt) {
+  const string myname = "test_PDDPCroUnpacker: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(20191002);
+
+  cout << myname << line << endl;
+  cout << myname << "Dispatch kernel: " << PDDPCroUnpacker::KernelName() << endl;
+  cout << myname << "Check the pair kernels." << endl;
+  for ( size_t npair=0; npair<200; ++npair ) {
+    vector<char> bytes = randomBytes(3*npair, rng);
+    vector<ADCs> ref;
+    referenceUnpack(bytes.data(), bytes.size(), 2*npair + 1, ref);
+    ref[0].resize(2*npair);
+    ADCs scalar(2*npair, -1);
+    PDDPCroUnpacker::Unpack12BitScalar(bytes.data(), npair, scalar.data());
+    assert( scalar == ref[0] );
+    if ( PDDPCroUnpacker::HasAVX2() ) {
+      ADCs avx2(2*npair, -1);
+      PDDPCroUnpacker::Unpack12BitAVX2(bytes.data(), npair, avx2.data());
+      assert( avx2 == ref[0] );
+    }
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check channel unpacking." << endl;
+  for ( size_t nsa : {1, 2, 3, 7, 64, 101, 10000} ) {
+    for ( size_t nsam : {nsa, 2*nsa, 9*nsa, 9*nsa + 1, 9*nsa + 2, 9*nsa + 5} ) {
+      checkChannels(randomBytes(3*((nsam + 1)/2), rng), nsa);
+    }
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check the worker pool." << endl;
+  for ( unsigned nthr : {1, 2, 3, 8} ) {
+    PDDPWorkerPool pool(nthr);
+    assert( pool.Size() == nthr );
+    for ( size_t ntask : {0, 1, 2, 7, 1000} ) {
+      for ( int irep=0; irep<20; ++irep ) {
+        vector<std::atomic<int>> hits(ntask);
+        pool.Run(ntask, [&hits](size_t i) { ++hits[i]; });
+        for ( auto& h : hits ) assert( h == 1 );
+      }
+    }
+    std::atomic<int> nrun(0);
+    bool caught = false;
+    try {
+      pool.Run(50, [&nrun](size_t i) { ++nrun; if ( i == 17 ) throw std::runtime_error("task 17"); });
+    } catch ( const std::runtime_error& e ) {
+      caught = string(e.what()) == "task 17";
+    }
+    assert( caught );
+    assert( nrun == 50 );
+  }
+  assert( PDDPWorkerPool(0).Size() >= 1 );
+
+  cout << myname << line << endl;
+  const size_t nsa = 10000;
+  const size_t nfrag = 2;
+  cout << myname << "Time " << nevt << " events of " << nfrag << " fragments x "
+       << nchan << " channels x " << nsa << " samples." << endl;
+  vector<vector<char>> frags;
+  for ( size_t ifrag=0; ifrag<nfrag; ++ifrag ) frags.push_back(randomBytes(3*nchan*nsa/2, rng));
+  auto t0 = Clock::now();
+  vector<ADCs> refevt;
+  for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+    refevt.clear();
+    for ( auto& frag : frags ) {
+      vector<ADCs> chans;
+      referenceUnpack(frag.data(), frag.size(), nsa, chans);
+      refevt.insert(refevt.end(), std::make_move_iterator(chans.begin()), std::make_move_iterator(chans.end()));
+    }
+  }
+  double dt = std::chrono::duration<double>(Clock::now() - t0).count();
+  cout << myname << "       old: " << nevt/dt << " events/s" << endl;
+  for ( unsigned nthr : {1u, 2u, 4u, 0u} ) {
+    PDDPWorkerPool pool(nthr);
+    vector<ADCs> evt;
+    t0 = Clock::now();
+    for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+      evt.clear();
+      evt.resize(nfrag*nchan);
+      pool.Run(nfrag*nchan/64, [&frags, &evt, nchan, nsa](size_t iblk) {
+        size_t ifrag = 64*iblk/nchan;
+        size_t ich0 = 64*iblk - ifrag*nchan;
+        PDDPCroUnpacker::UnpackChannels(frags[ifrag].data(), frags[ifrag].size(), nsa,
+                                        ich0, ich0 + 64, &evt[ifrag*nchan + ich0]);
+      });
+    }
+    dt = std::chrono::duration<double>(Clock::now() - t0).count();
+    assert( evt == refevt );
+    cout << myname << "  pool " << pool.Size() << (pool.Size() < 10 ? " " : "") << ": "
+         << nevt/dt << " events/s" << endl;
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nchan = 640;
+  size_t nevt = 10;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NCHAN [NEVT]]" << endl;
+      cout << "  NCHAN [640]: Channels per fragment (multiple of 64) in the timed events." << endl;
+      cout << "  NEVT [10]: Number of timed events." << endl;
+      return 0;
+    }
+    nchan = 64*(std::stoul(sarg)/64);
+  }
+  if ( argc > 2 ) nevt = std::stoul(argv[2]);
+  return test_PDDPCroUnpacker(nchan, nevt);
+}
+
+//**********************************************************************
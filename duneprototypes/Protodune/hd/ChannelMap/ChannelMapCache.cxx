@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// File:        ChannelMapCache.cxx
+//
+// Binary cache for channel maps read from text files.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ChannelMapCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+  const char kMagic[8] = {'D','U','N','E','C','M','A','P'};
+
+  // fixed-size header at the start of every cache file.  The records
+  // follow immediately, then the string table.
+  struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t nrecords;
+    uint64_t source_checksum;
+    uint64_t payload_checksum;   // everything after the header
+    uint64_t names_offset;       // from the start of the file
+    uint64_t names_size;
+  };
+
+  void appendU32(std::string & buf, uint32_t val)
+  {
+    buf.append(reinterpret_cast<const char*>(&val), sizeof(val));
+  }
+
+}
+
+//-----------------------------------------------------------------------
+
+uint64_t dune::chanmapcache::Checksum(const void * data, size_t nbytes, uint64_t seed)
+{
+  const unsigned char * p = static_cast<const unsigned char*>(data);
+  uint64_t hash = seed;
+  for (size_t i = 0; i < nbytes; ++i)
+    {
+      hash ^= p[i];
+      hash *= 0x100000001b3ULL;
+    }
+  return hash;
+}
+
+//-----------------------------------------------------------------------
+
+bool dune::chanmapcache::ChecksumFile(const std::string & fname, uint64_t & checksum)
+{
+  std::ifstream inFile(fname, std::ios::in | std::ios::binary);
+  if (!inFile) return false;
+  std::string contents((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+  checksum = Checksum(contents.data(), contents.size());
+  return true;
+}
+
+//-----------------------------------------------------------------------
+
+bool dune::chanmapcache::WriteCache(const std::string & cachename, Kind kind, uint64_t source_checksum,
+                                    const void * records, size_t record_size, size_t nrecords,
+                                    const std::vector<std::string> & names)
+{
+  std::string nameblock;
+  appendU32(nameblock, names.size());
+  for (const auto & name : names)
+    {
+      appendU32(nameblock, name.size());
+      nameblock.append(name);
+    }
+
+  const size_t recbytes = record_size*nrecords;
+  CacheHeader header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.kind = kind;
+  header.record_size = record_size;
+  header.nrecords = nrecords;
+  header.source_checksum = source_checksum;
+  header.payload_checksum = Checksum(nameblock.data(), nameblock.size(), Checksum(records, recbytes));
+  header.names_offset = sizeof(CacheHeader) + recbytes;
+  header.names_size = nameblock.size();
+
+  std::string tmpname = cachename + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream outFile(tmpname, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!outFile) return false;
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.write(static_cast<const char*>(records), recbytes);
+    outFile.write(nameblock.data(), nameblock.size());
+    outFile.close();
+    if (!outFile)
+      {
+        std::remove(tmpname.c_str());
+        return false;
+      }
+  }
+  if (std::rename(tmpname.c_str(), cachename.c_str()) != 0)
+    {
+      std::remove(tmpname.c_str());
+      return false;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------
+
+dune::chanmapcache::CacheReader::~CacheReader()
+{
+  Close();
+}
+
+//-----------------------------------------------------------------------
+
+void dune::chanmapcache::CacheReader::Close()
+{
+  if (fMap != nullptr) munmap(fMap, fMapSize);
+  fMap = nullptr;
+  fMapSize = 0;
+  fRecords = nullptr;
+  fNRecords = 0;
+  fNames.clear();
+}
+
+//-----------------------------------------------------------------------
+
+bool dune::chanmapcache::CacheReader::Open(const std::string & cachename, Kind kind, size_t record_size,
+                                           uint64_t source_checksum)
+{
+  Close();
+  if (cachename.empty()) return false;
+
+  int fd = open(cachename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(CacheHeader))
+    {
+      close(fd);
+      return false;
+    }
+  fMapSize = st.st_size;
+  fMap = mmap(nullptr, fMapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (fMap == MAP_FAILED)
+    {
+      fMap = nullptr;
+      fMapSize = 0;
+      return false;
+    }
+
+  const char * base = static_cast<const char*>(fMap);
+  CacheHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  bool good = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+    && header.version == kVersion
+    && header.kind == kind
+    && header.record_size == record_size
+    && header.source_checksum == source_checksum
+    && header.names_offset == sizeof(CacheHeader) + record_size*header.nrecords
+    && header.names_offset + header.names_size == fMapSize;
+  if (good)
+    {
+      const size_t recbytes = record_size*header.nrecords;
+      uint64_t payload = Checksum(base + header.names_offset, header.names_size,
+                                  Checksum(base + sizeof(CacheHeader), recbytes));
+      good = (payload == header.payload_checksum);
+    }
+  if (!good)
+    {
+      Close();
+      return false;
+    }
+
+  fRecords = base + sizeof(CacheHeader);
+  fNRecords = header.nrecords;
+
+  // string table: count, then length-prefixed strings
+  const char * p = base + header.names_offset;
+  const char * end = p + header.names_size;
+  uint32_t nnames = 0;
+  if (end - p < (long) sizeof(nnames))
+    {
+      Close();
+      return false;
+    }
+  std::memcpy(&nnames, p, sizeof(nnames));
+  p += sizeof(nnames);
+  for (uint32_t i = 0; i < nnames; ++i)
+    {
+      uint32_t len = 0;
+      if (end - p < (long) sizeof(len))
+        {
+          Close();
+          return false;
+        }
+      std::memcpy(&len, p, sizeof(len));
+      p += sizeof(len);
+      if (end - p < (long) len)
+        {
+          Close();
+          return false;
+        }
+      fNames.emplace_back(p, len);
+      p += len;
+    }
+  return true;
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// File:        ChannelMapCache.h
+//
+// Binary cache for channel maps read from text files.  art-independent.
+//
+// A cache file holds the parsed records of one map as a flat array of a
+// trivially copyable record type, followed by a table of strings (e.g. APA
+// names) the records refer to by index.  The header records a format
+// version, the kind and size of the records, a checksum of the text file
+// the cache was built from and a checksum of the payload.  A cache is only
+// used if all of these match, so an edited or replaced text map, or a
+// truncated cache, falls back to parsing the text.
+//
+// The file is memory mapped when read.  Writing goes through a temporary
+// file and a rename, so concurrent jobs never see a partial cache.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ChannelMapCache_H
+#define ChannelMapCache_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dune {
+namespace chanmapcache {
+
+  // identifies the map class a cache was written for
+  enum Kind : uint32_t {
+    kPD2HD = 1,
+    kDAPHNE = 2
+  };
+
+  // bump when the layout of the file or of any record type changes
+  constexpr uint32_t kVersion = 1;
+
+  // 64-bit FNV-1a checksum
+  uint64_t Checksum(const void * data, size_t nbytes, uint64_t seed = 0xcbf29ce484222325ULL);
+
+  // checksum of the full contents of a file; false if it cannot be read
+  bool ChecksumFile(const std::string & fname, uint64_t & checksum);
+
+  // Write a cache file.  Returns false (and leaves no file behind) on failure.
+  bool WriteCache(const std::string & cachename, Kind kind, uint64_t source_checksum,
+                  const void * records, size_t record_size, size_t nrecords,
+                  const std::vector<std::string> & names);
+
+  // Read-only view of a memory-mapped cache file.
+
+  class CacheReader {
+
+  public:
+
+    CacheReader() = default;
+    ~CacheReader();
+    CacheReader(const CacheReader &) = delete;
+    CacheReader & operator=(const CacheReader &) = delete;
+
+    // Map the file and check it.  Returns true only if the file is a
+    // complete cache of the given kind and record size built from a text
+    // file with the given checksum.
+    bool Open(const std::string & cachename, Kind kind, size_t record_size, uint64_t source_checksum);
+
+    void Close();
+
+    const void * Records() const { return fRecords; }
+    size_t NRecords() const { return fNRecords; }
+    const std::vector<std::string> & Names() const { return fNames; }
+
+    // copy the records into a vector of the record type
+    template <typename Record>
+    void CopyRecords(std::vector<Record> & out) const
+    {
+      const Record * begin = static_cast<const Record*>(fRecords);
+      out.assign(begin, begin + fNRecords);
+    }
+
+  private:
+
+    void * fMap = nullptr;
+    size_t fMapSize = 0;
+    const void * fRecords = nullptr;
+    size_t fNRecords = 0;
+    std::vector<std::string> fNames;
+
+  };
+
+}
+}
+
+#endif
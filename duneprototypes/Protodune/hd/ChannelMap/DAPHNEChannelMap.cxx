@@ -1,4 +1,5 @@
 #include "DAPHNEChannelMap.h"
+#include "ChannelMapCache.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -11,23 +12,53 @@ void dune::DAPHNEChannelMap::ReadMapFromFile(std::string &fullname) {
   while (std::getline(inFile,line)) {
     std::stringstream linestream(line);
 
-    unsigned int slot, link, daphne_channel, offline_channel;
+    DaphneMapLine mapline;
     linestream 
-      >> slot 
-      >> link 
-      >> daphne_channel 
-      >> offline_channel;
-
-    // fill maps.
-    if (fIgnoreLinks) link = 0;
-    check_offline_channel(offline_channel);
-    fMapToOfflineChannel[DaphneChanInfo({slot,link,daphne_channel})] = offline_channel;
-    //OfflToChanInfo[chanInfo.offlchan] = chanInfo;
+      >> mapline.slot 
+      >> mapline.link 
+      >> mapline.daphne_channel 
+      >> mapline.offline_channel;
+    if (linestream.fail()) continue;
 
+    AddLine(mapline);
   }
   inFile.close();
 }
 
+void dune::DAPHNEChannelMap::AddLine(const DaphneMapLine & mapline) {
+  unsigned int link = mapline.link;
+
+  // fill maps.
+  if (fIgnoreLinks) link = 0;
+  check_offline_channel(mapline.offline_channel);
+  fMapToOfflineChannel[DaphneChanInfo({mapline.slot,link,mapline.daphne_channel})] = mapline.offline_channel;
+  fLines.push_back(mapline);
+}
+
+bool dune::DAPHNEChannelMap::ReadMapFromFileWithCache(std::string &fullname, const std::string &cachename) {
+  uint64_t checksum = 0;
+  if (cachename.empty() || !chanmapcache::ChecksumFile(fullname, checksum)) {
+    ReadMapFromFile(fullname);
+    return false;
+  }
+
+  // the cache holds the lines as written; IgnoreLinks is applied on loading
+  chanmapcache::CacheReader cache;
+  if (cache.Open(cachename, chanmapcache::kDAPHNE, sizeof(DaphneMapLine), checksum)) {
+    std::vector<DaphneMapLine> lines;
+    cache.CopyRecords(lines);
+    for (const auto & mapline : lines) AddLine(mapline);
+    return true;
+  }
+
+  ReadMapFromFile(fullname);
+  if (!chanmapcache::WriteCache(cachename, chanmapcache::kDAPHNE, checksum,
+                                fLines.data(), sizeof(DaphneMapLine), fLines.size(), {})) {
+    std::cout << "DAPHNEChannelMap: unable to write map cache " << cachename << std::endl;
+  }
+  return false;
+}
+
 unsigned int dune::DAPHNEChannelMap::GetOfflineChannel(
     unsigned int slot, unsigned int link, unsigned int daphne_channel) {
 
@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <stdexcept>
+#include <cstdint>
 
 namespace dune {
   class DAPHNEChannelMap;
@@ -44,10 +45,31 @@ public:
   DAPHNEChannelMap() {};  // constructor
   DAPHNEChannelMap(bool ignore_links=false) : fIgnoreLinks(ignore_links) {};  // constructor
   void ReadMapFromFile(std::string &fullname);
+
+  // Load from the binary cache cachename if it matches the text file,
+  // otherwise parse the text and (re)write the cache.  Returns true if the
+  // map was loaded from the cache.
+  bool ReadMapFromFileWithCache(std::string &fullname, const std::string &cachename);
   unsigned int GetOfflineChannel(unsigned int slot, unsigned int link,
                                  unsigned int frame_chan);
 
+  // one line of the map file, as stored in the cache
+  struct DaphneMapLine {
+    uint32_t slot;
+    uint32_t link;
+    uint32_t daphne_channel;
+    uint32_t offline_channel;
+  };
+
+  // The lines read, with their links as in the file, for decoders that
+  // tabulate the map.
+  const std::vector<DaphneMapLine> & Lines() const { return fLines; }
+  bool IgnoreLinks() const { return fIgnoreLinks; }
+
 private:
+  std::vector<DaphneMapLine> fLines;
+  void AddLine(const DaphneMapLine & line);
+
   //Number of channels:
   //    4 Channels/Module x 10 Modules/APA x 4 APAs/PDHD
   const unsigned int fNChans = 4*10*4;
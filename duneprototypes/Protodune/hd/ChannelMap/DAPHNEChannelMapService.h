@@ -22,6 +22,9 @@ public:
    unsigned int link,
    unsigned int daphne_channel);
 
+  const std::vector<dune::DAPHNEChannelMap::DaphneMapLine> & Lines() const { return fChannelMap.Lines(); }
+  bool IgnoreLinks() const { return fChannelMap.IgnoreLinks(); }
+
 private:
 
   dune::DAPHNEChannelMap fChannelMap;
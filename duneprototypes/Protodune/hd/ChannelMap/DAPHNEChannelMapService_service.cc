@@ -6,6 +6,9 @@ dune::DAPHNEChannelMapService::DAPHNEChannelMapService(fhicl::ParameterSet const
 
   std::string channelMapFile = pset.get<std::string>("FileName");
 
+  // optional binary cache of the parsed map, rebuilt if missing or stale
+  std::string cacheFile = pset.get<std::string>("CacheFileName", "");
+
   std::string fullname;
   cet::search_path sp("FW_SEARCH_PATH");
   sp.find_file(channelMapFile, fullname);
@@ -17,7 +20,10 @@ dune::DAPHNEChannelMapService::DAPHNEChannelMapService(fhicl::ParameterSet const
   else
     std::cout << "DAPHNE Channel Map: Building DAPHNE channel map from file " << channelMapFile << std::endl;
 
-  fChannelMap.ReadMapFromFile(fullname);
+  if (cacheFile.empty())
+    fChannelMap.ReadMapFromFile(fullname);
+  else if (fChannelMap.ReadMapFromFileWithCache(fullname, cacheFile))
+    std::cout << "DAPHNE Channel Map: loaded from cache " << cacheFile << std::endl;
 }
 
 dune::DAPHNEChannelMapService::DAPHNEChannelMapService(fhicl::ParameterSet const& pset, art::ActivityRegistry&) : DAPHNEChannelMapService(pset) {}
@@ -0,0 +1,92 @@
+// pdhdChannelMapCache.cxx
+//
+// Build the binary cache for a PD2HD or DAPHNE text channel map and
+// report the time taken to load the map from text and from the cache.
+// The cache can then be given to the channel map service with the
+// CacheFileName parameter.
+
+#include "duneprototypes/Protodune/hd/ChannelMap/PD2HDChannelMapSP.h"
+#include "duneprototypes/Protodune/hd/ChannelMap/DAPHNEChannelMap.h"
+#include "duneprototypes/Protodune/hd/ChannelMap/ChannelMapCache.h"
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+
+using std::string;
+using std::cout;
+using std::endl;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+double msSince(Clock::time_point t0) {
+  return 1000.0*std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// Load the map from text, build the cache and load it back.
+template<class Map, class... Args>
+int convert(string textfile, string cachefile, Args... args) {
+  const string myname = "pdhdChannelMapCache: ";
+  std::remove(cachefile.c_str());
+  auto t0 = Clock::now();
+  {
+    Map cmap(args...);
+    cmap.ReadMapFromFile(textfile);
+  }
+  double mstext = msSince(t0);
+  t0 = Clock::now();
+  {
+    Map cmap(args...);
+    if ( cmap.ReadMapFromFileWithCache(textfile, cachefile) ) {
+      cout << myname << "ERROR: Unexpected cache hit." << endl;
+      return 2;
+    }
+  }
+  double msbuild = msSince(t0);
+  t0 = Clock::now();
+  {
+    Map cmap(args...);
+    if ( ! cmap.ReadMapFromFileWithCache(textfile, cachefile) ) {
+      cout << myname << "ERROR: Cache " << cachefile << " was not written or is not readable." << endl;
+      return 3;
+    }
+  }
+  double mscache = msSince(t0);
+  cout << myname << "Wrote " << cachefile << endl;
+  cout << myname << "  Load from text: " << mstext << " ms" << endl;
+  cout << myname << "  Text and write cache: " << msbuild << " ms" << endl;
+  cout << myname << "  Load from cache: " << mscache << " ms" << endl;
+  return 0;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int main(int argc, char** argv) {
+  const string myname = "pdhdChannelMapCache: ";
+  if ( argc != 4 || string(argv[1]) == "-h" ) {
+    cout << "Usage: " << argv[0] << " TYPE TEXTFILE CACHEFILE" << endl;
+    cout << "  TYPE: pd2hd or daphne" << endl;
+    cout << "  TEXTFILE: text channel map" << endl;
+    cout << "  CACHEFILE: binary cache to write" << endl;
+    return argc != 4;
+  }
+  string type = argv[1];
+  string textfile = argv[2];
+  string cachefile = argv[3];
+  uint64_t checksum = 0;
+  if ( ! dune::chanmapcache::ChecksumFile(textfile, checksum) ) {
+    cout << myname << "ERROR: Unable to read " << textfile << endl;
+    return 1;
+  }
+  if ( type == "pd2hd" ) return convert<dune::PD2HDChannelMapSP>(textfile, cachefile);
+  if ( type == "daphne" ) return convert<dune::DAPHNEChannelMap>(textfile, cachefile, false);
+  cout << myname << "ERROR: Invalid map type: " << type << endl;
+  return 1;
+}
+
+//**********************************************************************
@@ -8,10 +8,12 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "PD2HDChannelMapSP.h"
+#include "ChannelMapCache.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 // so far, nothing needs to be done in the constructor
 
@@ -49,62 +51,127 @@ void dune::PD2HDChannelMapSP::ReadMapFromFile(std::string &fullname)
 
     check_offline_channel(chanInfo.offlchan);
 
-    DetToChanInfo[chanInfo.crate][chanInfo.wib][chanInfo.link][chanInfo.wibframechan] = chanInfo;
-    OfflToChanInfo[chanInfo.offlchan] = chanInfo;
+    AddChannel(chanInfo);
 
   }
   inFile.close();
 
+  BuildTables();
 }
 
-dune::PD2HDChannelMapSP::HDChanInfo_t dune::PD2HDChannelMapSP::GetChanInfoFromWIBElements(
-    unsigned int crate,
-    unsigned int slot,
-    unsigned int link,
-    unsigned int wibframechan ) const {
+bool dune::PD2HDChannelMapSP::ReadMapFromFileWithCache(std::string &fullname, const std::string &cachename)
+{
+  uint64_t checksum = 0;
+  if (cachename.empty() || !chanmapcache::ChecksumFile(fullname, checksum))
+    {
+      ReadMapFromFile(fullname);
+      return false;
+    }
+
+  chanmapcache::CacheReader cache;
+  if (cache.Open(cachename, chanmapcache::kPD2HD, sizeof(HDChanRecord_t), checksum))
+    {
+      cache.CopyRecords(fRecords);
+      fAPANames = cache.Names();
+      for (const auto & rec : fRecords)
+        {
+          check_offline_channel(rec.offlchan);
+          if (rec.apaindex >= fAPANames.size()) throw std::range_error("PD2HDChannelMapSP corrupt map cache");
+        }
+      BuildTables();
+      return true;
+    }
+
+  ReadMapFromFile(fullname);
+  if (!chanmapcache::WriteCache(cachename, chanmapcache::kPD2HD, checksum,
+                                fRecords.data(), sizeof(HDChanRecord_t), fRecords.size(), fAPANames))
+    {
+      std::cout << "PD2HDChannelMapSP: unable to write map cache " << cachename << std::endl;
+    }
+  return false;
+}
 
-  unsigned int wib = slot + 1;
+void dune::PD2HDChannelMapSP::AddChannel(const HDChanInfo_t & chanInfo)
+{
+  HDChanRecord_t rec = {};
+  rec.offlchan = chanInfo.offlchan;
+  rec.crate = chanInfo.crate;
+  rec.wib = chanInfo.wib;
+  rec.link = chanInfo.link;
+  rec.femb_on_link = chanInfo.femb_on_link;
+  rec.cebchan = chanInfo.cebchan;
+  rec.plane = chanInfo.plane;
+  rec.chan_in_plane = chanInfo.chan_in_plane;
+  rec.femb = chanInfo.femb;
+  rec.asic = chanInfo.asic;
+  rec.asicchan = chanInfo.asicchan;
+  rec.wibframechan = chanInfo.wibframechan;
+  rec.valid = chanInfo.valid;
+
+  auto iname = std::find(fAPANames.begin(), fAPANames.end(), chanInfo.APAName);
+  rec.apaindex = iname - fAPANames.begin();
+  if (iname == fAPANames.end()) fAPANames.push_back(chanInfo.APAName);
+
+  fRecords.push_back(rec);
+}
 
-  HDChanInfo_t badInfo = {};
-  badInfo.valid = false;
+void dune::PD2HDChannelMapSP::BuildTables()
+{
+  fNCrate = fNWib = fNLink = fNWibFrameChan = 0;
+  for (const auto & rec : fRecords)
+    {
+      fNCrate = std::max(fNCrate, rec.crate + 1u);
+      fNWib = std::max(fNWib, rec.wib + 1u);
+      fNLink = std::max(fNLink, rec.link + 1u);
+      fNWibFrameChan = std::max(fNWibFrameChan, rec.wibframechan + 1u);
+    }
 
-// a hack -- ununderstood crates are mapped to crate 2
-// for use in the Coldbox
-// crate 2 has the lowest-numbered offline channels
-// data with two ununderstood crates, or an ununderstood crate and crate 2,
-// will have duplicate channels.
+  // later lines override earlier ones with the same key, as they did when
+  // the maps were filled line by line
 
-  auto fm1 = DetToChanInfo.find(crate);
-  if (fm1 == DetToChanInfo.end()) 
+  fDetTable.assign(fNCrate*fNWib*fNLink*fNWibFrameChan, fBadRecord);
+  fCrateInMap.assign(fNCrate, false);
+  fOfflTable.assign(fNChans, fBadRecord);
+  for (const auto & rec : fRecords)
     {
-      unsigned int substituteCrate = 2;  
-      fm1 = DetToChanInfo.find(substituteCrate);
-      if (fm1 == DetToChanInfo.end()) return badInfo;
+      fDetTable[((rec.crate*fNWib + rec.wib)*fNLink + rec.link)*fNWibFrameChan + rec.wibframechan] = rec;
+      fCrateInMap[rec.crate] = true;
+      fOfflTable[rec.offlchan] = rec;
     }
-  auto& m1 = fm1->second;
+}
 
-  auto fm2 = m1.find(wib);
-  if (fm2 == m1.end()) return badInfo;
-  auto& m2 = fm2->second;
+dune::PD2HDChannelMapSP::HDChanInfo_t dune::PD2HDChannelMapSP::MakeChanInfo(const HDChanRecord_t & rec) const
+{
+  HDChanInfo_t chanInfo = {};
+  chanInfo.valid = rec.valid;
+  if (!rec.valid) return chanInfo;
+  chanInfo.offlchan = rec.offlchan;
+  chanInfo.crate = rec.crate;
+  chanInfo.APAName = GetAPAName(rec);
+  chanInfo.wib = rec.wib;
+  chanInfo.link = rec.link;
+  chanInfo.femb_on_link = rec.femb_on_link;
+  chanInfo.cebchan = rec.cebchan;
+  chanInfo.plane = rec.plane;
+  chanInfo.chan_in_plane = rec.chan_in_plane;
+  chanInfo.femb = rec.femb;
+  chanInfo.asic = rec.asic;
+  chanInfo.asicchan = rec.asicchan;
+  chanInfo.wibframechan = rec.wibframechan;
+  return chanInfo;
+}
 
-  auto fm3 = m2.find(link);
-  if (fm3 == m2.end()) return badInfo;
-  auto& m3 = fm3->second;
+dune::PD2HDChannelMapSP::HDChanInfo_t dune::PD2HDChannelMapSP::GetChanInfoFromWIBElements(
+    unsigned int crate,
+    unsigned int slot,
+    unsigned int link,
+    unsigned int wibframechan ) const {
 
-  auto fm4 = m3.find(wibframechan);
-  if (fm4 == m3.end()) return badInfo;
-  return fm4->second;
+  return MakeChanInfo(GetChanRecordFromWIBElements(crate, slot, link, wibframechan));
 }
 
 
 dune::PD2HDChannelMapSP::HDChanInfo_t dune::PD2HDChannelMapSP::GetChanInfoFromOfflChan(unsigned int offlineChannel) const {
-  auto ci = OfflToChanInfo.find(offlineChannel);
-  if (ci == OfflToChanInfo.end()) 
-    {
-      HDChanInfo_t badInfo = {};
-      badInfo.valid = false;
-      return badInfo;
-    }
-  return ci->second;
 
+  return MakeChanInfo(GetChanRecordFromOfflChan(offlineChannel));
 }
@@ -12,10 +12,10 @@
 #ifndef PD2HDChannelMapSP_H
 #define PD2HDChannelMapSP_H
 
-#include <unordered_map>
 #include <vector>
 #include <string>
 #include <stdexcept>
+#include <cstdint>
 
 namespace dune {
   class PD2HDChannelMapSP;
@@ -42,12 +42,39 @@ public:
     bool valid;          // true if valid, false if not
   } HDChanInfo_t;
 
+  // Compact, trivially copyable version of HDChanInfo_t used in the lookup
+  // tables.  The APA name is kept in a side table, see GetAPAName.
+
+  typedef struct HDChanRecord {
+    uint32_t offlchan;
+    uint16_t crate;
+    uint16_t apaindex;        // index of the APA name in the side table
+    uint16_t wib;
+    uint16_t link;
+    uint16_t femb_on_link;
+    uint16_t cebchan;
+    uint16_t plane;
+    uint16_t chan_in_plane;
+    uint16_t femb;
+    uint16_t asic;
+    uint16_t asicchan;
+    uint16_t wibframechan;
+    bool valid;
+  } HDChanRecord_t;
+
   PD2HDChannelMapSP();  // constructor
 
   // initialize:  read map from file
 
   void ReadMapFromFile(std::string &fullname);
 
+  // As ReadMapFromFile, but load the parsed map from the binary cache file
+  // cachename if it was built from this version of the text file.  Otherwise
+  // parse the text and try to (re)write the cache.  Returns true if the map
+  // was loaded from the cache.
+
+  bool ReadMapFromFileWithCache(std::string &fullname, const std::string &cachename);
+
   // TPC channel map accessors
 
   // Map instrumentation numbers (crate:slot:link:FEMB:plane) to offline channel number.  FEMB is 0 or 1 and indexes the FEMB in the WIB frame.
@@ -61,26 +88,78 @@ public:
 
   HDChanInfo_t GetChanInfoFromOfflChan(unsigned int offlchan) const;
 
+  // Same lookups returning a reference to the compact record, for use in
+  // per-channel decoder loops.  An invalid record is returned if the
+  // channel is not in the map.
+
+  const HDChanRecord_t & GetChanRecordFromWIBElements(
+   unsigned int crate,
+   unsigned int slot,
+   unsigned int link,
+   unsigned int wibframechan) const
+  {
+    unsigned int wib = slot + 1;
+    if (crate >= fNCrate || !fCrateInMap[crate])
+      {
+        crate = fSubstituteCrate;
+        if (crate >= fNCrate || !fCrateInMap[crate]) return fBadRecord;
+      }
+    if (wib >= fNWib || link >= fNLink || wibframechan >= fNWibFrameChan) return fBadRecord;
+    return fDetTable[((crate*fNWib + wib)*fNLink + link)*fNWibFrameChan + wibframechan];
+  }
+
+  const HDChanRecord_t & GetChanRecordFromOfflChan(unsigned int offlchan) const
+  {
+    if (offlchan >= fOfflTable.size()) return fBadRecord;
+    return fOfflTable[offlchan];
+  }
+
+  const std::string & GetAPAName(const HDChanRecord_t & rec) const { return fAPANames.at(rec.apaindex); }
+
+  // expand a compact record into the full channel info struct
+
+  HDChanInfo_t MakeChanInfo(const HDChanRecord_t & rec) const;
+
   unsigned int GetNChannels() {return fNChans;};
 
 private:
 
   const unsigned int fNChans = 2560*4;
 
-  // map of crate, slot, link, femb_on_link, plane, chan to channel info struct
+  // a hack -- ununderstood crates are mapped to crate 2
+  // for use in the Coldbox
+  // crate 2 has the lowest-numbered offline channels
+  // data with two ununderstood crates, or an ununderstood crate and crate 2,
+  // will have duplicate channels.
+
+  const unsigned int fSubstituteCrate = 2;
+
+  // records in the order read from the map file, and the APA names they point to
 
-  std::unordered_map<unsigned int,   // crate
-    std::unordered_map<unsigned int, // wib
-    std::unordered_map<unsigned int, // link
-    std::unordered_map<unsigned int, // wibframechan
-    HDChanInfo_t > > > > DetToChanInfo;
+  std::vector<HDChanRecord_t> fRecords;
+  std::vector<std::string> fAPANames;
 
-  // map of chan info indexed by offline channel number
+  // dense table of records indexed by (crate, wib, link, wibframechan), sized
+  // from the largest values in the map.  Entries not in the map are invalid.
 
-  std::unordered_map<unsigned int, HDChanInfo_t> OfflToChanInfo;
+  unsigned int fNCrate = 0;
+  unsigned int fNWib = 0;
+  unsigned int fNLink = 0;
+  unsigned int fNWibFrameChan = 0;
+  std::vector<HDChanRecord_t> fDetTable;
+  std::vector<bool> fCrateInMap;
+
+  // records indexed by offline channel number
+
+  std::vector<HDChanRecord_t> fOfflTable;
+
+  HDChanRecord_t fBadRecord = {};
 
   //-----------------------------------------------
 
+  void AddChannel(const HDChanInfo_t & chanInfo);
+  void BuildTables();
+
   void check_offline_channel(unsigned int offlineChannel) const
   {
   if (offlineChannel >= fNChans)
@@ -34,6 +34,22 @@ public:
    unsigned int wibframechan) const;
 
   dune::PD2HDChannelMapSP::HDChanInfo_t GetChanInfoFromOfflChan(unsigned int offlchan) const;
+
+  // compact-record lookups for per-channel decoder loops; see PD2HDChannelMapSP
+
+  const dune::PD2HDChannelMapSP::HDChanRecord_t & GetChanRecordFromWIBElements(
+   unsigned int crate,
+   unsigned int slot,
+   unsigned int link,
+   unsigned int wibframechan) const
+  { return fHDChanMap.GetChanRecordFromWIBElements(crate, slot, link, wibframechan); }
+
+  const dune::PD2HDChannelMapSP::HDChanRecord_t & GetChanRecordFromOfflChan(unsigned int offlchan) const
+  { return fHDChanMap.GetChanRecordFromOfflChan(offlchan); }
+
+  const std::string & GetAPAName(const dune::PD2HDChannelMapSP::HDChanRecord_t & rec) const
+  { return fHDChanMap.GetAPAName(rec); }
+
   unsigned int GetNChannels() {return fHDChanMap.GetNChannels();};
 
 private:
@@ -14,6 +14,9 @@ dune::PD2HDChannelMapService::PD2HDChannelMapService(fhicl::ParameterSet const&
 
   std::string channelMapFile = pset.get<std::string>("FileName");
 
+  // optional binary cache of the parsed map, rebuilt if missing or stale
+  std::string cacheFile = pset.get<std::string>("CacheFileName", "");
+
   std::string fullname;
   cet::search_path sp("FW_SEARCH_PATH");
   sp.find_file(channelMapFile, fullname);
@@ -25,7 +28,10 @@ dune::PD2HDChannelMapService::PD2HDChannelMapService(fhicl::ParameterSet const&
   else
     std::cout << "PD2HD Channel Map: Building TPC wiremap from file " << channelMapFile << std::endl;
 
-  fHDChanMap.ReadMapFromFile(fullname);
+  if (cacheFile.empty())
+    fHDChanMap.ReadMapFromFile(fullname);
+  else if (fHDChanMap.ReadMapFromFileWithCache(fullname, cacheFile))
+    std::cout << "PD2HD Channel Map: loaded from cache " << cacheFile << std::endl;
 }
 
 dune::PD2HDChannelMapService::PD2HDChannelMapService(fhicl::ParameterSet const& pset, art::ActivityRegistry&) : PD2HDChannelMapService(pset) {
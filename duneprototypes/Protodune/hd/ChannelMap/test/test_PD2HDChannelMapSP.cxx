@@ -0,0 +1,207 @@
+// test_PD2HDChannelMapSP.cxx
+//
+// Test the dense lookup tables in PD2HDChannelMapSP against the nested
+// maps they replaced, for every line of each map file given on the
+// command line, check the binary map cache, and time both lookups.
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+#include "duneprototypes/Protodune/hd/ChannelMap/PD2HDChannelMapSP.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::PD2HDChannelMapSP;
+using ChanInfo = PD2HDChannelMapSP::HDChanInfo_t;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// The map as it was held before the dense tables.
+class ReferenceMap {
+public:
+  void read(const string& fname) {
+    std::ifstream fin(fname);
+    string line;
+    while ( std::getline(fin, line) ) {
+      std::stringstream ssin(line);
+      ChanInfo ci;
+      ssin >> ci.offlchan >> ci.crate >> ci.APAName >> ci.wib >> ci.link >> ci.femb_on_link
+           >> ci.cebchan >> ci.plane >> ci.chan_in_plane >> ci.femb >> ci.asic >> ci.asicchan
+           >> ci.wibframechan;
+      ci.valid = true;
+      det[ci.crate][ci.wib][ci.link][ci.wibframechan] = ci;
+      offl[ci.offlchan] = ci;
+      lines.push_back(ci);
+    }
+  }
+  ChanInfo fromWIB(unsigned int crate, unsigned int slot, unsigned int link, unsigned int wfc) const {
+    ChanInfo bad = {};
+    bad.valid = false;
+    auto fm1 = det.find(crate);
+    if ( fm1 == det.end() ) {
+      fm1 = det.find(2);
+      if ( fm1 == det.end() ) return bad;
+    }
+    auto fm2 = fm1->second.find(slot + 1);
+    if ( fm2 == fm1->second.end() ) return bad;
+    auto fm3 = fm2->second.find(link);
+    if ( fm3 == fm2->second.end() ) return bad;
+    auto fm4 = fm3->second.find(wfc);
+    if ( fm4 == fm3->second.end() ) return bad;
+    return fm4->second;
+  }
+  ChanInfo fromOffline(unsigned int chan) const {
+    auto ici = offl.find(chan);
+    if ( ici == offl.end() ) {
+      ChanInfo bad = {};
+      bad.valid = false;
+      return bad;
+    }
+    return ici->second;
+  }
+  std::unordered_map<unsigned int, std::unordered_map<unsigned int,
+    std::unordered_map<unsigned int, std::unordered_map<unsigned int, ChanInfo>>>> det;
+  std::unordered_map<unsigned int, ChanInfo> offl;
+  vector<ChanInfo> lines;
+};
+
+bool same(const ChanInfo& a, const ChanInfo& b) {
+  if ( a.valid != b.valid ) return false;
+  if ( ! a.valid ) return true;
+  return a.offlchan == b.offlchan && a.crate == b.crate && a.APAName == b.APAName &&
+         a.wib == b.wib && a.link == b.link && a.femb_on_link == b.femb_on_link &&
+         a.cebchan == b.cebchan && a.plane == b.plane && a.chan_in_plane == b.chan_in_plane &&
+         a.femb == b.femb && a.asic == b.asic && a.asicchan == b.asicchan &&
+         a.wibframechan == b.wibframechan;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_PD2HDChannelMapSP(string fname) {
+  const string myname = "test_PD2HDChannelMapSP: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+
+  cout << myname << line << endl;
+  cout << myname << "Reading " << fname << endl;
+  ReferenceMap ref;
+  ref.read(fname);
+  assert( ref.lines.size() > 0 );
+  PD2HDChannelMapSP cmap;
+  cmap.ReadMapFromFile(fname);
+
+  cout << myname << line << endl;
+  cout << myname << "Check every line of the map (" << ref.lines.size() << ")." << endl;
+  for ( const ChanInfo& ci : ref.lines ) {
+    unsigned int slot = ci.wib - 1;
+    assert( same(cmap.GetChanInfoFromWIBElements(ci.crate, slot, ci.link, ci.wibframechan),
+                 ref.fromWIB(ci.crate, slot, ci.link, ci.wibframechan)) );
+    const auto& rec = cmap.GetChanRecordFromWIBElements(ci.crate, slot, ci.link, ci.wibframechan);
+    assert( same(cmap.MakeChanInfo(rec), ref.fromWIB(ci.crate, slot, ci.link, ci.wibframechan)) );
+    assert( same(cmap.GetChanInfoFromOfflChan(ci.offlchan), ref.fromOffline(ci.offlchan)) );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check every element in and around the map ranges." << endl;
+  size_t nvalid = 0;
+  for ( unsigned int crate=0; crate<8; ++crate ) {
+    for ( unsigned int slot=0; slot<8; ++slot ) {
+      for ( unsigned int link=0; link<3; ++link ) {
+        for ( unsigned int wfc=0; wfc<260; ++wfc ) {
+          ChanInfo ciref = ref.fromWIB(crate, slot, link, wfc);
+          assert( same(cmap.GetChanInfoFromWIBElements(crate, slot, link, wfc), ciref) );
+          if ( ciref.valid ) ++nvalid;
+        }
+      }
+    }
+  }
+  cout << myname << "  Valid lookups: " << nvalid << endl;
+  for ( unsigned int chan=0; chan<12000; ++chan ) {
+    assert( same(cmap.GetChanInfoFromOfflChan(chan), ref.fromOffline(chan)) );
+  }
+  // unknown crates are substituted with crate 2
+  assert( same(cmap.GetChanInfoFromWIBElements(1000000, 0, 0, 0), ref.fromWIB(1000000, 0, 0, 0)) );
+
+  cout << myname << line << endl;
+  cout << myname << "Check the binary map cache." << endl;
+  string cachename = "test_PD2HDChannelMapSP.cache";
+  std::remove(cachename.c_str());
+  PD2HDChannelMapSP cmapw;
+  assert( ! cmapw.ReadMapFromFileWithCache(fname, cachename) );
+  PD2HDChannelMapSP cmapc;
+  assert( cmapc.ReadMapFromFileWithCache(fname, cachename) );
+  for ( const ChanInfo& ci : ref.lines ) {
+    assert( same(cmapc.GetChanInfoFromWIBElements(ci.crate, ci.wib - 1, ci.link, ci.wibframechan),
+                 ref.fromWIB(ci.crate, ci.wib - 1, ci.link, ci.wibframechan)) );
+    assert( same(cmapc.GetChanInfoFromOfflChan(ci.offlchan), ref.fromOffline(ci.offlchan)) );
+  }
+  {
+    // a corrupted cache is rejected and rebuilt
+    std::ofstream fcache(cachename, std::ios::in | std::ios::out | std::ios::binary);
+    fcache.seekp(100);
+    fcache.put('x');
+  }
+  PD2HDChannelMapSP cmapbad;
+  assert( ! cmapbad.ReadMapFromFileWithCache(fname, cachename) );
+  PD2HDChannelMapSP cmapre;
+  assert( cmapre.ReadMapFromFileWithCache(fname, cachename) );
+  std::remove(cachename.c_str());
+
+  cout << myname << line << endl;
+  cout << myname << "Time lookups of every line." << endl;
+  const size_t nrep = 100;
+  size_t sumref = 0;
+  size_t sumrec = 0;
+  auto t0 = Clock::now();
+  for ( size_t irep=0; irep<nrep; ++irep ) {
+    for ( const ChanInfo& ci : ref.lines ) sumref += ref.fromWIB(ci.crate, ci.wib - 1, ci.link, ci.wibframechan).offlchan;
+  }
+  auto t1 = Clock::now();
+  for ( size_t irep=0; irep<nrep; ++irep ) {
+    for ( const ChanInfo& ci : ref.lines ) sumrec += cmap.GetChanRecordFromWIBElements(ci.crate, ci.wib - 1, ci.link, ci.wibframechan).offlchan;
+  }
+  auto t2 = Clock::now();
+  assert( sumref == sumrec );
+  double nlook = nrep*ref.lines.size();
+  cout << myname << "  nested maps: " << 1.e9*std::chrono::duration<double>(t1 - t0).count()/nlook << " ns/lookup" << endl;
+  cout << myname << "  dense table: " << 1.e9*std::chrono::duration<double>(t2 - t1).count()/nlook << " ns/lookup" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  if ( argc < 2 || string(argv[1]) == "-h" ) {
+    cout << "Usage: " << argv[0] << " MAPFILE [MAPFILE ...]" << endl;
+    cout << "  MAPFILE: PD2HD channel map text file to check." << endl;
+    return argc < 2;
+  }
+  for ( int iarg=1; iarg<argc; ++iarg ) {
+    int rstat = test_PD2HDChannelMapSP(argv[iarg]);
+    if ( rstat ) return rstat;
+  }
+  return 0;
+}
+
+//**********************************************************************
@@ -61,7 +61,8 @@ class DAPHNEInterface1 : public DAPHNEInterfaceBase {
     }
   }
   
-  //Get number of streaming Frames then loop over them and process each one
+  //Get number of streaming Frames then deinterleave them into the
+  //channel waveforms, sized for the whole fragment
   void ProcessStreamFrames(
       std::unique_ptr<Fragment> & frag,
       std::unordered_map<unsigned int, std::vector<raw::OpDetWaveform>> & wf_map,
@@ -69,68 +70,8 @@ class DAPHNEInterface1 : public DAPHNEInterfaceBase {
   
     auto n_frames = GetNFrames<DAPHNEStreamFrame>(frag->get_size(),
                                                   FragmentHeaderSize);
-    for (size_t i = 0; i < n_frames; ++i) {
-      auto frame
-          = reinterpret_cast<DAPHNEStreamFrame*>(
-              static_cast<uint8_t*>(frag->get_data()) + i*StreamFrameSize);
-      ProcessStreamFrame(frame, wf_map, daphne_tree);
-    }
-  }
-
-  void ProcessStreamFrame(
-      DAPHNEStreamFrame * frame,
-      std::unordered_map<unsigned int, std::vector<raw::OpDetWaveform>> & wf_map,
-      utils::DAPHNETree * daphne_tree) {
-    art::ServiceHandle<dune::DAPHNEChannelMapService> channel_map;
-    auto b_link = frame->daq_header.link_id;
-    auto b_slot = frame->daq_header.slot_id;
-  
-  
-    //Each streaming frame comes with data from 4 channels
-    std::array<size_t, 4> frame_channels = {
-      frame->header.channel_0,
-      frame->header.channel_1,
-      frame->header.channel_2,
-      frame->header.channel_3};
-    // Loop over channels
-    for (size_t i = 0; i < frame->s_channels_per_frame; ++i) {
-      auto offline_channel = -1;
-  
-      try {
-        offline_channel = channel_map->GetOfflineChannel(
-          b_slot, b_link, frame_channels[i]);
-      }
-      catch (const std::range_error & err) {
-        std::cout << "WARNING: Could not find offline channel for " <<
-                     b_slot << " " << b_link << " " << frame_channels[i] << std::endl;
-      }
-  
-      //Make output
-      auto & waveform = daphne::utils::MakeWaveform(
-            offline_channel,
-            frame->s_adcs_per_channel,
-            frame->get_timestamp(),
-            wf_map,
-            true);
-  
-      // Loop over ADC values in the frame for channel i 
-      for (size_t j = 0; j < static_cast<size_t>(frame->s_adcs_per_channel); ++j) {
-        waveform.push_back(frame->get_adc(j, i));
-        if (daphne_tree != nullptr)
-          daphne_tree->fADCValue[j] = frame->get_adc(j, i);
-      }
-  
-      if (daphne_tree != nullptr) {
-        daphne_tree->fSlot = b_slot;
-        daphne_tree->fDaphneChannel = frame_channels[i];
-        daphne_tree->fOfflineChannel = offline_channel;
-        daphne_tree->fFrameTimestamp = frame->get_timestamp();
-        daphne_tree->fTriggerSampleValue = 0;
-        daphne_tree->fThreshold = 0;
-        daphne_tree->fBaseline = 0;
-        daphne_tree->Fill();
-      } 
-    }
+    auto frames = reinterpret_cast<const DAPHNEStreamFrame*>(frag->get_data());
+    AssembleStreamFrames(frames, n_frames, fChannelTable, wf_map, daphne_tree);
   }
 
   void ProcessFrame(
@@ -138,16 +79,12 @@ class DAPHNEInterface1 : public DAPHNEInterfaceBase {
       std::unordered_map<unsigned int, std::vector<raw::OpDetWaveform>> & wf_map,
       utils::DAPHNETree * daphne_tree) {
   
-    art::ServiceHandle<dune::DAPHNEChannelMapService> channel_map;
     int b_channel_0 = frame->get_channel();
     int b_link = frame->daq_header.link_id;
     int b_slot = frame->daq_header.slot_id;
-    auto offline_channel=-1;
-    try {
-       offline_channel = channel_map->GetOfflineChannel(
-          b_slot, b_link, b_channel_0);
-    }
-    catch (const std::range_error & err) {
+    auto offline_channel = fChannelTable.OfflineChannel(
+        b_slot, b_link, b_channel_0);
+    if (offline_channel == DAPHNEChannelTable::kUnmapped) {
       //Just throw a warning so users can check out the rest of the data
       //maybe we can configure this to crash for keepup reco
       std::cout << "WARNING: Could not find offline channel for " <<
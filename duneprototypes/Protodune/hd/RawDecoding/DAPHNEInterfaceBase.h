@@ -5,6 +5,7 @@
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "duneprototypes/Protodune/hd/ChannelMap/DAPHNEChannelMapService.h"
+#include "DAPHNEStreamAssembler.h"
 
 namespace raw {
 class OpDetWaveform;
@@ -25,9 +26,14 @@ class DAPHNEInterfaceBase {
       std::unordered_map<unsigned int, std::vector<raw::OpDetWaveform>> & wf_map,
       utils::DAPHNETree * daphne_tree) = 0;
 
+  DAPHNEInterfaceBase() {
+    fChannelTable.Build(fChannelMap->Lines(), fChannelMap->IgnoreLinks());
+  }
   virtual ~DAPHNEInterfaceBase() = default;
  protected:
   art::ServiceHandle<dune::DAPHNEChannelMapService> fChannelMap;
+  //Offline channels looked up once, for all the frames
+  DAPHNEChannelTable fChannelTable;
 };
 }
 
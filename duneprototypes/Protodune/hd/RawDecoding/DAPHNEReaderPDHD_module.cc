@@ -27,6 +27,7 @@
 #include "art_root_io/TFileService.h"
 
 #include <memory>
+#include <iterator>
 namespace pdhd {
 
 //For brevity 
@@ -117,12 +118,15 @@ void pdhd::DAPHNEReaderPDHD::produce(art::Event& evt) {
   //Process the event
   fDAPHNETool->Process(evt, fFileInfoLabel, fSubDetString, wf_map, fDAPHNETree);
 
-  //Convert map to vector for output
+  //Convert map to vector for output, moving the waveforms
+  size_t n_waveforms = 0;
+  for (auto & chan_wf_vector : wf_map) n_waveforms += chan_wf_vector.second.size();
+  opdet_waveforms.reserve(n_waveforms);
   for (auto & chan_wf_vector : wf_map) {//Loop over channels
     //std::cout << "Inserting " << chan_wf_vector.first << " " << chan_wf_vector.second.size() << std::endl;
     opdet_waveforms.insert(opdet_waveforms.end(),
-                           chan_wf_vector.second.begin(),
-                           chan_wf_vector.second.end());
+                           std::make_move_iterator(chan_wf_vector.second.begin()),
+                           std::make_move_iterator(chan_wf_vector.second.end()));
     //Remove elements from wf_map to save memory
     chan_wf_vector.second.clear();
   }
@@ -0,0 +1,29 @@
+// DAPHNEStreamAssembler.cxx
+
+#include "DAPHNEStreamAssembler.h"
+
+namespace daphne {
+
+void DAPHNEChannelTable::Build(
+    const std::vector<dune::DAPHNEChannelMap::DaphneMapLine> & lines,
+    bool ignore_links) {
+
+  fIgnoreLinks = ignore_links;
+  fNSlots = fNLinks = fNChans = 0;
+  for (const auto & line : lines) {
+    unsigned int link = fIgnoreLinks ? 0 : line.link;
+    fNSlots = std::max<unsigned int>(fNSlots, line.slot + 1);
+    fNLinks = std::max<unsigned int>(fNLinks, link + 1);
+    fNChans = std::max<unsigned int>(fNChans, line.daphne_channel + 1);
+  }
+  fTable.assign(size_t(fNSlots)*fNLinks*fNChans, kUnmapped);
+
+  //Later lines replace earlier ones, as in the map
+  for (const auto & line : lines) {
+    unsigned int link = fIgnoreLinks ? 0 : line.link;
+    fTable[(size_t(line.slot)*fNLinks + link)*fNChans + line.daphne_channel]
+        = line.offline_channel;
+  }
+}
+
+}
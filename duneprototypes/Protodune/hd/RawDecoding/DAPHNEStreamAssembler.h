@@ -0,0 +1,186 @@
+// DAPHNEStreamAssembler.h
+//
+// Assembles the waveforms of streaming DAPHNE fragments.  Each stream
+// frame carries s_adcs_per_channel samples of four channels; the channels
+// of a frame are appended to one continuous waveform per offline channel,
+// created with the timestamp of the first frame that reaches it.
+//
+// The (slot, link, frame channel) to offline channel lookup is tabulated
+// once in a DAPHNEChannelTable.  The assembler then takes the runs of
+// consecutive frames with the same slot, link and channels (normally the
+// whole fragment) together: the four waveforms are found once and sized
+// for the run, and the frames are deinterleaved into them in a single
+// pass.  If two of the frame channels share an offline channel (e.g.
+// unmapped channels) the samples are appended frame by frame in the
+// original order instead.
+//
+// The frame type is a template parameter so the assembler serves both
+// DAPHNEStreamFrame versions.  It needs daq_header.slot_id and link_id,
+// header.channel_0 .. channel_3, get_timestamp(), get_adc(sample, channel)
+// and the s_channels_per_frame and s_adcs_per_channel constants.
+
+#ifndef DAPHNEStreamAssembler_H
+#define DAPHNEStreamAssembler_H
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+#include "duneprototypes/Protodune/hd/ChannelMap/DAPHNEChannelMap.h"
+#include "lardataobj/RawData/OpDetWaveform.h"
+
+namespace daphne {
+
+  using WaveformMap = std::unordered_map<unsigned int, std::vector<raw::OpDetWaveform>>;
+
+  // Flat (slot, link, frame channel) -> offline channel table.
+
+  class DAPHNEChannelTable {
+
+  public:
+
+    // Offline channel of triplets not in the map.  The decoders used -1.
+    static constexpr unsigned int kUnmapped = std::numeric_limits<unsigned int>::max();
+
+    void Build(const std::vector<dune::DAPHNEChannelMap::DaphneMapLine> & lines,
+               bool ignore_links);
+
+    bool empty() const { return fTable.empty(); }
+
+    unsigned int OfflineChannel(unsigned int slot, unsigned int link,
+                                unsigned int frame_chan) const {
+      if (fIgnoreLinks) link = 0;
+      if (slot >= fNSlots || link >= fNLinks || frame_chan >= fNChans) return kUnmapped;
+      return fTable[(slot*fNLinks + link)*fNChans + frame_chan];
+    }
+
+  private:
+
+    std::vector<unsigned int> fTable;
+    unsigned int fNSlots = 0;
+    unsigned int fNLinks = 0;
+    unsigned int fNChans = 0;
+    bool fIgnoreLinks = false;
+
+  };
+
+  // The waveform a stream channel is appended to.
+  inline raw::OpDetWaveform & StreamWaveform(unsigned int offline_chan,
+                                             raw::TimeStamp_t timestamp,
+                                             WaveformMap & wf_map) {
+    auto & wfs = wf_map[offline_chan];
+    if (wfs.empty()) wfs.emplace_back(timestamp, offline_chan);
+    return wfs.back();
+  }
+
+  // Append the frames of a stream fragment to the waveforms in wf_map.
+  // If tree is not null, one entry is filled per frame and channel.
+  template <class StreamFrame, class Tree>
+  void AssembleStreamFrames(const StreamFrame * frames, size_t n_frames,
+                            const DAPHNEChannelTable & table,
+                            WaveformMap & wf_map, Tree * tree) {
+    constexpr size_t nch = StreamFrame::s_channels_per_frame;
+    constexpr size_t nadc = StreamFrame::s_adcs_per_channel;
+    static_assert(nch == 4, "DAPHNE stream frames have four channels");
+
+    auto channels = [](const StreamFrame & frame) {
+      return std::array<unsigned int, nch>{
+        static_cast<unsigned int>(frame.header.channel_0),
+        static_cast<unsigned int>(frame.header.channel_1),
+        static_cast<unsigned int>(frame.header.channel_2),
+        static_cast<unsigned int>(frame.header.channel_3)};
+    };
+
+    size_t first = 0;
+    while (first < n_frames) {
+      const StreamFrame & frame0 = frames[first];
+      const unsigned int slot = frame0.daq_header.slot_id;
+      const unsigned int link = frame0.daq_header.link_id;
+      const auto frame_chans = channels(frame0);
+
+      // Run of frames with the same slot, link and channels.
+      size_t last = first + 1;
+      while (last < n_frames &&
+             frames[last].daq_header.slot_id == slot &&
+             frames[last].daq_header.link_id == link &&
+             channels(frames[last]) == frame_chans) ++last;
+
+      std::array<unsigned int, nch> offline;
+      for (size_t i = 0; i < nch; ++i) {
+        offline[i] = table.OfflineChannel(slot, link, frame_chans[i]);
+        if (offline[i] == DAPHNEChannelTable::kUnmapped) {
+          std::cout << "WARNING: Could not find offline channel for " <<
+                       slot << " " << link << " " << frame_chans[i] << std::endl;
+        }
+      }
+      // Channel i of frame, with its samples already in tree->fADCValue
+      auto fillTree = [&](const StreamFrame & frame, size_t i) {
+        tree->fSlot = slot;
+        tree->fDaphneChannel = frame_chans[i];
+        tree->fOfflineChannel = offline[i];
+        tree->fFrameTimestamp = frame.get_timestamp();
+        tree->fTriggerSampleValue = 0;
+        tree->fThreshold = 0;
+        tree->fBaseline = 0;
+        tree->Fill();
+      };
+
+      bool distinct = true;
+      for (size_t i = 0; i < nch; ++i)
+        for (size_t k = i + 1; k < nch; ++k)
+          if (offline[i] == offline[k]) distinct = false;
+
+      std::array<raw::OpDetWaveform*, nch> wfs;
+      std::array<size_t, nch> start;
+      for (size_t i = 0; i < nch; ++i) {
+        wfs[i] = &StreamWaveform(offline[i], frame0.get_timestamp(), wf_map);
+        start[i] = wfs[i]->size();
+        wfs[i]->reserve(start[i] + (last - first)*nadc);
+      }
+
+      if (distinct) {
+        std::array<short*, nch> out;
+        for (size_t i = 0; i < nch; ++i) {
+          wfs[i]->resize(start[i] + (last - first)*nadc);
+          out[i] = wfs[i]->data() + start[i];
+        }
+        for (size_t f = first; f < last; ++f) {
+          const StreamFrame & frame = frames[f];
+          for (size_t j = 0; j < nadc; ++j)
+            for (size_t i = 0; i < nch; ++i)
+              out[i][j] = frame.get_adc(j, i);
+          if (tree != nullptr) {
+            for (size_t i = 0; i < nch; ++i) {
+              std::copy(out[i], out[i] + nadc, tree->fADCValue);
+              fillTree(frame, i);
+            }
+          }
+          for (size_t i = 0; i < nch; ++i) out[i] += nadc;
+        }
+      }
+      else {
+        for (size_t f = first; f < last; ++f) {
+          const StreamFrame & frame = frames[f];
+          for (size_t i = 0; i < nch; ++i) {
+            for (size_t j = 0; j < nadc; ++j) {
+              wfs[i]->push_back(frame.get_adc(j, i));
+              if (tree != nullptr) tree->fADCValue[j] = frame.get_adc(j, i);
+            }
+            if (tree != nullptr) {
+              fillTree(frame, i);
+            }
+          }
+        }
+      }
+      first = last;
+    }
+  }
+
+}
+
+#endif
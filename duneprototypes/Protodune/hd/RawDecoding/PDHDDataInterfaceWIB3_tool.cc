@@ -4,7 +4,8 @@
 #include <sstream>
 #include <cstring>
 #include <string>
-#include "TMath.h"
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -227,7 +228,7 @@ public:
 		uint32_t slotloc = slot;
 		slotloc &= 0x7;
 
-		auto hdchaninfo = channelMap->GetChanInfoFromWIBElements (crate, slotloc, link, iChan); 
+		const auto & hdchaninfo = channelMap->GetChanRecordFromWIBElements (crate, slotloc, link, iChan);
 		unsigned int offline_chan = hdchaninfo.offlchan;
 
 		if (offline_chan > fMaxChan) continue;
@@ -247,35 +248,18 @@ public:
 
   void getMedianSigma(const raw::RawDigit::ADCvector_t &v_adc, float &median,
 					 float &sigma) {
-    size_t asiz = v_adc.size();
-    int imed=0;
-    if (asiz == 0) {
-      median = 0;
-      sigma = 0;
-    }
-    else {
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
-
-      imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-      median = imed;
-      sigma = TMath::RMS(asiz,v_adc.data());
-    
-      // add in a correction suggested by David Adams, May 6, 2019
-    
-      size_t s1 = 0;
-      size_t sm = 0;
-      for (size_t i = 0; i < asiz; ++i) {
-	if (v_adc.at(i) < imed) s1++;
-	if (v_adc.at(i) == imed) sm++;
-      }
-      if (sm > 0) {
-	float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-	if (fDebugLevel > 0)
-	  {
-	    if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-	  }
-	median += mcorr;
-      }
+    // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+
+    dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+    ped.Fill(v_adc);
+
+    // integer median plus a correction suggested by David Adams, May 6, 2019
+
+    median = ped.CorrectedMedian();
+    sigma = ped.RMS();
+    if (fDebugLevel > 0) {
+      float mcorr = ped.MedianCorrection();
+      if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
     }
   }
 };
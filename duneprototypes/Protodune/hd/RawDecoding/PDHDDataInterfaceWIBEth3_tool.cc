@@ -8,7 +8,12 @@
 #include <sstream>
 #include <cstring>
 #include <string>
-#include "TMath.h"
+#include <cmath>
+#include <memory>
+#include <iterator>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -16,6 +21,7 @@
 #include "dunecore/HDF5Utils/HDF5RawFile3Service.h"
 #include "detdataformats/wibeth/WIBEthFrame.hpp"
 #include "duneprototypes/Protodune/hd/ChannelMap/PD2HDChannelMapService.h"
+#include "duneprototypes/Protodune/hd/RawDecoding/WIBEthUnpacker.h"
 #include "dunecore/DuneObj/PDSPTPCDataInterfaceParent.h"
 
 class PDHDDataInterfaceWIBEth3 : public PDSPTPCDataInterfaceParent {
@@ -32,9 +38,20 @@ private:
   unsigned int fDefaultCrate = 1;
   int fDebugLevel = 0;   // switch to turn on debugging printout
   std::string fSubDetectorString;  // two values seen in the data:  HD_TPC and VD_Bottom_TPC
+  int fMaxConcurrency = 1;  // fragments decoded in parallel: 1 = serial, 0 = no limit
   typedef std::vector<raw::RawDigit> RawDigits;
   typedef std::vector<raw::RDTimeStamp> RDTimeStamps;
   typedef std::vector<raw::RDStatus> RDStatuses;
+  typedef dunedaq::daqdataformats::Fragment Fragment;
+  typedef std::vector<std::unique_ptr<Fragment>> Fragments;
+
+  // decoded products of one fragment
+  struct FragmentOutput {
+    RawDigits raw_digits;
+    RDTimeStamps timestamps;
+    RDStatuses rdstatuses;
+    std::string messages;  // printout, written to std::cout in fragment order
+  };
 
 public:
 
@@ -43,7 +60,8 @@ public:
       fMaxChan(p.get<int>("MaxChan",1000000)),
       fDefaultCrate(p.get<unsigned int>("DefaultCrate", 1)),
       fDebugLevel(p.get<int>("DebugLevel",0)),
-      fSubDetectorString(p.get<std::string>("SubDetectorString","HD_TPC"))
+      fSubDetectorString(p.get<std::string>("SubDetectorString","HD_TPC")),
+      fMaxConcurrency(p.get<int>("MaxConcurrency",1))
   { }
 
 
@@ -80,6 +98,10 @@ public:
 	std::cout << logname << " : " <<  "Retrieving Data for " << apalist.size() << " APAs " << std::endl;
       }
   
+    // Read the fragments serially -- HDF5 access is not thread safe.  When
+    // decoding serially each fragment is decoded as it is read; otherwise they
+    // are all read first and then decoded in parallel.
+    Fragments frags;
     for (const int & i : apalist)
       {
 	int apano = i;
@@ -88,7 +110,14 @@ public:
 	    std::cout << logname << " Tool called with requested APA:" << "apano: " << i << std::endl;
 	  }
 
-	getFragmentsForEvent(rid, raw_digits, rd_timestamps, apano, rdstatuses);
+	getFragmentsForEvent(rid, apano, frags, raw_digits, rd_timestamps, rdstatuses);
+      }
+
+    decodeFragments(frags, raw_digits, rd_timestamps, rdstatuses);
+
+    if (fDebugLevel > 0)
+      {
+	std::cout << "PDHDDataInterfaceToolWIBEth: number of raw digits found: "  << raw_digits.size() << std::endl;
       }
 
     return 0;
@@ -107,15 +136,17 @@ public:
   }
 
 
-  // This is designed to get data from one APA. 
+  // Read the fragments for one APA.  With MaxConcurrency 1 each fragment is
+  // decoded into the output and released before the next one is read;
+  // otherwise the fragments are appended to frags for decodeFragments.
   void getFragmentsForEvent(dunedaq::hdf5libs::HDF5RawDataFile::record_id_t &rid,
+                            int apano,
+                            Fragments & frags,
                             RawDigits& raw_digits,
                             RDTimeStamps &timestamps,
-                            int apano,
                             RDStatuses & rdstatuses)
   {
-    using dunedaq::fddetdataformats::WIBEthFrame;
-    art::ServiceHandle<dune::PD2HDChannelMapService> channelMap;
+    const dune::PD2HDChannelMapService * channelMap = &*art::ServiceHandle<dune::PD2HDChannelMapService>();
     art::ServiceHandle<dune::HDF5RawFile3Service> rawFileService;
     auto rf = rawFileService->GetPtr();
     auto sourceids = rf->get_source_ids(rid);
@@ -182,6 +213,89 @@ public:
 	    // it goes out of scope.
  
 	    auto frag = rf->get_frag_ptr(rid, source_id);
+	    if (fMaxConcurrency == 1)
+	      {
+		FragmentOutput out;
+		decodeFragment(frag.get(), channelMap, out);
+		appendFragmentOutput(out, raw_digits, timestamps, rdstatuses);
+	      }
+	    else
+	      {
+		frags.push_back(std::move(frag));
+	      }
+	  }
+      }
+  }
+
+  // Decode the fragments into raw digits, timestamps and statuses.  Each
+  // fragment is an independent task; the results are appended in fragment
+  // order whether or not the decoding ran in parallel.
+  void decodeFragments(const Fragments & frags,
+                       RawDigits& raw_digits,
+                       RDTimeStamps &timestamps,
+                       RDStatuses & rdstatuses)
+  {
+    const dune::PD2HDChannelMapService * channelMap = &*art::ServiceHandle<dune::PD2HDChannelMapService>();
+    std::vector<FragmentOutput> outputs(frags.size());
+
+    if (fMaxConcurrency == 1 || frags.size() < 2)
+      {
+	for (size_t i = 0; i < frags.size(); ++i) decodeFragment(frags[i].get(), channelMap, outputs[i]);
+      }
+    else
+      {
+	// 0 means use the scheduler's own limit
+	int nthread = fMaxConcurrency > 0 ? fMaxConcurrency : tbb::task_arena::automatic;
+	tbb::task_arena arena(nthread);
+	arena.execute([&] {
+	    tbb::parallel_for(size_t(0), frags.size(),
+			      [&](size_t i) { decodeFragment(frags[i].get(), channelMap, outputs[i]); });
+	  });
+      }
+
+    size_t ndigit = raw_digits.size();
+    for (const auto & out : outputs) ndigit += out.raw_digits.size();
+    raw_digits.reserve(ndigit);
+    timestamps.reserve(ndigit);
+    rdstatuses.reserve(ndigit);
+    for (auto & out : outputs) appendFragmentOutput(out, raw_digits, timestamps, rdstatuses);
+  }
+
+  // Append the products of one fragment and print its messages
+  void appendFragmentOutput(FragmentOutput & out,
+                            RawDigits& raw_digits,
+                            RDTimeStamps &timestamps,
+                            RDStatuses & rdstatuses) const
+  {
+    std::move(out.raw_digits.begin(), out.raw_digits.end(), std::back_inserter(raw_digits));
+    timestamps.insert(timestamps.end(), out.timestamps.begin(), out.timestamps.end());
+    rdstatuses.insert(rdstatuses.end(), out.rdstatuses.begin(), out.rdstatuses.end());
+    if (!out.messages.empty()) std::cout << out.messages << std::flush;
+  }
+
+  // Decode one WIBEth fragment.  Only reads tool configuration, so it may
+  // run concurrently on different fragments.  Printout goes to out.messages
+  // so that the output of concurrent fragments does not interleave.
+  void decodeFragment(const Fragment * frag,
+                      const dune::PD2HDChannelMapService * channelMap,
+                      FragmentOutput & out) const
+  {
+    std::ostringstream msg;
+    decodeFragment(frag, channelMap, out, msg);
+    out.messages = msg.str();
+  }
+
+  void decodeFragment(const Fragment * frag,
+                      const dune::PD2HDChannelMapService * channelMap,
+                      FragmentOutput & out,
+                      std::ostream & msg) const
+  {
+    using dunedaq::fddetdataformats::WIBEthFrame;
+    RawDigits & raw_digits = out.raw_digits;
+    RDTimeStamps & timestamps = out.timestamps;
+    RDStatuses & rdstatuses = out.rdstatuses;
+    pdhd::rawdecoding::WIBEthUnpacker unpacker;
+	  {
 	    auto frag_size = frag->get_size();
             auto frag_timestamp = frag->get_trigger_timestamp();
             auto frag_window_begin = frag->get_window_begin();
@@ -192,14 +306,13 @@ public:
             );
 
 	    size_t fhs = sizeof(dunedaq::daqdataformats::FragmentHeader);
-	    if (frag_size <= fhs) continue; // Too small to even have a header
+	    if (frag_size <= fhs) return; // Too small to even have a header
 	    size_t n_frames = (frag_size - fhs)/sizeof(WIBEthFrame);
 	    if (fDebugLevel > 0)
 	      {
-		std::cout << "n_frames calc.: " << frag_size << " " << fhs << " " << sizeof(WIBEthFrame) << " " << n_frames << std::endl;
+		msg << "n_frames calc.: " << frag_size << " " << fhs << " " << sizeof(WIBEthFrame) << " " << n_frames << std::endl;
 	      }
 
-	    std::vector<raw::RawDigit::ADCvector_t> adc_vectors(64);   // 64 channels per WIBEth frame
 	    unsigned int slot = 0, link = 0, crate = 0, stream = 0, locstream = 0;
           
             //We expect to have extra wib ticks, so figure out how many
@@ -213,29 +326,30 @@ public:
             //This will track if we see any problems
             bool any_bad = false;
 
-            //For reordering
-            std::vector<std::vector<raw::RawDigit::ADCvector_t>> temp_adcs;
+            //Ticks of each frame that fall inside the readout window.
+            //Filled in frame order, unpacked later in timestamp order
+            std::vector<std::pair<int, int>> frame_ticks;
+            frame_ticks.reserve(n_frames);
+            timestamp_indices.reserve(n_frames);
+
             //Tracks whether a given frame has hit the end
             bool reached_end = false;
 	    for (size_t i = 0; i < n_frames; ++i)
 	      {
-                //Makes a 64-channel wide vector
-                temp_adcs.emplace_back(64);
-
                 std::bitset<8> condition;
 		if (fDebugLevel > 2)
 		  {
 		    // dump WIB frames in binary
-		    std::cout << "Frame number: " << i << std::endl;
+		    msg << "Frame number: " << i << std::endl;
 		    size_t wfs32 = sizeof(WIBEthFrame)/4;
 		    uint32_t *fdp = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(frag->get_data()) + i*sizeof(WIBEthFrame));
-		    std::cout << std::dec;
+		    msg << std::dec;
 		    for (size_t iwdt = 0; iwdt < std::min(wfs32, (size_t) 4); iwdt++)  // dumps just the first 4 words.  use wfs32 if you want them all
 		      {
-			std::cout << iwdt << " : 10987654321098765432109876543210" << std::endl;
-			std::cout << iwdt << " : " << std::bitset<32>{fdp[iwdt]} << std::endl;
+			msg << iwdt << " : 10987654321098765432109876543210" << std::endl;
+			msg << iwdt << " : " << std::bitset<32>{fdp[iwdt]} << std::endl;
 		      }
-		    std::cout << std::dec;
+		    msg << std::dec;
 		  }
 
 		auto frame = reinterpret_cast<WIBEthFrame*>(static_cast<uint8_t*>(frag->get_data()) + i*sizeof(WIBEthFrame));
@@ -253,7 +367,7 @@ public:
                 auto frame_size = 64*512/16;
 
                 if (fDebugLevel > 0) {
-                  std::cout << "Frame " << i << " timestamps:" <<
+                  msg << "Frame " << i << " timestamps:" <<
                                "\n\tlink0: " << link0_timestamp <<
                                "\n\tlink1: " << link1_timestamp <<
                                "\n\tmaster:" << frame_timestamp <<
@@ -293,12 +407,12 @@ public:
                 //Should also check that none of the frames come out of order
                 //TODO -- figure out a way to order them if not good
                 if (frame_timestamp < latest_time) {
-                  std::cout << "Frame " << i <<
+                  msg << "Frame " << i <<
                                " is earlier than the so-far latest time " <<
                                latest_time << std::endl;
                 }
                 else if (frame_timestamp == latest_time) {
-                  std::cout << "Frame " << i <<
+                  msg << "Frame " << i <<
                                " is same as the so-far latest time " <<
                                latest_time << std::endl;
                 }
@@ -318,15 +432,14 @@ public:
                       (frag_window_begin*16./512 - frame_timestamp*16./512.)
                   );
                   if (fDebugLevel > 0)
-                    std::cout << "\tFirst frame. Start tick:" << start_tick << std::endl;
+                    msg << "\tFirst frame. Start tick:" << start_tick << std::endl;
 
                   if (i != 0) {
-                    std::cout << "WARNING. FIRST FRAME BY TIME, BUT NOT BY ITERATION" << std::endl;
+                    msg << "WARNING. FIRST FRAME BY TIME, BUT NOT BY ITERATION" << std::endl;
                   }
                   leftover_wib_ticks -= start_tick;
                 }
 
-		int adcvs = adc_vectors.size();  // convert to int
                 int last_tick = 64;
                 //if the readout time is past the frame, don't change anything
                 //if frame is past readout time, determine where to stop
@@ -334,17 +447,10 @@ public:
                   //Account for the ticks at the front
                   last_tick -= leftover_wib_ticks;
                   if (fDebugLevel > 0)
-                    std::cout << "Last frame. last tick: " << last_tick << std::endl;
+                    msg << "Last frame. last tick: " << last_tick << std::endl;
                 }
 
-		for (int jChan = 0; jChan < adcvs; ++jChan)   // these are ints because get_adc wants ints.
-		  {
-		    for (int kSample = start_tick; kSample < last_tick; ++kSample)
-		      {
-			adc_vectors[jChan].push_back(frame->get_adc(jChan,kSample));
-                        temp_adcs.back()[jChan].push_back(frame->get_adc(jChan,kSample));
-		      }
-		  }
+                frame_ticks.emplace_back(start_tick, last_tick);
               
 		if (i == 0)
 		  {
@@ -364,8 +470,8 @@ public:
 	      }
 	    if (fDebugLevel > 0)
 	      {
-		std::cout << "PDHDDataInterfaceToolWIBEth: crate, slot, link: "  << crate << ", " << slot << ", " << link << std::endl;
-		std::cout << "PDHDDataInterfaceToolWIBEth: stream, locstream: " << stream << ", " << locstream << std::endl;
+		msg << "PDHDDataInterfaceToolWIBEth: crate, slot, link: "  << crate << ", " << slot << ", " << link << std::endl;
+		msg << "PDHDDataInterfaceToolWIBEth: stream, locstream: " << stream << ", " << locstream << std::endl;
 	      }
 
             
@@ -383,44 +489,30 @@ public:
               reordered |= (timestamp_indices[i] != unordered[i]);
             }
 
-            //If we need to reorder, go through and correct the adcs
             if (reordered) {
-              std::cout << "Sorted: " << std::endl;
-
-              //Use this to move through full adc vectors in increments of
-              //the frame sizes
-              size_t sample_start = 0;
-
-              //Loop over frame in correct order
+              msg << "Sorted: " << std::endl;
               for (size_t i = 0; i < timestamp_indices.size(); ++i) {
                 const auto & ti = timestamp_indices[i];
                 const auto & u = unordered[i];
-                std::cout << "\t" << ti.first << " " << ti.second <<
+                msg << "\t" << ti.first << " " << ti.second <<
                              " " << u.first << " " << u.second << std::endl;
-
-                //Get the next frame
-                auto & this_adcs = temp_adcs[ti.second];
-                if (this_adcs.empty()) {
-                  throw cet::exception("PDHDDataInterfaceWIBEth3_tool.cc") <<
-                      "Somehow the reordering vector is empty at index " <<
-                      ti.second;
-                }
-
-                //Use first one -- should be safe because of above exception
-                size_t frame_samples = this_adcs[0].size();
-                //Go over channels in this frame
-                for (size_t jChan = 0; jChan < this_adcs.size(); ++jChan) {
-                  //For this channel, look over the samples
-                  for (size_t kSample = 0; kSample < frame_samples; ++kSample) {
-                    //And set the corresponding one in the output vector
-                    adc_vectors[jChan][kSample + sample_start] = this_adcs[jChan][kSample];
-                  }
-                }
-                //Move forward in the output vector by the length of this frame
-                sample_start += frame_samples;
               }
             }
 
+            //Unpack the frames in timestamp order straight into the output,
+            //sized once from the ticks each frame contributes
+            size_t n_samples = 0;
+            for (const auto & ft : frame_ticks) {
+              n_samples += std::max(0, ft.second - ft.first);
+            }
+            unpacker.Allocate(n_samples);
+            for (const auto & ti : timestamp_indices) {
+              auto frame = reinterpret_cast<WIBEthFrame*>(static_cast<uint8_t*>(frag->get_data()) + ti.second*sizeof(WIBEthFrame));
+              const auto & ft = frame_ticks[ti.second];
+              unpacker.Append(*frame, ft.first, ft.second);
+            }
+            auto & adc_vectors = unpacker.ADCs();
+
             //Check that no frames are dropped,they should be 2048 DTS ticks apart
             //64 WIB tick * 512 ns/WIB tick / (16 ns/DTS tick) = 2048 DTS ticks
             auto prev_timestamp = timestamp_indices[0].first;
@@ -429,7 +521,7 @@ public:
               auto this_timestamp = timestamp_indices[i].first;
               auto delta = this_timestamp - prev_timestamp;
               if (fDebugLevel > 0)
-                std::cout << i << " " << this_timestamp << " " <<
+                msg << i << " " << this_timestamp << " " <<
                              delta << std::endl;
               prev_timestamp = this_timestamp;
 
@@ -437,7 +529,7 @@ public:
               skipped_frames |= (delta != 2048);
 
               if (delta != 2048)
-                std::cout << "WARNING. APPARENT SKIPPED FRAME " << i << 
+                msg << "WARNING. APPARENT SKIPPED FRAME " << i << 
                              " timestamp delta: " << delta << std::endl;
               //TODO -- implement the patching,
               //but wait until we have bad data to work with
@@ -446,17 +538,17 @@ public:
 
 	    for (size_t iChan = 0; iChan < 64; ++iChan)
 	      {
-		const raw::RawDigit::ADCvector_t & v_adc = adc_vectors[iChan];
+		raw::RawDigit::ADCvector_t & v_adc = adc_vectors[iChan];
 
 		uint32_t slotloc = slot;
 		slotloc &= 0x7;
 
 		size_t wibframechan = iChan + 64*locstream; 
 
-		auto hdchaninfo = channelMap->GetChanInfoFromWIBElements (crate, slotloc, link, wibframechan);
+		const auto & hdchaninfo = channelMap->GetChanRecordFromWIBElements (crate, slotloc, link, wibframechan);
 		if (fDebugLevel > 2)
 		  {
-		    std::cout << "PDHDDataInterfaceToolWIBEth: wibframechan, valid: " << wibframechan << " " << hdchaninfo.valid << std::endl;
+		    msg << "PDHDDataInterfaceToolWIBEth: wibframechan, valid: " << wibframechan << " " << hdchaninfo.valid << std::endl;
 		  }
 		if (!hdchaninfo.valid) continue;
 
@@ -467,10 +559,12 @@ public:
 		timestamps.push_back(rd_ts);
 
 		float median = 0., sigma = 0.;
-		getMedianSigma(v_adc, median, sigma);
-		raw::RawDigit rd(offline_chan, v_adc.size(), v_adc);
+		getMedianSigma(v_adc, median, sigma, msg);
+		// each channel is used once, so hand the unpacked samples over
+		const size_t n_adc = v_adc.size();
+		raw::RawDigit rd(offline_chan, n_adc, std::move(v_adc));
 		rd.SetPedestal(median, sigma);
-		raw_digits.push_back(rd);
+		raw_digits.push_back(std::move(rd));
 
                 //Add a status so we can tell if it's bad or not
                 //
@@ -495,44 +589,22 @@ public:
                                         statword.to_ulong());
 	      }
 	  }
-      }
-    if (fDebugLevel > 0)
-      {
-	std::cout << "PDHDDataInterfaceToolWIBEth: number of raw digits found: "  << raw_digits.size() << std::endl;
-      }
   }
 
   void getMedianSigma(const raw::RawDigit::ADCvector_t &v_adc, float &median,
-		      float &sigma) {
-    size_t asiz = v_adc.size();
-    int imed=0;
-    if (asiz == 0) {
-      median = 0;
-      sigma = 0;
-    }
-    else {
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
-
-      imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-      median = imed;
-      sigma = TMath::RMS(asiz,v_adc.data());
-    
-      // add in a correction suggested by David Adams, May 6, 2019
-    
-      size_t s1 = 0;
-      size_t sm = 0;
-      for (size_t i = 0; i < asiz; ++i) {
-	if (v_adc.at(i) < imed) s1++;
-	if (v_adc.at(i) == imed) sm++;
-      }
-      if (sm > 0) {
-	float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-	if (fDebugLevel > 0)
-	  {
-	    if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-	  }
-	median += mcorr;
-      }
+		      float &sigma, std::ostream &msg) const {
+    // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+
+    dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+    ped.Fill(v_adc);
+
+    // integer median plus a correction suggested by David Adams, May 6, 2019
+
+    median = ped.CorrectedMedian();
+    sigma = ped.RMS();
+    if (fDebugLevel > 0) {
+      float mcorr = ped.MedianCorrection();
+      if (std::abs(mcorr)>1.0) msg << "mcorr: " << mcorr << std::endl;
     }
   }
 };
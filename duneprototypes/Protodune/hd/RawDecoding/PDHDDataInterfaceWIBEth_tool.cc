@@ -4,7 +4,8 @@
 #include <sstream>
 #include <cstring>
 #include <string>
-#include "TMath.h"
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
 
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -12,6 +13,7 @@
 #include "dunecore/HDF5Utils/HDF5RawFile2Service.h"
 #include "detdataformats/wibeth/WIBEthFrame.hpp"
 #include "duneprototypes/Protodune/hd/ChannelMap/PD2HDChannelMapService.h"
+#include "duneprototypes/Protodune/hd/RawDecoding/WIBEthUnpacker.h"
 #include "dunecore/DuneObj/PDSPTPCDataInterfaceParent.h"
 
 class PDHDDataInterfaceWIBEth : public PDSPTPCDataInterfaceParent {
@@ -28,6 +30,7 @@ private:
   unsigned int fDefaultCrate = 1;
   int fDebugLevel = 0;   // switch to turn on debugging printout
   std::string fSubDetectorString;  // two values seen in the data:  HD_TPC and VD_Bottom_TPC
+  pdhd::rawdecoding::WIBEthUnpacker fUnpacker;  // reused across source IDs
   typedef std::vector<raw::RawDigit> RawDigits;
   typedef std::vector<raw::RDTimeStamp> RDTimeStamps;
 
@@ -186,7 +189,8 @@ public:
 		std::cout << "n_frames calc.: " << frag_size << " " << fhs << " " << sizeof(WIBEthFrame) << " " << n_frames << std::endl;
 	      }
 
-	    std::vector<raw::RawDigit::ADCvector_t> adc_vectors(64);   // 64 channels per WIBEth frame
+	    fUnpacker.Allocate(n_frames*pdhd::rawdecoding::WIBEthUnpacker::kNTicks);
+	    auto & adc_vectors = fUnpacker.ADCs();   // 64 channels per WIBEth frame
 	    unsigned int slot = 0, link = 0, crate = 0, stream = 0, locstream = 0;
           
 	    for (size_t i = 0; i < n_frames; ++i)
@@ -207,14 +211,7 @@ public:
 		  }
 
 		auto frame = reinterpret_cast<WIBEthFrame*>(static_cast<uint8_t*>(frag->get_data()) + i*sizeof(WIBEthFrame));
-		int adcvs = adc_vectors.size();  // convert to int
-		for (int jChan = 0; jChan < adcvs; ++jChan)   // these are ints because get_adc wants ints.
-		  {
-		    for (int kSample=0; kSample<64; ++kSample)
-		      {
-			adc_vectors[jChan].push_back(frame->get_adc(jChan,kSample));
-		      }
-		  }
+		fUnpacker.Append(*frame);
               
 		if (i == 0)
 		  {
@@ -247,7 +244,7 @@ public:
 
 		size_t wibframechan = iChan + 64*locstream; 
 
-		auto hdchaninfo = channelMap->GetChanInfoFromWIBElements (crate, slotloc, link, wibframechan);
+		const auto & hdchaninfo = channelMap->GetChanRecordFromWIBElements (crate, slotloc, link, wibframechan);
 		if (fDebugLevel > 2)
 		  {
 		    std::cout << "PDHDDataInterfaceToolWIBEth: wibframechan, valid: " << wibframechan << " " << hdchaninfo.valid << std::endl;
@@ -276,35 +273,18 @@ public:
 
   void getMedianSigma(const raw::RawDigit::ADCvector_t &v_adc, float &median,
 		      float &sigma) {
-    size_t asiz = v_adc.size();
-    int imed=0;
-    if (asiz == 0) {
-      median = 0;
-      sigma = 0;
-    }
-    else {
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
-
-      imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-      median = imed;
-      sigma = TMath::RMS(asiz,v_adc.data());
-    
-      // add in a correction suggested by David Adams, May 6, 2019
-    
-      size_t s1 = 0;
-      size_t sm = 0;
-      for (size_t i = 0; i < asiz; ++i) {
-	if (v_adc.at(i) < imed) s1++;
-	if (v_adc.at(i) == imed) sm++;
-      }
-      if (sm > 0) {
-	float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-	if (fDebugLevel > 0)
-	  {
-	    if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-	  }
-	median += mcorr;
-      }
+    // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+
+    dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+    ped.Fill(v_adc);
+
+    // integer median plus a correction suggested by David Adams, May 6, 2019
+
+    median = ped.CorrectedMedian();
+    sigma = ped.RMS();
+    if (fDebugLevel > 0) {
+      float mcorr = ped.MedianCorrection();
+      if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
     }
   }
 };
@@ -32,6 +32,7 @@
 #include "art_root_io/TFileService.h"
 
 #include <memory>
+#include <chrono>
 
 class PDHDTPCReader;
 
@@ -63,6 +64,7 @@ private:
   TTree *m_StatusTree;
   int m_Event, m_Run, m_Subrun;
   std::vector<unsigned int> m_StatWord;
+  double m_DecodeTime;   // wall time spent in the decoder tool, seconds
 
   void SetRDTSFlags(
       const std::vector<raw::RawDigit> & raw_digits,
@@ -119,7 +121,9 @@ void PDHDTPCReader::produce(art::Event& e)
   std::vector<raw::RDTimeStamp> rdtscol;
   art::Assns<raw::RawDigit,raw::RDTimeStamp> rdtacol;
 
+  auto decode_start = std::chrono::steady_clock::now();
   m_DecoderTool->retrieveDataForSpecifiedAPAs(e, rawdigitcol, rdtscol, rdstatuscol, m_APAList);
+  m_DecodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - decode_start).count();
 
   SetRDTSFlags(rawdigitcol, rdtscol);
 
@@ -153,6 +157,7 @@ void PDHDTPCReader::beginJob() {
     m_StatusTree->Branch("event", &m_Event);
     m_StatusTree->Branch("run", &m_Run);
     m_StatusTree->Branch("subrun", &m_Subrun);
+    m_StatusTree->Branch("decodetime", &m_DecodeTime);
   }
 }
 DEFINE_ART_MODULE(PDHDTPCReader)
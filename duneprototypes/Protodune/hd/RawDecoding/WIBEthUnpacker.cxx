@@ -0,0 +1,197 @@
+#include "WIBEthUnpacker.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define WIBETHUNPACKER_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  constexpr int kBitsPerADC = 14;
+  constexpr uint64_t kADCMask = (1u << kBitsPerADC) - 1;
+
+  using pdhd::rawdecoding::WIBEthFrame;
+  static_assert(WIBEthFrame::s_bits_per_adc == kBitsPerADC, "WIBEth ADC width changed");
+  static_assert(WIBEthFrame::s_num_adc_words_per_ts*64 == WIBEthFrame::s_num_channels*kBitsPerADC,
+                "WIBEth per-tick packing changed");
+
+}
+
+//**********************************************************************
+
+pdhd::rawdecoding::WIBEthUnpacker::WIBEthUnpacker()
+  : fADCs(kNChannels), fPos(0) { }
+
+//**********************************************************************
+
+void pdhd::rawdecoding::WIBEthUnpacker::Allocate(size_t nsamples) {
+  for (auto & v : fADCs) v.resize(nsamples);
+  fPos = 0;
+}
+
+//**********************************************************************
+
+size_t pdhd::rawdecoding::WIBEthUnpacker::Append(const WIBEthFrame & frame, int first_tick, int last_tick) {
+  first_tick = std::max(first_tick, 0);
+  last_tick = std::min(last_tick, (int) kNTicks);
+  if (last_tick <= first_tick) return 0;
+  size_t nticks = last_tick - first_tick;
+
+  // grow if the caller under-allocated, so that we never write out of bounds
+  if (fPos + nticks > fADCs[0].size()) {
+    for (auto & v : fADCs) v.resize(fPos + nticks);
+  }
+
+  short * out[kNChannels];
+  for (size_t ich = 0; ich < kNChannels; ++ich) out[ich] = fADCs[ich].data() + fPos;
+  UnpackFrame(frame, first_tick, last_tick, out);
+  fPos += nticks;
+  return nticks;
+}
+
+//**********************************************************************
+
+void pdhd::rawdecoding::WIBEthUnpacker::UnpackFrame(const WIBEthFrame & frame, int first_tick, int last_tick,
+                                                   short * const * out) {
+  static const auto kernel = HasAVX2() ? &UnpackFrameAVX2 : &UnpackFrameScalar;
+  kernel(frame, first_tick, last_tick, out);
+}
+
+//**********************************************************************
+
+const char * pdhd::rawdecoding::WIBEthUnpacker::KernelName() {
+  return HasAVX2() ? "avx2" : "scalar";
+}
+
+//**********************************************************************
+
+void pdhd::rawdecoding::WIBEthUnpacker::UnpackFrameScalar(const WIBEthFrame & frame, int first_tick, int last_tick,
+                                                         short * const * out) {
+  // Samples for one tick are packed contiguously, channel 0 in the lowest
+  // bits of the first word.  Every 32 channels fill exactly 7 words, so the
+  // word index and shift of each channel are compile-time patterns.
+  for (int itick = first_tick; itick < last_tick; ++itick) {
+    const uint64_t * words = frame.adc_words[itick];
+    const size_t isam = itick - first_tick;
+    for (int ich = 0; ich < (int) kNChannels; ++ich) {
+      const int bit = kBitsPerADC*ich;
+      const int iword = bit >> 6;
+      const int shift = bit & 63;
+      uint64_t adc = words[iword] >> shift;
+      if (shift > 64 - kBitsPerADC) adc |= words[iword + 1] << (64 - shift);
+      out[ich][isam] = adc & kADCMask;
+    }
+  }
+}
+
+//**********************************************************************
+
+#if defined(WIBETHUNPACKER_HAVE_AVX2)
+
+bool pdhd::rawdecoding::WIBEthUnpacker::HasAVX2() {
+  static const bool has = __builtin_cpu_supports("avx2");
+  return has;
+}
+
+namespace {
+
+  // Unpack the 64 samples of one tick (112 bytes) into 64 consecutive
+  // int16.  Each group of 8 channels occupies 14 bytes; channels 0-3 of
+  // a group start at byte offsets 0,1,3,5 with bit shifts 0,6,4,2 and
+  // channels 4-7 repeat that pattern 7 bytes further on.  Each 128-bit
+  // lane gathers the 4 bytes holding one channel into a 32-bit element,
+  // which is then shifted and masked.  The loads read up to 23 bytes past
+  // the start of the last group, so the caller must provide 9 bytes of
+  // readable padding after the row.
+  __attribute__((target("avx2")))
+  inline void unpackTickAVX2(const uint8_t * row, int16_t * dst) {
+    const __m256i shuf = _mm256_setr_epi8(0, 1, 2, 3,  1, 2, 3, 4,  3, 4, 5, 6,  5, 6, 7, 8,
+                                          0, 1, 2, 3,  1, 2, 3, 4,  3, 4, 5, 6,  5, 6, 7, 8);
+    const __m256i shift = _mm256_setr_epi32(0, 6, 4, 2, 0, 6, 4, 2);
+    const __m256i mask = _mm256_set1_epi32(kADCMask);
+    for (int igrp = 0; igrp < 8; igrp += 2) {
+      __m256i v[2];
+      for (int k = 0; k < 2; ++k) {
+        const uint8_t * p = row + 14*(igrp + k);
+        __m256i raw = _mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 7)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        raw = _mm256_shuffle_epi8(raw, shuf);
+        v[k] = _mm256_and_si256(_mm256_srlv_epi32(raw, shift), mask);
+      }
+      // pack to 16 bits; packus interleaves the 128-bit lanes, so restore
+      // channel order with a 64-bit permute
+      __m256i packed = _mm256_packus_epi32(v[0], v[1]);
+      packed = _mm256_permute4x64_epi64(packed, 0xD8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 8*igrp), packed);
+    }
+  }
+
+  // Transpose an 8x8 block of int16: rows are ticks, columns channels.
+  __attribute__((target("avx2")))
+  inline void transpose8x8(const int16_t * src, size_t src_stride, short * const * out, size_t isam) {
+    __m128i r[8];
+    for (int i = 0; i < 8; ++i) r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*src_stride));
+    __m128i t0 = _mm_unpacklo_epi16(r[0], r[1]), t1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i t2 = _mm_unpacklo_epi16(r[2], r[3]), t3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i t4 = _mm_unpacklo_epi16(r[4], r[5]), t5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i t6 = _mm_unpacklo_epi16(r[6], r[7]), t7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i u0 = _mm_unpacklo_epi32(t0, t2), u1 = _mm_unpackhi_epi32(t0, t2);
+    __m128i u2 = _mm_unpacklo_epi32(t1, t3), u3 = _mm_unpackhi_epi32(t1, t3);
+    __m128i u4 = _mm_unpacklo_epi32(t4, t6), u5 = _mm_unpackhi_epi32(t4, t6);
+    __m128i u6 = _mm_unpacklo_epi32(t5, t7), u7 = _mm_unpackhi_epi32(t5, t7);
+    __m128i c[8] = { _mm_unpacklo_epi64(u0, u4), _mm_unpackhi_epi64(u0, u4),
+                     _mm_unpacklo_epi64(u1, u5), _mm_unpackhi_epi64(u1, u5),
+                     _mm_unpacklo_epi64(u2, u6), _mm_unpackhi_epi64(u2, u6),
+                     _mm_unpacklo_epi64(u3, u7), _mm_unpackhi_epi64(u3, u7) };
+    for (int i = 0; i < 8; ++i) _mm_storeu_si128(reinterpret_cast<__m128i*>(out[i] + isam), c[i]);
+  }
+
+}
+
+__attribute__((target("avx2")))
+void pdhd::rawdecoding::WIBEthUnpacker::UnpackFrameAVX2(const WIBEthFrame & frame, int first_tick, int last_tick,
+                                                       short * const * out) {
+  first_tick = std::max(first_tick, 0);
+  last_tick = std::min(last_tick, (int) kNTicks);
+  if (last_tick <= first_tick) return;
+
+  // Unpack tick-major into a scratch tile, then transpose to channel-major
+  // in 8x8 blocks.  The last tick of a frame is copied to a padded row so
+  // the vector loads never run past the end of the fragment.
+  constexpr size_t kRowBytes = sizeof(frame.adc_words[0]);
+  alignas(32) int16_t tile[kNTicks][kNChannels];
+  alignas(32) uint8_t lastrow[kRowBytes + 16] = {};
+  for (int itick = first_tick; itick < last_tick; ++itick) {
+    const uint8_t * row = reinterpret_cast<const uint8_t*>(frame.adc_words[itick]);
+    if (itick == (int) kNTicks - 1) {
+      std::memcpy(lastrow, row, kRowBytes);
+      row = lastrow;
+    }
+    unpackTickAVX2(row, tile[itick]);
+  }
+
+  const int nfull = first_tick + 8*((last_tick - first_tick)/8);
+  for (size_t ich = 0; ich < kNChannels; ich += 8) {
+    for (int itick = first_tick; itick < nfull; itick += 8) {
+      transpose8x8(&tile[itick][ich], kNChannels, out + ich, itick - first_tick);
+    }
+    for (int itick = nfull; itick < last_tick; ++itick) {
+      for (size_t jch = ich; jch < ich + 8; ++jch) out[jch][itick - first_tick] = tile[itick][jch];
+    }
+  }
+}
+
+#else
+
+bool pdhd::rawdecoding::WIBEthUnpacker::HasAVX2() { return false; }
+
+void pdhd::rawdecoding::WIBEthUnpacker::UnpackFrameAVX2(const WIBEthFrame & frame, int first_tick, int last_tick,
+                                                       short * const * out) {
+  UnpackFrameScalar(frame, first_tick, last_tick, out);
+}
+
+#endif
@@ -0,0 +1,78 @@
+// WIBEthUnpacker.h
+//
+// Bulk unpacker for WIBEth frames.  Collects the 64 channels of a
+// sequence of frames into per-channel ADC vectors sized once up front,
+// unpacking each frame (64 channels x 64 ticks of 14-bit samples) in a
+// single transposing pass instead of calling WIBEthFrame::get_adc for
+// every sample.
+//
+// The frame kernel has a portable scalar version and an AVX2 version.
+// The AVX2 one is used when the CPU running the job supports it; the
+// choice is made once, at first use.
+
+#ifndef WIBEthUnpacker_H
+#define WIBEthUnpacker_H
+
+#include <cstddef>
+#include <vector>
+
+#include "detdataformats/wibeth/WIBEthFrame.hpp"
+#include "lardataobj/RawData/RawDigit.h"
+
+namespace pdhd {
+namespace rawdecoding {
+
+  using dunedaq::fddetdataformats::WIBEthFrame;
+
+  class WIBEthUnpacker {
+
+  public:
+
+    static constexpr size_t kNChannels = 64;   // channels per WIBEth frame
+    static constexpr size_t kNTicks = 64;      // time samples per WIBEth frame
+
+    WIBEthUnpacker();
+
+    // Size every channel to hold nsamples and rewind the write position.
+    // The vectors are resized, not reserved, so Append writes in place.
+    void Allocate(size_t nsamples);
+
+    // Unpack ticks [first_tick, last_tick) of a frame and append them to
+    // every channel at the current write position.  Returns the number
+    // of ticks written.
+    size_t Append(const WIBEthFrame & frame, int first_tick = 0, int last_tick = kNTicks);
+
+    // Number of samples written so far per channel.
+    size_t Size() const { return fPos; }
+
+    std::vector<raw::RawDigit::ADCvector_t> & ADCs() { return fADCs; }
+    const std::vector<raw::RawDigit::ADCvector_t> & ADCs() const { return fADCs; }
+
+    // Unpack ticks [first_tick, last_tick) of one frame.  Channel ch is
+    // written to out[ch][0 .. last_tick-first_tick).  Dispatches to the
+    // fastest kernel available on this CPU.
+    static void UnpackFrame(const WIBEthFrame & frame, int first_tick, int last_tick,
+                            short * const * out);
+
+    // The individual kernels, exposed for testing.  UnpackFrameAVX2 must
+    // only be called if HasAVX2() is true.
+    static void UnpackFrameScalar(const WIBEthFrame & frame, int first_tick, int last_tick,
+                                  short * const * out);
+    static void UnpackFrameAVX2(const WIBEthFrame & frame, int first_tick, int last_tick,
+                                short * const * out);
+    static bool HasAVX2();
+
+    // Name of the kernel UnpackFrame dispatches to: "avx2" or "scalar".
+    static const char * KernelName();
+
+  private:
+
+    std::vector<raw::RawDigit::ADCvector_t> fADCs;
+    size_t fPos;
+
+  };
+
+}
+}
+
+#endif
@@ -0,0 +1,291 @@
+// test_DAPHNEStreamAssembler.cxx
+//
+// Test DAPHNEChannelTable against DAPHNEChannelMap lookups, with and
+// without IgnoreLinks, and AssembleStreamFrames against the per-frame
+// loop DAPHNEInterface1/2 used before.  Fragments with one set of
+// channels, with channels changing between frames, with unmapped
+// channels and split over two fragments are checked, together with the
+// waveform tree entries.  The frames are a stand-in with the DAPHNE
+// stream frame interface.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include "duneprototypes/Protodune/hd/RawDecoding/DAPHNEStreamAssembler.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using daphne::DAPHNEChannelTable;
+using daphne::WaveformMap;
+using MapLine = dune::DAPHNEChannelMap::DaphneMapLine;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// Stand-in for the DAPHNE stream frame: 64 samples of 4 channels,
+// interleaved sample by sample.
+struct StreamFrame {
+  static const uint8_t s_channels_per_frame = 4;
+  static const uint8_t s_adcs_per_channel = 64;
+  struct { uint32_t slot_id = 0; uint32_t link_id = 0; } daq_header;
+  struct { uint32_t channel_0 = 0, channel_1 = 0, channel_2 = 0, channel_3 = 0; } header;
+  uint64_t timestamp = 0;
+  uint16_t adcs[s_adcs_per_channel*s_channels_per_frame];
+  uint64_t get_timestamp() const { return timestamp; }
+  uint16_t get_adc(unsigned int i, unsigned int chn) const { return adcs[i*s_channels_per_frame + chn]; }
+};
+
+// Records the tree entries.
+struct Tree {
+  int fSlot, fDaphneChannel, fOfflineChannel, fTriggerSampleValue, fThreshold, fBaseline;
+  long fFrameTimestamp;
+  short fADCValue[1024];
+  vector<vector<long>> entries;
+  void Fill() {
+    vector<long> ent = {fSlot, fDaphneChannel, fOfflineChannel, fFrameTimestamp,
+                        fTriggerSampleValue, fThreshold, fBaseline};
+    ent.insert(ent.end(), fADCValue, fADCValue + StreamFrame::s_adcs_per_channel);
+    entries.push_back(ent);
+  }
+};
+
+// The lookup and per-frame loop the decoders used.
+void referenceProcess(const vector<StreamFrame>& frames, dune::DAPHNEChannelMap& chmap,
+                      WaveformMap& wf_map, Tree* tree) {
+  for ( const StreamFrame& fr : frames ) {
+    const StreamFrame* frame = &fr;
+    auto b_link = frame->daq_header.link_id;
+    auto b_slot = frame->daq_header.slot_id;
+    std::array<size_t, 4> frame_channels = {
+      frame->header.channel_0, frame->header.channel_1,
+      frame->header.channel_2, frame->header.channel_3};
+    for ( size_t i = 0; i < frame->s_channels_per_frame; ++i ) {
+      auto offline_channel = -1;
+      try {
+        offline_channel = chmap.GetOfflineChannel(b_slot, b_link, frame_channels[i]);
+      }
+      catch (const std::range_error & err) { }
+      unsigned int offline_chan = offline_channel;
+      if ( wf_map.find(offline_chan) == wf_map.end() ) {
+        wf_map.emplace(offline_chan, std::vector<raw::OpDetWaveform>());
+      }
+      if ( wf_map.at(offline_chan).size() == 0 ) {
+        wf_map.at(offline_chan).emplace_back(raw::OpDetWaveform(frame->get_timestamp(), offline_chan));
+      }
+      auto & waveform = wf_map.at(offline_chan).back();
+      for ( size_t j = 0; j < static_cast<size_t>(frame->s_adcs_per_channel); ++j ) {
+        waveform.push_back(frame->get_adc(j, i));
+        if ( tree != nullptr ) tree->fADCValue[j] = frame->get_adc(j, i);
+      }
+      if ( tree != nullptr ) {
+        tree->fSlot = b_slot;
+        tree->fDaphneChannel = frame_channels[i];
+        tree->fOfflineChannel = offline_channel;
+        tree->fFrameTimestamp = frame->get_timestamp();
+        tree->fTriggerSampleValue = 0;
+        tree->fThreshold = 0;
+        tree->fBaseline = 0;
+        tree->Fill();
+      }
+    }
+  }
+}
+
+void makeFrames(vector<StreamFrame>& frames, size_t nfrm, uint32_t slot, uint32_t link,
+                std::array<uint32_t, 4> chans, uint64_t t0, std::mt19937& rng) {
+  std::uniform_int_distribution<int> adcdist(0, 0x3fff);
+  for ( size_t ifrm=0; ifrm<nfrm; ++ifrm ) {
+    StreamFrame fr;
+    fr.daq_header.slot_id = slot;
+    fr.daq_header.link_id = link;
+    fr.header.channel_0 = chans[0];
+    fr.header.channel_1 = chans[1];
+    fr.header.channel_2 = chans[2];
+    fr.header.channel_3 = chans[3];
+    fr.timestamp = t0 + 64*ifrm;
+    for ( uint16_t& adc : fr.adcs ) adc = adcdist(rng);
+    frames.push_back(fr);
+  }
+}
+
+bool sameWaveforms(const WaveformMap& lhs, const WaveformMap& rhs) {
+  if ( lhs.size() != rhs.size() ) return false;
+  for ( const auto& ent : lhs ) {
+    auto irhs = rhs.find(ent.first);
+    if ( irhs == rhs.end() ) return false;
+    if ( ent.second.size() != irhs->second.size() ) return false;
+    for ( size_t iwf=0; iwf<ent.second.size(); ++iwf ) {
+      const raw::OpDetWaveform& wl = ent.second[iwf];
+      const raw::OpDetWaveform& wr = irhs->second[iwf];
+      if ( wl.ChannelNumber() != wr.ChannelNumber() ) return false;
+      if ( wl.TimeStamp() != wr.TimeStamp() ) return false;
+      if ( static_cast<const std::vector<short>&>(wl) != static_cast<const std::vector<short>&>(wr) ) return false;
+    }
+  }
+  return true;
+}
+
+// Both ways for a list of fragments, with and without the tree.
+void check(const vector<vector<StreamFrame>>& frags, dune::DAPHNEChannelMap& chmap,
+           const DAPHNEChannelTable& table) {
+  for ( bool usetree : {false, true} ) {
+    WaveformMap wfref, wfnew;
+    Tree treeref, treenew;
+    for ( const auto& frames : frags ) {
+      referenceProcess(frames, chmap, wfref, usetree ? &treeref : nullptr);
+      daphne::AssembleStreamFrames(frames.data(), frames.size(), table, wfnew,
+                                   usetree ? &treenew : nullptr);
+    }
+    assert( sameWaveforms(wfref, wfnew) );
+    assert( treeref.entries == treenew.entries );
+  }
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_DAPHNEStreamAssembler(size_t nfrm) {
+  const string myname = "test_DAPHNEStreamAssembler: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(2023);
+
+  // Four slots, two links, channels 0-47 on every other link.
+  vector<MapLine> lines;
+  unsigned int offl = 0;
+  for ( uint32_t slot : {4u, 5u, 7u, 9u} ) {
+    for ( uint32_t link : {0u, 1u} ) {
+      for ( uint32_t ch=0; ch<48; ch += (link == 0 ? 1 : 2) ) {
+        lines.push_back({slot, link, ch, offl % 160});
+        ++offl;
+      }
+    }
+  }
+
+  string mapname = "test_DAPHNEStreamAssembler_map.txt";
+  {
+    std::ofstream fout(mapname);
+    for ( const MapLine& ml : lines ) {
+      fout << ml.slot << " " << ml.link << " " << ml.daphne_channel << " " << ml.offline_channel << "\n";
+    }
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Channel table." << endl;
+  for ( bool ignore_links : {false, true} ) {
+    dune::DAPHNEChannelMap chmap(ignore_links);
+    chmap.ReadMapFromFile(mapname);
+    assert( chmap.Lines().size() == lines.size() );
+    DAPHNEChannelTable table;
+    assert( table.empty() );
+    table.Build(chmap.Lines(), chmap.IgnoreLinks());
+    assert( !table.empty() );
+    for ( unsigned int slot=0; slot<12; ++slot ) {
+      for ( unsigned int link=0; link<3; ++link ) {
+        for ( unsigned int ch=0; ch<64; ++ch ) {
+          unsigned int expect = DAPHNEChannelTable::kUnmapped;
+          try { expect = chmap.GetOfflineChannel(slot, link, ch); }
+          catch (const std::range_error &) { }
+          assert( table.OfflineChannel(slot, link, ch) == expect );
+        }
+      }
+    }
+  }
+
+  dune::DAPHNEChannelMap chmap(false);
+  chmap.ReadMapFromFile(mapname);
+  DAPHNEChannelTable table;
+  table.Build(chmap.Lines(), chmap.IgnoreLinks());
+
+  cout << myname << line << endl;
+  cout << myname << "One set of channels." << endl;
+  {
+    vector<vector<StreamFrame>> frags(1);
+    makeFrames(frags[0], nfrm, 5, 0, {0, 1, 2, 3}, 1000, rng);
+    check(frags, chmap, table);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Channels changing between frames, two fragments." << endl;
+  {
+    vector<vector<StreamFrame>> frags(2);
+    makeFrames(frags[0], 10, 5, 0, {0, 1, 2, 3}, 1000, rng);
+    makeFrames(frags[0], 7, 5, 0, {4, 5, 6, 7}, 2000, rng);
+    makeFrames(frags[0], 1, 7, 1, {0, 2, 4, 6}, 3000, rng);
+    makeFrames(frags[0], 5, 5, 0, {0, 1, 2, 3}, 4000, rng);
+    makeFrames(frags[1], 9, 5, 0, {0, 1, 2, 3}, 5000, rng);
+    makeFrames(frags[1], 3, 9, 1, {10, 12, 14, 16}, 6000, rng);
+    check(frags, chmap, table);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Unmapped channels." << endl;
+  {
+    vector<vector<StreamFrame>> frags(1);
+    // Odd channels are not mapped on link 1; slot 2 not at all.
+    makeFrames(frags[0], 6, 7, 1, {0, 1, 2, 3}, 1000, rng);
+    makeFrames(frags[0], 4, 2, 0, {0, 1, 2, 3}, 2000, rng);
+    makeFrames(frags[0], 4, 7, 1, {1, 2, 4, 6}, 3000, rng);
+    check(frags, chmap, table);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Timing." << endl;
+  {
+    vector<StreamFrame> frames;
+    makeFrames(frames, nfrm, 4, 0, {8, 9, 10, 11}, 1000, rng);
+    WaveformMap wfref, wfnew;
+    auto t0 = Clock::now();
+    referenceProcess(frames, chmap, wfref, nullptr);
+    auto t1 = Clock::now();
+    daphne::AssembleStreamFrames(frames.data(), frames.size(), table, wfnew,
+                                 static_cast<Tree*>(nullptr));
+    auto t2 = Clock::now();
+    assert( sameWaveforms(wfref, wfnew) );
+    double tref = std::chrono::duration<double>(t1 - t0).count();
+    double tnew = std::chrono::duration<double>(t2 - t1).count();
+    cout << myname << "Frames/s, per-frame loop: " << nfrm/tref << endl;
+    cout << myname << "Frames/s, assembler:      " << nfrm/tnew << endl;
+  }
+
+  std::remove(mapname.c_str());
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nfrm = 20000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NFRM]" << endl;
+      cout << "  NFRM [20000]: Number of frames in the large fragments." << endl;
+      return 0;
+    }
+    nfrm = std::stoul(sarg);
+  }
+  return test_DAPHNEStreamAssembler(nfrm);
+}
+
+//**********************************************************************
@@ -0,0 +1,216 @@
+// test_WIBEthUnpacker.cxx
+//
+// Test WIBEthUnpacker against the per-sample WIBEthFrame::get_adc path
+// used previously in PDHDDataInterfaceWIBEth3, including out-of-order
+// frames and trimmed first/last frames.  Both frame kernels (scalar and,
+// where the CPU has it, AVX2) are checked bit for bit on randomized
+// frames.  Reports frames/s for each kernel and decode rates for an
+// APA-sized block of fragments.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include "duneprototypes/Protodune/hd/RawDecoding/WIBEthUnpacker.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using pdhd::rawdecoding::WIBEthFrame;
+using pdhd::rawdecoding::WIBEthUnpacker;
+using ADCvector = raw::RawDigit::ADCvector_t;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// Fill nfrm frames with random 14-bit samples and consecutive timestamps.
+void makeFrames(vector<uint8_t>& buf, size_t nfrm, std::mt19937& rng) {
+  buf.assign(nfrm*sizeof(WIBEthFrame), 0);
+  std::uniform_int_distribution<int> adcdist(0, 0x3fff);
+  for ( size_t ifrm=0; ifrm<nfrm; ++ifrm ) {
+    auto pfrm = reinterpret_cast<WIBEthFrame*>(buf.data() + ifrm*sizeof(WIBEthFrame));
+    pfrm->set_timestamp(1000000 + 2048*ifrm);
+    for ( int itck=0; itck<64; ++itck ) {
+      for ( int icha=0; icha<64; ++icha ) {
+        pfrm->set_adc(icha, itck, adcdist(rng));
+      }
+    }
+  }
+}
+
+const WIBEthFrame* frame(const vector<uint8_t>& buf, size_t ifrm) {
+  return reinterpret_cast<const WIBEthFrame*>(buf.data() + ifrm*sizeof(WIBEthFrame));
+}
+
+// Reference: the old per-sample decode with a per-frame reordering copy.
+void decodeReference(const vector<uint8_t>& buf, const vector<size_t>& order,
+                     const vector<std::pair<int,int>>& ticks, vector<ADCvector>& adcs) {
+  size_t nfrm = order.size();
+  adcs.assign(64, ADCvector());
+  vector<vector<ADCvector>> temp_adcs;
+  for ( size_t ifrm=0; ifrm<nfrm; ++ifrm ) {
+    temp_adcs.emplace_back(64);
+    for ( int icha=0; icha<64; ++icha ) {
+      for ( int itck=ticks[ifrm].first; itck<ticks[ifrm].second; ++itck ) {
+        adcs[icha].push_back(frame(buf, ifrm)->get_adc(icha, itck));
+        temp_adcs.back()[icha].push_back(frame(buf, ifrm)->get_adc(icha, itck));
+      }
+    }
+  }
+  size_t isam0 = 0;
+  for ( size_t ifrm : order ) {
+    size_t nsam = temp_adcs[ifrm][0].size();
+    for ( int icha=0; icha<64; ++icha ) {
+      for ( size_t isam=0; isam<nsam; ++isam ) adcs[icha][isam0 + isam] = temp_adcs[ifrm][icha][isam];
+    }
+    isam0 += nsam;
+  }
+}
+
+void decodeUnpacker(const vector<uint8_t>& buf, const vector<size_t>& order,
+                    const vector<std::pair<int,int>>& ticks, WIBEthUnpacker& unp) {
+  size_t nsam = 0;
+  for ( const auto& tck : ticks ) nsam += std::max(0, tck.second - tck.first);
+  unp.Allocate(nsam);
+  for ( size_t ifrm : order ) unp.Append(*frame(buf, ifrm), ticks[ifrm].first, ticks[ifrm].second);
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_WIBEthUnpacker(size_t nfrm =129, size_t nrep =10) {
+  const string myname = "test_WIBEthUnpacker: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(20240423);
+
+  using Kernel = void (*)(const WIBEthFrame&, int, int, short* const*);
+  vector<std::pair<string, Kernel>> kernels = {{"scalar", &WIBEthUnpacker::UnpackFrameScalar}};
+  if ( WIBEthUnpacker::HasAVX2() ) kernels.emplace_back("avx2", &WIBEthUnpacker::UnpackFrameAVX2);
+  cout << myname << line << endl;
+  cout << myname << "Dispatch kernel: " << WIBEthUnpacker::KernelName() << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Check frame kernels against get_adc on random frames." << endl;
+  const size_t nrfrm = 256;
+  vector<uint8_t> buf;
+  makeFrames(buf, nrfrm, rng);
+  vector<short> blk(64*64);
+  vector<short*> outs(64);
+  for ( int icha=0; icha<64; ++icha ) outs[icha] = blk.data() + 64*icha;
+  std::uniform_int_distribution<int> tckdist(0, 64);
+  for ( const auto& ker : kernels ) {
+    cout << myname << "  " << ker.first << endl;
+    for ( size_t ifrm=0; ifrm<nrfrm; ++ifrm ) {
+      // full frame for the first half, random tick ranges for the rest
+      int itck1 = 0;
+      int itck2 = 64;
+      if ( ifrm >= nrfrm/2 ) {
+        itck1 = tckdist(rng);
+        itck2 = tckdist(rng);
+        if ( itck2 < itck1 ) std::swap(itck1, itck2);
+      }
+      std::fill(blk.begin(), blk.end(), -1);
+      ker.second(*frame(buf, ifrm), itck1, itck2, outs.data());
+      for ( int icha=0; icha<64; ++icha ) {
+        for ( int itck=itck1; itck<itck2; ++itck ) {
+          assert( blk[64*icha + itck - itck1] == frame(buf, ifrm)->get_adc(icha, itck) );
+        }
+        for ( int isam=itck2-itck1; isam<64; ++isam ) assert( blk[64*icha + isam] == -1 );
+      }
+    }
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Time frame kernels." << endl;
+  for ( const auto& ker : kernels ) {
+    const size_t nloop = 50*nrep;
+    auto tk0 = Clock::now();
+    for ( size_t iloop=0; iloop<nloop; ++iloop ) {
+      for ( size_t ifrm=0; ifrm<nrfrm; ++ifrm ) ker.second(*frame(buf, ifrm), 0, 64, outs.data());
+    }
+    auto tk1 = Clock::now();
+    double sec = std::chrono::duration<double>(tk1 - tk0).count();
+    cout << myname << std::setw(10) << ker.first << ": " << nloop*nrfrm/sec << " frames/s" << endl;
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check in-order, trimmed and reordered fragments." << endl;
+  makeFrames(buf, nfrm, rng);
+  vector<std::pair<int,int>> ticks(nfrm, {0, 64});
+  ticks.front().first = 17;
+  ticks.back().second = 40;
+  vector<size_t> order(nfrm);
+  for ( size_t ifrm=0; ifrm<nfrm; ++ifrm ) order[ifrm] = ifrm;
+  vector<vector<size_t>> orders = {order};
+  std::swap(order[3], order[4]);
+  orders.push_back(order);
+  std::shuffle(order.begin(), order.end(), rng);
+  orders.push_back(order);
+  WIBEthUnpacker unp;
+  for ( const auto& ord : orders ) {
+    vector<ADCvector> ref;
+    decodeReference(buf, ord, ticks, ref);
+    decodeUnpacker(buf, ord, ticks, unp);
+    assert( unp.Size() == ref[0].size() );
+    for ( int icha=0; icha<64; ++icha ) assert( unp.ADCs()[icha] == ref[icha] );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Time decoding of one APA (40 links x " << nfrm << " frames)." << endl;
+  const size_t nlink = 40;
+  double mbytes = nrep*nlink*nfrm*sizeof(WIBEthFrame)/1.e6;
+  order.resize(nfrm);
+  for ( size_t ifrm=0; ifrm<nfrm; ++ifrm ) order[ifrm] = ifrm;
+  auto t0 = Clock::now();
+  for ( size_t irep=0; irep<nrep*nlink; ++irep ) {
+    vector<ADCvector> ref;
+    decodeReference(buf, order, ticks, ref);
+  }
+  auto t1 = Clock::now();
+  for ( size_t irep=0; irep<nrep*nlink; ++irep ) decodeUnpacker(buf, order, ticks, unp);
+  auto t2 = Clock::now();
+  double sref = std::chrono::duration<double>(t1 - t0).count();
+  double sunp = std::chrono::duration<double>(t2 - t1).count();
+  cout << myname << "   get_adc: " << mbytes/sref << " MB/s, " << sref/nrep << " s/APA" << endl;
+  cout << myname << "  unpacker: " << mbytes/sunp << " MB/s, " << sunp/nrep << " s/APA" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nfrm = 129;
+  size_t nrep = 10;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NFRAME [NREP]]" << endl;
+      cout << "  NFRAME [129]: Number of frames per link in the timing test." << endl;
+      cout << "  NREP [10]: Number of times the APA is decoded in the timing test." << endl;
+      return 0;
+    }
+    nfrm = std::stoul(sarg);
+  }
+  if ( argc > 2 ) nrep = std::stoul(argv[2]);
+  return test_WIBEthUnpacker(nfrm, nrep);
+}
+
+//**********************************************************************
@@ -0,0 +1,144 @@
+// BeamCoincidence.cc
+
+#include "BeamCoincidence.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+using std::vector;
+using proto::BeamTime;
+using proto::CoincidenceFinder;
+
+//**********************************************************************
+
+void CoincidenceFinder::Set(const vector<BeamTime>& times) {
+  fTimes = times;
+  size_t n = fTimes.size();
+  fKeys.resize(n);
+  fOrder.resize(n);
+  fMaxKey.resize(n);
+  fMaxAbsKey = 0.0;
+  vector<double> keys(n);
+  for ( size_t i=0; i<n; ++i ) {
+    keys[i] = Key(fTimes[i]);
+    fMaxKey[i] = i ? std::max(fMaxKey[i-1], keys[i]) : keys[i];
+    fMaxAbsKey = std::max(fMaxAbsKey, std::abs(keys[i]));
+  }
+  std::iota(fOrder.begin(), fOrder.end(), 0);
+  std::stable_sort(fOrder.begin(), fOrder.end(),
+                   [&keys](size_t i1, size_t i2) { return keys[i1] < keys[i2]; });
+  for ( size_t i=0; i<n; ++i ) fKeys[i] = keys[fOrder[i]];
+}
+
+//**********************************************************************
+
+double CoincidenceFinder::Margin(const BeamTime& ref) const {
+  // The keys and deltas are rounded by a few parts in 1e16 of the times.
+  return 1.0 + 1.e-14*(fMaxAbsKey + std::abs(Key(ref)));
+}
+
+//**********************************************************************
+
+size_t CoincidenceFinder::Before(const BeamTime& ref) const {
+  double key = Key(ref);
+  double margin = Margin(ref);
+  // Entries before k0 are earlier than ref and entry k1 is later, so
+  // the first later entry is in [k0, k1].
+  size_t k0 = std::upper_bound(fMaxKey.begin(), fMaxKey.end(), key - margin) - fMaxKey.begin();
+  size_t k1 = std::upper_bound(fMaxKey.begin(), fMaxKey.end(), key + margin) - fMaxKey.begin();
+  for ( size_t k=k0; k<k1; ++k ) {
+    if ( Delta(ref, fTimes[k]) < 0. ) return k;
+  }
+  return k1;
+}
+
+//**********************************************************************
+
+void CoincidenceFinder::Window(const BeamTime& ref, double minDelta, double maxDelta,
+                               vector<size_t>& out, size_t end) const {
+  out.clear();
+  double key = Key(ref);
+  double margin = Margin(ref);
+  auto ibeg = std::lower_bound(fKeys.begin(), fKeys.end(), key - maxDelta - margin);
+  auto iend = std::upper_bound(ibeg, fKeys.end(), key - minDelta + margin);
+  for ( auto ikey=ibeg; ikey!=iend; ++ikey ) {
+    size_t idx = fOrder[ikey - fKeys.begin()];
+    if ( idx < end ) out.push_back(idx);
+  }
+  std::sort(out.begin(), out.end());
+}
+
+//**********************************************************************
+
+namespace {
+
+// Upstream entries for the downstream entry idown at time down.
+void matchUpstream(const BeamTime& down, size_t idown, const CoincidenceFinder& up,
+                   int chan, double upstreamToDownstream,
+                   proto::TOFCandidates& cands, vector<size_t>& iups) {
+  up.Window(down, 0., upstreamToDownstream, iups, up.Before(down));
+  for ( size_t iup : iups ) {
+    double delta = CoincidenceFinder::Delta(down, up.Time(iup));
+    if ( delta > 0. && delta < upstreamToDownstream ) {
+      cands.tofs.push_back(delta);
+      cands.chans.push_back(chan);
+      cands.upstream.push_back(iup);
+      cands.downstream.push_back(idown);
+    }
+  }
+}
+
+// Downstream entries for the trigger at gen and their upstream entries.
+void matchDownstream(const BeamTime& gen, const CoincidenceFinder& down,
+                     const CoincidenceFinder& upA, const CoincidenceFinder& upB,
+                     int chanA, int chanB,
+                     double downstreamToGenTrig, double upstreamToDownstream,
+                     proto::TOFCandidates& cands) {
+  vector<size_t> idowns;
+  vector<size_t> iups;
+  down.Window(gen, 0., downstreamToGenTrig, idowns, down.Before(gen));
+  for ( size_t idown : idowns ) {
+    const BeamTime& tdown = down.Time(idown);
+    double delta = CoincidenceFinder::Delta(gen, tdown);
+    if ( delta < 0. || delta > downstreamToGenTrig ) continue;
+    matchUpstream(tdown, idown, upA, chanA, upstreamToDownstream, cands, iups);
+    matchUpstream(tdown, idown, upB, chanB, upstreamToDownstream, cands, iups);
+  }
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+void proto::MatchTOFs(const BeamTime& gen,
+                      const CoincidenceFinder& tof1A, const CoincidenceFinder& tof1B,
+                      const CoincidenceFinder& tof2A, const CoincidenceFinder& tof2B,
+                      double downstreamToGenTrig, double upstreamToDownstream,
+                      TOFCandidates& cands) {
+  cands.clear();
+  matchDownstream(gen, tof2A, tof1A, tof1B, k1A2A, k1B2A,
+                  downstreamToGenTrig, upstreamToDownstream, cands);
+  matchDownstream(gen, tof2B, tof1A, tof1B, k1A2B, k1B2B,
+                  downstreamToGenTrig, upstreamToDownstream, cands);
+}
+
+//**********************************************************************
+
+size_t proto::MatchFiberRecord(const CoincidenceFinder& t0s, const BeamTime& rec,
+                               vector<bool>& used) {
+  vector<size_t> its;
+  t0s.Window(rec, 100., 1000., its);
+  for ( size_t it : its ) {
+    if ( used[it] ) continue;
+    const BeamTime& t0 = t0s.Time(it);
+    double delta = (t0.first - rec.first);
+    delta += 1.e-9*(t0.second - rec.second);
+    if ( delta < -1.e-7 && delta > -10.e-7 ) {
+      used[it] = true;
+      return it;
+    }
+  }
+  return CoincidenceFinder::npos;
+}
+
+//**********************************************************************
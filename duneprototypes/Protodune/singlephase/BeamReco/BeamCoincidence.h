@@ -0,0 +1,113 @@
+// BeamCoincidence.h
+//
+// Time coincidences between the beam instrumentation timestamp streams
+// (GeneralTrigger, TOF counters, fiber monitors) used by BeamEvent.
+//
+// CoincidenceFinder sorts a stream of times once and answers window
+// queries by binary search, so matching two streams is n log n instead
+// of the n*m (or n*m*k) of scanning every stream for every trigger.  The
+// streams are kept in their original order and the queries reproduce the
+// scanning loops exactly: a loop over a stream stops at the first entry
+// (in stored order) later than the reference time, and matches are
+// returned in stored order.  The sort keys are approximate (a time is
+// seconds ~1.5e9 plus nanoseconds), so a window query may return a few
+// entries just outside the window and callers apply their exact cut.
+//
+// A time is a pair (seconds, nanoseconds).
+
+#ifndef BeamCoincidence_H
+#define BeamCoincidence_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace proto {
+
+using BeamTime = std::pair<double, double>;
+
+// TOF channels: upstream counter 1A or 1B, downstream 2A or 2B.
+enum tofChan {
+  k1A2A,
+  k1B2A,
+  k1A2B,
+  k1B2B
+};
+
+class CoincidenceFinder {
+
+public:
+
+  static constexpr size_t npos = size_t(-1);
+
+  CoincidenceFinder() = default;
+  explicit CoincidenceFinder(const std::vector<BeamTime>& times) { Set(times); }
+
+  void Set(const std::vector<BeamTime>& times);
+
+  size_t size() const { return fTimes.size(); }
+  const BeamTime& Time(size_t i) const { return fTimes[i]; }
+
+  // Time a - b in ns, computed as in BeamEvent.
+  static double Delta(const BeamTime& a, const BeamTime& b) {
+    return 1.e9*(a.first - b.first) + a.second - b.second;
+  }
+
+  // Number of entries before the first one, in stored order, that is
+  // later than ref, i.e. where a loop breaking on Delta(ref, t) < 0 stops.
+  size_t Before(const BeamTime& ref) const;
+
+  // Indices below end, in increasing order, of the entries t with
+  // Delta(ref, t) in [minDelta, maxDelta] (plus possibly a few just
+  // outside).
+  void Window(const BeamTime& ref, double minDelta, double maxDelta,
+              std::vector<size_t>& out, size_t end =npos) const;
+
+private:
+
+  static double Key(const BeamTime& t) { return 1.e9*t.first + t.second; }
+
+  // Bound on the rounding of the keys and deltas around ref.
+  double Margin(const BeamTime& ref) const;
+
+  std::vector<BeamTime> fTimes;
+  std::vector<double> fKeys;    // sorted keys
+  std::vector<size_t> fOrder;   // entry index for each sorted key
+  std::vector<double> fMaxKey;  // running maximum of the keys in stored order
+  double fMaxAbsKey = 0.0;
+
+};
+
+// TOF candidates for a GeneralTrigger, as BeamEvent stores them in the
+// beam spill: time of flight (ns), channel (tofChan) and the upstream
+// and downstream counter entries.
+struct TOFCandidates {
+  std::vector<double> tofs;
+  std::vector<int> chans;
+  std::vector<size_t> upstream;
+  std::vector<size_t> downstream;
+  void clear() { tofs.clear(); chans.clear(); upstream.clear(); downstream.clear(); }
+  size_t size() const { return tofs.size(); }
+};
+
+// Find the TOF candidates for the GeneralTrigger at gen: each downstream
+// (2A, 2B) entry 0 to downstreamToGenTrig ns before the trigger with each
+// upstream (1A, 1B) entry 0 to upstreamToDownstream ns (exclusive) before
+// that.  The candidates are in the order of the BeamEvent loops: 2A then
+// 2B, and for each downstream entry 1A then 1B.
+void MatchTOFs(const BeamTime& gen,
+               const CoincidenceFinder& tof1A, const CoincidenceFinder& tof1B,
+               const CoincidenceFinder& tof2A, const CoincidenceFinder& tof2B,
+               double downstreamToGenTrig, double upstreamToDownstream,
+               TOFCandidates& cands);
+
+// Trigger for a fiber monitor record at rec (seconds less the TAI offset,
+// nanoseconds): the first trigger in t0s that is not yet used and is 100 ns
+// to 1 us before the record.  The trigger is marked as used.  Returns
+// CoincidenceFinder::npos if there is none.
+size_t MatchFiberRecord(const CoincidenceFinder& t0s, const BeamTime& rec,
+                        std::vector<bool>& used);
+
+}
+
+#endif
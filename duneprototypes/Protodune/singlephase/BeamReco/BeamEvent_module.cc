@@ -15,6 +15,7 @@
 #include "art/Framework/Principal/SubRun.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "canvas/Utilities/InputTag.h"
+#include "canvas/Utilities/Exception.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "ifdh_art/IFBeamService/IFBeam_service.h"
@@ -27,6 +28,8 @@
 #include "duneprototypes/Protodune/singlephase/CTB/data/pdspctb.h"
 #include "lardataobj/RawData/RDTimeStamp.h"
 #include "dunecore/DuneObj/ProtoDUNETimeStamp.h"
+#include "duneprototypes/Protodune/singlephase/BeamReco/BeamSpillCache.h"
+#include "duneprototypes/Protodune/singlephase/BeamReco/BeamCoincidence.h"
 #include <bitset>
 #include <iomanip>
 #include <utility>
@@ -42,13 +45,6 @@ namespace proto {
   class BeamEvent;
 }
 
-enum tofChan{
-  k1A2A,
-  k1B2A,
-  k1A2B,
-  k1B2B
-};
-
 typedef std::numeric_limits< double > dbl;
 
 class proto::BeamEvent : public art::EDProducer {
@@ -72,6 +68,7 @@ public:
 
   // Selected optional functions.
   void beginJob() override;
+  void endJob() override;
 
   uint64_t joinHighLow(double,double);
 
@@ -300,6 +297,13 @@ private:
   std::unique_ptr<ifbeam_ns::BeamFolder> bfp_xcet;
   art::ServiceHandle<ifbeam_ns::IFBeam> ifb;
 
+  //Local copy of the database queries. In Replay mode
+  //the database is not accessed.
+  proto::BeamSpillCache fSpillCache;
+
+  //Triggers of the current spill for the fiber monitor matching
+  proto::CoincidenceFinder fT0Finder;
+
   art::Handle< std::vector<raw::RDTimeStamp> > RDTimeStampHandle;
 
 //  double L1=1.980, L2=1.69472, L3=2.11666;
@@ -426,6 +430,9 @@ proto::BeamEvent::BeamEvent(fhicl::ParameterSet const & p)
   std::vector< std::pair<std::string, double> > tempFiberDims = p.get< std::vector<std::pair<std::string,double> > >("Dimension");
   fFiberDimension = std::map<std::string, double>(tempFiberDims.begin(), tempFiberDims.end());
 
+  fSpillCache = proto::BeamSpillCache( p.get<std::string>("SpillCacheFile"),
+                                       proto::BeamSpillCache::ModeFromName( p.get<std::string>("SpillCacheMode") ) );
+
   
 
 }
@@ -444,7 +451,10 @@ std::vector<double> proto::BeamEvent::FetchAndReport(long long time, std::string
     MF_LOG_INFO("BeamEvent") << "At Time: " << time << "\n";    
   }
 
-  theResult = the_folder->GetNamedVector(time, name);
+  //Queries are keyed by the folder's bundle
+  const std::string & bundle = ( &the_folder == &bfp_xcet ? fXCETBundleName : fBundleName );
+  theResult = fSpillCache.Get( bundle, name, time,
+                               [&]{ return the_folder->GetNamedVector(time, name); } );
 
   if( fPrintDebug )
     MF_LOG_INFO("BeamEvent") << "Successfully fetched " << time << "\n";
@@ -731,6 +741,9 @@ void proto::BeamEvent::produce(art::Event & e){
 
   reset();
 
+  //Spill cache misses before this event
+  const size_t nCacheMiss = fSpillCache.Misses();
+
   eventNum = e.event();
   runNum = e.run();
   subRunNum = e.subRun();
@@ -789,112 +802,116 @@ void proto::BeamEvent::produce(art::Event & e){
       if( fPrintDebug )
         MF_LOG_INFO("BeamEvent") << "New spill or forced new fetch. Getting new beamspill info" << "\n";
 
-      //Testing: printing out cache start and end 
-      cache_start = bfp->GetCacheStartTime();
-      cache_end   = bfp->GetCacheEndTime();
+      //When replaying from the spill cache there are no folders to fill
+      if( !fSpillCache.Replay() ){
 
-      if( fPrintDebug ){
-        MF_LOG_INFO("BeamEvent") << "cache_start: " << cache_start << "\n";
-        MF_LOG_INFO("BeamEvent") << "cache_end: "   << cache_end << "\n";
-        MF_LOG_INFO("BeamEvent") << "fetch_time: "  << fetch_time << "\n";
-      }
+        //Testing: printing out cache start and end 
+        cache_start = bfp->GetCacheStartTime();
+        cache_end   = bfp->GetCacheEndTime();
+
+        if( fPrintDebug ){
+          MF_LOG_INFO("BeamEvent") << "cache_start: " << cache_start << "\n";
+          MF_LOG_INFO("BeamEvent") << "cache_end: "   << cache_end << "\n";
+          MF_LOG_INFO("BeamEvent") << "fetch_time: "  << fetch_time << "\n";
+        }
      
-      cache_start = bfp_xcet->GetCacheStartTime();
-      cache_end   = bfp_xcet->GetCacheEndTime();
+        cache_start = bfp_xcet->GetCacheStartTime();
+        cache_end   = bfp_xcet->GetCacheEndTime();
 
-      if( fPrintDebug ){
-        MF_LOG_INFO("BeamEvent") << "xcet cache_start: " << cache_start << "\n";
-        MF_LOG_INFO("BeamEvent") << "xcet cache_end: "   << cache_end << "\n";
-        MF_LOG_INFO("BeamEvent") << "xcet fetch_time: "  << fetch_time << "\n";
-      }
+        if( fPrintDebug ){
+          MF_LOG_INFO("BeamEvent") << "xcet cache_start: " << cache_start << "\n";
+          MF_LOG_INFO("BeamEvent") << "xcet cache_end: "   << cache_end << "\n";
+          MF_LOG_INFO("BeamEvent") << "xcet fetch_time: "  << fetch_time << "\n";
+        }
 
-      //Not the first event
-      if(cache_start > 0 && cache_end > 0){
+        //Not the first event
+        if(cache_start > 0 && cache_end > 0){
+
+          //So try filling the cache first with the 'possible' end of spill time
+          //then the lower spill time.
+          //
+          //This is done so that the cache essentially reshuffles where it starts and ends
+          //
+          //All the checking is done internal to the FillCache method
+          //
+          //Note: I'm using a loose definition of the start and end of spills
+          //      It's really just the maximum and minimum possible vales of those times
+          //      since it's not possible to know for certain in any given event. 
+          //      (The info does exist in the raw decoder info, but it's not always 
+          //       present, so I'm just opting for this)
+          try{        
+            bfp->FillCache( fetch_time + fFillCacheUp );
+
+            if( fPrintDebug ){
+              cache_start = bfp->GetCacheStartTime();
+              cache_end   = bfp->GetCacheEndTime();
+              MF_LOG_INFO("BeamEvent") << "interim cache_start: " << cache_start << "\n";
+              MF_LOG_INFO("BeamEvent") << "interim cache_end: "   << cache_end << "\n";
+            }
+
+            bfp->FillCache( fetch_time - fFillCacheDown );
+            if( fPrintDebug ){
+              cache_start = bfp->GetCacheStartTime();
+              cache_end   = bfp->GetCacheEndTime();
+              MF_LOG_INFO("BeamEvent") << "new cache_start: " << cache_start << "\n";
+              MF_LOG_INFO("BeamEvent") << "new cache_end: "   << cache_end << "\n";
+            }
+
+            bfp_xcet->FillCache( fetch_time + fFillCacheUp );
+            if( fPrintDebug ){
+              cache_start = bfp_xcet->GetCacheStartTime();
+              cache_end   = bfp_xcet->GetCacheEndTime();
+              MF_LOG_INFO("BeamEvent") << "interim xcet cache_start: " << cache_start << "\n";
+              MF_LOG_INFO("BeamEvent") << "interim xcet cache_end: "   << cache_end << "\n";
+            }
+
+            bfp_xcet->FillCache( fetch_time - fFillCacheDown );
+            if( fPrintDebug ){
+              cache_start = bfp_xcet->GetCacheStartTime();
+              cache_end   = bfp_xcet->GetCacheEndTime();
+              MF_LOG_INFO("BeamEvent") << "new xcet cache_start: " << cache_start << "\n";
+              MF_LOG_INFO("BeamEvent") << "new xcet cache_end: "   << cache_end << "\n";
+            }
+          }
+          catch( std::exception const& e){
+            MF_LOG_WARNING("BeamEvent") << "Could not fill cache\n"; 
+            MF_LOG_ERROR("BeamEvent") << e.what() << "\n";
+          }
+        }      
+        else{
+          //First event, let's get the start of spill info 
 
-        //So try filling the cache first with the 'possible' end of spill time
-        //then the lower spill time.
-        //
-        //This is done so that the cache essentially reshuffles where it starts and ends
-        //
-        //All the checking is done internal to the FillCache method
-        //
-        //Note: I'm using a loose definition of the start and end of spills
-        //      It's really just the maximum and minimum possible vales of those times
-        //      since it's not possible to know for certain in any given event. 
-        //      (The info does exist in the raw decoder info, but it's not always 
-        //       present, so I'm just opting for this)
-        try{        
-          bfp->FillCache( fetch_time + fFillCacheUp );
+          if( fPrintDebug )
+            MF_LOG_INFO("BeamEvent") << "First Event: Priming cache\n";
 
-          if( fPrintDebug ){
-            cache_start = bfp->GetCacheStartTime();
-            cache_end   = bfp->GetCacheEndTime();
-            MF_LOG_INFO("BeamEvent") << "interim cache_start: " << cache_start << "\n";
-            MF_LOG_INFO("BeamEvent") << "interim cache_end: "   << cache_end << "\n";
+          try{        
+            bfp->FillCache( fetch_time - fFillCacheDown );
+          }
+          catch( std::exception const& e){
+            MF_LOG_WARNING("BeamEvent") << "Could not fill cache\n"; 
+            MF_LOG_ERROR("BeamEvent") << e.what() << "\n";
+          }
+          try{
+            bfp_xcet->FillCache( fetch_time - fFillCacheDown );
+          }
+          catch( std::exception const& e){
+            MF_LOG_WARNING("BeamEvent") << "Could not fill xcet cache\n"; 
+            MF_LOG_ERROR("BeamEvent") << e.what() << "\n";
           }
 
-          bfp->FillCache( fetch_time - fFillCacheDown );
           if( fPrintDebug ){
             cache_start = bfp->GetCacheStartTime();
             cache_end   = bfp->GetCacheEndTime();
             MF_LOG_INFO("BeamEvent") << "new cache_start: " << cache_start << "\n";
             MF_LOG_INFO("BeamEvent") << "new cache_end: "   << cache_end << "\n";
-          }
-
-          bfp_xcet->FillCache( fetch_time + fFillCacheUp );
-          if( fPrintDebug ){
-            cache_start = bfp_xcet->GetCacheStartTime();
-            cache_end   = bfp_xcet->GetCacheEndTime();
-            MF_LOG_INFO("BeamEvent") << "interim xcet cache_start: " << cache_start << "\n";
-            MF_LOG_INFO("BeamEvent") << "interim xcet cache_end: "   << cache_end << "\n";
-          }
 
-          bfp_xcet->FillCache( fetch_time - fFillCacheDown );
-          if( fPrintDebug ){
             cache_start = bfp_xcet->GetCacheStartTime();
             cache_end   = bfp_xcet->GetCacheEndTime();
             MF_LOG_INFO("BeamEvent") << "new xcet cache_start: " << cache_start << "\n";
             MF_LOG_INFO("BeamEvent") << "new xcet cache_end: "   << cache_end << "\n";
           }
-        }
-        catch( std::exception const& e){
-          MF_LOG_WARNING("BeamEvent") << "Could not fill cache\n"; 
-          MF_LOG_ERROR("BeamEvent") << e.what() << "\n";
-        }
-      }      
-      else{
-        //First event, let's get the start of spill info 
-
-        if( fPrintDebug )
-          MF_LOG_INFO("BeamEvent") << "First Event: Priming cache\n";
-
-        try{        
-          bfp->FillCache( fetch_time - fFillCacheDown );
-        }
-        catch( std::exception const& e){
-          MF_LOG_WARNING("BeamEvent") << "Could not fill cache\n"; 
-          MF_LOG_ERROR("BeamEvent") << e.what() << "\n";
-        }
-        try{
-          bfp_xcet->FillCache( fetch_time - fFillCacheDown );
-        }
-        catch( std::exception const& e){
-          MF_LOG_WARNING("BeamEvent") << "Could not fill xcet cache\n"; 
-          MF_LOG_ERROR("BeamEvent") << e.what() << "\n";
-        }
 
-        if( fPrintDebug ){
-          cache_start = bfp->GetCacheStartTime();
-          cache_end   = bfp->GetCacheEndTime();
-          MF_LOG_INFO("BeamEvent") << "new cache_start: " << cache_start << "\n";
-          MF_LOG_INFO("BeamEvent") << "new cache_end: "   << cache_end << "\n";
-
-          cache_start = bfp_xcet->GetCacheStartTime();
-          cache_end   = bfp_xcet->GetCacheEndTime();
-          MF_LOG_INFO("BeamEvent") << "new xcet cache_start: " << cache_start << "\n";
-          MF_LOG_INFO("BeamEvent") << "new xcet cache_end: "   << cache_end << "\n";
         }
-
       }
 
       // Parse the Time of Flight Counter data for the list
@@ -1046,6 +1063,16 @@ void proto::BeamEvent::produce(art::Event & e){
     prev_beamspill = *beamspill;   
   }
   
+  //A query missing from a replayed spill cache was handled above as if
+  //the database had failed. Stop rather than write degraded beam info.
+  if( fSpillCache.Misses() > nCacheMiss ){
+    delete beamevt;
+    delete beamspill;
+    throw art::Exception(art::errors::NotFound, "BeamEvent")
+      << "Spill cache replay: " << fSpillCache.Misses() - nCacheMiss
+      << " queries for this event are not in the cache. " << fSpillCache.LastMiss() << "\n";
+  }
+
   //Can Remove BITrigger,CTBTimestamp
   beamevt->SetBITrigger(-1);
   beamevt->SetTimingTrigger(RDTSTrigger);
@@ -1313,12 +1340,14 @@ void proto::BeamEvent::parseXTOF(uint64_t time){
       if (fXTOF2ACoarse == 0.0 && fXTOF2AFrac == 0.0 && fXTOF2ASec == 0.0) break;
       unorderedTOF2ATime.push_back(std::make_pair(fXTOF2ASec, (fXTOF2ACoarse*8. + fXTOF2AFrac/512.)) );
 
-      if(diff2A.size()) diff2A.clear();
-      for(size_t j = 0; j < timestampCountGeneralTrigger[0]; ++j){
-        diff2A.push_back( 1.e9*(unorderedTOF2ATime.back().first - unorderedGenTrigTime[j].first) + (unorderedTOF2ATime.back().second - unorderedGenTrigTime[j].second) );
+      //Differences to every GeneralTrigger, only for the debug tree
+      if(fDebugTOFs){
+        if(diff2A.size()) diff2A.clear();
+        for(size_t j = 0; j < unorderedGenTrigTime.size(); ++j){
+          diff2A.push_back( 1.e9*(unorderedTOF2ATime.back().first - unorderedGenTrigTime[j].first) + (unorderedTOF2ATime.back().second - unorderedGenTrigTime[j].second) );
+        }
+        fXTOF2ATree->Fill();
       }
-      
-      if(fDebugTOFs)fXTOF2ATree->Fill();
 
     }  
 
@@ -1336,182 +1365,69 @@ void proto::BeamEvent::parseXTOF(uint64_t time){
 
       unorderedTOF2BTime.push_back(std::make_pair(fXTOF2BSec, (fXTOF2BCoarse*8. + fXTOF2BFrac/512.) ));
 
-      if(diff2B.size()) diff2B.clear();
-
-      for(size_t j = 0; j < timestampCountGeneralTrigger[0]; ++j){
-        diff2B.push_back( 1.e9*(unorderedTOF2BTime.back().first - unorderedGenTrigTime[j].first) + (unorderedTOF2BTime.back().second - unorderedGenTrigTime[j].second) );
+      //Differences to every GeneralTrigger, only for the debug tree
+      if(fDebugTOFs){
+        if(diff2B.size()) diff2B.clear();
+        for(size_t j = 0; j < unorderedGenTrigTime.size(); ++j){
+          diff2B.push_back( 1.e9*(unorderedTOF2BTime.back().first - unorderedGenTrigTime[j].first) + (unorderedTOF2BTime.back().second - unorderedGenTrigTime[j].second) );
+        }
+        fXTOF2BTree->Fill();
       }
-
-      if(fDebugTOFs)fXTOF2BTree->Fill();
     }
   }
 
   if( fPrintDebug )
     MF_LOG_INFO("BeamEvent") << "NGenTrigs: " << timestampCountGeneralTrigger[0] << " NTOF2s: " << unorderedTOF2ATime.size() + unorderedTOF2BTime.size() << "\n";
 
+  //Sort the TOF streams once for the coincidences with the triggers
+  proto::CoincidenceFinder TOF1AFinder(unorderedTOF1ATime);
+  proto::CoincidenceFinder TOF1BFinder(unorderedTOF1BTime);
+  proto::CoincidenceFinder TOF2AFinder(unorderedTOF2ATime);
+  proto::CoincidenceFinder TOF2BFinder(unorderedTOF2BTime);
+  proto::TOFCandidates TOFCands;
+
   for(size_t iT = 0; iT < unorderedGenTrigTime.size(); ++iT){
     
-    bool found_TOF = false;
-
     double the_gen_sec = unorderedGenTrigTime[iT].first;
     double the_gen_ns = unorderedGenTrigTime[iT].second;
 
     //1A2A = 0; 1B2A = 1, 1A2B = 2,  1B2B = 3
     //Add 1 for 1B, add 2 for 2B
-    int channel = 0;
-
-    std::vector< double > possibleTOF; 
-    std::vector< int >    possibleTOFChan; 
-    std::vector< size_t > UpstreamTriggers;
-    std::vector< size_t > DownstreamTriggers;
+    TOFCands.clear();
 
     if( gotTOFs ){
 
       if( fPrintDebug )
         MF_LOG_INFO("BeamEvent") << "Gen: " << the_gen_sec << " " << the_gen_ns << "\n";
 
-      //First check 2A
-      for(size_t ip2A = 0; ip2A < unorderedTOF2ATime.size(); ++ip2A){
-        double TOF2A_sec = unorderedTOF2ATime[ip2A].first;
-        double TOF2A_ns  = unorderedTOF2ATime[ip2A].second;         
-        double delta_2A = 1.e9*(the_gen_sec - TOF2A_sec) + the_gen_ns - TOF2A_ns;
-
-        if( delta_2A < 0. ) break;
-        else if( delta_2A > fDownstreamToGenTrig ) continue;
-
-        //if here, 0. < delta < 50ns
-        if( fPrintDebug )
-          MF_LOG_INFO("BeamEvent") << "Found match 2A to Gen" << "\n";
-
-        //So check 1A and 1B
-        for(size_t ip1A = 0; ip1A < unorderedTOF1ATime.size(); ++ip1A){
-          double TOF1A_sec = unorderedTOF1ATime[ip1A].first;
-          double TOF1A_ns  = unorderedTOF1ATime[ip1A].second;         
-          double delta = 1.e9*( TOF2A_sec - TOF1A_sec ) + TOF2A_ns - TOF1A_ns;
+      //Downstream (2A, 2B) hits 0 to fDownstreamToGenTrig ns before the trigger,
+      //each with the upstream (1A, 1B) hits 0 to fUpstreamToDownstream ns before it
+      proto::MatchTOFs(unorderedGenTrigTime[iT], TOF1AFinder, TOF1BFinder, TOF2AFinder, TOF2BFinder,
+                       fDownstreamToGenTrig, fUpstreamToDownstream, TOFCands);
 
-          if( delta < 0. ) break;
-          else if( delta > 0. && delta < fUpstreamToDownstream){
-            if( fPrintDebug )
-              MF_LOG_INFO("BeamEvent") << "Found match 1A to 2A " << delta << "\n";
-
-            found_TOF = true;
-            channel = k1A2A;
-
-            possibleTOF.push_back( delta ); 
-            possibleTOFChan.push_back( channel );
-
-            UpstreamTriggers.push_back( ip1A );
-            DownstreamTriggers.push_back( ip2A );
-          }
-          else continue; 
-        }
-        for(size_t ip1B = 0; ip1B < unorderedTOF1BTime.size(); ++ip1B){
-          double TOF1B_sec = unorderedTOF1BTime[ip1B].first;
-          double TOF1B_ns  = unorderedTOF1BTime[ip1B].second;         
-          double delta = 1.e9*( TOF2A_sec - TOF1B_sec ) + TOF2A_ns - TOF1B_ns;
-
-          if( delta < 0. ) break;
-          else if( delta > 0. && delta < fUpstreamToDownstream){
-
-            if( fPrintDebug )
-              MF_LOG_INFO("BeamEvent") << "Found match 1B to 2A " << delta << "\n";
-
-            found_TOF = true;
-            channel = k1B2A;
-
-            possibleTOF.push_back( delta ); 
-            possibleTOFChan.push_back( channel );
-
-            UpstreamTriggers.push_back( ip1B );
-            DownstreamTriggers.push_back( ip2A );
-          }
-          else continue; 
-        }
-      }
-
-      //Then check 2B 
-      for(size_t ip2B = 0; ip2B < unorderedTOF2BTime.size(); ++ip2B){
-        double TOF2B_sec = unorderedTOF2BTime[ip2B].first;
-        double TOF2B_ns  = unorderedTOF2BTime[ip2B].second;         
-        double delta_2B = 1.e9*(the_gen_sec - TOF2B_sec) + the_gen_ns - TOF2B_ns;
-
-
-        if( delta_2B < 0. ) break;
-        else if( delta_2B > fDownstreamToGenTrig ) continue;
-
-        //if here, 0. < delta < 50ns
-        if( fPrintDebug )
-          MF_LOG_INFO("BeamEvent") << "Found match 2B to Gen" << "\n";
-
-        //So check 1A and 1B
-        for(size_t ip1A = 0; ip1A < unorderedTOF1ATime.size(); ++ip1A){
-          double TOF1A_sec = unorderedTOF1ATime[ip1A].first;
-          double TOF1A_ns  = unorderedTOF1ATime[ip1A].second;         
-          double delta = 1.e9*( TOF2B_sec - TOF1A_sec ) + TOF2B_ns - TOF1A_ns;
-
-
-          if( delta < 0. ) break;
-          else if( delta > 0. && delta < fUpstreamToDownstream){
-                              
-            if( fPrintDebug )
-              MF_LOG_INFO("BeamEvent") << "Found match 1A to 2B " << delta << "\n";
-             
-            found_TOF = true;
-            channel = k1A2B;
-
-            possibleTOF.push_back( delta ); 
-            possibleTOFChan.push_back( channel );
-
-            UpstreamTriggers.push_back( ip1A );
-            DownstreamTriggers.push_back( ip2B );
-          }
-          else continue; 
-        }
-        for(size_t ip1B = 0; ip1B < unorderedTOF1BTime.size(); ++ip1B){
-          double TOF1B_sec = unorderedTOF1BTime[ip1B].first;
-          double TOF1B_ns  = unorderedTOF1BTime[ip1B].second;         
-          double delta = 1.e9*( TOF2B_sec - TOF1B_sec ) + TOF2B_ns - TOF1B_ns;
-
-          
-          if( delta < 0. ) break;
-          else if( delta > 0. && delta < fUpstreamToDownstream){
-
-            if( fPrintDebug )
-              MF_LOG_INFO("BeamEvent") << "Found match 1B to 2B " << delta << "\n";
-
-            found_TOF = true;
-            channel = k1B2B;
-
-            possibleTOF.push_back( delta ); 
-            possibleTOFChan.push_back( channel );
-
-            UpstreamTriggers.push_back( ip1B );
-            DownstreamTriggers.push_back( ip2B );
-          }
-          else continue;
-        }
+      if( fPrintDebug ){
+        for(size_t ic = 0; ic < TOFCands.size(); ++ic)
+          MF_LOG_INFO("BeamEvent") << "Found match chan " << TOFCands.chans[ic] << " " << TOFCands.tofs[ic] << "\n";
+        MF_LOG_INFO("BeamEvent") << "Found " << TOFCands.size() << " matched TOFs" << "\n";
       }
-
-      if( fPrintDebug )
-        MF_LOG_INFO("BeamEvent") << "Found " << possibleTOF.size() << " matched TOFs" << "\n";
     }
 
-    if( !found_TOF ){
+    if( !TOFCands.size() ){
 
       if( fPrintDebug )
         MF_LOG_INFO("BeamEvent") << "No matching TOFs found. Placing dummy\n";
 
-      possibleTOF.push_back( 0. );
-      possibleTOFChan.push_back( -1 );
-      UpstreamTriggers.push_back(0);
-      DownstreamTriggers.push_back(0);
+      TOFCands.tofs.push_back( 0. );
+      TOFCands.chans.push_back( -1 );
+      TOFCands.upstream.push_back(0);
+      TOFCands.downstream.push_back(0);
     }
 
     beamspill->AddT0(std::make_pair(the_gen_sec - fOffsetTAI, the_gen_ns));
-    beamspill->AddMultipleTOFs( possibleTOF );
-    beamspill->AddMultipleTOFChans( possibleTOFChan );
-    beamspill->AddUpstreamTriggers( UpstreamTriggers );
-    beamspill->AddDownstreamTriggers( DownstreamTriggers );
+    beamspill->AddMultipleTOFs( TOFCands.tofs );
+    beamspill->AddMultipleTOFChans( TOFCands.chans );
+    beamspill->AddUpstreamTriggers( TOFCands.upstream );
+    beamspill->AddDownstreamTriggers( TOFCands.downstream );
 
   }
 
@@ -1727,13 +1643,8 @@ void proto::BeamEvent::parseGeneralXBPF(std::string name, uint64_t time, size_t
   fbm.active = std::vector<short>();
   */
     
-  //Use this just in case any are out of sync?
-  //Shouldn't be, but just to be safe...
-  //Helps cut down on time
-  std::vector<size_t> leftOvers;      
-  for(size_t lo = 0; lo < beamspill->GetNT0(); ++lo){
-    leftOvers.push_back(lo);
-  }
+  //Triggers already matched to a record of this device
+  std::vector<bool> usedT0s(fT0Finder.size(), false);
  
   //std::cout.precision(20);
   for(size_t i = 0; i < counts[1]; ++i){      
@@ -1755,27 +1666,18 @@ void proto::BeamEvent::parseGeneralXBPF(std::string name, uint64_t time, size_t
       continue;
      
 
-    for(std::vector<size_t>::iterator ip = leftOvers.begin(); ip != leftOvers.end(); ++ip){
-
-      // Compute the time delta between the timeStamp and the T0, see if it's less than 500ns away
-
-      double delta = (beamspill->GetT0Sec(*ip)  - (fbm.timeData[3] - fOffsetTAI) );
-      delta += 1.e-9*( beamspill->GetT0Nano(*ip) - 8.*fbm.timeData[2] ); 
-
-      if( delta < -1.e-7 && delta > -10.e-7 ){
-
-	beamspill->ReplaceFBMTrigger(name, fbm, *ip);
-	leftOvers.erase(ip);
-	break;
-      } 
-    } 
+    // Match to the first free T0 100ns to 1us before the timeStamp
+    size_t iT0 = proto::MatchFiberRecord(fT0Finder, std::make_pair(fbm.timeData[3] - fOffsetTAI, 8.*fbm.timeData[2]), usedT0s);
+    if( iT0 != proto::CoincidenceFinder::npos ){
+      beamspill->ReplaceFBMTrigger(name, fbm, iT0);
+    }
   } 
 
   if( fPrintDebug ){
-    if( leftOvers.size() ){
+    if( std::count(usedT0s.begin(), usedT0s.end(), false) ){
       MF_LOG_WARNING("BeamEvent") << "Warning! Could not match to Good Particles: " << "\n";
-      for( size_t ip = 0; ip < leftOvers.size(); ++ip){
-        MF_LOG_WARNING("BeamEvent") << leftOvers[ip] << " ";
+      for( size_t ip = 0; ip < usedT0s.size(); ++ip){
+        if( !usedT0s[ip] ) MF_LOG_WARNING("BeamEvent") << ip << " ";
       }
       MF_LOG_WARNING("BeamEvent") << "\n";
     }
@@ -1803,6 +1705,14 @@ void proto::BeamEvent::parseGeneralXBPF(std::string name, uint64_t time, size_t
 ////////////////////////
 // 
 void proto::BeamEvent::parseXBPF(uint64_t time){
+
+  //The triggers of the spill, sorted once for all the devices
+  std::vector<proto::BeamTime> t0s;
+  for(size_t iT = 0; iT < beamspill->GetNT0(); ++iT){
+    t0s.push_back( beamspill->GetT0(iT) );
+  }
+  fT0Finder.Set(t0s);
+
   for(size_t d = 0; d < fDevices.size(); ++d){
     std::string name = fDevices[d];
     parseGeneralXBPF(name, time, d);
@@ -1886,37 +1796,51 @@ void proto::BeamEvent::beginJob()
     fXTOF2BTree->Branch("diff2B", &diff2B);
   }
 
-  //Tells IFBeam to print out debug statements
-  ifbeam_ns::BeamFolder::_debug = fIFBeamDebug;
+  //The beam folders are only needed when the database is used
+  if( !fSpillCache.Replay() ){
+    //Tells IFBeam to print out debug statements
+    ifbeam_ns::BeamFolder::_debug = fIFBeamDebug;
 
-  bfp = ifb->getBeamFolder(fBundleName,fURLStr,fTimeWindow);
-  if( fPrintDebug ){ 
-    MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Got beam folder %%%%%%%%%%\n"; 
-    MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Setting TimeWindow: " << fTimeWindow << " %%%%%%%%%%\n";
-  }
+    bfp = ifb->getBeamFolder(fBundleName,fURLStr,fTimeWindow);
+    if( fPrintDebug ){ 
+      MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Got beam folder %%%%%%%%%%\n"; 
+      MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Setting TimeWindow: " << fTimeWindow << " %%%%%%%%%%\n";
+    }
 
-  bfp->set_epsilon( fBFEpsilon );
+    bfp->set_epsilon( fBFEpsilon );
 
-  if( fPrintDebug )
-    MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Set beam epislon " << fBFEpsilon << " %%%%%%%%%%\n";
+    if( fPrintDebug )
+      MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Set beam epislon " << fBFEpsilon << " %%%%%%%%%%\n";
 
-  bfp_xcet = ifb->getBeamFolder(fXCETBundleName,fURLStr,fTimeWindow);
+    bfp_xcet = ifb->getBeamFolder(fXCETBundleName,fURLStr,fTimeWindow);
 
-  if( fPrintDebug ){ 
-    MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Got beam folder %%%%%%%%%%\n"; 
-    MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Setting TimeWindow: " << fTimeWindow << " %%%%%%%%%%\n";
-  }
+    if( fPrintDebug ){ 
+      MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Got beam folder %%%%%%%%%%\n"; 
+      MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Setting TimeWindow: " << fTimeWindow << " %%%%%%%%%%\n";
+    }
  
-  bfp_xcet->set_epsilon( fXCETEpsilon );
-
-  if( fPrintDebug ) 
-    MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Set beam epislon " << fBFEpsilon << " %%%%%%%%%%\n";
+    bfp_xcet->set_epsilon( fXCETEpsilon );
 
+    if( fPrintDebug ) 
+      MF_LOG_INFO("BeamEvent") << "%%%%%%%%%% Set beam epislon " << fBFEpsilon << " %%%%%%%%%%\n";
+  }
 
   //Rotate the basis vectors of the FBMs
   BeamMonitorBasisVectors();
 }
 
+void proto::BeamEvent::endJob()
+{
+  if( fSpillCache.GetMode() != proto::BeamSpillCache::kOff ){
+    MF_LOG_INFO("BeamEvent") << "Spill cache " << fSpillCache.FileName() << ": "
+                             << fSpillCache.Hits() << " queries from the cache, "
+                             << fSpillCache.Fetches() << " from the database, "
+                             << fSpillCache.Misses() << " missing, "
+                             << fSpillCache.Size() << " entries\n";
+  }
+  fSpillCache.Write();
+}
+
 uint64_t proto::BeamEvent::joinHighLow(double high, double low){
 
   uint64_t low64 = (uint64_t)low;
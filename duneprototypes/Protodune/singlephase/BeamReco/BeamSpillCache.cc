@@ -0,0 +1,168 @@
+// BeamSpillCache.cc
+
+#include "BeamSpillCache.h"
+#include "cetlib_except/exception.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TDirectory.h"
+#include <fstream>
+#include <memory>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+
+using std::string;
+
+namespace {
+const char* const treeName = "BeamSpillCache";
+}
+
+//**********************************************************************
+
+proto::BeamSpillCache::Mode proto::BeamSpillCache::ModeFromName(const string& name) {
+  if ( name == "Off" ) return kOff;
+  if ( name == "Record" ) return kRecord;
+  if ( name == "Replay" ) return kReplay;
+  throw cet::exception("BeamSpillCache")
+    << "Invalid mode \"" << name << "\". Use Off, Record or Replay.\n";
+}
+
+//**********************************************************************
+
+proto::BeamSpillCache::BeamSpillCache() : fMode(kOff) { }
+
+//**********************************************************************
+
+proto::BeamSpillCache::BeamSpillCache(const string& fileName, Mode mode)
+: fFileName(fileName), fMode(mode) {
+  if ( fMode == kOff ) return;
+  if ( fFileName.empty() ) {
+    throw cet::exception("BeamSpillCache") << "A file name is required for Record and Replay.\n";
+  }
+  // A new file is started in Record mode.
+  if ( fMode == kRecord && ! std::ifstream(fFileName).good() ) return;
+  Read();
+}
+
+//**********************************************************************
+
+proto::BeamSpillCache::Values
+proto::BeamSpillCache::Get(const string& bundle, const string& device,
+                           long long time, const Fetcher& fetch) {
+  if ( fMode == kOff ) return fetch();
+  Key key(bundle, device, time);
+  auto ient = fEntries.find(key);
+  if ( fMode == kReplay ) {
+    if ( ient == fEntries.end() ) {
+      ++fMisses;
+      fLastMiss = "No entry for " + device + " in " + bundle + " at " + std::to_string(time) +
+                  " in " + fFileName;
+      throw cet::exception("BeamSpillCache") << fLastMiss << "\n";
+    }
+    ++fHits;
+    // A recorded failure is thrown with the original message.
+    if ( ! ient->second.ok ) throw std::runtime_error(ient->second.error);
+    return ient->second.values;
+  }
+  if ( ient != fEntries.end() && ient->second.ok ) {
+    ++fHits;
+    return ient->second.values;
+  }
+  ++fFetches;
+  fModified = true;
+  Entry& ent = fEntries[key];
+  try {
+    ent.values = fetch();
+  } catch ( std::exception const& e ) {
+    ent.ok = false;
+    ent.values.clear();
+    ent.error = e.what();
+    throw;
+  }
+  ent.ok = true;
+  ent.error.clear();
+  return ent.values;
+}
+
+//**********************************************************************
+
+void proto::BeamSpillCache::Write() {
+  if ( fMode != kRecord || ! fModified ) return;
+  // Write a temporary file and move it into place so an interrupted
+  // job does not leave a truncated cache behind.
+  string tmpName = fFileName + ".tmp";
+  {
+    TDirectory::TContext context;
+    std::unique_ptr<TFile> pfile(TFile::Open(tmpName.c_str(), "RECREATE"));
+    if ( ! pfile || pfile->IsZombie() ) {
+      throw cet::exception("BeamSpillCache") << "Unable to open " << tmpName << " for writing.\n";
+    }
+    string bundle;
+    string device;
+    Long64_t time = 0;
+    Bool_t ok = false;
+    Values values;
+    string error;
+    TTree* ptree = new TTree(treeName, "IFBeam query results");
+    ptree->Branch("bundle", &bundle);
+    ptree->Branch("device", &device);
+    ptree->Branch("time", &time);
+    ptree->Branch("ok", &ok);
+    ptree->Branch("values", &values);
+    ptree->Branch("error", &error);
+    for ( const auto& kent : fEntries ) {
+      std::tie(bundle, device, time) = kent.first;
+      ok = kent.second.ok;
+      values = kent.second.values;
+      error = kent.second.error;
+      ptree->Fill();
+    }
+    pfile->Write();
+    pfile->Close();
+  }
+  if ( std::rename(tmpName.c_str(), fFileName.c_str()) != 0 ) {
+    throw cet::exception("BeamSpillCache") << "Unable to rename " << tmpName << " to " << fFileName << ".\n";
+  }
+  fModified = false;
+}
+
+//**********************************************************************
+
+void proto::BeamSpillCache::Read() {
+  TDirectory::TContext context;
+  std::unique_ptr<TFile> pfile(TFile::Open(fFileName.c_str(), "READ"));
+  if ( ! pfile || pfile->IsZombie() ) {
+    throw cet::exception("BeamSpillCache") << "Unable to open " << fFileName << ".\n";
+  }
+  TTree* ptree = dynamic_cast<TTree*>(pfile->Get(treeName));
+  if ( ptree == nullptr ) {
+    throw cet::exception("BeamSpillCache") << "No tree " << treeName << " in " << fFileName << ".\n";
+  }
+  string* pbundle = nullptr;
+  string* pdevice = nullptr;
+  Long64_t time = 0;
+  Bool_t ok = false;
+  Values* pvalues = nullptr;
+  string* perror = nullptr;
+  ptree->SetBranchAddress("bundle", &pbundle);
+  ptree->SetBranchAddress("device", &pdevice);
+  ptree->SetBranchAddress("time", &time);
+  ptree->SetBranchAddress("ok", &ok);
+  ptree->SetBranchAddress("values", &pvalues);
+  ptree->SetBranchAddress("error", &perror);
+  Long64_t nent = ptree->GetEntries();
+  for ( Long64_t ient=0; ient<nent; ++ient ) {
+    ptree->GetEntry(ient);
+    Entry& ent = fEntries[Key(*pbundle, *pdevice, time)];
+    ent.ok = ok;
+    ent.values = *pvalues;
+    ent.error = *perror;
+  }
+  ptree->ResetBranchAddresses();
+  delete pbundle;
+  delete pdevice;
+  delete pvalues;
+  delete perror;
+}
+
+//**********************************************************************
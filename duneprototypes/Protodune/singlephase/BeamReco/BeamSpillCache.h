@@ -0,0 +1,98 @@
+// BeamSpillCache.h
+//
+// Local replay cache for the beam instrumentation (IFBeam) database.
+//
+// Each entry is the result of one query: the values of a device variable
+// in a bundle at the fetch time of a spill, or the error the query failed
+// with.  The entries are kept in a ROOT file holding one tree with a branch
+// per field, sorted by bundle, device and time, so the data for a run can
+// be fetched once and then replayed by any number of reprocessing jobs.
+//
+// Modes:
+//   Off    - no cache: every query is passed to the fetch function.
+//   Record - a query found in the cache is answered from it, otherwise it
+//            is fetched and added.  Failed queries are fetched again.
+//            The file is read on construction (if present) and written by
+//            Write().
+//   Replay - queries are answered from the cache only and the fetch
+//            function is never called.  A recorded failure or a query that
+//            is not in the cache throws, as a failed fetch would.  Queries
+//            not in the cache are also counted as misses, so the caller
+//            can tell a stale or incomplete cache from a database failure.
+
+#ifndef BeamSpillCache_H
+#define BeamSpillCache_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <functional>
+
+namespace proto {
+
+class BeamSpillCache {
+
+public:
+
+  enum Mode { kOff, kRecord, kReplay };
+
+  using Values = std::vector<double>;
+  using Fetcher = std::function<Values()>;
+
+  // Mode from its name: "Off", "Record" or "Replay".
+  static Mode ModeFromName(const std::string& name);
+
+  // Cache that is off.
+  BeamSpillCache();
+
+  // Cache backed by file fileName.  Throws if the mode is Replay and the
+  // file cannot be read.
+  BeamSpillCache(const std::string& fileName, Mode mode);
+
+  // Values for device in bundle at time.  Calls fetch when the query
+  // has to go to the database.
+  Values Get(const std::string& bundle, const std::string& device,
+             long long time, const Fetcher& fetch);
+
+  // Write the file if entries were added.
+  void Write();
+
+  Mode GetMode() const { return fMode; }
+  bool Replay() const { return fMode == kReplay; }
+  const std::string& FileName() const { return fFileName; }
+
+  size_t Size() const { return fEntries.size(); }
+  size_t Hits() const { return fHits; }
+  size_t Fetches() const { return fFetches; }
+
+  // Replay queries that were not in the cache, and the last one of them.
+  size_t Misses() const { return fMisses; }
+  const std::string& LastMiss() const { return fLastMiss; }
+
+private:
+
+  using Key = std::tuple<std::string, std::string, long long>;
+
+  struct Entry {
+    bool ok = false;
+    Values values;
+    std::string error;
+  };
+
+  void Read();
+
+  std::string fFileName;
+  Mode fMode;
+  std::map<Key, Entry> fEntries;
+  size_t fHits = 0;
+  size_t fFetches = 0;
+  size_t fMisses = 0;
+  std::string fLastMiss;
+  bool fModified = false;
+
+};
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+// BeamMatchingReference.h
+//
+// The TOF and fiber monitor matching loops BeamEvent used before
+// BeamCoincidence, and a generator of beam spills, shared by
+// test_BeamCoincidence and beamMatchingBenchmark.
+
+#ifndef BeamMatchingReference_H
+#define BeamMatchingReference_H
+
+#include "duneprototypes/Protodune/singlephase/BeamReco/BeamCoincidence.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+namespace beamref {
+
+using proto::BeamTime;
+using proto::TOFCandidates;
+using std::vector;
+
+// Nested loops of BeamEvent::parseXTOF for one GeneralTrigger.
+inline void matchTOFs(const BeamTime& gen,
+                      const vector<BeamTime>& unorderedTOF1ATime, const vector<BeamTime>& unorderedTOF1BTime,
+                      const vector<BeamTime>& unorderedTOF2ATime, const vector<BeamTime>& unorderedTOF2BTime,
+                      double fDownstreamToGenTrig, double fUpstreamToDownstream,
+                      TOFCandidates& cands) {
+  cands.clear();
+  double the_gen_sec = gen.first;
+  double the_gen_ns = gen.second;
+  const vector<BeamTime>* downs[2] = {&unorderedTOF2ATime, &unorderedTOF2BTime};
+  const vector<BeamTime>* ups[2] = {&unorderedTOF1ATime, &unorderedTOF1BTime};
+  for ( int idn=0; idn<2; ++idn ) {
+    const vector<BeamTime>& down = *downs[idn];
+    for(size_t ip2 = 0; ip2 < down.size(); ++ip2){
+      double TOF2_sec = down[ip2].first;
+      double TOF2_ns  = down[ip2].second;
+      double delta_2 = 1.e9*(the_gen_sec - TOF2_sec) + the_gen_ns - TOF2_ns;
+      if( delta_2 < 0. ) break;
+      else if( delta_2 > fDownstreamToGenTrig ) continue;
+      for ( int iup=0; iup<2; ++iup ) {
+        const vector<BeamTime>& up = *ups[iup];
+        for(size_t ip1 = 0; ip1 < up.size(); ++ip1){
+          double TOF1_sec = up[ip1].first;
+          double TOF1_ns  = up[ip1].second;
+          double delta = 1.e9*( TOF2_sec - TOF1_sec ) + TOF2_ns - TOF1_ns;
+          if( delta < 0. ) break;
+          else if( delta > 0. && delta < fUpstreamToDownstream){
+            cands.tofs.push_back( delta );
+            cands.chans.push_back( 2*idn + iup );
+            cands.upstream.push_back( ip1 );
+            cands.downstream.push_back( ip2 );
+          }
+          else continue;
+        }
+      }
+    }
+  }
+}
+
+// Leftover loop of BeamEvent::parseGeneralXBPF: the trigger for each
+// record, or -1.
+inline vector<long> matchFibers(const vector<BeamTime>& t0s, const vector<BeamTime>& recs) {
+  vector<long> trigs;
+  vector<size_t> leftOvers;
+  for(size_t lo = 0; lo < t0s.size(); ++lo){
+    leftOvers.push_back(lo);
+  }
+  for ( const BeamTime& rec : recs ) {
+    long trig = -1;
+    for(vector<size_t>::iterator ip = leftOvers.begin(); ip != leftOvers.end(); ++ip){
+      double delta = (t0s[*ip].first  - rec.first );
+      delta += 1.e-9*( t0s[*ip].second - rec.second );
+      if( delta < -1.e-7 && delta > -10.e-7 ){
+        trig = *ip;
+        leftOvers.erase(ip);
+        break;
+      }
+    }
+    trigs.push_back(trig);
+  }
+  return trigs;
+}
+
+// A spill: GeneralTrigger and TOF counter times (seconds, ns) in
+// database order, and fiber monitor record times for the triggers.
+struct Spill {
+  vector<BeamTime> gen;
+  vector<BeamTime> tof1A, tof1B, tof2A, tof2B;
+  vector<BeamTime> fibers;
+};
+
+// Time t shifted by dns ns, keeping ns in [0, 1e9).
+inline BeamTime shifted(const BeamTime& t, double dns) {
+  double sec = t.first;
+  double ns = t.second + dns;
+  while ( ns < 0. ) { ns += 1.e9; sec -= 1.; }
+  while ( ns >= 1.e9 ) { ns -= 1.e9; sec += 1.; }
+  return BeamTime(sec, ns);
+}
+
+// Spill with ntrig triggers over 4.8 s.  The counter times are multiples
+// of 1/512 ns as in the data, a fraction of the deltas are exactly on the
+// window edges and a few entries are out of order.
+inline Spill makeSpill(size_t ntrig, std::mt19937& rng, double sec0 =1540000000.) {
+  Spill sp;
+  std::uniform_real_distribution<double> spillTime(0., 4.8e9);
+  std::uniform_real_distribution<double> unif(0., 1.);
+  auto tick = [](double ns) { return std::round(512.*ns)/512.; };
+  vector<double> ts;
+  for ( size_t itrg=0; itrg<ntrig; ++itrg ) ts.push_back(spillTime(rng));
+  std::sort(ts.begin(), ts.end());
+  const double edges[] = {0., 50., 500.};
+  auto pickDelta = [&](double lo, double hi) {
+    double r = unif(rng);
+    if ( r < 0.05 ) return edges[size_t(30*r)%3];
+    return tick(lo + (hi - lo)*unif(rng));
+  };
+  for ( double t : ts ) {
+    BeamTime gen(sec0 + std::floor(t/1.e9), tick(std::fmod(t, 1.e9)));
+    sp.gen.push_back(gen);
+    // Downstream 0-70 ns before, on A or B (or both).
+    double r = unif(rng);
+    BeamTime down = shifted(gen, -pickDelta(-5., 70.));
+    if ( r < 0.5 ) sp.tof2A.push_back(down);
+    else if ( r < 0.95 ) sp.tof2B.push_back(down);
+    else { sp.tof2A.push_back(down); sp.tof2B.push_back(shifted(down, -tick(3.*unif(rng)))); }
+    // Upstream 0-600 ns before the downstream.
+    BeamTime up = shifted(down, -pickDelta(-20., 600.));
+    if ( unif(rng) < 0.5 ) sp.tof1A.push_back(up);
+    else sp.tof1B.push_back(up);
+    if ( unif(rng) < 0.1 ) sp.tof1A.push_back(shifted(up, -tick(900.*unif(rng))));
+    // Fiber record 0-1100 ns after the trigger, sometimes twice.
+    size_t nrec = unif(rng) < 0.05 ? 2 : 1;
+    for ( size_t irec=0; irec<nrec; ++irec ) {
+      double dt = unif(rng) < 0.05 ? edges[1] + 50. : tick(1100.*unif(rng));
+      sp.fibers.push_back(shifted(gen, dt));
+    }
+  }
+  // Noise hits.
+  for ( vector<BeamTime>* pts : {&sp.tof1A, &sp.tof1B, &sp.tof2A, &sp.tof2B} ) {
+    size_t nnoise = ntrig/5;
+    for ( size_t inoi=0; inoi<nnoise; ++inoi ) {
+      double t = spillTime(rng);
+      pts->push_back(BeamTime(sec0 + std::floor(t/1.e9), tick(std::fmod(t, 1.e9))));
+    }
+  }
+  // Database order is time order with an occasional swap.
+  auto before = [](const BeamTime& a, const BeamTime& b) {
+    return a.first < b.first || (a.first == b.first && a.second < b.second);
+  };
+  for ( vector<BeamTime>* pts : {&sp.tof1A, &sp.tof1B, &sp.tof2A, &sp.tof2B, &sp.fibers} ) {
+    std::sort(pts->begin(), pts->end(), before);
+    for ( size_t i=1; i<pts->size(); ++i ) {
+      if ( unif(rng) < 0.01 ) std::swap((*pts)[i-1], (*pts)[i]);
+    }
+  }
+  return sp;
+}
+
+}  // end namespace beamref
+
+#endif
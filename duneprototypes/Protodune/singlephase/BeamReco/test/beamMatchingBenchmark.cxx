@@ -0,0 +1,100 @@
+// beamMatchingBenchmark.cxx
+//
+// Time the BeamEvent spill matching, the TOF candidates for every
+// GeneralTrigger and the fiber monitor records of eight devices, with the
+// nested loops BeamEvent used before and with CoincidenceFinder.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "duneprototypes/Protodune/singlephase/BeamReco/BeamCoincidence.h"
+#include "BeamMatchingReference.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using proto::BeamTime;
+using proto::CoincidenceFinder;
+using proto::TOFCandidates;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  const string myname = "beamMatchingBenchmark: ";
+  size_t nspill = 5;
+  size_t ntrig = 5000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NSPILL [NTRIG]]" << endl;
+      cout << "  NSPILL [5]: Number of spills." << endl;
+      cout << "  NTRIG [5000]: Number of triggers in each spill." << endl;
+      return 0;
+    }
+    nspill = std::stoul(sarg);
+  }
+  if ( argc > 2 ) ntrig = std::stoul(argv[2]);
+  const size_t ndev = 8;
+  std::mt19937 rng(2018);
+  double dttofOld = 0.0;
+  double dttofNew = 0.0;
+  double dtfibOld = 0.0;
+  double dtfibNew = 0.0;
+  size_t ncandOld = 0;
+  size_t ncandNew = 0;
+  size_t nfibOld = 0;
+  size_t nfibNew = 0;
+  TOFCandidates cands;
+  for ( size_t ispl=0; ispl<nspill; ++ispl ) {
+    beamref::Spill sp = beamref::makeSpill(ntrig, rng);
+    auto t0 = Clock::now();
+    for ( const BeamTime& gen : sp.gen ) {
+      beamref::matchTOFs(gen, sp.tof1A, sp.tof1B, sp.tof2A, sp.tof2B, 50., 500., cands);
+      ncandOld += cands.size();
+    }
+    auto t1 = Clock::now();
+    CoincidenceFinder f1A(sp.tof1A);
+    CoincidenceFinder f1B(sp.tof1B);
+    CoincidenceFinder f2A(sp.tof2A);
+    CoincidenceFinder f2B(sp.tof2B);
+    for ( const BeamTime& gen : sp.gen ) {
+      proto::MatchTOFs(gen, f1A, f1B, f2A, f2B, 50., 500., cands);
+      ncandNew += cands.size();
+    }
+    auto t2 = Clock::now();
+    for ( size_t idev=0; idev<ndev; ++idev ) {
+      vector<long> trigs = beamref::matchFibers(sp.gen, sp.fibers);
+      for ( long trig : trigs ) nfibOld += trig >= 0;
+    }
+    auto t3 = Clock::now();
+    CoincidenceFinder ft0(sp.gen);
+    for ( size_t idev=0; idev<ndev; ++idev ) {
+      vector<bool> used(sp.gen.size(), false);
+      for ( const BeamTime& rec : sp.fibers ) {
+        nfibNew += proto::MatchFiberRecord(ft0, rec, used) != CoincidenceFinder::npos;
+      }
+    }
+    auto t4 = Clock::now();
+    dttofOld += std::chrono::duration<double>(t1 - t0).count();
+    dttofNew += std::chrono::duration<double>(t2 - t1).count();
+    dtfibOld += std::chrono::duration<double>(t3 - t2).count();
+    dtfibNew += std::chrono::duration<double>(t4 - t3).count();
+  }
+  if ( ncandNew != ncandOld || nfibNew != nfibOld ) {
+    cout << myname << "ERROR: Results differ." << endl;
+    return 1;
+  }
+  cout << myname << nspill << " spills with " << ntrig << " triggers" << endl;
+  cout << myname << "TOF candidates: " << ncandNew << ", matched fiber records: " << nfibNew << endl;
+  cout << myname << "         TOF loops: " << 1.e3*dttofOld/nspill << " ms/spill" << endl;
+  cout << myname << "TOF coincidences:   " << 1.e3*dttofNew/nspill << " ms/spill" << endl;
+  cout << myname << "       fiber loops: " << 1.e3*dtfibOld/nspill << " ms/spill" << endl;
+  cout << myname << "fiber coincidences: " << 1.e3*dtfibNew/nspill << " ms/spill" << endl;
+  return 0;
+}
+
+//**********************************************************************
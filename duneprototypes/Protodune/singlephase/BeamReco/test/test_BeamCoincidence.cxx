@@ -0,0 +1,146 @@
+// test_BeamCoincidence.cxx
+//
+// Test the BeamEvent TOF and fiber monitor matching with CoincidenceFinder
+// against the nested loops it replaced, on random spills with window-edge
+// deltas, times across second boundaries and out-of-order entries.  The
+// TOF candidates (values, channels and counter entries, in order) and the
+// triggers chosen for the fiber records must be unchanged.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include "duneprototypes/Protodune/singlephase/BeamReco/BeamCoincidence.h"
+#include "BeamMatchingReference.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using proto::BeamTime;
+using proto::CoincidenceFinder;
+using proto::TOFCandidates;
+
+//**********************************************************************
+
+int test_BeamCoincidence(size_t nspill, size_t ntrig) {
+  const string myname = "test_BeamCoincidence: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(2018);
+  const double fDownstreamToGenTrig = 50.;
+  const double fUpstreamToDownstream = 500.;
+
+  cout << myname << line << endl;
+  cout << myname << "Finder queries." << endl;
+  {
+    vector<BeamTime> ts = {{10., 500.}, {10., 100.}, {10., 900.}, {11., 0.}, {10., 999999980.}};
+    CoincidenceFinder fnd(ts);
+    assert( fnd.size() == ts.size() );
+    assert( fnd.Before({9., 999999999.}) == 0 );
+    assert( fnd.Before({10., 500.}) == 2 );   // 10+500ns is not later
+    assert( fnd.Before({10., 999.}) == 3 );
+    assert( fnd.Before({12., 0.}) == 5 );
+    vector<size_t> idxs;
+    fnd.Window({10., 1000.}, 0., 150., idxs);
+    assert( idxs.size() == 1 && idxs[0] == 2 );
+    fnd.Window({11., 50.}, 0., 1.e9, idxs);
+    assert( idxs == vector<size_t>({0, 1, 2, 3, 4}) );
+    fnd.Window({11., 50.}, 0., 1.e9, idxs, 3);
+    assert( idxs == vector<size_t>({0, 1, 2}) );
+    fnd.Window({11., 50.}, 0., 100., idxs);
+    assert( idxs.size() == 2 && idxs[0] == 3 && idxs[1] == 4 );
+    CoincidenceFinder empty;
+    assert( empty.Before({10., 0.}) == 0 );
+    empty.Window({10., 0.}, 0., 100., idxs);
+    assert( idxs.empty() );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Spills." << endl;
+  size_t ngen = 0;
+  size_t ncand = 0;
+  size_t nfib = 0;
+  size_t nfibmatch = 0;
+  TOFCandidates refCands;
+  TOFCandidates newCands;
+  for ( size_t ispl=0; ispl<nspill; ++ispl ) {
+    beamref::Spill sp = beamref::makeSpill(ntrig + 37*ispl, rng);
+    CoincidenceFinder f1A(sp.tof1A);
+    CoincidenceFinder f1B(sp.tof1B);
+    CoincidenceFinder f2A(sp.tof2A);
+    CoincidenceFinder f2B(sp.tof2B);
+    for ( const BeamTime& gen : sp.gen ) {
+      beamref::matchTOFs(gen, sp.tof1A, sp.tof1B, sp.tof2A, sp.tof2B,
+                         fDownstreamToGenTrig, fUpstreamToDownstream, refCands);
+      proto::MatchTOFs(gen, f1A, f1B, f2A, f2B,
+                       fDownstreamToGenTrig, fUpstreamToDownstream, newCands);
+      assert( newCands.tofs == refCands.tofs );
+      assert( newCands.chans == refCands.chans );
+      assert( newCands.upstream == refCands.upstream );
+      assert( newCands.downstream == refCands.downstream );
+      ++ngen;
+      ncand += newCands.size();
+    }
+    // Fiber records against the triggers (with the TAI offset removed).
+    vector<BeamTime> t0s;
+    for ( const BeamTime& gen : sp.gen ) t0s.push_back({gen.first - 37., gen.second});
+    vector<BeamTime> recs;
+    for ( const BeamTime& fib : sp.fibers ) recs.push_back({fib.first - 37., fib.second});
+    vector<long> refTrigs = beamref::matchFibers(t0s, recs);
+    CoincidenceFinder ft0(t0s);
+    vector<bool> used(t0s.size(), false);
+    for ( size_t irec=0; irec<recs.size(); ++irec ) {
+      size_t it = proto::MatchFiberRecord(ft0, recs[irec], used);
+      long trig = it == CoincidenceFinder::npos ? -1 : long(it);
+      assert( trig == refTrigs[irec] );
+      if ( trig >= 0 ) ++nfibmatch;
+    }
+    nfib += recs.size();
+  }
+  cout << myname << "Triggers: " << ngen << ", TOF candidates: " << ncand << endl;
+  cout << myname << "Fiber records: " << nfib << ", matched: " << nfibmatch << endl;
+  assert( ncand > ngen/2 );
+  assert( nfibmatch > nfib/2 && nfibmatch < nfib );
+
+  cout << myname << line << endl;
+  cout << myname << "No TOFs." << endl;
+  {
+    CoincidenceFinder none;
+    proto::MatchTOFs({1540000000., 5.}, none, none, none, none,
+                     fDownstreamToGenTrig, fUpstreamToDownstream, newCands);
+    assert( newCands.size() == 0 );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nspill = 20;
+  size_t ntrig = 300;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NSPILL [NTRIG]]" << endl;
+      cout << "  NSPILL [20]: Number of spills." << endl;
+      cout << "  NTRIG [300]: Number of triggers in the first spill." << endl;
+      return 0;
+    }
+    nspill = std::stoul(sarg);
+  }
+  if ( argc > 2 ) ntrig = std::stoul(argv[2]);
+  return test_BeamCoincidence(nspill, ntrig);
+}
+
+//**********************************************************************
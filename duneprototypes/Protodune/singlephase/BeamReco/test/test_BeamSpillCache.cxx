@@ -0,0 +1,242 @@
+// test_BeamSpillCache.cxx
+//
+// Test BeamSpillCache with a local stand-in for the IFBeam database.
+// The queries BeamEvent makes for a run of spills are recorded, including
+// some that fail, and then replayed from the file with a database that
+// must not be called.  The replayed values and failures must be those of
+// the database.  Also checks that a recorded cache is extended by a second
+// Record job and that missing entries and bad configurations throw.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include "duneprototypes/Protodune/singlephase/BeamReco/BeamSpillCache.h"
+#include "cetlib_except/exception.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using proto::BeamSpillCache;
+using Values = BeamSpillCache::Values;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+struct Query {
+  string bundle;
+  string device;
+  long long time;
+};
+
+// Stand-in for the database: the values depend on the device and the
+// time, and the magnet current is missing for every fifth spill.
+class StandIn {
+public:
+  size_t ncall = 0;
+  bool allowed = true;
+  Values Fetch(const Query& q) {
+    assert( allowed );
+    ++ncall;
+    if ( q.device.find("current") != string::npos && (q.time/60)%5 == 0 ) {
+      throw cet::exception("WebAPI") << "No data for " << q.device << " at " << q.time;
+    }
+    size_t n = 1 + q.device.size()%7 + q.time%3;
+    Values vals(n);
+    for ( size_t i=0; i<n; ++i ) vals[i] = 1.e-3*q.time + 0.5*i + q.device.size();
+    return vals;
+  }
+};
+
+// The queries for the spills of a run, with the devices BeamEvent reads.
+vector<Query> runQueries(long long t0, size_t nspill) {
+  const string bundle = "DUNE_CERN_SEP2018";
+  const string xcetBundle = "DUNE_CERN_SEP2018_TIMBER";
+  const string pre = "dip/acc/NORTH/NP04/BI/";
+  vector<string> devices = {
+    pre + "XBTF/GeneralTrigger:coarse[]", pre + "XBTF/GeneralTrigger:frac[]",
+    pre + "XBTF/GeneralTrigger:seconds[]", pre + "XBTF/S11:coarse[]",
+    pre + "XTOF/XBTF022687A:coarse[]", pre + "XTOF/XBTF022687A:frac[]",
+    pre + "XTOF/XBTF022716B:seconds[]", pre + "XBPF/XBPF022697:eventsData[]",
+    pre + "XCET/XCET022713:pressure", "dip/acc/NORTH/NP04/POW/MBPL022699:current"
+  };
+  vector<Query> qs;
+  for ( size_t ispill=0; ispill<nspill; ++ispill ) {
+    long long time = t0 + 60*ispill;
+    for ( const string& dev : devices ) qs.push_back({bundle, dev, time});
+    qs.push_back({xcetBundle, "timber/XBH4/XTDC/022/713:SECONDS", time - 5});
+  }
+  return qs;
+}
+
+// Result of a query: the values or the error message.
+struct Result {
+  bool ok = false;
+  Values values;
+  string error;
+  bool operator==(const Result& rhs) const {
+    return ok == rhs.ok && values == rhs.values && error == rhs.error;
+  }
+};
+
+Result get(BeamSpillCache& cache, StandIn& db, const Query& q) {
+  Result res;
+  try {
+    res.values = cache.Get(q.bundle, q.device, q.time, [&]{ return db.Fetch(q); });
+    res.ok = true;
+  } catch ( std::exception const& e ) {
+    res.error = e.what();
+  }
+  return res;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_BeamSpillCache(size_t nspill) {
+  const string myname = "test_BeamSpillCache: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  const string fname = "test_BeamSpillCache.root";
+  std::remove(fname.c_str());
+  vector<Query> qs = runQueries(1540000000, nspill);
+  vector<Query> moreqs = runQueries(1540000000 + 60*nspill, 2);
+
+  cout << myname << line << endl;
+  cout << myname << "Database results." << endl;
+  StandIn db;
+  vector<Result> expected;
+  size_t nfail = 0;
+  {
+    BeamSpillCache off;
+    assert( off.GetMode() == BeamSpillCache::kOff );
+    for ( const Query& q : qs ) {
+      expected.push_back(get(off, db, q));
+      if ( ! expected.back().ok ) ++nfail;
+    }
+    assert( db.ncall == qs.size() );
+    assert( off.Size() == 0 );
+    off.Write();
+  }
+  cout << myname << "Queries: " << qs.size() << ", failures: " << nfail << endl;
+  assert( nfail > 0 );
+  assert( nfail < qs.size() );
+
+  cout << myname << line << endl;
+  cout << myname << "Record." << endl;
+  {
+    db.ncall = 0;
+    BeamSpillCache cache(fname, BeamSpillCache::ModeFromName("Record"));
+    assert( cache.Size() == 0 );
+    for ( size_t iqry=0; iqry<qs.size(); ++iqry ) assert( get(cache, db, qs[iqry]) == expected[iqry] );
+    assert( db.ncall == qs.size() );
+    assert( cache.Size() == qs.size() );
+    // Same spills again: the failures are retried.
+    for ( size_t iqry=0; iqry<qs.size(); ++iqry ) assert( get(cache, db, qs[iqry]) == expected[iqry] );
+    assert( db.ncall == qs.size() + nfail );
+    assert( cache.Hits() == qs.size() - nfail );
+    cache.Write();
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Replay without database." << endl;
+  double dtrep = 0.0;
+  {
+    db.allowed = false;
+    BeamSpillCache cache(fname, BeamSpillCache::kReplay);
+    assert( cache.Replay() );
+    assert( cache.Size() == qs.size() );
+    auto t0 = Clock::now();
+    for ( size_t iqry=0; iqry<qs.size(); ++iqry ) {
+      Result res = get(cache, db, qs[iqry]);
+      if ( expected[iqry].ok ) assert( res == expected[iqry] );
+      else assert( ! res.ok && res.error == expected[iqry].error );
+    }
+    dtrep = std::chrono::duration<double>(Clock::now() - t0).count();
+    assert( cache.Hits() == qs.size() );
+    assert( cache.Fetches() == 0 );
+    assert( cache.Misses() == 0 );
+    cout << myname << "Missing entry." << endl;
+    Result res = get(cache, db, moreqs.front());
+    assert( ! res.ok );
+    assert( res.error.find("No entry") != string::npos );
+    assert( cache.Misses() == 1 );
+    assert( res.error.find(cache.LastMiss()) != string::npos );
+  }
+  cout << myname << "Replay: " << 1.e9*dtrep/qs.size() << " ns/query" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Extend the recorded cache." << endl;
+  {
+    db.allowed = true;
+    db.ncall = 0;
+    BeamSpillCache cache(fname, BeamSpillCache::kRecord);
+    assert( cache.Size() == qs.size() );
+    for ( size_t iqry=0; iqry<qs.size(); ++iqry ) assert( get(cache, db, qs[iqry]) == expected[iqry] );
+    assert( db.ncall == nfail );
+    for ( const Query& q : moreqs ) get(cache, db, q);
+    assert( db.ncall == nfail + moreqs.size() );
+    cache.Write();
+    db.allowed = false;
+    BeamSpillCache replay(fname, BeamSpillCache::kReplay);
+    assert( replay.Size() == qs.size() + moreqs.size() );
+    for ( const Query& q : moreqs ) {
+      Result res = get(replay, db, q);
+      Result resdb;
+      db.allowed = true;
+      resdb.values = db.Fetch(q);
+      db.allowed = false;
+      assert( res.ok && res.values == resdb.values );
+    }
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Bad configurations." << endl;
+  {
+    bool threw = false;
+    try { BeamSpillCache::ModeFromName("Replace"); } catch ( cet::exception const& ) { threw = true; }
+    assert( threw );
+    threw = false;
+    try { BeamSpillCache cache("no_such_file.root", BeamSpillCache::kReplay); } catch ( cet::exception const& ) { threw = true; }
+    assert( threw );
+    threw = false;
+    try { BeamSpillCache cache("", BeamSpillCache::kRecord); } catch ( cet::exception const& ) { threw = true; }
+    assert( threw );
+  }
+
+  std::remove(fname.c_str());
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nspill = 100;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NSPILL]" << endl;
+      cout << "  NSPILL [100]: Number of spills in the run." << endl;
+      return 0;
+    }
+    nspill = std::max(size_t(1), size_t(std::stoul(sarg)));
+  }
+  return test_BeamSpillCache(nspill);
+}
+
+//**********************************************************************
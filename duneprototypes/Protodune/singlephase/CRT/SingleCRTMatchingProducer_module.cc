@@ -54,6 +54,9 @@
 
 //Local includes
 #include "duneprototypes/Protodune/singlephase/CRT/data/CRTTrigger.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitPairing.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitCollection.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/TrackMetrics.h"
 
 //ROOT includes
 #include "TH1.h"
@@ -89,7 +92,7 @@ public:
   SingleCRTMatchingProducer & operator = (SingleCRTMatchingProducer const &) = delete;
   SingleCRTMatchingProducer & operator = (SingleCRTMatchingProducer &&) = delete;
   
-  bool moduleMatcher(int module1, int module2);
+  void beginRun(art::Run const & r) override;
   void produce(art::Event & event) override;
   std::string fTrackModuleLabel = "pandoraTrack";
 
@@ -118,30 +121,7 @@ public:
     double CRTT0;
     double flashTime;
     double opCRTTDiff;
-  typedef struct // Structures for arrays to move hits from raw to reco to validation
-  {
 
-    int channel;
-    int module;
-    int channelGeo;
-    int adc;
-    int triggerTime;
-    int triggerNumber;
-  }
-  tempHits;
-
-  typedef struct {
-    int tempId;	
-    int adcX;
-    int adcY;
-    int stripX, stripY, moduleX, moduleY;
-    double hitPositionX;
-    double hitPositionY;
-    double hitPositionZ;
-    double timeAvg;
-    int trigNumberX, trigNumberY;
-  }
-  recoHits;
 
   typedef struct // These are displacement metrics for track and hit reco
   {
@@ -187,11 +167,13 @@ public:
 
   }
   };
-  std::vector < recoHits > primaryHits_F;
-  std::vector < recoHits > primaryHits_B;
+  CRT::HitCollection primaryHits_F;
+  CRT::HitCollection primaryHits_B;
 
-  std::vector < tempHits > tempHits_F;
-  std::vector < tempHits > tempHits_B;
+  std::vector < CRT::StripHit > tempHits_F;
+  std::vector < CRT::StripHit > tempHits_B;
+  CRT::HitPairing fHitPairing; // 2D hits from the strip hits
+  CRT::TrackCandidates fCandidates; // Track and CRT hit combinations
   std::vector < tracksPair > tracksPair_F;
   std::vector < tracksPair > tracksPair_B;
 };
@@ -213,12 +195,10 @@ CRT::SingleCRTMatchingProducer::SingleCRTMatchingProducer(fhicl::ParameterSet
 
 
 
-// v6 Geo Channel Map
-bool CRT::SingleCRTMatchingProducer::moduleMatcher(int module1, int module2) {
-  // Function checking if two hits could reasonably be matched into a 2D hit
-  if ((module1 == 6 && (module2 == 10 || module2 == 11)) || (module1 == 14 && (module2 == 10 || module2 == 11)) || (module1 == 19 && (module2 == 26 || module2 == 27)) || (module1 == 31 && (module2 == 26 || module2 == 27)) || (module1 == 7 && (module2 == 12 || module2 == 13)) || (module1 == 15 && (module2 == 12 || module2 == 13)) || (module1 == 18 && (module2 == 24 || module2 == 25)) || (module1 == 30 && (module2 == 24 || module2 == 25)) || (module1 == 1 && (module2 == 4 || module2 == 5)) || (module1 == 9 && (module2 == 4 || module2 == 5)) || (module1 == 16 && (module2 == 20 || module2 == 21)) || (module1 == 28 && (module2 == 20 || module2 == 21)) || (module1 == 0 && (module2 == 2 || module2 == 3)) || (module1 == 8 && (module2 == 2 || module2 == 3)) || (module1 == 17 && (module2 == 22 || module2 == 23)) || (module1 == 29 && (module2 == 22 || module2 == 23))) return 1;
-  else return 0;
-
+void CRT::SingleCRTMatchingProducer::beginRun(art::Run const & r) {
+  // Strip centers for making 2D hits and sorting hits into front and back
+  art::ServiceHandle < geo::Geometry > geom;
+  fHitPairing.SetStripCenters(*geom);
 }
 
 
@@ -302,12 +282,11 @@ void CRT::SingleCRTMatchingProducer::produce(art::Event & event)
     for (const auto & hit: hits) { // Collect hits on all modules
       if (hit.ADC() > fADCThreshold) { // Keep if they are above threshold
 
-        tempHits tHits;
+        CRT::StripHit tHits;
 	if (!fMCCSwitch){
 	art::ValidHandle<std::vector<raw::RDTimeStamp>> timingHandle = event.getValidHandle<std::vector<raw::RDTimeStamp>>("timingrawdecoder:daq");
 
         tHits.module = trigger.Channel(); // Values to add to array
-        tHits.channelGeo = hit.Channel();
 	tHits.channel=hit.Channel();
         tHits.adc = hit.ADC();
 	tHits.triggerTime=trigger.Timestamp()-timingHandle->at(0).GetTimeStamp();
@@ -315,7 +294,6 @@ void CRT::SingleCRTMatchingProducer::produce(art::Event & event)
 	}
 	else{
         tHits.module = trigger.Channel(); // Values to add to array
-        tHits.channelGeo = hit.Channel();
 	tHits.channel=hit.Channel();
         tHits.adc = hit.ADC();
 	tHits.triggerTime=trigger.Timestamp();
@@ -324,10 +302,8 @@ void CRT::SingleCRTMatchingProducer::produce(art::Event & event)
 	 //cout<<trigger.Channel()<<','<<hit.Channel()<<','<<hit.ADC()<<endl;
         nHits++;
 
-        const auto & trigGeo = geom -> AuxDet(trigger.Channel()); // Get geo  
-        const auto & csens = trigGeo.SensitiveVolume(hit.Channel());
-        const auto center = csens.GetCenter();
-        if (center.Z() < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
+        const auto & center = fHitPairing.StripCenter(trigger.Channel(), hit.Channel()); // Get geo
+        if (center.z < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
         else tempHits_B.push_back(tHits);
         hitID++;
       }
@@ -338,108 +314,8 @@ void CRT::SingleCRTMatchingProducer::produce(art::Event & event)
   //cout << "Hits compiled for event: " << nEvents << endl;
   //cout << "Number of Hits above Threshold:  " << hitID << endl;
 
-  for (unsigned int f = 0; f < tempHits_F.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_F.size(); f_test++) {
-       if (fabs(tempHits_F[f_test].triggerTime-tempHits_F[f].triggerTime)>fModuletoModuleTimingCut) continue;
-      const auto & trigGeo = geom -> AuxDet(tempHits_F[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_F[f_test].module);
-
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_F[f].channelGeo);
-      const auto hit1Center = hit1Geo.GetCenter();
-      // Create 2D hits from geo of the Y and X modules
-       const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_F[f_test].channelGeo);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_F[f_test].module, tempHits_F[f].module);
-
-      if (moduleMatched) {
-        // Get the center of the hits (CRT_Res=2.5 cm)
-        double hitX = hit1Center.X();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f].module && (tempHits_F[a].channelGeo-1)==tempHits_F[f].channelGeo) hitX=hit1Center.X()+1.25;
-	}
-	double hitYPrelim=hit2Center.Y();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f_test].module && (tempHits_F[a].channelGeo-1)==tempHits_F[f_test].channelGeo) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	
-
-	
-	double hitY=hitYPrelim;
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.adcX=tempHits_F[f].adc;
-	rHits.adcY=tempHits_F[f_test].adc;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-	rHits.moduleX=tempHits_F[f].module;
-        rHits.moduleY=tempHits_F[f_test].module;
-        rHits.trigNumberX=tempHits_F[f].triggerNumber;
-	rHits.trigNumberY=tempHits_F[f_test].triggerNumber;
-	rHits.stripX=tempHits_F[f].channel;
-	rHits.stripY=tempHits_F[f_test].channel;
-	rHits.timeAvg = (tempHits_F[f_test].triggerTime+tempHits_F[f].triggerTime)/2.0;
-       primaryHits_F.push_back(rHits); // Add array
-    }
-    }
-  }
-  for (unsigned int f = 0; f < tempHits_B.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_B.size(); f_test++) { // Same as above but for back CRT
-       if (fabs(tempHits_B[f_test].triggerTime-tempHits_B[f].triggerTime)>fModuletoModuleTimingCut) continue;
-
-      const auto & trigGeo = geom -> AuxDet(tempHits_B[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_B[f_test].module);
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_B[f].channelGeo);
-      const auto hit1Center = hit1Geo.GetCenter();
-
-      const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_B[f_test].channelGeo);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_B[f_test].module, tempHits_B[f].module);
-
-
-      if (moduleMatched) {
-        double hitX = hit1Center.X();
-	
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f].module && (tempHits_B[a].channelGeo-1)==tempHits_B[f].channelGeo) hitX=hit1Center.X()+1.25;
-	}
-	
-        double hitYPrelim = hit2Center.Y();
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f_test].module && (tempHits_B[a].channel-1)==tempHits_B[f_test].channel) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	double hitY=hitYPrelim;
-
-	
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.adcX=tempHits_B[f].adc;
-	rHits.adcY=tempHits_B[f_test].adc;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-        rHits.moduleX=tempHits_B[f].module;
-        rHits.moduleY=tempHits_B[f_test].module;
-	rHits.stripX=tempHits_B[f].channel;
-	rHits.trigNumberX=tempHits_B[f].triggerNumber;
-	rHits.trigNumberY=tempHits_B[f_test].triggerNumber;
-	rHits.stripY=tempHits_B[f_test].channel;
-	rHits.timeAvg = (tempHits_B[f_test].triggerTime+tempHits_B[f].triggerTime)/2.0;
-	 primaryHits_B.push_back(rHits); 
-
-	 }
-    }
-  }
+  fHitPairing.Pair(tempHits_F, fModuletoModuleTimingCut, primaryHits_F); // Create 2D hits from the X and Y modules
+  fHitPairing.Pair(tempHits_B, fModuletoModuleTimingCut, primaryHits_B); // Same as above but for back CRT
 
      auto const t0CandPtr = art::PtrMaker<anab::T0>(event);
      auto const crtPtr = art::PtrMaker<anab::CosmicTag>(event);	
@@ -510,32 +386,25 @@ event.put(std::move(T0col)); event.put(std::move(CRTTrack)); event.put(std::move
     }
  if ((trackEndPositionZ_noSCE>90 && trackEndPositionZ_noSCE < 660 && trackStartPositionZ_noSCE <50 && trackStartPositionZ_noSCE<660) || (trackStartPositionZ_noSCE>90 && trackStartPositionZ_noSCE < 660 && trackEndPositionZ_noSCE <50 && trackEndPositionZ_noSCE<660)) {
 
-      double min_delta = DBL_MAX;
-
-      double best_dotProductCos = DBL_MAX;
-      double best_deltaXF = DBL_MAX;
-      double best_deltaYF = DBL_MAX;
-      int bestHitIndex_F=-1;
-      double best_trackX1=DBL_MAX;
-      double best_trackX2=DBL_MAX;
+      fCandidates.clear();
       for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
    double xOffset=0;
 
 		double trackStartPositionX_notCorrected=trackStartPositionX_noSCE;
 		double trackEndPositionX_notCorrected=trackEndPositionX_noSCE;
 		if (!t0s.empty()){
-		if (event.isRealData() && fabs(t0s.at(0)->Time()-(primaryHits_F[iHit_F].timeAvg*20.f))>100000) continue;
-		if (!event.isRealData() && fabs(t0s.at(0)->Time()-primaryHits_F[iHit_F].timeAvg)>100000) continue;
+		if (event.isRealData() && fabs(t0s.at(0)->Time()-(primaryHits_F.timeAvg[iHit_F]*20.f))>100000) continue;
+		if (!event.isRealData() && fabs(t0s.at(0)->Time()-primaryHits_F.timeAvg[iHit_F])>100000) continue;
 		}
 		if (t0s.empty()){
 		int RDOffset=0;
 		if (!fMCCSwitch) RDOffset=111;
 		double ticksOffset=0;
-		//cout<<(primaryHits_F[iHit_F].timeAvg+RDOffset)<<endl;
+		//cout<<(primaryHits_F.timeAvg[iHit_F]+RDOffset)<<endl;
                 //cout<<detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat)<<endl;
-                if (!fMCCSwitch) ticksOffset = (primaryHits_F[iHit_F].timeAvg+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                if (!fMCCSwitch) ticksOffset = (primaryHits_F.timeAvg[iHit_F]+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 
-                else if (fMCCSwitch) ticksOffset = (primaryHits_F[iHit_F].timeAvg/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                else if (fMCCSwitch) ticksOffset = (primaryHits_F.timeAvg[iHit_F]/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		
                xOffset=detProp.ConvertTicksToX(ticksOffset,allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		//double xOffset=.08*ticksOffset
@@ -566,62 +435,21 @@ if(geom->PositionToTPCID(geo::Point_t(trackEndPositionX, trackEndPositionY, trac
 	}
     }
 
-        double X1 = primaryHits_F[iHit_F].hitPositionX;
-
-        double Y1 = primaryHits_F[iHit_F].hitPositionY;
-
-        double Z1 = primaryHits_F[iHit_F].hitPositionZ;
-
-	// Make metrics for a CRT pair to compare later
-	TVector3 trackStart(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-	TVector3 trackEnd(trackEndPositionX, trackEndPositionY, trackEndPositionZ);
-	TVector3 v1(X1,Y1,Z1);
-	TVector3 v2(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-
-            TVector3 v4(trackStartPositionX,
-                        trackStartPositionY,
-                        trackStartPositionZ);
-            TVector3 v5(trackEndPositionX,
-                        trackEndPositionY,
-                        trackEndPositionZ);
-	TVector3 trackVector = (v5-v4).Unit();
-	TVector3 hitVector=(v2-v1).Unit();
-
-
-
-
-              double predictedHitPositionY1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
-
-
-              double predictedHitPositionX1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
-
-
-	if (predictedHitPositionX1<-200 || predictedHitPositionX1>580 || predictedHitPositionY1<-50 || predictedHitPositionY1>620) continue;
-
-	double dotProductCos=trackVector*hitVector;
-
-        double deltaX1 = (predictedHitPositionX1-X1);
-
-
-        double deltaY1 = (predictedHitPositionY1-Y1);
-
-
-   if (min_delta > std::abs(deltaX1) + std::abs(deltaY1) ){
-
-	   min_delta=std::abs(deltaX1)+std::abs(deltaY1);
-
-            best_dotProductCos = dotProductCos;
-	    best_trackX1=trackStartPositionX;
-	    best_trackX2=trackEndPositionX;
-            best_deltaXF = deltaX1;
-            best_deltaYF = deltaY1;
-	    bestHitIndex_F=iHit_F;
-          }
-
+	fCandidates.Add(trackStartPositionX, trackStartPositionY, trackStartPositionZ,
+	                trackEndPositionX, trackEndPositionY, trackEndPositionZ, xOffset, iHit_F);
 	}
-   
-    int  f=bestHitIndex_F; 
-    if (bestHitIndex_F==-1) continue;
+
+      // Make metrics for each CRT hit and keep the closest to the track
+      const CRT::Window frontWindow{-200, 580, -50, 620}; // Predicted hit position on the CRT
+      CRT::EvaluateSingle(primaryHits_F, fCandidates);
+      const size_t best = CRT::BestCandidate(fCandidates, &frontWindow);
+      if (best == CRT::TrackCandidates::none) continue;
+      double best_dotProductCos = fCandidates.dotProductCos[best];
+      double best_trackX1=fCandidates.startX[best];
+      double best_trackX2=fCandidates.endX[best];
+      double best_deltaXF = fCandidates.deltaX1[best];
+      double best_deltaYF = fCandidates.deltaY1[best];
+      int  f=fCandidates.hit1[best];
 
    double deltaX=best_deltaXF; double deltaY=best_deltaYF;
    double dotProductCos=best_dotProductCos;
@@ -648,19 +476,19 @@ if(geom->PositionToTPCID(geo::Point_t(trackEndPositionX, trackEndPositionY, trac
         tPair.deltaY=deltaY;
         tPair.dotProductCos=dotProductCos;
 
-        tPair.moduleX1 = primaryHits_F[f].moduleX;
-        tPair.moduleY1 = primaryHits_F[f].moduleY;
-        tPair.adcX1=primaryHits_F[f].adcX;
-        tPair.adcY1=primaryHits_F[f].adcY;
+        tPair.moduleX1 = primaryHits_F.moduleX[f];
+        tPair.moduleY1 = primaryHits_F.moduleY[f];
+        tPair.adcX1=primaryHits_F.adcX[f];
+        tPair.adcY1=primaryHits_F.adcY[f];
         
-        tPair.stripX1 = primaryHits_F[f].stripX;
-        tPair.stripY1 = primaryHits_F[f].stripY;
-        tPair.trigNumberX = primaryHits_F[f].trigNumberX;
-        tPair.trigNumberY = primaryHits_F[f].trigNumberY;
-        tPair.X1 = primaryHits_F[f].hitPositionX;
-        tPair.Y1 = primaryHits_F[f].hitPositionY;
-        tPair.Z1 = primaryHits_F[f].hitPositionZ;
-	tPair.timeAvg=primaryHits_F[f].timeAvg;
+        tPair.stripX1 = primaryHits_F.stripX[f];
+        tPair.stripY1 = primaryHits_F.stripY[f];
+        tPair.trigNumberX = primaryHits_F.trigNumberX[f];
+        tPair.trigNumberY = primaryHits_F.trigNumberY[f];
+        tPair.X1 = primaryHits_F.x[f];
+        tPair.Y1 = primaryHits_F.y[f];
+        tPair.Z1 = primaryHits_F.z[f];
+	tPair.timeAvg=primaryHits_F.timeAvg[f];
         tPair.trackStartPosition=trackStart;
 	tPair.trackEndPosition=trackEnd;
         tracksPair_B.push_back(tPair);
@@ -668,14 +496,7 @@ if(geom->PositionToTPCID(geo::Point_t(trackEndPositionX, trackEndPositionY, trac
       }
 	
  if ( (trackStartPositionZ_noSCE<620 && trackEndPositionZ_noSCE > 660 && trackStartPositionZ_noSCE > 50 && trackEndPositionZ_noSCE > 50) || (trackStartPositionZ_noSCE>660 && trackEndPositionZ_noSCE < 620 && trackStartPositionZ_noSCE > 50 && trackEndPositionZ_noSCE > 50)) {
-      double min_delta = DBL_MAX;
-
-      double best_dotProductCos = DBL_MAX;
-      double best_deltaXF = DBL_MAX;
-      double best_deltaYF = DBL_MAX;     
-      int bestHitIndex_B=-1;
-      double best_trackX1=DBL_MAX;
-      double best_trackX2=DBL_MAX;
+      fCandidates.clear();
       for (unsigned int iHit_B = 0; iHit_B < primaryHits_B.size(); iHit_B++) {
 double xOffset=0;
     
@@ -683,16 +504,16 @@ double xOffset=0;
 		double trackStartPositionX_notCorrected=trackStartPositionX_noSCE;
 		double trackEndPositionX_notCorrected=trackEndPositionX_noSCE;
 		if (!t0s.empty()){
-		if (event.isRealData() && fabs(t0s.at(0)->Time()-(primaryHits_B[iHit_B].timeAvg*20.f))>100000) continue;
-		if (!event.isRealData() && fabs(t0s.at(0)->Time()-primaryHits_B[iHit_B].timeAvg)>100000) continue;
+		if (event.isRealData() && fabs(t0s.at(0)->Time()-(primaryHits_B.timeAvg[iHit_B]*20.f))>100000) continue;
+		if (!event.isRealData() && fabs(t0s.at(0)->Time()-primaryHits_B.timeAvg[iHit_B])>100000) continue;
 	}
 		if (t0s.empty()){
 		int RDOffset=0;
 		if (!fMCCSwitch) RDOffset=111;
 		double ticksOffset=0;
-                if (!fMCCSwitch) ticksOffset = (primaryHits_B[iHit_B].timeAvg+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                if (!fMCCSwitch) ticksOffset = (primaryHits_B.timeAvg[iHit_B]+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 
-                else if (fMCCSwitch) ticksOffset = (primaryHits_B[iHit_B].timeAvg/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                else if (fMCCSwitch) ticksOffset = (primaryHits_B.timeAvg[iHit_B]/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		
                xOffset=detProp.ConvertTicksToX(ticksOffset,allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		//double xOffset=.08*ticksOffset
@@ -710,61 +531,22 @@ double xOffset=0;
    double trackEndPositionX=trackEndPositionX_noSCE;
    double trackEndPositionY=trackEndPositionY_noSCE;
    double trackEndPositionZ=trackEndPositionZ_noSCE;
-        double X1 = primaryHits_B[iHit_B].hitPositionX;
-
-        double Y1 = primaryHits_B[iHit_B].hitPositionY;
-
-        double Z1 = primaryHits_B[iHit_B].hitPositionZ;
-
-
- 
-	// Make metrics for a CRT pair to compare later
-	TVector3 trackStart(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-	TVector3 trackEnd(trackEndPositionX, trackEndPositionY, trackEndPositionZ);
-	TVector3 v1(X1,Y1,Z1);
-	TVector3 v2(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-
-            TVector3 v4(trackStartPositionX,
-                        trackStartPositionY,
-                        trackStartPositionZ);
-            TVector3 v5(trackEndPositionX,
-                        trackEndPositionY,
-                        trackEndPositionZ);
-	TVector3 trackVector = (v5-v4).Unit();
-	TVector3 hitVector=(v2-v1).Unit();
-
-
-
-
-              double predictedHitPositionY1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
-
-
-              double predictedHitPositionX1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
-
-	if (abs(predictedHitPositionX1)>340 || predictedHitPositionY1<-160 || predictedHitPositionY1>560) continue;
-
-	double dotProductCos=trackVector*hitVector;
-
-        double deltaX1 = (predictedHitPositionX1-X1);
-
-        double deltaY1 = (predictedHitPositionY1-Y1);
-
-      if (min_delta > std::abs(deltaX1) + std::abs(deltaY1) ){
-
-	   min_delta=std::abs(deltaX1)+std::abs(deltaY1);
-
-            best_dotProductCos = dotProductCos;
-	    best_trackX1=trackStartPositionX;
-	    best_trackX2=trackEndPositionX;
-            best_deltaXF = deltaX1;
-            best_deltaYF = deltaY1;
-	    bestHitIndex_B=iHit_B; 
-          }
 
+	fCandidates.Add(trackStartPositionX, trackStartPositionY, trackStartPositionZ,
+	                trackEndPositionX, trackEndPositionY, trackEndPositionZ, xOffset, iHit_B);
 	}
-   
-   int  f=bestHitIndex_B; 
-      if (bestHitIndex_B==-1) continue;
+
+      // Make metrics for each CRT hit and keep the closest to the track
+      const CRT::Window backWindow{-340, 340, -160, 560}; // Predicted hit position on the CRT
+      CRT::EvaluateSingle(primaryHits_B, fCandidates);
+      const size_t best = CRT::BestCandidate(fCandidates, &backWindow);
+      if (best == CRT::TrackCandidates::none) continue;
+      double best_dotProductCos = fCandidates.dotProductCos[best];
+      double best_trackX1=fCandidates.startX[best];
+      double best_trackX2=fCandidates.endX[best];
+      double best_deltaXF = fCandidates.deltaX1[best];
+      double best_deltaYF = fCandidates.deltaY1[best];
+      int  f=fCandidates.hit1[best];
    double deltaX=best_deltaXF; double deltaY=best_deltaYF;
    double dotProductCos=best_dotProductCos;
 
@@ -790,20 +572,20 @@ double xOffset=0;
         tPair.deltaY=deltaY;
         tPair.dotProductCos=dotProductCos;
 
-        tPair.moduleX1 = primaryHits_B[f].moduleX;
-        tPair.moduleY1 = primaryHits_B[f].moduleY;
+        tPair.moduleX1 = primaryHits_B.moduleX[f];
+        tPair.moduleY1 = primaryHits_B.moduleY[f];
 
-        tPair.adcX1=primaryHits_B[f].adcX;
-        tPair.adcY1=primaryHits_B[f].adcY;
+        tPair.adcX1=primaryHits_B.adcX[f];
+        tPair.adcY1=primaryHits_B.adcY[f];
 
-        tPair.stripX1 = primaryHits_B[f].stripX;
-        tPair.stripY1 = primaryHits_B[f].stripY;
-       tPair.trigNumberX = primaryHits_B[f].trigNumberX;
-        tPair.trigNumberY = primaryHits_B[f].trigNumberY;
-        tPair.X1 = primaryHits_B[f].hitPositionX;
-        tPair.Y1 = primaryHits_B[f].hitPositionY;
-        tPair.Z1 = primaryHits_B[f].hitPositionZ;
-	tPair.timeAvg=primaryHits_B[f].timeAvg;
+        tPair.stripX1 = primaryHits_B.stripX[f];
+        tPair.stripY1 = primaryHits_B.stripY[f];
+       tPair.trigNumberX = primaryHits_B.trigNumberX[f];
+        tPair.trigNumberY = primaryHits_B.trigNumberY[f];
+        tPair.X1 = primaryHits_B.x[f];
+        tPair.Y1 = primaryHits_B.y[f];
+        tPair.Z1 = primaryHits_B.z[f];
+	tPair.timeAvg=primaryHits_B.timeAvg[f];
         tPair.trackStartPosition=trackStart;
 	tPair.trackEndPosition=trackEnd;
         tracksPair_B.push_back(tPair);
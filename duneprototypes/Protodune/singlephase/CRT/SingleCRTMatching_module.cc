@@ -54,6 +54,9 @@
 
 //Local includes
 #include "duneprototypes/Protodune/singlephase/CRT/data/CRTTrigger.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitPairing.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitCollection.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/TrackMetrics.h"
 
 //ROOT includes
 #include "TH1.h"
@@ -94,7 +97,7 @@ class CRT::SingleCRTMatching: public art::EDAnalyzer {
   void analyze(art::Event
     const & e) override;
 // Declare functions and variables for validation
-  bool moduleMatcher(int module1, int module2);
+  void beginRun(art::Run const & r) override;
   void beginJob() override;
   void endJob() override;
   double setAngle(double angle);
@@ -140,35 +143,7 @@ int moduletoCTB(int module2, int module1);
     double mccT0;
     double opCRTDiff, maxPurity;
       long long timeStamp;
-  typedef struct // Structures for arrays to move hits from raw to reco to validation
-  {
 
-    int channel;
-    int module;
-    int channelGeo;
-    int adc;
-    int triggerTime;
-    int triggerNumber;
-  }
-  tempHits;
-
-  typedef struct {
-    int tempId;	
-    int adcX;
-    int adcY;
-
-    double hitPositionX;
-    double hitPositionY;
-    double hitPositionZ;
-    double timeAvg;
-    int geoX;
-    int geoY;
-    int stripX;
-    int stripY;
-    int trigNumberX;
-    int trigNumberY;
-  }
-  recoHits;
 
   typedef struct // These are displacement metrics for track and hit reco
   {
@@ -225,11 +200,13 @@ int moduletoCTB(int module2, int module1);
 	//return (fabs(pair1.deltaY)<fabs(pair2.deltaY));
   }
   };
-  std::vector < recoHits > primaryHits_F;
-  std::vector < recoHits > primaryHits_B;
+  CRT::HitCollection primaryHits_F;
+  CRT::HitCollection primaryHits_B;
 
-  std::vector < tempHits > tempHits_F;
-  std::vector < tempHits > tempHits_B;
+  std::vector < CRT::StripHit > tempHits_F;
+  std::vector < CRT::StripHit > tempHits_B;
+  CRT::HitPairing fHitPairing; // 2D hits from the strip hits
+  CRT::TrackCandidates fCandidates; // Track and CRT hit combinations
   std::vector < tracksPair > tracksPair_F;
   std::vector < tracksPair > tracksPair_B;
 };
@@ -244,12 +221,10 @@ CRT::SingleCRTMatching::SingleCRTMatching(fhicl::ParameterSet
   }
 
 
-// v6 Geo Channel Map
-bool CRT::SingleCRTMatching::moduleMatcher(int module1, int module2) {
-  // Function checking if two hits could reasonably be matched into a 2D hit
-  if ((module1 == 6 && (module2 == 10 || module2 == 11)) || (module1 == 14 && (module2 == 10 || module2 == 11)) || (module1 == 19 && (module2 == 26 || module2 == 27)) || (module1 == 31 && (module2 == 26 || module2 == 27)) || (module1 == 7 && (module2 == 12 || module2 == 13)) || (module1 == 15 && (module2 == 12 || module2 == 13)) || (module1 == 18 && (module2 == 24 || module2 == 25)) || (module1 == 30 && (module2 == 24 || module2 == 25)) || (module1 == 1 && (module2 == 4 || module2 == 5)) || (module1 == 9 && (module2 == 4 || module2 == 5)) || (module1 == 16 && (module2 == 20 || module2 == 21)) || (module1 == 28 && (module2 == 20 || module2 == 21)) || (module1 == 0 && (module2 == 2 || module2 == 3)) || (module1 == 8 && (module2 == 2 || module2 == 3)) || (module1 == 17 && (module2 == 22 || module2 == 23)) || (module1 == 29 && (module2 == 22 || module2 == 23))) return 1;
-  else return 0;
-
+void CRT::SingleCRTMatching::beginRun(art::Run const & r) {
+  // Strip centers for making 2D hits and sorting hits into front and back
+  art::ServiceHandle < geo::Geometry > geom;
+  fHitPairing.SetStripCenters(*geom);
 }
 
 int CRT::SingleCRTMatching::moduletoCTB(int module2, int module1){
@@ -371,7 +346,7 @@ void CRT::SingleCRTMatching::analyze(art::Event
 	//cout<<hits.size()<<','<<hit.ADC()<<endl;
       if (hit.ADC() > fADCThreshold) { // Keep if they are above threshold
 
-        tempHits tHits;
+        CRT::StripHit tHits;
 	if (!fMCCSwitch){
 
         tHits.module = trigger.Channel(); // Values to add to array
@@ -388,10 +363,8 @@ void CRT::SingleCRTMatching::analyze(art::Event
 	 //cout<<trigger.Channel()<<','<<hit.Channel()<<','<<hit.ADC()<<endl;
         nHits++;
 	tHits.triggerNumber=trigID;
-        const auto & trigGeo = geom -> AuxDet(trigger.Channel()); // Get geo  
-        const auto & csens = trigGeo.SensitiveVolume(hit.Channel());
-        const auto center = csens.GetCenter();
-        if (center.Z() < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
+        const auto & center = fHitPairing.StripCenter(trigger.Channel(), hit.Channel()); // Get geo
+        if (center.z < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
         else tempHits_B.push_back(tHits);
         hitID++;
       }
@@ -402,107 +375,8 @@ void CRT::SingleCRTMatching::analyze(art::Event
   cout << "Hits compiled for event: " << nEvents << endl;
   cout << "Number of Hits above Threshold:  " << hitID << endl;
 
-  for (unsigned int f = 0; f < tempHits_F.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_F.size(); f_test++) {
-       if (fabs(tempHits_F[f_test].triggerTime-tempHits_F[f].triggerTime)>fModuletoModuleTimingCut) continue;
-      const auto & trigGeo = geom -> AuxDet(tempHits_F[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_F[f_test].module);
-
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_F[f].channel);
-      const auto hit1Center = hit1Geo.GetCenter();
-      // Create 2D hits from geo of the Y and X modules
-       const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_F[f_test].channel);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_F[f_test].module, tempHits_F[f].module);
-      if (moduleMatched) {
-        // Get the center of the hits (CRT_Res=2.5 cm)
-        double hitX = hit1Center.X();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f].module && (tempHits_F[a].channel-1)==tempHits_F[f].channel) hitX=hit1Center.X()+1.25;
-	}
-	double hitYPrelim=hit2Center.Y();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f_test].module && (tempHits_F[a].channel-1)==tempHits_F[f_test].channel) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	
-
-	
-	double hitY=hitYPrelim;
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-	rHits.geoX=tempHits_F[f].module;
-	rHits.geoY=tempHits_F[f_test].module;
-	rHits.stripX=tempHits_F[f].channel;
-	rHits.stripY=tempHits_F[f_test].channel;
-
-	rHits.adcX=tempHits_F[f].adc;
-	rHits.adcY=tempHits_F[f_test].adc;
-	rHits.trigNumberX=tempHits_F[f].triggerNumber;
-	rHits.trigNumberY=tempHits_F[f_test].triggerNumber;
-	rHits.timeAvg = (tempHits_F[f_test].triggerTime+tempHits_F[f].triggerTime)/2.0;
-       primaryHits_F.push_back(rHits); // Add array
-    }
-    }
-  }
-  for (unsigned int f = 0; f < tempHits_B.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_B.size(); f_test++) { // Same as above but for back CRT
-       if (fabs(tempHits_B[f_test].triggerTime-tempHits_B[f].triggerTime)>fModuletoModuleTimingCut) continue;
-
-      const auto & trigGeo = geom -> AuxDet(tempHits_B[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_B[f_test].module);
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_B[f].channel);
-      const auto hit1Center = hit1Geo.GetCenter();
-
-      const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_B[f_test].channel);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_B[f_test].module, tempHits_B[f].module);
-
-      if (moduleMatched) {
-        double hitX = hit1Center.X();
-	
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f].module && (tempHits_B[a].channel-1)==tempHits_B[f].channel) hitX=hit1Center.X()+1.25;
-	}
-	
-        double hitYPrelim = hit2Center.Y();
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f_test].module && (tempHits_B[a].channel-1)==tempHits_B[f_test].channel) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	double hitY=hitYPrelim;
-
-	
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-	rHits.geoX=tempHits_B[f].module;
-	rHits.geoY=tempHits_B[f_test].module;
-	rHits.adcX=tempHits_B[f].adc;
-	rHits.adcY=tempHits_B[f_test].adc;
-	rHits.stripX=tempHits_B[f].channel;
-	rHits.stripY=tempHits_B[f_test].channel;
-	rHits.trigNumberX=tempHits_B[f].triggerNumber;
-	rHits.trigNumberY=tempHits_B[f_test].triggerNumber;
-	rHits.timeAvg = (tempHits_B[f_test].triggerTime+tempHits_B[f].triggerTime)/2.0;
-	 primaryHits_B.push_back(rHits); 
-
-	 }
-    }
-  }
+  fHitPairing.Pair(tempHits_F, fModuletoModuleTimingCut, primaryHits_F); // Create 2D hits from the X and Y modules
+  fHitPairing.Pair(tempHits_B, fModuletoModuleTimingCut, primaryHits_B); // Same as above but for back CRT
   // Reconstruciton information
  art::Handle < vector < recob::Track > > trackListHandle;
   vector < art::Ptr < recob::Track > > trackList;
@@ -569,16 +443,7 @@ void CRT::SingleCRTMatching::analyze(art::Event
  if ((trackEndPositionZ_noSCE>90 && trackEndPositionZ_noSCE < 660 && trackStartPositionZ_noSCE <50 && trackStartPositionZ_noSCE<660) || (trackStartPositionZ_noSCE>90 && trackStartPositionZ_noSCE < 660 && trackEndPositionZ_noSCE <50 && trackEndPositionZ_noSCE<660)) {
 
 
-      double min_delta = DBL_MAX;
-
-      double best_dotProductCos = DBL_MAX;
-      double best_deltaXF = DBL_MAX;
-      double best_deltaYF = DBL_MAX;
-      double best_T=DBL_MAX;
-      double best_trackX1=DBL_MAX;
-      double best_trackX2=DBL_MAX;
-      double best_xOffset=DBL_MAX;
-      int bestHitIndex_F=0;
+      fCandidates.clear();
 
 	int beamRight=-1;
 	int beamLeft=-1;
@@ -655,11 +520,11 @@ if (beamLeft!=-1 || beamRight!=-1){
 for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
 
 
-        double X1 = primaryHits_F[iHit_F].hitPositionX;
+        double X1 = primaryHits_F.x[iHit_F];
 
-        double Y1 = primaryHits_F[iHit_F].hitPositionY;
+        double Y1 = primaryHits_F.y[iHit_F];
 
-        double Z1 = primaryHits_F[iHit_F].hitPositionZ;
+        double Z1 = primaryHits_F.z[iHit_F];
 	double mccHitY=(endPos.Y()-startPos.Y())/(endPos.Z()-startPos.Z())*(Z1-startPos.Z())+startPos.Y();
 	double mccHitX=(endPos.X()-startPos.X())/(endPos.Z()-startPos.Z())*(Z1-startPos.Z())+startPos.X();
 	
@@ -705,19 +570,19 @@ for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
 		double trackStartPositionX_notCorrected=trackStartPositionX_noSCE;
 		double trackEndPositionX_notCorrected=trackEndPositionX_noSCE;
 		if (!t0s.empty()){
-		if (event.isRealData() && fabs(t_zero-(primaryHits_F[iHit_F].timeAvg*20.f))>100000) continue;
-		if (!event.isRealData() && fabs(t_zero-primaryHits_F[iHit_F].timeAvg)>100000) continue;
+		if (event.isRealData() && fabs(t_zero-(primaryHits_F.timeAvg[iHit_F]*20.f))>100000) continue;
+		if (!event.isRealData() && fabs(t_zero-primaryHits_F.timeAvg[iHit_F])>100000) continue;
 		}
 		if (t0s.empty()){
 
 		int RDOffset=0;
 		if (!fMCCSwitch) RDOffset=111;
 		double ticksOffset=0;
-		//cout<<(primaryHits_F[iHit_F].timeAvg+RDOffset)<<endl;
+		//cout<<(primaryHits_F.timeAvg[iHit_F]+RDOffset)<<endl;
                 //cout<<detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat)<<endl;
-                if (!fMCCSwitch) ticksOffset = (primaryHits_F[iHit_F].timeAvg+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                if (!fMCCSwitch) ticksOffset = (primaryHits_F.timeAvg[iHit_F]+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 
-                else if (fMCCSwitch) ticksOffset = (primaryHits_F[iHit_F].timeAvg/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                else if (fMCCSwitch) ticksOffset = (primaryHits_F.timeAvg[iHit_F]/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		
                xOffset=detProp.ConvertTicksToX(ticksOffset,allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		//double xOffset=.08*ticksOffset
@@ -734,68 +599,24 @@ for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
    double trackEndPositionX=trackEndPositionX_noSCE;
    double trackEndPositionY=trackEndPositionY_noSCE;
    double trackEndPositionZ=trackEndPositionZ_noSCE;
-//	if (!fMCCSwitch && moduletoCTB(primaryHits_F[iHit_F].moduleX, primaryHits_F[iHit_F].moduleY)!=pixel0) continue;
-        double X1 = primaryHits_F[iHit_F].hitPositionX;
-
-        double Y1 = primaryHits_F[iHit_F].hitPositionY;
-
-        double Z1 = primaryHits_F[iHit_F].hitPositionZ;
-
-
-	//if (mccTruthCheck==1) cout<<iRecoTrack<<endl;
-
-
-	// Make metrics for a CRT pair to compare later
-	TVector3 trackStart(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-	TVector3 trackEnd(trackEndPositionX, trackEndPositionY, trackEndPositionZ);
-	TVector3 v1(X1,Y1,Z1);
-	TVector3 v2(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-
-            TVector3 v4(trackStartPositionX,
-                        trackStartPositionY,
-                        trackStartPositionZ);
-            TVector3 v5(trackEndPositionX,
-                        trackEndPositionY,
-                        trackEndPositionZ);
-	TVector3 trackVector = (v5-v4).Unit();
-	TVector3 hitVector=(v2-v1).Unit();
-
-
-
-
-              double predictedHitPositionY1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
-
-
-              double predictedHitPositionX1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
-
-	if (predictedHitPositionX1<-200 || predictedHitPositionX1>580 || predictedHitPositionY1<-50 || predictedHitPositionY1>620) continue;
-
-	double dotProductCos=trackVector*hitVector;
-
-        double deltaX1 = (predictedHitPositionX1-X1);
-
-
-        double deltaY1 = (predictedHitPositionY1-Y1);
-
-      if (min_delta > std::abs(deltaX1) + std::abs(deltaY1) ){
-
-	   min_delta=std::abs(deltaX1)+std::abs(deltaY1);
-
-            best_dotProductCos = dotProductCos;
-	    best_trackX1=trackStartPositionX;
-	    best_trackX2=trackEndPositionX;
-            best_deltaXF = deltaX1;
-            best_deltaYF = deltaY1;
-	    best_xOffset=xOffset;
-	    best_T = primaryHits_F[iHit_F].timeAvg;
-	    bestHitIndex_F=iHit_F;
-	    if (!fMCCSwitch) best_T=(111.f+best_T)*20.f;
-
-	    // Added 111 tick CRT-CTB offset
-          }
+//	if (!fMCCSwitch && moduletoCTB(primaryHits_F.moduleX[iHit_F], primaryHits_F.moduleY[iHit_F])!=pixel0) continue;
 
+	fCandidates.Add(trackStartPositionX, trackStartPositionY, trackStartPositionZ,
+	                trackEndPositionX, trackEndPositionY, trackEndPositionZ, xOffset, iHit_F);
 	}
-	int  f=bestHitIndex_F; 
+
+      // Make metrics for each CRT hit and keep the closest to the track
+      const CRT::Window frontWindow{-200, 580, -50, 620}; // Predicted hit position on the CRT
+      CRT::EvaluateSingle(primaryHits_F, fCandidates);
+      const size_t best = CRT::BestCandidate(fCandidates, &frontWindow);
+      if (best == CRT::TrackCandidates::none) continue;
+      double best_dotProductCos = fCandidates.dotProductCos[best];
+      double best_trackX1=fCandidates.startX[best];
+      double best_trackX2=fCandidates.endX[best];
+      double best_deltaXF = fCandidates.deltaX1[best];
+      double best_deltaYF = fCandidates.deltaY1[best];
+      double best_xOffset=fCandidates.xOffset[best];
+      int  f=fCandidates.hit1[best];
  //double t0=best_T;
  double deltaX=best_deltaXF; double deltaY=best_deltaYF;
 	double dotProductCos=best_dotProductCos;
@@ -812,7 +633,6 @@ for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
 	TVector3 trackStart(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
 	TVector3 trackEnd(trackEndPositionX, trackEndPositionY, trackEndPositionZ);
 
-	if (deltaX==DBL_MAX || deltaY==DBL_MAX)	continue;
 	 //if (minTimeDifference>100000) continue;
 	double minTimeDifference=999999.99;
          tracksPair tPair;
@@ -824,22 +644,22 @@ for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
         tPair.deltaY=deltaY;
         tPair.dotProductCos=dotProductCos;
 
-        tPair.moduleX1 = primaryHits_F[f].geoX;
-        tPair.moduleY1 = primaryHits_F[f].geoY;
+        tPair.moduleX1 = primaryHits_F.moduleX[f];
+        tPair.moduleY1 = primaryHits_F.moduleY[f];
 
-        tPair.adcX1=primaryHits_F[f].adcX;
-        tPair.adcY1=primaryHits_F[f].adcY;
+        tPair.adcX1=primaryHits_F.adcX[f];
+        tPair.adcY1=primaryHits_F.adcY[f];
 	tPair.xOffset=best_xOffset;
-        tPair.stripX1 = primaryHits_F[f].stripX;
-        tPair.stripY1 = primaryHits_F[f].stripY;
-        tPair.X1 = primaryHits_F[f].hitPositionX;
-        tPair.Y1 = primaryHits_F[f].hitPositionY;
-        tPair.Z1 = primaryHits_F[f].hitPositionZ;
+        tPair.stripX1 = primaryHits_F.stripX[f];
+        tPair.stripY1 = primaryHits_F.stripY[f];
+        tPair.X1 = primaryHits_F.x[f];
+        tPair.Y1 = primaryHits_F.y[f];
+        tPair.Z1 = primaryHits_F.z[f];
         tPair.mccX = mccX;
         tPair.mccY = mccY;
         tPair.mccZ =mccZ;
 	tPair.truthId=trackid;
-	tPair.timeAvg=primaryHits_F[f].timeAvg;
+	tPair.timeAvg=primaryHits_F.timeAvg[f];
         tPair.trackStartPosition=trackStart;
 	tPair.flashTDiff=minTimeDifference;
 	tPair.trackEndPosition=trackEnd;
@@ -854,16 +674,7 @@ for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
 	}
  if ( (trackStartPositionZ_noSCE<620 && trackEndPositionZ_noSCE > 660 && trackStartPositionZ_noSCE > 50 && trackEndPositionZ_noSCE > 50) || (trackStartPositionZ_noSCE>660 && trackEndPositionZ_noSCE < 620 && trackStartPositionZ_noSCE > 50 && trackEndPositionZ_noSCE > 50)) {
 
-      double min_delta = DBL_MAX;
-
-      double best_dotProductCos = DBL_MAX;
-      double best_deltaXF = DBL_MAX;
-      double best_deltaYF = DBL_MAX;
-      double best_T=DBL_MAX;
-      double best_xOffset=DBL_MAX;
-      int bestHitIndex_B=0;
-      double best_trackX1=DBL_MAX;
-      double best_trackX2=DBL_MAX;
+      fCandidates.clear();
 	
       int trackid=-1;
 if (fMCCSwitch){
@@ -927,11 +738,11 @@ if (approxExit!=-1){
 for (unsigned int iHit_F = 0; iHit_F < primaryHits_B.size(); iHit_F++) {
 
 
-        double X1 = primaryHits_B[iHit_F].hitPositionX;
+        double X1 = primaryHits_B.x[iHit_F];
 
-        double Y1 = primaryHits_B[iHit_F].hitPositionY;
+        double Y1 = primaryHits_B.y[iHit_F];
 
-        double Z1 = primaryHits_B[iHit_F].hitPositionZ;
+        double Z1 = primaryHits_B.z[iHit_F];
 	double mccHitY=(endPos.Y()-startPos.Y())/(endPos.Z()-startPos.Z())*(Z1-startPos.Z())+startPos.Y();
 	double mccHitX=(endPos.X()-startPos.X())/(endPos.Z()-startPos.Z())*(Z1-startPos.Z())+startPos.X();
         if (fabs(X1-mccHitX)<60 && fabs(Y1-mccHitY)<60) {mccTruthCheck=1;
@@ -963,19 +774,19 @@ double xOffset=0;
 		double trackEndPositionX_notCorrected=trackEndPositionX_noSCE;
 
 		if (!t0s.empty()){
-		if (event.isRealData() && fabs(t_zero-(primaryHits_B[iHit_B].timeAvg*20.f))>100000) continue;
-		if (!event.isRealData() && fabs(t_zero-primaryHits_B[iHit_B].timeAvg)>100000) continue;
+		if (event.isRealData() && fabs(t_zero-(primaryHits_B.timeAvg[iHit_B]*20.f))>100000) continue;
+		if (!event.isRealData() && fabs(t_zero-primaryHits_B.timeAvg[iHit_B])>100000) continue;
 	}
 		if (t0s.empty()){
 
 		int RDOffset=0;
 		if (!fMCCSwitch) RDOffset=111;
 		double ticksOffset=0;
-		//cout<<(primaryHits_B[iHit_B].timeAvg+RDOffset)<<endl;
+		//cout<<(primaryHits_B.timeAvg[iHit_B]+RDOffset)<<endl;
                 //cout<<detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat)<<endl;
-                if (!fMCCSwitch) ticksOffset = (primaryHits_B[iHit_B].timeAvg+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                if (!fMCCSwitch) ticksOffset = (primaryHits_B.timeAvg[iHit_B]+RDOffset)/25.f+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 
-                else if (fMCCSwitch) ticksOffset = (primaryHits_B[iHit_B].timeAvg/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
+                else if (fMCCSwitch) ticksOffset = (primaryHits_B.timeAvg[iHit_B]/500.f)+detProp.GetXTicksOffset(allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		
                xOffset=detProp.ConvertTicksToX(ticksOffset,allHits[firstHit]->WireID().Plane, allHits[firstHit]->WireID().TPC, allHits[firstHit]->WireID().Cryostat);
 		//double xOffset=.08*ticksOffset
@@ -1006,65 +817,22 @@ if(geom->PositionToTPCID(geo::Point_t(trackEndPositionX, trackEndPositionY, trac
 	}
     }
 
-        double X1 = primaryHits_B[iHit_B].hitPositionX;
-
-        double Y1 = primaryHits_B[iHit_B].hitPositionY;
-
-        double Z1 = primaryHits_B[iHit_B].hitPositionZ;
-
- 
-	// Make metrics for a CRT pair to compare later
-	TVector3 trackStart(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-	TVector3 trackEnd(trackEndPositionX, trackEndPositionY, trackEndPositionZ);
-	TVector3 v1(X1,Y1,Z1);
-	TVector3 v2(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-
-            TVector3 v4(trackStartPositionX,
-                        trackStartPositionY,
-                        trackStartPositionZ);
-            TVector3 v5(trackEndPositionX,
-                        trackEndPositionY,
-                        trackEndPositionZ);
-	TVector3 trackVector = (v5-v4).Unit();
-	TVector3 hitVector=(v2-v1).Unit();
-
-
-
-
-              double predictedHitPositionY1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
-
-
-              double predictedHitPositionX1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
-
-	if (abs(predictedHitPositionX1)>340 || predictedHitPositionY1<-160 || predictedHitPositionY1>560) continue;
-
-	double dotProductCos=trackVector*hitVector;
-
-        double deltaX1 = (predictedHitPositionX1-X1);
-
-
-        double deltaY1 = (predictedHitPositionY1-Y1);
-
-
-      //std::cout<<deltaX1<<','<<deltaY1<<std::endl;
-      if (min_delta > std::abs(deltaX1) + std::abs(deltaY1) ){
-
-	   min_delta=std::abs(deltaX1)+std::abs(deltaY1);
-
-            best_dotProductCos = dotProductCos;
-	    best_trackX1=trackStartPositionX;
-	    best_trackX2=trackEndPositionX;
-            best_deltaXF = deltaX1;
-            best_deltaYF = deltaY1;
-	    best_xOffset=xOffset;
-	    best_T = primaryHits_F[iHit_B].timeAvg;
-	    bestHitIndex_B=iHit_B;
-	    if (!fMCCSwitch) best_T=(111.f+best_T)*20.f;
-	    // Added 111 tick CRT-CTB offset
-          }
-
+	fCandidates.Add(trackStartPositionX, trackStartPositionY, trackStartPositionZ,
+	                trackEndPositionX, trackEndPositionY, trackEndPositionZ, xOffset, iHit_B);
 	}
-	int  f=bestHitIndex_B; 
+
+      // Make metrics for each CRT hit and keep the closest to the track
+      const CRT::Window backWindow{-340, 340, -160, 560}; // Predicted hit position on the CRT
+      CRT::EvaluateSingle(primaryHits_B, fCandidates);
+      const size_t best = CRT::BestCandidate(fCandidates, &backWindow);
+      if (best == CRT::TrackCandidates::none) continue;
+      double best_dotProductCos = fCandidates.dotProductCos[best];
+      double best_trackX1=fCandidates.startX[best];
+      double best_trackX2=fCandidates.endX[best];
+      double best_deltaXF = fCandidates.deltaX1[best];
+      double best_deltaYF = fCandidates.deltaY1[best];
+      double best_xOffset=fCandidates.xOffset[best];
+      int  f=fCandidates.hit1[best];
  //double t0=best_T;
  double deltaX=best_deltaXF; double deltaY=best_deltaYF;
 	double dotProductCos=best_dotProductCos;
@@ -1084,7 +852,6 @@ if(geom->PositionToTPCID(geo::Point_t(trackEndPositionX, trackEndPositionY, trac
 	TVector3 trackStart(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
 	TVector3 trackEnd(trackEndPositionX, trackEndPositionY, trackEndPositionZ);
 
-	if (deltaX==DBL_MAX && deltaY==DBL_MAX)	continue;
 	 //if (minTimeDifference>100000) continue;
 	double minTimeDifference=999999.99;
          tracksPair tPair;
@@ -1096,22 +863,22 @@ if(geom->PositionToTPCID(geo::Point_t(trackEndPositionX, trackEndPositionY, trac
         tPair.deltaY=deltaY;
         tPair.dotProductCos=dotProductCos;
 
-        tPair.moduleX1 = primaryHits_B[f].geoX;
-        tPair.moduleY1 = primaryHits_B[f].geoY;
+        tPair.moduleX1 = primaryHits_B.moduleX[f];
+        tPair.moduleY1 = primaryHits_B.moduleY[f];
 
-        tPair.adcX1=primaryHits_B[f].adcX;
-        tPair.adcY1=primaryHits_B[f].adcY;
+        tPair.adcX1=primaryHits_B.adcX[f];
+        tPair.adcY1=primaryHits_B.adcY[f];
 	tPair.xOffset=best_xOffset;
-        tPair.stripX1 = primaryHits_B[f].stripX;
-        tPair.stripY1 = primaryHits_B[f].stripY;
-        tPair.X1 = primaryHits_B[f].hitPositionX;
-        tPair.Y1 = primaryHits_B[f].hitPositionY;
-        tPair.Z1 = primaryHits_B[f].hitPositionZ;
+        tPair.stripX1 = primaryHits_B.stripX[f];
+        tPair.stripY1 = primaryHits_B.stripY[f];
+        tPair.X1 = primaryHits_B.x[f];
+        tPair.Y1 = primaryHits_B.y[f];
+        tPair.Z1 = primaryHits_B.z[f];
         tPair.mccX = mccX;
         tPair.mccY = mccY;
         tPair.mccZ =mccZ;
 	tPair.truthId=trackid;
-	tPair.timeAvg=primaryHits_B[f].timeAvg;
+	tPair.timeAvg=primaryHits_B.timeAvg[f];
         tPair.trackStartPosition=trackStart;
 	tPair.flashTDiff=minTimeDifference;
 	tPair.trackEndPosition=trackEnd;
@@ -1200,14 +967,14 @@ std::cout<<"Final Track Metrics:"<<CRTT0<<','<<mccT0<<','<<deltaX<<','<<deltaY<<
 	if (fabs(mccT0-CRTT0)>0 && !event.isRealData()) {
         if (Z_CRT<100){
 	for (unsigned int iHit_F = 0; iHit_F < primaryHits_F.size(); iHit_F++) {
-	//cout<<"Candidate CRTT0:"<<primaryHits_F[iHit_F].timeAvg<<endl;
+	//cout<<"Candidate CRTT0:"<<primaryHits_F.timeAvg[iHit_F]<<endl;
 
 
 }
 }
 	else{
 	for (unsigned int iHit_F = 0; iHit_F < primaryHits_B.size(); iHit_F++) {
-	//cout<<"Candidate CRTT0:"<<primaryHits_B[iHit_F].timeAvg<<endl;
+	//cout<<"Candidate CRTT0:"<<primaryHits_B.timeAvg[iHit_F]<<endl;
 
 
 }
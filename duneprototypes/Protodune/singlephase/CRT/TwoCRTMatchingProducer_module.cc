@@ -59,6 +59,9 @@
 
 //Local includes
 #include "duneprototypes/Protodune/singlephase/CRT/data/CRTTrigger.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitPairing.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitCollection.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/TrackMetrics.h"
 
 
 
@@ -94,7 +97,7 @@ public:
   TwoCRTMatchingProducer(TwoCRTMatchingProducer &&) = delete;
   TwoCRTMatchingProducer & operator = (TwoCRTMatchingProducer const &) = delete;
   TwoCRTMatchingProducer & operator = (TwoCRTMatchingProducer &&) = delete;
-  bool moduleMatcher(int module1, int module2);
+  void beginRun(art::Run const & r) override;
   // Required functions.
 
   void produce(art::Event & event) override;
@@ -114,33 +117,17 @@ private:
     long long timeStamp;
 
 
-typedef struct // Structures for arrays to move hits from raw to reco to validation
-  {
-    int triggerNumber;
-    int channel;
-    int module;
-    int adc;
-    int triggerTime;
-  }
-  tempHits;
-
-  typedef struct {
-    int tempId;	
-    int trigNumberX;
-    int trigNumberY;
-    double hitPositionX;
-    double hitPositionY;
-    double hitPositionZ;
-    double timeAvg;
-  }
-  recoHits;
 
 
-  std::vector < recoHits > primaryHits_F;
-  std::vector < recoHits > primaryHits_B;
 
-  std::vector < tempHits > tempHits_F;
-  std::vector < tempHits > tempHits_B;
+  CRT::HitCollection primaryHits_F;
+  CRT::HitCollection primaryHits_B;
+
+  std::vector < CRT::StripHit > tempHits_F;
+  std::vector < CRT::StripHit > tempHits_B;
+  CRT::HitPairing fHitPairing; // 2D hits from the strip hits
+  std::vector < std::pair < size_t, size_t > > fInTimePairs; // Front and back hits in time
+  CRT::TrackCandidates fCandidates; // Track and CRT pair combinations
 
 
 
@@ -161,12 +148,10 @@ CRT::TwoCRTMatchingProducer::TwoCRTMatchingProducer(fhicl::ParameterSet const &
   fSCECorrection=(p.get<bool>("SCECorrection"));
 }
 
-// v6 Geo Channel Map
-bool CRT::TwoCRTMatchingProducer::moduleMatcher(int module1, int module2) {
-  // Function checking if two hits could reasonably be matched into a 2D hit
-  if ((module1 == 6 && (module2 == 10 || module2 == 11)) || (module1 == 14 && (module2 == 10 || module2 == 11)) || (module1 == 19 && (module2 == 26 || module2 == 27)) || (module1 == 31 && (module2 == 26 || module2 == 27)) || (module1 == 7 && (module2 == 12 || module2 == 13)) || (module1 == 15 && (module2 == 12 || module2 == 13)) || (module1 == 18 && (module2 == 24 || module2 == 25)) || (module1 == 30 && (module2 == 24 || module2 == 25)) || (module1 == 1 && (module2 == 4 || module2 == 5)) || (module1 == 9 && (module2 == 4 || module2 == 5)) || (module1 == 16 && (module2 == 20 || module2 == 21)) || (module1 == 28 && (module2 == 20 || module2 == 21)) || (module1 == 0 && (module2 == 2 || module2 == 3)) || (module1 == 8 && (module2 == 2 || module2 == 3)) || (module1 == 17 && (module2 == 22 || module2 == 23)) || (module1 == 29 && (module2 == 22 || module2 == 23))) return 1;
-  else return 0;
-
+void CRT::TwoCRTMatchingProducer::beginRun(art::Run const & r) {
+  // Strip centers for making 2D hits and sorting hits into front and back
+  art::ServiceHandle < geo::Geometry > geom;
+  fHitPairing.SetStripCenters(*geom);
 }
 
 
@@ -238,7 +223,7 @@ void CRT::TwoCRTMatchingProducer::produce(art::Event & event)
 	//cout<<hits.size()<<','<<hit.ADC()<<endl;
       if (hit.ADC() > fADCThreshold) { // Keep if they are above threshold
 
-        tempHits tHits;
+        CRT::StripHit tHits;
 	if (!fMCCSwitch){
 
         tHits.module = trigger.Channel(); // Values to add to array
@@ -255,10 +240,8 @@ void CRT::TwoCRTMatchingProducer::produce(art::Event & event)
 	 //cout<<trigger.Channel()<<','<<hit.Channel()<<','<<hit.ADC()<<endl;
         nHits++;
 	tHits.triggerNumber=trigID;
-        const auto & trigGeo = geom -> AuxDet(trigger.Channel()); // Get geo  
-        const auto & csens = trigGeo.SensitiveVolume(hit.Channel());
-        const auto center = csens.GetCenter();
-        if (center.Z() < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
+        const auto & center = fHitPairing.StripCenter(trigger.Channel(), hit.Channel()); // Get geo
+        if (center.z < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
         else tempHits_B.push_back(tHits);
         hitID++;
       }
@@ -269,94 +252,9 @@ void CRT::TwoCRTMatchingProducer::produce(art::Event & event)
   //cout << "Hits compiled for event: " << nEvents << endl;
   //cout << "Number of Hits above Threshold:  " << hitID << endl;
 
-  for (unsigned int f = 0; f < tempHits_F.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_F.size(); f_test++) {
-       if (fabs(tempHits_F[f_test].triggerTime-tempHits_F[f].triggerTime)>fModuletoModuleTimingCut) continue;
-      const auto & trigGeo = geom -> AuxDet(tempHits_F[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_F[f_test].module);
-
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_F[f].channel);
-      const auto hit1Center = hit1Geo.GetCenter();
-      // Create 2D hits from geo of the Y and X modules
-       const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_F[f_test].channel);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_F[f_test].module, tempHits_F[f].module);
-      if (moduleMatched) {
-        // Get the center of the hits (CRT_Res=2.5 cm)
-        double hitX = hit1Center.X();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f].module && (tempHits_F[a].channel-1)==tempHits_F[f].channel) hitX=hit1Center.X()+1.25;
-	}
-	double hitYPrelim=hit2Center.Y();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f_test].module && (tempHits_F[a].channel-1)==tempHits_F[f_test].channel) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	
-
-	
-	double hitY=hitYPrelim;
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-	rHits.trigNumberX=tempHits_F[f].triggerNumber;
-	rHits.trigNumberY=tempHits_F[f_test].triggerNumber;
-	rHits.timeAvg = (tempHits_F[f_test].triggerTime+tempHits_F[f].triggerTime)/2.0;
-       primaryHits_F.push_back(rHits); // Add array
-    }
-    }
-  }
-  for (unsigned int f = 0; f < tempHits_B.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_B.size(); f_test++) { // Same as above but for back CRT
-       if (fabs(tempHits_B[f_test].triggerTime-tempHits_B[f].triggerTime)>fModuletoModuleTimingCut) continue;
-
-      const auto & trigGeo = geom -> AuxDet(tempHits_B[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_B[f_test].module);
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_B[f].channel);
-      const auto hit1Center = hit1Geo.GetCenter();
-
-      const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_B[f_test].channel);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_B[f_test].module, tempHits_B[f].module);
-
-      if (moduleMatched) {
-        double hitX = hit1Center.X();
-	
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f].module && (tempHits_B[a].channel-1)==tempHits_B[f].channel) hitX=hit1Center.X()+1.25;
-	}
-	
-        double hitYPrelim = hit2Center.Y();
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f_test].module && (tempHits_B[a].channel-1)==tempHits_B[f_test].channel) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	double hitY=hitYPrelim;
-
-	
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-	rHits.trigNumberX=tempHits_B[f].triggerNumber;
-	rHits.trigNumberY=tempHits_B[f_test].triggerNumber;
-	rHits.timeAvg = (tempHits_B[f_test].triggerTime+tempHits_B[f].triggerTime)/2.0;
-	 primaryHits_B.push_back(rHits); 
-
-	 }
-    }
-  }
+  fHitPairing.Pair(tempHits_F, fModuletoModuleTimingCut, primaryHits_F); // Create 2D hits from the X and Y modules
+  fHitPairing.Pair(tempHits_B, fModuletoModuleTimingCut, primaryHits_B); // Same as above but for back CRT
+  CRT::FrontBackPairs(primaryHits_F, primaryHits_B, fFronttoBackTimingCut, fInTimePairs);
   vector < art::Ptr < recob::Track > > trackList;
   auto trackListHandle = event.getHandle < vector < recob::Track > >(fTrackModuleLabel);
   vector<art::Ptr<recob::PFParticle> > pfplist;
@@ -419,38 +317,11 @@ void CRT::TwoCRTMatchingProducer::produce(art::Event & event)
 
     if ((trackEndPositionZ_noSCE > 660 && trackStartPositionZ_noSCE < 50) || (trackStartPositionZ_noSCE > 660 && trackEndPositionZ_noSCE < 50)) {
 
-      double min_delta = DBL_MAX;
-      double best_XF = DBL_MAX;
-      double best_YF = DBL_MAX;
-      double best_ZF = DBL_MAX;
-      double best_XB = DBL_MAX;
-      double best_YB = DBL_MAX;
-      double best_ZB = DBL_MAX;
-      double best_dotProductCos = DBL_MAX;
-      double best_deltaXF = DBL_MAX;
-      double best_deltaYF = DBL_MAX;
-      double best_deltaXB = DBL_MAX;
-      double best_deltaYB = DBL_MAX;
-      double best_T=DBL_MAX;
-      int best_trigXF=0;
-      int best_trigYF=0;
-      int best_trigXB=0;
-      int best_trigYB=0;
-
-    for (unsigned int f = 0; f < primaryHits_F.size(); f++) {
-        for (unsigned int b = 0; b < primaryHits_B.size(); b++) {
-
-      double X1 = primaryHits_F[f].hitPositionX;
-      double Y1 = primaryHits_F[f].hitPositionY;
-      double Z1 = primaryHits_F[f].hitPositionZ;
-      double X2 = primaryHits_B[b].hitPositionX;
-      double Y2 = primaryHits_B[b].hitPositionY;
-      double Z2= primaryHits_B[b].hitPositionZ;
-     
-
-	        if (fabs(primaryHits_F[f].timeAvg-primaryHits_B[b].timeAvg)>fFronttoBackTimingCut) continue;
-		double t0=(primaryHits_F[f].timeAvg+primaryHits_B[b].timeAvg)/2.f;
-  		int tempId = 0;
+      fCandidates.clear();
+      for (const auto & inTime: fInTimePairs) { // Front and back hits close in time
+        const size_t f = inTime.first;
+        const size_t b = inTime.second;
+		double t0=(primaryHits_F.timeAvg[f]+primaryHits_B.timeAvg[b])/2.f;
 		double xOffset=0;
     
 
@@ -492,72 +363,34 @@ if(geom->PositionToTPCID(geo::Point_t(trackEndPositionX, trackEndPositionY, trac
 	}
     }
 
-
-
-
-
-	// Make metrics for a CRT pair to compare later
-	TVector3 trackStart(trackStartPositionX, trackStartPositionY, trackStartPositionZ);
-	TVector3 trackEnd(trackEndPositionX, trackEndPositionY, trackEndPositionZ);
-	TVector3 v1(X1,Y1,Z1);
-	TVector3 v2(X2, Y2, Z2);
-
-            TVector3 v4(trackStartPositionX,
-                        trackStartPositionY,
-                        trackStartPositionZ);
-            TVector3 v5(trackEndPositionX,
-                        trackEndPositionY,
-                        trackEndPositionZ);
-	TVector3 trackVector = (v5-v4).Unit();
-	TVector3 hitVector=(v2-v1).Unit();
-
-
-
-
-              double predictedHitPositionY1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
-              double predictedHitPositionY2 = (v2.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
-
-              double predictedHitPositionX1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
-              double predictedHitPositionX2 = (v2.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
-
-	double dotProductCos=trackVector*hitVector;
-
-        double deltaX1 = (predictedHitPositionX1-X1);
-        double deltaX2 = (predictedHitPositionX2-X2);
-
-        double deltaY1 = (predictedHitPositionY1-Y1);
-
-        double deltaY2 = (predictedHitPositionY2-Y2);
-
-
-
-      tempId++;
-
-     //iRecoTrack
-      if (min_delta > std::abs(deltaX1)+std::abs(deltaX2) + std::abs(deltaY1)+std::abs(deltaY2) ){
-
-	   min_delta=std::abs(deltaX1)+std::abs(deltaX2) + std::abs(deltaY1)+std::abs(deltaY2);
-            best_XF = X1;
-            best_YF = Y1;
-            best_ZF = Z1;
-            best_XB = X2;
-            best_YB = Y2;
-            best_ZB = Z2;
-            best_dotProductCos = dotProductCos;
-            best_deltaXF = deltaX1;
-            best_deltaYF = deltaY1;
-            best_deltaXB = deltaX2;
-            best_deltaYB = deltaY2;
-	    best_trigXF=primaryHits_F[f].trigNumberX;
-	    best_trigYF=primaryHits_F[f].trigNumberY;
-	    best_trigXB=primaryHits_B[b].trigNumberX;
-	    best_trigYB=primaryHits_B[b].trigNumberY;
-	    best_T = t0;
-	    if (!fMCCSwitch) best_T=(111.f+best_T)*20.f;
-	    // Added 111 tick CRT-CTB offset
-          }
-        }
+        fCandidates.Add(trackStartPositionX, trackStartPositionY, trackStartPositionZ,
+                        trackEndPositionX, trackEndPositionY, trackEndPositionZ, xOffset, f, b);
       }
+
+      // Make metrics for each CRT pair and keep the closest to the track
+      CRT::EvaluatePair(primaryHits_F, primaryHits_B, fCandidates);
+      const size_t best = CRT::BestCandidate(fCandidates);
+      if (best == CRT::TrackCandidates::none) continue;
+      const size_t f = fCandidates.hit1[best];
+      const size_t b = fCandidates.hit2[best];
+      double best_XF = primaryHits_F.x[f];
+      double best_YF = primaryHits_F.y[f];
+      double best_ZF = primaryHits_F.z[f];
+      double best_XB = primaryHits_B.x[b];
+      double best_YB = primaryHits_B.y[b];
+      double best_ZB = primaryHits_B.z[b];
+      double best_dotProductCos = fCandidates.dotProductCos[best];
+      double best_deltaXF = fCandidates.deltaX1[best];
+      double best_deltaYF = fCandidates.deltaY1[best];
+      double best_deltaXB = fCandidates.deltaX2[best];
+      double best_deltaYB = fCandidates.deltaY2[best];
+      int best_trigXF=primaryHits_F.trigNumberX[f];
+      int best_trigYF=primaryHits_F.trigNumberY[f];
+      int best_trigXB=primaryHits_B.trigNumberX[b];
+      int best_trigYB=primaryHits_B.trigNumberY[b];
+      double best_T = (primaryHits_F.timeAvg[f]+primaryHits_B.timeAvg[b])/2.f;
+      if (!fMCCSwitch) best_T=(111.f+best_T)*20.f;
+      // Added 111 tick CRT-CTB offset
       if (std::abs(best_dotProductCos)>0.99 && std::abs(best_deltaXF)+std::abs(best_deltaXB)<40 && std::abs(best_deltaYF)+std::abs(best_deltaYB)<40 ) {
         //std::cout<<"Found match with TPC*CRT "<<best_dotProductCos<<std::endl;
 
@@ -52,6 +52,9 @@
 
 //Local includes
 #include "duneprototypes/Protodune/singlephase/CRT/data/CRTTrigger.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitPairing.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitCollection.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/TrackMetrics.h" // For FrontBackPairs
 
 
 
@@ -104,7 +107,7 @@ class CRT::TwoCRTReco: public art::EDAnalyzer {
   void analyze(art::Event const & e) override;
   //bool filter(art::Event const & e) override;
 // Declare functions and variables for validation
-  bool moduleMatcher(int module1, int module2);
+  void beginRun(art::Run const & r) override;
   void beginJob() override;
   void endJob() override;
   void createPNG(TH1D * histo);
@@ -142,35 +145,7 @@ int moduletoCTB(int module2, int module1);
     double CRT_TOF;
     long long timeStamp;
     int eventNum;
-  typedef struct // Structures for arrays to move hits from raw to reco to validation
-  {
 
-    int channel;
-    int module;
-    int channelGeo;
-    int adc;
-    int triggerTime;
-    int triggerNumber;
-  }
-  tempHits;
-
-  typedef struct {
-    int tempId;	
-    int adcX;
-    int adcY;
-
-    double hitPositionX;
-    double hitPositionY;
-    double hitPositionZ;
-    double timeAvg;
-    int geoX;
-    int geoY;
-    int stripX;
-    int stripY;
-    int trigNumberX;
-    int trigNumberY;
-  }
-  recoHits;
 
 
 
@@ -200,11 +175,13 @@ int moduletoCTB(int module2, int module1);
 
 
 
-  std::vector < recoHits > primaryHits_F;
-  std::vector < recoHits > primaryHits_B;
+  CRT::HitCollection primaryHits_F;
+  CRT::HitCollection primaryHits_B;
 
-  std::vector < tempHits > tempHits_F;
-  std::vector < tempHits > tempHits_B;
+  std::vector < CRT::StripHit > tempHits_F;
+  std::vector < CRT::StripHit > tempHits_B;
+  CRT::HitPairing fHitPairing; // 2D hits from the strip hits
+  std::vector < std::pair < size_t, size_t > > fInTimePairs; // Front and back hits in time
   std::vector < tracksPair > allTracksPair;
 
 };
@@ -222,12 +199,10 @@ CRT::TwoCRTReco::TwoCRTReco(fhicl::ParameterSet
 
 
 
-// v6 Geo Channel Map
-bool CRT::TwoCRTReco::moduleMatcher(int module1, int module2) {
-  // Function checking if two hits could reasonably be matched into a 2D hit
-  if ((module1 == 6 && (module2 == 10 || module2 == 11)) || (module1 == 14 && (module2 == 10 || module2 == 11)) || (module1 == 19 && (module2 == 26 || module2 == 27)) || (module1 == 31 && (module2 == 26 || module2 == 27)) || (module1 == 7 && (module2 == 12 || module2 == 13)) || (module1 == 15 && (module2 == 12 || module2 == 13)) || (module1 == 18 && (module2 == 24 || module2 == 25)) || (module1 == 30 && (module2 == 24 || module2 == 25)) || (module1 == 1 && (module2 == 4 || module2 == 5)) || (module1 == 9 && (module2 == 4 || module2 == 5)) || (module1 == 16 && (module2 == 20 || module2 == 21)) || (module1 == 28 && (module2 == 20 || module2 == 21)) || (module1 == 0 && (module2 == 2 || module2 == 3)) || (module1 == 8 && (module2 == 2 || module2 == 3)) || (module1 == 17 && (module2 == 22 || module2 == 23)) || (module1 == 29 && (module2 == 22 || module2 == 23))) return 1;
-  else return 0;
-
+void CRT::TwoCRTReco::beginRun(art::Run const & r) {
+  // Strip centers for making 2D hits and sorting hits into front and back
+  art::ServiceHandle < geo::Geometry > geom;
+  fHitPairing.SetStripCenters(*geom);
 }
 
 
@@ -403,7 +378,7 @@ for (size_t k=0; k<HLTriggers.size(); ++k)
 	//cout<<hits.size()<<','<<hit.ADC()<<endl;
       if (hit.ADC() > fADCThreshold) { // Keep if they are above threshold
 
-        tempHits tHits;
+        CRT::StripHit tHits;
 	if (!fMCCSwitch){
 
         tHits.module = trigger.Channel(); // Values to add to array
@@ -420,10 +395,8 @@ for (size_t k=0; k<HLTriggers.size(); ++k)
 	 //cout<<trigger.Channel()<<','<<hit.Channel()<<','<<hit.ADC()<<endl;
         nHits++;
 	tHits.triggerNumber=trigID;
-        const auto & trigGeo = geom -> AuxDet(trigger.Channel()); // Get geo  
-        const auto & csens = trigGeo.SensitiveVolume(hit.Channel());
-        const auto center = csens.GetCenter();
-        if (center.Z() < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
+        const auto & center = fHitPairing.StripCenter(trigger.Channel(), hit.Channel()); // Get geo
+        if (center.z < 100) tempHits_F.push_back(tHits); // Sort F/B from Z
         else tempHits_B.push_back(tHits);
         hitID++;
       }
@@ -434,107 +407,8 @@ for (size_t k=0; k<HLTriggers.size(); ++k)
   cout << "Hits compiled for event: " << nEvents << endl;
   cout << "Number of Hits above Threshold:  " << hitID << endl;
 
-  for (unsigned int f = 0; f < tempHits_F.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_F.size(); f_test++) {
-       if (fabs(tempHits_F[f_test].triggerTime-tempHits_F[f].triggerTime)>fModuletoModuleTimingCut) continue;
-      const auto & trigGeo = geom -> AuxDet(tempHits_F[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_F[f_test].module);
-
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_F[f].channel);
-      const auto hit1Center = hit1Geo.GetCenter();
-      // Create 2D hits from geo of the Y and X modules
-       const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_F[f_test].channel);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_F[f_test].module, tempHits_F[f].module);
-      if (moduleMatched) {
-        // Get the center of the hits (CRT_Res=2.5 cm)
-        double hitX = hit1Center.X();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f].module && (tempHits_F[a].channel-1)==tempHits_F[f].channel) hitX=hit1Center.X()+1.25;
-	}
-	double hitYPrelim=hit2Center.Y();
-	for (unsigned int a = 0; a < tempHits_F.size(); a++)
-	{
-	if(tempHits_F[a].module==tempHits_F[f_test].module && (tempHits_F[a].channel-1)==tempHits_F[f_test].channel) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	
-
-	
-	double hitY=hitYPrelim;
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-	rHits.geoX=tempHits_F[f].module;
-	rHits.geoY=tempHits_F[f_test].module;
-	rHits.stripX=tempHits_F[f].channel;
-	rHits.stripY=tempHits_F[f_test].channel;
-
-	rHits.adcX=tempHits_F[f].adc;
-	rHits.adcY=tempHits_F[f_test].adc;
-	rHits.trigNumberX=tempHits_F[f].triggerNumber;
-	rHits.trigNumberY=tempHits_F[f_test].triggerNumber;
-	rHits.timeAvg = (tempHits_F[f_test].triggerTime+tempHits_F[f].triggerTime)/2.0;
-       primaryHits_F.push_back(rHits); // Add array
-    }
-    }
-  }
-  for (unsigned int f = 0; f < tempHits_B.size(); f++) {
-    for (unsigned int f_test = 0; f_test < tempHits_B.size(); f_test++) { // Same as above but for back CRT
-       if (fabs(tempHits_B[f_test].triggerTime-tempHits_B[f].triggerTime)>fModuletoModuleTimingCut) continue;
-
-      const auto & trigGeo = geom -> AuxDet(tempHits_B[f].module);
-      const auto & trigGeo2 = geom -> AuxDet(tempHits_B[f_test].module);
-      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits_B[f].channel);
-      const auto hit1Center = hit1Geo.GetCenter();
-
-      const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits_B[f_test].channel);
-      const auto hit2Center = hit2Geo.GetCenter();
-      bool moduleMatched;
-      moduleMatched=moduleMatcher(tempHits_B[f_test].module, tempHits_B[f].module);
-
-      if (moduleMatched) {
-        double hitX = hit1Center.X();
-	
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f].module && (tempHits_B[a].channel-1)==tempHits_B[f].channel) hitX=hit1Center.X()+1.25;
-	}
-	
-        double hitYPrelim = hit2Center.Y();
-	
-	for (unsigned int a = 0; a < tempHits_B.size(); a++)
-	{
-	if(tempHits_B[a].module==tempHits_B[f_test].module && (tempHits_B[a].channel-1)==tempHits_B[f_test].channel) hitYPrelim=hit2Center.Y()+1.25;
-	}
-	double hitY=hitYPrelim;
-
-	
-        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
-
-        recoHits rHits;
-        rHits.hitPositionX = hitX;
-        rHits.hitPositionY = hitY;
-        rHits.hitPositionZ = hitZ;
-	rHits.geoX=tempHits_B[f].module;
-	rHits.geoY=tempHits_B[f_test].module;
-	rHits.adcX=tempHits_B[f].adc;
-	rHits.adcY=tempHits_B[f_test].adc;
-	rHits.stripX=tempHits_B[f].channel;
-	rHits.stripY=tempHits_B[f_test].channel;
-	rHits.trigNumberX=tempHits_B[f].triggerNumber;
-	rHits.trigNumberY=tempHits_B[f_test].triggerNumber;
-	rHits.timeAvg = (tempHits_B[f_test].triggerTime+tempHits_B[f].triggerTime)/2.0;
-	 primaryHits_B.push_back(rHits); 
-
-	 }
-    }
-  }
+  fHitPairing.Pair(tempHits_F, fModuletoModuleTimingCut, primaryHits_F); // Create 2D hits from the X and Y modules
+  fHitPairing.Pair(tempHits_B, fModuletoModuleTimingCut, primaryHits_B); // Same as above but for back CRT
 
 	std::cout<<"Number of Hits: "<<primaryHits_F.size()<<','<<primaryHits_B.size()<<std::endl;
 
@@ -546,41 +420,41 @@ for (size_t k=0; k<HLTriggers.size(); ++k)
     adcY_B=0;
     int crtPixel0=-1;
     int crtPixel1=-1;
-    for (unsigned int f = 0; f < primaryHits_F.size(); f++) {
+    CRT::FrontBackPairs(primaryHits_F, primaryHits_B, fFronttoBackTimingCut, fInTimePairs);
+    for (const auto & inTime: fInTimePairs) { // Front and back hits close in time
       if (pixel0==-1 || pixel1==-1) break; 
-      for (unsigned int b = 0; b < primaryHits_B.size(); b++) {
-      if (fabs(primaryHits_F[f].timeAvg-primaryHits_B[b].timeAvg)>fFronttoBackTimingCut) continue;
-      crtPixel0=moduletoCTB(primaryHits_F[f].geoX,primaryHits_F[f].geoY);
-      crtPixel1=moduletoCTB(primaryHits_B[b].geoX, primaryHits_B[b].geoY);
+      const size_t f = inTime.first;
+      const size_t b = inTime.second;
+      crtPixel0=moduletoCTB(primaryHits_F.moduleX[f],primaryHits_F.moduleY[f]);
+      crtPixel1=moduletoCTB(primaryHits_B.moduleX[b], primaryHits_B.moduleY[b]);
       if (crtPixel0!=pixel0 || crtPixel1!=pixel1) continue;	
       //std::cout<<"HEY"<<std::endl;
-      if (adcX_F<primaryHits_F[f].adcX && adcY_F<primaryHits_F[f].adcY && adcX_B<primaryHits_B[b].adcX  && adcY_B<primaryHits_B[b].adcY){
-      X_F = primaryHits_F[f].hitPositionX;
-      Y_F = primaryHits_F[f].hitPositionY;
-      Z_F = primaryHits_F[f].hitPositionZ;
-      X_B = primaryHits_B[b].hitPositionX;
-      Y_B = primaryHits_B[b].hitPositionY;
-      Z_B= primaryHits_B[b].hitPositionZ;
-      adcX_F=primaryHits_F[f].adcX;
-      adcX_B=primaryHits_B[b].adcX;
-      adcY_F=primaryHits_F[f].adcY;
-      adcY_B=primaryHits_B[b].adcY;
-      moduleX_F=primaryHits_F[f].geoX;
-      moduleY_F=primaryHits_F[f].geoY;
-      moduleX_B=primaryHits_B[b].geoX;
-      moduleY_B=primaryHits_B[b].geoY;
-
-      stripX_F=primaryHits_F[f].stripX;
-      stripY_F=primaryHits_F[f].stripY;
-      stripX_B=primaryHits_B[b].stripX;
-      stripY_B=primaryHits_B[b].stripY;
+      if (adcX_F<primaryHits_F.adcX[f] && adcY_F<primaryHits_F.adcY[f] && adcX_B<primaryHits_B.adcX[b]  && adcY_B<primaryHits_B.adcY[b]){
+      X_F = primaryHits_F.x[f];
+      Y_F = primaryHits_F.y[f];
+      Z_F = primaryHits_F.z[f];
+      X_B = primaryHits_B.x[b];
+      Y_B = primaryHits_B.y[b];
+      Z_B= primaryHits_B.z[b];
+      adcX_F=primaryHits_F.adcX[f];
+      adcX_B=primaryHits_B.adcX[b];
+      adcY_F=primaryHits_F.adcY[f];
+      adcY_B=primaryHits_B.adcY[b];
+      moduleX_F=primaryHits_F.moduleX[f];
+      moduleY_F=primaryHits_F.moduleY[f];
+      moduleX_B=primaryHits_B.moduleX[b];
+      moduleY_B=primaryHits_B.moduleY[b];
+
+      stripX_F=primaryHits_F.stripX[f];
+      stripY_F=primaryHits_F.stripY[f];
+      stripX_B=primaryHits_B.stripX[b];
+      stripY_B=primaryHits_B.stripY[b];
       //std::cout<<"FOUND A COMBO"<<std::endl;
-      measuredT0=(primaryHits_F[f].timeAvg+primaryHits_B[b].timeAvg)/2.f;
-	CRT_TOF=(primaryHits_F[f].timeAvg-primaryHits_B[b].timeAvg);
+      measuredT0=(primaryHits_F.timeAvg[f]+primaryHits_B.timeAvg[b])/2.f;
+	CRT_TOF=(primaryHits_F.timeAvg[f]-primaryHits_B.timeAvg[b]);
 	tempId++;
 
 	}	
-        }
       }
     if (adcX_F>0) fCRTTree->Fill();
     // Filter return if (adcX_F==0) return false;
@@ -0,0 +1,62 @@
+//File: HitCollection.cpp
+//Brief: 2D CRT hits in structure-of-arrays layout.  See HitCollection.h.
+
+#include "HitCollection.h" //Header
+#include "HitPairing.h"
+
+namespace CRT
+{
+  void HitCollection::clear()
+  {
+    x.clear();
+    y.clear();
+    z.clear();
+    timeAvg.clear();
+    moduleX.clear();
+    moduleY.clear();
+    stripX.clear();
+    stripY.clear();
+    adcX.clear();
+    adcY.clear();
+    trigNumberX.clear();
+    trigNumberY.clear();
+  }
+
+  void HitCollection::reserve(const size_t n)
+  {
+    x.reserve(n);
+    y.reserve(n);
+    z.reserve(n);
+    timeAvg.reserve(n);
+    moduleX.reserve(n);
+    moduleY.reserve(n);
+    stripX.reserve(n);
+    stripY.reserve(n);
+    adcX.reserve(n);
+    adcY.reserve(n);
+    trigNumberX.reserve(n);
+    trigNumberY.reserve(n);
+  }
+
+  void HitCollection::Add(const std::vector<StripHit>& hits, const std::vector<PairedHit>& pairs)
+  {
+    reserve(size() + pairs.size());
+    for(const PairedHit& pair: pairs)
+    {
+      const StripHit& hitX = hits[pair.hitX];
+      const StripHit& hitY = hits[pair.hitY];
+      x.push_back(pair.x);
+      y.push_back(pair.y);
+      z.push_back(pair.z);
+      timeAvg.push_back(pair.timeAvg);
+      moduleX.push_back(hitX.module);
+      moduleY.push_back(hitY.module);
+      stripX.push_back(hitX.channel);
+      stripY.push_back(hitY.channel);
+      adcX.push_back(hitX.adc);
+      adcY.push_back(hitY.adc);
+      trigNumberX.push_back(hitX.triggerNumber);
+      trigNumberY.push_back(hitY.triggerNumber);
+    }
+  }
+}
@@ -0,0 +1,46 @@
+//File: HitCollection.h
+//Brief: The 2D hits of one CRT (front or back) in structure-of-arrays layout,
+//       one vector per quantity, so that metrics over all hits run over
+//       contiguous arrays.  Holds what the recoHits structs of the CRT
+//       matching modules held.  X quantities come from the strip hit in the
+//       X module and Y quantities from the strip hit in the Y module.
+//       Doesn't depend on the offline framework.
+
+#ifndef CRT_HITCOLLECTION_H
+#define CRT_HITCOLLECTION_H
+
+//c++ includes
+#include <cstddef> //For size_t
+#include <vector>
+
+namespace CRT
+{
+  struct StripHit;
+  struct PairedHit;
+
+  struct HitCollection
+  {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+    std::vector<double> timeAvg;
+    std::vector<int> moduleX;
+    std::vector<int> moduleY;
+    std::vector<int> stripX;
+    std::vector<int> stripY;
+    std::vector<int> adcX;
+    std::vector<int> adcY;
+    std::vector<int> trigNumberX; //Index of the trigger in the event
+    std::vector<int> trigNumberY;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    void clear();
+    void reserve(const size_t n);
+
+    //Append the 2D hits made from the strip hits hits by HitPairing::Pair.
+    void Add(const std::vector<StripHit>& hits, const std::vector<PairedHit>& pairs);
+  };
+}
+
+#endif //CRT_HITCOLLECTION_H
@@ -0,0 +1,138 @@
+//File: HitPairing.cpp
+//Brief: Pairs CRT strip hits into 2D hits.  See HitPairing.h.
+
+#include "HitPairing.h" //Header
+#include "HitCollection.h"
+
+//c++ includes
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+  //Y module and the two X modules it overlaps
+  const int overlaps[][3] = { {6, 10, 11}, {14, 10, 11}, {19, 26, 27}, {31, 26, 27},
+                              {7, 12, 13}, {15, 12, 13}, {18, 24, 25}, {30, 24, 25},
+                              {1, 4, 5}, {9, 4, 5}, {16, 20, 21}, {28, 20, 21},
+                              {0, 2, 3}, {8, 2, 3}, {17, 22, 23}, {29, 22, 23} };
+}
+
+namespace CRT
+{
+  void HitPairing::ClearStripCenters()
+  {
+    fCenters.clear();
+    fPartners.clear();
+  }
+
+  void HitPairing::SetStripCenter(const size_t module, const size_t strip, const Point& center)
+  {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    if(module >= fCenters.size()) fCenters.resize(module + 1);
+    if(strip >= fCenters[module].size()) fCenters[module].resize(strip + 1, Point{nan, nan, nan});
+    fCenters[module][strip] = center;
+    fPartners.clear();
+  }
+
+  const HitPairing::Point& HitPairing::StripCenter(const int module, const int strip) const
+  {
+    if(module < 0 || strip < 0) throw std::out_of_range("CRT::HitPairing: negative module or strip");
+    return fCenters.at(module).at(strip);
+  }
+
+  bool HitPairing::ModulesOverlap(const int moduleY, const int moduleX)
+  {
+    for(const auto& ovl: overlaps)
+    {
+      if(ovl[0] == moduleY && (ovl[1] == moduleX || ovl[2] == moduleX)) return true;
+    }
+    return false;
+  }
+
+  void HitPairing::Pair(const std::vector<StripHit>& hits, const int timingCut, std::vector<PairedHit>& pairs)
+  {
+    pairs.clear();
+    const size_t nmod = fCenters.size();
+    if(fPartners.size() != nmod)
+    {
+      fPartners.assign(nmod, {});
+      for(size_t moduleX = 0; moduleX < nmod; ++moduleX)
+      {
+        for(size_t moduleY = 0; moduleY < nmod; ++moduleY)
+        {
+          if(ModulesOverlap(moduleY, moduleX)) fPartners[moduleX].push_back(moduleY);
+        }
+      }
+    }
+
+    //Index the hits by module and strip
+    fByModule.resize(nmod);
+    fStripHit.resize(nmod);
+    for(size_t module = 0; module < nmod; ++module)
+    {
+      fByModule[module].clear();
+      fStripHit[module].assign(fCenters[module].size(), false);
+    }
+    for(size_t ihit = 0; ihit < hits.size(); ++ihit)
+    {
+      const StripHit& hit = hits[ihit];
+      StripCenter(hit.module, hit.channel); //Throws for a strip outside the geometry
+      fByModule[hit.module].push_back(ihit);
+      fStripHit[hit.module][hit.channel] = true;
+    }
+    for(auto& byModule: fByModule)
+    {
+      std::stable_sort(byModule.begin(), byModule.end(),
+                       [&hits](const size_t lhs, const size_t rhs) { return hits[lhs].triggerTime < hits[rhs].triggerTime; });
+    }
+
+    for(size_t ix = 0; ix < hits.size(); ++ix)
+    {
+      const StripHit& hitX = hits[ix];
+      const int64_t tmin = int64_t(hitX.triggerTime) - timingCut;
+      const int64_t tmax = int64_t(hitX.triggerTime) + timingCut;
+      fCandidates.clear();
+      for(const int moduleY: fPartners[hitX.module])
+      {
+        const auto& byModule = fByModule[moduleY];
+        auto it = std::lower_bound(byModule.begin(), byModule.end(), tmin,
+                                   [&hits](const size_t ihit, const int64_t t) { return hits[ihit].triggerTime < t; });
+        for(; it != byModule.end() && hits[*it].triggerTime <= tmax; ++it) fCandidates.push_back(*it);
+      }
+      if(fCandidates.empty()) continue;
+      std::sort(fCandidates.begin(), fCandidates.end());
+
+      const Point& centerX = fCenters[hitX.module][hitX.channel];
+      const auto& stripsX = fStripHit[hitX.module];
+      const size_t nextX = hitX.channel + 1;
+      double x = centerX.x;
+      if(nextX < stripsX.size() && stripsX[nextX]) x = centerX.x + 1.25;
+      for(const size_t iy: fCandidates)
+      {
+        const StripHit& hitY = hits[iy];
+        const Point& centerY = fCenters[hitY.module][hitY.channel];
+        const auto& stripsY = fStripHit[hitY.module];
+        const size_t nextY = hitY.channel + 1;
+        double y = centerY.y;
+        if(nextY < stripsY.size() && stripsY[nextY]) y = centerY.y + 1.25;
+        PairedHit pair;
+        pair.x = x;
+        pair.y = y;
+        pair.z = (centerX.z + centerY.z) / 2.f;
+        pair.timeAvg = (hitY.triggerTime + hitX.triggerTime) / 2.0;
+        pair.hitX = ix;
+        pair.hitY = iy;
+        pairs.push_back(pair);
+      }
+    }
+  }
+
+  void HitPairing::Pair(const std::vector<StripHit>& hits, const int timingCut, HitCollection& pairs)
+  {
+    Pair(hits, timingCut, fPairs);
+    pairs.clear();
+    pairs.Add(hits, fPairs);
+  }
+}
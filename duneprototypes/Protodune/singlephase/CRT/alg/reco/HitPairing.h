@@ -0,0 +1,109 @@
+//File: HitPairing.h
+//Brief: Forms 2D CRT hits from pairs of strip hits in overlapping modules
+//       of one CRT (front or back), the way the CRT matching modules do.
+//       A hit in an X module is paired with every hit within the timing
+//       cut in a Y module overlapping it.  X (Y) is the center of the X (Y)
+//       strip, moved by half a strip (1.25 cm) if the next strip of the
+//       module also has a hit, and Z is the average of the two strip centers.
+//
+//       The strip centers are set once per run from the detector geometry
+//       instead of being looked up for every pair.  Hits are sorted by time
+//       in each module and the partners of a hit are found in a time window
+//       of the modules overlapping it.  A bitmap of the hit strips of each
+//       module answers the next-strip question.  The 2D hits come out in the
+//       order of the double loop the modules used: by X hit, then by Y hit.
+//       They can also be written straight into a CRT::HitCollection.
+//       Doesn't depend on the offline framework.
+
+#ifndef CRT_HITPAIRING_H
+#define CRT_HITPAIRING_H
+
+//c++ includes
+#include <cstddef> //For size_t
+#include <vector>
+
+namespace CRT
+{
+  struct HitCollection;
+
+  //A strip hit above threshold.  module and channel are those of the
+  //CRT::Trigger and CRT::Hit it came from.
+  struct StripHit
+  {
+    int channel;
+    int module;
+    int adc;
+    int triggerTime;
+    int triggerNumber; //Index of the trigger in the event
+  };
+
+  //A 2D hit.  hitX and hitY are the indices of the strip hits in the
+  //list that was paired.
+  struct PairedHit
+  {
+    double x;
+    double y;
+    double z;
+    double timeAvg;
+    size_t hitX;
+    size_t hitY;
+  };
+
+  class HitPairing
+  {
+    public:
+      struct Point
+      {
+        double x;
+        double y;
+        double z;
+      };
+
+      //Strip centers of all modules, from a geometry with the AuxDet
+      //interface of geo::GeometryCore.  Module numbers are AuxDet numbers.
+      template <class GEOMETRY>
+      void SetStripCenters(const GEOMETRY& geom);
+
+      void ClearStripCenters();
+      void SetStripCenter(const size_t module, const size_t strip, const Point& center);
+
+      //Throws std::out_of_range for a strip that was not set.
+      const Point& StripCenter(const int module, const int strip) const;
+      size_t NModules() const { return fCenters.size(); }
+
+      //Whether hits in Y module moduleY and X module moduleX can be
+      //paired into a 2D hit (v6 geometry channel map).
+      static bool ModulesOverlap(const int moduleY, const int moduleX);
+
+      //Pair the hits of one CRT, replacing the contents of pairs.
+      void Pair(const std::vector<StripHit>& hits, const int timingCut, std::vector<PairedHit>& pairs);
+      void Pair(const std::vector<StripHit>& hits, const int timingCut, HitCollection& pairs);
+
+    private:
+      std::vector<std::vector<Point>> fCenters; //By module and strip
+      std::vector<std::vector<int>> fPartners; //Y modules overlapping each X module
+
+      //Per-event work space
+      std::vector<std::vector<size_t>> fByModule; //Hit indices by module, sorted by time
+      std::vector<std::vector<bool>> fStripHit; //Strips with hits by module
+      std::vector<size_t> fCandidates;
+      std::vector<PairedHit> fPairs;
+  };
+
+  template <class GEOMETRY>
+  void HitPairing::SetStripCenters(const GEOMETRY& geom)
+  {
+    ClearStripCenters();
+    for(size_t module = 0; module < geom.NAuxDets(); ++module)
+    {
+      const auto& det = geom.AuxDet(module);
+      for(size_t strip = 0; strip < det.NSensitiveVolume(); ++strip)
+      {
+        const auto center = det.SensitiveVolume(strip).GetCenter();
+        SetStripCenter(module, strip, Point{center.X(), center.Y(), center.Z()});
+      }
+    }
+  }
+}
+
+#endif //CRT_HITPAIRING_H
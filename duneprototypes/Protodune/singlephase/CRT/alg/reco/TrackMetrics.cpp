@@ -0,0 +1,214 @@
+//File: TrackMetrics.cpp
+//Brief: Track to CRT hit matching metrics.  See TrackMetrics.h.
+
+#include "TrackMetrics.h" //Header
+#include "HitCollection.h"
+
+//c++ includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+  //Metrics of candidates 0 .. n-1 from arrays of track ends and hit
+  //positions.  For one hit, point 2 is the track start and there are no
+  //deltas at it.  Written after the TVector3 code of the modules:
+  //Unit() scales by 1/sqrt(Mag2()) if Mag2() > 0, and operator* is the dot
+  //product summed in x, y, z order.  Adding DBL_MIN to Mag2() instead of
+  //testing it keeps the loop free of branches: a zero vector stays zero and
+  //the sum is Mag2() itself for any length above 1e-146 cm.  The directory
+  //is built with -fno-math-errno so that sqrt has no error branch either.
+  //The output arrays are distinct from each other and from the inputs;
+  //__restrict__ saves the compiler from checking that at run time.  The
+  //inputs may alias each other (point 2 is the track start for one hit).
+  template <bool TWOHITS>
+  void metrics(const size_t n,
+               const double* __restrict__ sx, const double* __restrict__ sy, const double* __restrict__ sz,
+               const double* __restrict__ ex, const double* __restrict__ ey, const double* __restrict__ ez,
+               const double* __restrict__ x1, const double* __restrict__ y1, const double* __restrict__ z1,
+               const double* __restrict__ x2, const double* __restrict__ y2, const double* __restrict__ z2,
+               double* __restrict__ px1, double* __restrict__ py1, double* __restrict__ dx1, double* __restrict__ dy1,
+               double* __restrict__ dx2, double* __restrict__ dy2, double* __restrict__ cosine, double* __restrict__ sum)
+  {
+    for(size_t i = 0; i < n; ++i)
+    {
+      const double tx = ex[i] - sx[i];
+      const double ty = ey[i] - sy[i];
+      const double tz = ez[i] - sz[i];
+      const double tmag2 = tx*tx + ty*ty + tz*tz;
+      const double tnorm = 1.0/std::sqrt(tmag2 + DBL_MIN);
+      const double hx = x2[i] - x1[i];
+      const double hy = y2[i] - y1[i];
+      const double hz = z2[i] - z1[i];
+      const double hmag2 = hx*hx + hy*hy + hz*hz;
+      const double hnorm = 1.0/std::sqrt(hmag2 + DBL_MIN);
+      cosine[i] = (tx*tnorm)*(hx*hnorm) + (ty*tnorm)*(hy*hnorm) + (tz*tnorm)*(hz*hnorm);
+
+      const double dz = sz[i] - ez[i];
+      const double predX1 = (z1[i] - ez[i])/dz*(sx[i] - ex[i]) + ex[i];
+      const double predY1 = (z1[i] - ez[i])/dz*(sy[i] - ey[i]) + ey[i];
+      px1[i] = predX1;
+      py1[i] = predY1;
+      dx1[i] = predX1 - x1[i];
+      dy1[i] = predY1 - y1[i];
+      if(TWOHITS)
+      {
+        const double predX2 = (z2[i] - ez[i])/dz*(sx[i] - ex[i]) + ex[i];
+        const double predY2 = (z2[i] - ez[i])/dz*(sy[i] - ey[i]) + ey[i];
+        dx2[i] = predX2 - x2[i];
+        dy2[i] = predY2 - y2[i];
+        sum[i] = std::abs(dx1[i]) + std::abs(dx2[i]) + std::abs(dy1[i]) + std::abs(dy2[i]);
+      }
+      else
+      {
+        dx2[i] = 0;
+        dy2[i] = 0;
+        sum[i] = std::abs(dx1[i]) + std::abs(dy1[i]);
+      }
+    }
+  }
+
+  void gather(const CRT::HitCollection& hits, const std::vector<size_t>& index,
+              std::vector<double>& x, std::vector<double>& y, std::vector<double>& z)
+  {
+    const size_t n = index.size();
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+      const size_t ihit = index[i];
+      x[i] = hits.x[ihit];
+      y[i] = hits.y[ihit];
+      z[i] = hits.z[ihit];
+    }
+  }
+
+  void resizeOutput(CRT::TrackCandidates& cands)
+  {
+    const size_t n = cands.size();
+    cands.predictedX1.resize(n);
+    cands.predictedY1.resize(n);
+    cands.deltaX1.resize(n);
+    cands.deltaY1.resize(n);
+    cands.deltaX2.resize(n);
+    cands.deltaY2.resize(n);
+    cands.dotProductCos.resize(n);
+    cands.deltaSum.resize(n);
+  }
+}
+
+namespace CRT
+{
+  void TrackCandidates::clear()
+  {
+    startX.clear();
+    startY.clear();
+    startZ.clear();
+    endX.clear();
+    endY.clear();
+    endZ.clear();
+    xOffset.clear();
+    hit1.clear();
+    hit2.clear();
+    predictedX1.clear();
+    predictedY1.clear();
+    deltaX1.clear();
+    deltaY1.clear();
+    deltaX2.clear();
+    deltaY2.clear();
+    dotProductCos.clear();
+    deltaSum.clear();
+  }
+
+  size_t TrackCandidates::Add(const double xStart, const double yStart, const double zStart,
+                              const double xEnd, const double yEnd, const double zEnd,
+                              const double offset, const size_t ihit1, const size_t ihit2)
+  {
+    startX.push_back(xStart);
+    startY.push_back(yStart);
+    startZ.push_back(zStart);
+    endX.push_back(xEnd);
+    endY.push_back(yEnd);
+    endZ.push_back(zEnd);
+    xOffset.push_back(offset);
+    hit1.push_back(ihit1);
+    hit2.push_back(ihit2);
+    return startX.size() - 1;
+  }
+
+  void EvaluateSingle(const HitCollection& hits, TrackCandidates& cands)
+  {
+    gather(hits, cands.hit1, cands.hitX1, cands.hitY1, cands.hitZ1);
+    resizeOutput(cands);
+    metrics<false>(cands.size(),
+                   cands.startX.data(), cands.startY.data(), cands.startZ.data(),
+                   cands.endX.data(), cands.endY.data(), cands.endZ.data(),
+                   cands.hitX1.data(), cands.hitY1.data(), cands.hitZ1.data(),
+                   cands.startX.data(), cands.startY.data(), cands.startZ.data(),
+                   cands.predictedX1.data(), cands.predictedY1.data(),
+                   cands.deltaX1.data(), cands.deltaY1.data(),
+                   cands.deltaX2.data(), cands.deltaY2.data(),
+                   cands.dotProductCos.data(), cands.deltaSum.data());
+  }
+
+  void EvaluatePair(const HitCollection& front, const HitCollection& back, TrackCandidates& cands)
+  {
+    gather(front, cands.hit1, cands.hitX1, cands.hitY1, cands.hitZ1);
+    gather(back, cands.hit2, cands.hitX2, cands.hitY2, cands.hitZ2);
+    resizeOutput(cands);
+    metrics<true>(cands.size(),
+                  cands.startX.data(), cands.startY.data(), cands.startZ.data(),
+                  cands.endX.data(), cands.endY.data(), cands.endZ.data(),
+                  cands.hitX1.data(), cands.hitY1.data(), cands.hitZ1.data(),
+                  cands.hitX2.data(), cands.hitY2.data(), cands.hitZ2.data(),
+                  cands.predictedX1.data(), cands.predictedY1.data(),
+                  cands.deltaX1.data(), cands.deltaY1.data(),
+                  cands.deltaX2.data(), cands.deltaY2.data(),
+                  cands.dotProductCos.data(), cands.deltaSum.data());
+  }
+
+  void FrontBackPairs(const HitCollection& front, const HitCollection& back, const double timingCut,
+                      std::vector<std::pair<size_t, size_t>>& pairs)
+  {
+    pairs.clear();
+    std::vector<size_t> byTime(back.size());
+    for(size_t ib = 0; ib < byTime.size(); ++ib) byTime[ib] = ib;
+    std::sort(byTime.begin(), byTime.end(),
+              [&back](const size_t lhs, const size_t rhs) { return back.timeAvg[lhs] < back.timeAvg[rhs]; });
+    std::vector<size_t> inTime;
+    for(size_t f = 0; f < front.size(); ++f)
+    {
+      //The window is a tick wider than the cut and the cut itself is
+      //applied as the modules do, so rounding can't change the pairs.
+      const double t = front.timeAvg[f];
+      auto it = std::lower_bound(byTime.begin(), byTime.end(), t - timingCut - 1,
+                                 [&back](const size_t ib, const double tmin) { return back.timeAvg[ib] < tmin; });
+      inTime.clear();
+      for(; it != byTime.end() && back.timeAvg[*it] <= t + timingCut + 1; ++it)
+      {
+        if(std::fabs(t - back.timeAvg[*it]) <= timingCut) inTime.push_back(*it);
+      }
+      std::sort(inTime.begin(), inTime.end());
+      for(const size_t b: inTime) pairs.emplace_back(f, b);
+    }
+  }
+
+  size_t BestCandidate(const TrackCandidates& cands, const Window* window)
+  {
+    size_t best = TrackCandidates::none;
+    double minDelta = DBL_MAX;
+    for(size_t i = 0; i < cands.deltaSum.size(); ++i)
+    {
+      if(window != nullptr && (cands.predictedX1[i] < window->xMin || cands.predictedX1[i] > window->xMax ||
+                               cands.predictedY1[i] < window->yMin || cands.predictedY1[i] > window->yMax)) continue;
+      if(minDelta > cands.deltaSum[i])
+      {
+        minDelta = cands.deltaSum[i];
+        best = i;
+      }
+    }
+    return best;
+  }
+}
@@ -0,0 +1,110 @@
+//File: TrackMetrics.h
+//Brief: Displacement and angle metrics for matching TPC tracks to CRT 2D
+//       hits, as the CRT matching modules compute them.  A candidate is a
+//       track, with the ends it has after the modules' t0 and space charge
+//       corrections for that candidate, and either one CRT hit (single CRT
+//       matching) or a front and a back CRT hit (two CRT matching).
+//
+//       For each candidate:
+//         predictedX1, predictedY1  track line extended to the Z of hit 1
+//         deltaX1, deltaY1          predicted minus hit 1 position
+//         deltaX2, deltaY2          the same at hit 2 (zero for one hit)
+//         dotProductCos             cosine between the track direction and
+//                                   the direction from hit 1 to the track
+//                                   start (one hit) or to hit 2 (two hits)
+//         deltaSum                  |deltaX1| + |deltaX2| + |deltaY1| + |deltaY2|
+//       with the same arithmetic as the TVector3 code the modules used, so
+//       the values are bit for bit those of the modules.
+//
+//       The candidates are kept in structure-of-arrays layout.  Evaluate
+//       gathers the hit positions of all candidates into contiguous arrays
+//       and then computes the metrics of all of them in one loop without
+//       branches that the compiler can vectorize.
+//
+//       FrontBackPairs lists the front and back hits close enough in time
+//       to be candidates for two CRT matching, once per event.
+//       Doesn't depend on the offline framework.
+
+#ifndef CRT_TRACKMETRICS_H
+#define CRT_TRACKMETRICS_H
+
+//c++ includes
+#include <cstddef> //For size_t
+#include <utility>
+#include <vector>
+
+namespace CRT
+{
+  struct HitCollection;
+
+  struct TrackCandidates
+  {
+    static constexpr size_t none = size_t(-1);
+
+    //Filled by the caller.  The track start is its upstream (low Z) end.
+    std::vector<double> startX;
+    std::vector<double> startY;
+    std::vector<double> startZ;
+    std::vector<double> endX;
+    std::vector<double> endY;
+    std::vector<double> endZ;
+    std::vector<double> xOffset; //Drift correction applied to X, for bookkeeping
+    std::vector<size_t> hit1; //Index of the hit (front hit for two CRTs)
+    std::vector<size_t> hit2; //Index of the back hit or none
+
+    //Filled by Evaluate
+    std::vector<double> predictedX1;
+    std::vector<double> predictedY1;
+    std::vector<double> deltaX1;
+    std::vector<double> deltaY1;
+    std::vector<double> deltaX2;
+    std::vector<double> deltaY2;
+    std::vector<double> dotProductCos;
+    std::vector<double> deltaSum;
+
+    size_t size() const { return startX.size(); }
+    bool empty() const { return startX.empty(); }
+    void clear();
+
+    //Returns the index of the new candidate
+    size_t Add(const double xStart, const double yStart, const double zStart,
+               const double xEnd, const double yEnd, const double zEnd,
+               const double offset, const size_t ihit1, const size_t ihit2 = none);
+
+    //Hit positions gathered by Evaluate
+    std::vector<double> hitX1;
+    std::vector<double> hitY1;
+    std::vector<double> hitZ1;
+    std::vector<double> hitX2;
+    std::vector<double> hitY2;
+    std::vector<double> hitZ2;
+  };
+
+  //Allowed range of the predicted position at hit 1.  Limits are inclusive.
+  struct Window
+  {
+    double xMin;
+    double xMax;
+    double yMin;
+    double yMax;
+  };
+
+  //Metrics of candidates with one hit from hits.
+  void EvaluateSingle(const HitCollection& hits, TrackCandidates& cands);
+
+  //Metrics of candidates with hit 1 from front and hit 2 from back.
+  void EvaluatePair(const HitCollection& front, const HitCollection& back, TrackCandidates& cands);
+
+  //Front and back hits with |front timeAvg - back timeAvg| <= timingCut,
+  //in the order of a loop over front hits and then back hits.  Found from
+  //the back hits sorted in time rather than by testing every pair.
+  void FrontBackPairs(const HitCollection& front, const HitCollection& back, const double timingCut,
+                      std::vector<std::pair<size_t, size_t>>& pairs);
+
+  //Index of the candidate with the smallest deltaSum, the first one if
+  //there is a tie, skipping candidates outside window if there is one.
+  //Returns TrackCandidates::none if no candidate is left.
+  size_t BestCandidate(const TrackCandidates& cands, const Window* window = nullptr);
+}
+
+#endif //CRT_TRACKMETRICS_H
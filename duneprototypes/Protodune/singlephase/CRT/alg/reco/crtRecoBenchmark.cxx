@@ -0,0 +1,177 @@
+// crtRecoBenchmark.cxx
+//
+// Times the CRT reconstruction library on synthetic events: strip hits to
+// 2D hits (HitPairing), then single CRT and two CRT track matching metrics
+// for a set of TPC tracks (TrackMetrics).  The geometry has the module
+// overlaps of ProtoDUNE-SP with 64 strips per module, front modules at
+// z = -900 cm and back modules at z = 1200 cm.  Each event has NTRIG module
+// triggers spread over the readout window, most of them crossing muons
+// with hits in overlapping modules, and NTRK tracks.
+//
+// Prints the time per event of each step.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitPairing.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitCollection.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/TrackMetrics.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using CRT::StripHit;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int nmod = 32;
+const int nstrip = 64;
+
+double seconds(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+void setGeometry(CRT::HitPairing& pairing) {
+  for ( int imod=0; imod<nmod; ++imod ) {
+    double z = imod%2 ? 1200.0 : -900.0;
+    for ( int istr=0; istr<nstrip; ++istr ) {
+      double pos = 5.0*istr - 160.0;
+      if ( imod%4 < 2 ) pairing.SetStripCenter(imod, istr, CRT::HitPairing::Point{pos, 20.0*imod, z});
+      else pairing.SetStripCenter(imod, istr, CRT::HitPairing::Point{-13.0*imod, pos, z + 1.0});
+    }
+  }
+}
+
+void makeEvent(std::mt19937& rng, const CRT::HitPairing& pairing, size_t ntrig,
+               vector<StripHit>& front, vector<StripHit>& back) {
+  front.clear();
+  back.clear();
+  std::uniform_int_distribution<int> time(-250000, 250000);
+  std::uniform_int_distribution<int> module(0, nmod - 1);
+  std::uniform_int_distribution<int> strip(0, nstrip - 2);
+  std::uniform_int_distribution<int> adc(21, 4000);
+  std::uniform_int_distribution<int> jitter(-6, 6);
+  std::uniform_int_distribution<int> coin(0, 3);
+  int itrig = 0;
+  auto addTrigger = [&](int imod, int t) {
+    int istr = strip(rng);
+    int nstr = coin(rng) == 0 ? 2 : 1;
+    for ( int jstr=istr; jstr<istr+nstr; ++jstr ) {
+      StripHit hit{jstr, imod, adc(rng), t, itrig};
+      if ( pairing.StripCenter(imod, jstr).z < 100 ) front.push_back(hit);
+      else back.push_back(hit);
+    }
+    ++itrig;
+  };
+  while ( size_t(itrig) < ntrig ) {
+    int imod = module(rng);
+    int t = time(rng);
+    addTrigger(imod, t);
+    if ( coin(rng) != 0 ) {
+      for ( int jmod=0; jmod<nmod; ++jmod ) {
+        if ( CRT::HitPairing::ModulesOverlap(jmod, imod) || CRT::HitPairing::ModulesOverlap(imod, jmod) ) {
+          if ( coin(rng) != 0 ) addTrigger(jmod, t + jitter(rng));
+        }
+      }
+    }
+  }
+}
+
+}  // end unnamed namespace
+
+int main(int argc, char* argv[]) {
+  const string myname = "crtRecoBenchmark: ";
+  size_t nevt = 100;
+  size_t ntrig = 500;
+  size_t ntrk = 20;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NEVT [NTRIG [NTRK]]]" << endl;
+      cout << "  NEVT [100]: Number of events." << endl;
+      cout << "  NTRIG [500]: Module triggers per event." << endl;
+      cout << "  NTRK [20]: TPC tracks per event." << endl;
+      return 0;
+    }
+    nevt = std::max(size_t(1), size_t(std::stoul(sarg)));
+  }
+  if ( argc > 2 ) ntrig = std::stoul(argv[2]);
+  if ( argc > 3 ) ntrk = std::stoul(argv[3]);
+  const int moduleTimingCut = 5;
+  const double frontToBackTimingCut = 100;
+  const CRT::Window frontWindow{-200, 580, -50, 620};
+
+  CRT::HitPairing pairing;
+  setGeometry(pairing);
+  std::mt19937 rng(20181004);
+  std::uniform_real_distribution<double> xpos(-360.0, 360.0);
+  std::uniform_real_distribution<double> ypos(0.0, 600.0);
+  vector<StripHit> stripsF, stripsB;
+  CRT::HitCollection hitsF, hitsB;
+  CRT::TrackCandidates cands;
+  vector<std::pair<size_t, size_t>> inTime;
+  double dtpair = 0.0;
+  double dtsingle = 0.0;
+  double dttwo = 0.0;
+  size_t nhit = 0;
+  size_t ncandSingle = 0;
+  size_t ncandTwo = 0;
+  size_t nbest = 0;
+  for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+    makeEvent(rng, pairing, ntrig, stripsF, stripsB);
+    auto t0 = Clock::now();
+    pairing.Pair(stripsF, moduleTimingCut, hitsF);
+    pairing.Pair(stripsB, moduleTimingCut, hitsB);
+    dtpair += seconds(t0);
+    nhit += hitsF.size() + hitsB.size();
+
+    // Single CRT: each track with each front hit.
+    t0 = Clock::now();
+    for ( size_t itrk=0; itrk<ntrk; ++itrk ) {
+      double x = xpos(rng);
+      double y = ypos(rng);
+      cands.clear();
+      for ( size_t ihit=0; ihit<hitsF.size(); ++ihit ) {
+        cands.Add(x, y, 10.0, x + 30.0, y - 40.0, 500.0, 0.0, ihit);
+      }
+      CRT::EvaluateSingle(hitsF, cands);
+      if ( CRT::BestCandidate(cands, &frontWindow) != CRT::TrackCandidates::none ) ++nbest;
+      ncandSingle += cands.size();
+    }
+    dtsingle += seconds(t0);
+
+    // Two CRTs: each track with each front-back pair in time.
+    t0 = Clock::now();
+    CRT::FrontBackPairs(hitsF, hitsB, frontToBackTimingCut, inTime);
+    for ( size_t itrk=0; itrk<ntrk; ++itrk ) {
+      double x = xpos(rng);
+      double y = ypos(rng);
+      cands.clear();
+      for ( const auto& fb : inTime ) {
+        cands.Add(x, y, 10.0, x + 30.0, y - 40.0, 690.0, 0.0, fb.first, fb.second);
+      }
+      CRT::EvaluatePair(hitsF, hitsB, cands);
+      if ( CRT::BestCandidate(cands) != CRT::TrackCandidates::none ) ++nbest;
+      ncandTwo += cands.size();
+    }
+    dttwo += seconds(t0);
+  }
+  string line = "-----------------------------";
+  cout << myname << line << endl;
+  cout << myname << nevt << " events, " << ntrig << " triggers and " << ntrk << " tracks per event" << endl;
+  cout << myname << "      2D hits/event: " << double(nhit)/nevt << endl;
+  cout << myname << "   single cand/event: " << double(ncandSingle)/nevt << endl;
+  cout << myname << "      two cand/event: " << double(ncandTwo)/nevt << endl;
+  cout << myname << "     best candidates: " << nbest << endl;
+  cout << myname << line << endl;
+  cout << myname << "    pairing: " << 1000*dtpair/nevt << " ms/event" << endl;
+  cout << myname << " single CRT: " << 1000*dtsingle/nevt << " ms/event" << endl;
+  cout << myname << "    two CRT: " << 1000*dttwo/nevt << " ms/event" << endl;
+  cout << myname << line << endl;
+  return 0;
+}
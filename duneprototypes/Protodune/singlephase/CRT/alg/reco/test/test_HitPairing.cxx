@@ -0,0 +1,264 @@
+// test_HitPairing.cxx
+//
+// Test CRT::HitPairing against the 2D hit loops of the CRT matching modules
+// (e.g. SingleCRTMatching): for every pair of hits in one CRT, look up both
+// strip centers in the geometry, check the module pair and the time, and
+// scan all hits for a hit on the next strip.  Events are made the way the
+// CRT reports them: triggers of one module with one or two adjacent strips
+// hit, a few of them coincident in overlapping modules, plus noise triggers
+// spread over the readout window.  The 2D hits must be identical, in the
+// same order, and the time per event is reported for each.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitPairing.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using CRT::StripHit;
+using CRT::PairedHit;
+using CRT::HitPairing;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+const size_t nmod = 32;
+const size_t nstrip = 64;
+
+// Geometry with the AuxDet interface of geo::GeometryCore.  Even modules
+// are on the front, odd modules on the back; strips are 5 cm apart in X
+// or in Y depending on the module.
+struct Point {
+  double x, y, z;
+  double X() const { return x; }
+  double Y() const { return y; }
+  double Z() const { return z; }
+};
+
+struct Strip {
+  Point center;
+  Point GetCenter() const { return center; }
+};
+
+struct Module {
+  vector<Strip> strips;
+  size_t NSensitiveVolume() const { return strips.size(); }
+  const Strip& SensitiveVolume(size_t istr) const { return strips.at(istr); }
+};
+
+struct Geometry {
+  vector<Module> modules;
+  Geometry() : modules(nmod) {
+    for ( size_t imod=0; imod<nmod; ++imod ) {
+      double z = imod%2 ? 1200.0 + 0.1*imod : -900.0 + 0.1*imod;
+      for ( size_t istr=0; istr<nstrip; ++istr ) {
+        double pos = 5.0*istr - 160.0 + 0.37*imod;
+        if ( imod%4 < 2 ) modules[imod].strips.push_back(Strip{Point{pos, 20.0*imod, z}});
+        else modules[imod].strips.push_back(Strip{Point{-13.0*imod, pos, z + 1.0}});
+      }
+    }
+  }
+  size_t NAuxDets() const { return modules.size(); }
+  const Module& AuxDet(size_t imod) const { return modules.at(imod); }
+};
+
+bool moduleMatcher(int module1, int module2) {
+  if ((module1 == 6 && (module2 == 10 || module2 == 11)) || (module1 == 14 && (module2 == 10 || module2 == 11)) || (module1 == 19 && (module2 == 26 || module2 == 27)) || (module1 == 31 && (module2 == 26 || module2 == 27)) || (module1 == 7 && (module2 == 12 || module2 == 13)) || (module1 == 15 && (module2 == 12 || module2 == 13)) || (module1 == 18 && (module2 == 24 || module2 == 25)) || (module1 == 30 && (module2 == 24 || module2 == 25)) || (module1 == 1 && (module2 == 4 || module2 == 5)) || (module1 == 9 && (module2 == 4 || module2 == 5)) || (module1 == 16 && (module2 == 20 || module2 == 21)) || (module1 == 28 && (module2 == 20 || module2 == 21)) || (module1 == 0 && (module2 == 2 || module2 == 3)) || (module1 == 8 && (module2 == 2 || module2 == 3)) || (module1 == 17 && (module2 == 22 || module2 == 23)) || (module1 == 29 && (module2 == 22 || module2 == 23))) return 1;
+  else return 0;
+}
+
+// The loop of the matching modules.
+vector<PairedHit> pairOld(const Geometry& geom, const vector<StripHit>& tempHits, int fModuletoModuleTimingCut) {
+  vector<PairedHit> out;
+  for (unsigned int f = 0; f < tempHits.size(); f++) {
+    for (unsigned int f_test = 0; f_test < tempHits.size(); f_test++) {
+      if (fabs(tempHits[f_test].triggerTime-tempHits[f].triggerTime)>fModuletoModuleTimingCut) continue;
+      const auto & trigGeo = geom.AuxDet(tempHits[f].module);
+      const auto & trigGeo2 = geom.AuxDet(tempHits[f_test].module);
+      const auto & hit1Geo = trigGeo.SensitiveVolume(tempHits[f].channel);
+      const auto hit1Center = hit1Geo.GetCenter();
+      const auto & hit2Geo = trigGeo2.SensitiveVolume(tempHits[f_test].channel);
+      const auto hit2Center = hit2Geo.GetCenter();
+      if (moduleMatcher(tempHits[f_test].module, tempHits[f].module)) {
+        double hitX = hit1Center.X();
+        for (unsigned int a = 0; a < tempHits.size(); a++) {
+          if (tempHits[a].module==tempHits[f].module && (tempHits[a].channel-1)==tempHits[f].channel) hitX=hit1Center.X()+1.25;
+        }
+        double hitY = hit2Center.Y();
+        for (unsigned int a = 0; a < tempHits.size(); a++) {
+          if (tempHits[a].module==tempHits[f_test].module && (tempHits[a].channel-1)==tempHits[f_test].channel) hitY=hit2Center.Y()+1.25;
+        }
+        double hitZ = (hit1Center.Z() + hit2Center.Z()) / 2.f;
+        out.push_back(PairedHit{hitX, hitY, hitZ, (tempHits[f_test].triggerTime+tempHits[f].triggerTime)/2.0, f, f_test});
+      }
+    }
+  }
+  return out;
+}
+
+// Hits of one event, split into front and back by strip Z as the modules do.
+void makeEvent(std::mt19937& rng, const Geometry& geom, size_t ntrig, vector<StripHit>& front, vector<StripHit>& back) {
+  front.clear();
+  back.clear();
+  std::uniform_int_distribution<int> time(-250000, 250000);
+  std::uniform_int_distribution<int> module(0, nmod - 1);
+  std::uniform_int_distribution<int> strip(0, nstrip - 1);
+  std::uniform_int_distribution<int> adc(21, 4000);
+  std::uniform_int_distribution<int> jitter(-6, 6);
+  std::uniform_int_distribution<int> coin(0, 3);
+  int itrig = 0;
+  auto addTrigger = [&](int imod, int t) {
+    int istr = strip(rng);
+    vector<int> strips{istr};
+    if ( coin(rng) == 0 && istr + 1 < int(nstrip) ) strips.push_back(istr + 1);
+    for ( int jstr : strips ) {
+      StripHit hit{jstr, imod, adc(rng), t, itrig};
+      if ( geom.AuxDet(imod).SensitiveVolume(jstr).GetCenter().Z() < 100 ) front.push_back(hit);
+      else back.push_back(hit);
+    }
+    ++itrig;
+  };
+  while ( size_t(itrig) < ntrig ) {
+    int imod = module(rng);
+    int t = time(rng);
+    addTrigger(imod, t);
+    // a muon crossing overlapping modules
+    if ( coin(rng) != 0 ) {
+      for ( int jmod=0; jmod<int(nmod); ++jmod ) {
+        if ( HitPairing::ModulesOverlap(jmod, imod) || HitPairing::ModulesOverlap(imod, jmod) ) {
+          if ( coin(rng) != 0 ) addTrigger(jmod, t + jitter(rng));
+        }
+      }
+    }
+  }
+}
+
+bool sameHits(const vector<PairedHit>& hs1, const vector<PairedHit>& hs2) {
+  if ( hs1.size() != hs2.size() ) return false;
+  for ( size_t ihit=0; ihit<hs1.size(); ++ihit ) {
+    const PairedHit& h1 = hs1[ihit];
+    const PairedHit& h2 = hs2[ihit];
+    if ( h1.x != h2.x || h1.y != h2.y || h1.z != h2.z || h1.timeAvg != h2.timeAvg ||
+         h1.hitX != h2.hitX || h1.hitY != h2.hitY ) {
+      cout << "  Hit " << ihit << " differs." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_HitPairing(size_t nevt, size_t ntrig) {
+  const string myname = "test_HitPairing: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  const int timingCut = 5;
+
+  cout << myname << line << endl;
+  cout << myname << "Check the geometry and module table." << endl;
+  Geometry geom;
+  HitPairing pairing;
+  pairing.SetStripCenters(geom);
+  assert( pairing.NModules() == nmod );
+  assert( pairing.StripCenter(7, 3).y == geom.AuxDet(7).SensitiveVolume(3).GetCenter().Y() );
+  bool threw = false;
+  try { pairing.StripCenter(3, nstrip); } catch ( const std::out_of_range& ) { threw = true; }
+  assert( threw );
+  for ( int mod1=0; mod1<int(nmod); ++mod1 ) {
+    for ( int mod2=0; mod2<int(nmod); ++mod2 ) {
+      assert( HitPairing::ModulesOverlap(mod1, mod2) == moduleMatcher(mod1, mod2) );
+    }
+  }
+  {
+    // two strips of X module 10 with Y hits on two strips of module 6, 5
+    // and 6 ticks later
+    vector<StripHit> hits{ {12, 10, 100, 50, 0}, {13, 10, 90, 50, 0}, {40, 6, 200, 55, 1}, {41, 6, 200, 56, 2} };
+    vector<PairedHit> pairs;
+    pairing.Pair(hits, timingCut, pairs);
+    assert( sameHits(pairs, pairOld(geom, hits, timingCut)) );
+    assert( pairs.size() == 2 );
+    assert( pairs[0].hitX == 0 && pairs[0].hitY == 2 );
+    assert( pairs[0].x == geom.AuxDet(10).SensitiveVolume(12).GetCenter().X() + 1.25 );
+    assert( pairs[0].y == geom.AuxDet(6).SensitiveVolume(40).GetCenter().Y() + 1.25 );
+    assert( pairs[1].hitX == 1 && pairs[1].hitY == 2 );
+    assert( pairs[1].x == geom.AuxDet(10).SensitiveVolume(13).GetCenter().X() );
+    pairing.Pair(vector<StripHit>(), timingCut, pairs);
+    assert( pairs.empty() );
+    hits.push_back(StripHit{nstrip, 10, 100, 50, 3});
+    threw = false;
+    try { pairing.Pair(hits, timingCut, pairs); } catch ( const std::out_of_range& ) { threw = true; }
+    assert( threw );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Pair " << nevt << " events of " << ntrig << " triggers." << endl;
+  std::mt19937 rng(20181004);
+  vector<vector<StripHit>> evts;
+  for ( size_t ievt=0; ievt<nevt; ++ievt ) {
+    vector<StripHit> front, back;
+    makeEvent(rng, geom, ntrig, front, back);
+    evts.push_back(front);
+    evts.push_back(back);
+  }
+  vector<vector<PairedHit>> hitsold;
+  auto t0 = Clock::now();
+  for ( const auto& hits : evts ) hitsold.push_back(pairOld(geom, hits, timingCut));
+  double dtold = std::chrono::duration<double>(Clock::now() - t0).count();
+  vector<vector<PairedHit>> hitsnew(evts.size());
+  t0 = Clock::now();
+  for ( size_t ievt=0; ievt<evts.size(); ++ievt ) pairing.Pair(evts[ievt], timingCut, hitsnew[ievt]);
+  double dtnew = std::chrono::duration<double>(Clock::now() - t0).count();
+  size_t npair = 0;
+  for ( size_t ievt=0; ievt<evts.size(); ++ievt ) {
+    assert( sameHits(hitsold[ievt], hitsnew[ievt]) );
+    npair += hitsnew[ievt].size();
+  }
+  cout << myname << "2D hits per event: " << double(npair)/nevt << endl;
+  assert( npair > 0 );
+
+  cout << myname << line << endl;
+  cout << myname << "    old: " << 1000*dtold/nevt << " ms/event" << endl;
+  cout << myname << "    alg: " << 1000*dtnew/nevt << " ms/event" << endl;
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nevt = 20;
+  size_t ntrig = 500;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NEVT [NTRIG]]" << endl;
+      cout << "  NEVT [20]: Number of events." << endl;
+      cout << "  NTRIG [500]: Module triggers per event." << endl;
+      return 0;
+    }
+    nevt = std::max(size_t(1), size_t(std::stoul(sarg)));
+  }
+  if ( argc > 2 ) ntrig = std::stoul(argv[2]);
+  return test_HitPairing(nevt, ntrig);
+}
+
+//**********************************************************************
@@ -0,0 +1,271 @@
+// test_TrackMetrics.cxx
+//
+// Test the CRT track matching metrics against the TVector3 code of the CRT
+// matching modules: single CRT candidates (one hit, hit vector to the track
+// start, predicted position windows) and two CRT candidates (front and back
+// hit).  The metrics must be identical and the best candidates the same.
+// The front-back pairs in time must be those of the modules' double loop.
+// Random tracks and hits are used, including tracks with both ends at the
+// same point.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/HitCollection.h"
+#include "duneprototypes/Protodune/singlephase/CRT/alg/reco/TrackMetrics.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using CRT::HitCollection;
+using CRT::TrackCandidates;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// The parts of TVector3 the modules use.
+struct Vec3 {
+  double fX, fY, fZ;
+  double X() const { return fX; }
+  double Y() const { return fY; }
+  double Z() const { return fZ; }
+  double Mag2() const { return fX*fX + fY*fY + fZ*fZ; }
+  Vec3 Unit() const {
+    double tot2 = Mag2();
+    double tot = (tot2 > 0) ?  1.0/std::sqrt(tot2) : 1.0;
+    return Vec3{fX*tot, fY*tot, fZ*tot};
+  }
+  double operator*(const Vec3& p) const { return fX*p.fX + fY*p.fY + fZ*p.fZ; }
+  Vec3 operator-(const Vec3& p) const { return Vec3{fX - p.fX, fY - p.fY, fZ - p.fZ}; }
+};
+
+struct Metrics {
+  double predictedX1, predictedY1, deltaX1, deltaY1, deltaX2, deltaY2, dotProductCos;
+};
+
+// Single CRT metrics as in SingleCRTMatching.
+Metrics oldSingle(const Vec3& trackStart, const Vec3& trackEnd, double X1, double Y1, double Z1) {
+  Vec3 v1{X1, Y1, Z1};
+  Vec3 v2 = trackStart;
+  Vec3 v4 = trackStart;
+  Vec3 v5 = trackEnd;
+  Vec3 trackVector = (v5-v4).Unit();
+  Vec3 hitVector = (v2-v1).Unit();
+  double predictedHitPositionY1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
+  double predictedHitPositionX1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
+  double dotProductCos = trackVector*hitVector;
+  double deltaX1 = (predictedHitPositionX1-X1);
+  double deltaY1 = (predictedHitPositionY1-Y1);
+  return Metrics{predictedHitPositionX1, predictedHitPositionY1, deltaX1, deltaY1, 0.0, 0.0, dotProductCos};
+}
+
+// Two CRT metrics as in TwoCRTMatching.
+Metrics oldPair(const Vec3& trackStart, const Vec3& trackEnd, const Vec3& v1, const Vec3& v2) {
+  Vec3 v4 = trackStart;
+  Vec3 v5 = trackEnd;
+  Vec3 trackVector = (v5-v4).Unit();
+  Vec3 hitVector = (v2-v1).Unit();
+  double predictedHitPositionY1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
+  double predictedHitPositionY2 = (v2.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.Y()-v5.Y())+v5.Y();
+  double predictedHitPositionX1 = (v1.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
+  double predictedHitPositionX2 = (v2.Z()-v5.Z())/(v4.Z()-v5.Z())*(v4.X()-v5.X())+v5.X();
+  double dotProductCos = trackVector*hitVector;
+  return Metrics{predictedHitPositionX1, predictedHitPositionY1,
+                 predictedHitPositionX1-v1.X(), predictedHitPositionY1-v1.Y(),
+                 predictedHitPositionX2-v2.X(), predictedHitPositionY2-v2.Y(), dotProductCos};
+}
+
+bool same(double x1, double x2) {
+  return x1 == x2 || (std::isnan(x1) && std::isnan(x2));
+}
+
+bool sameMetrics(const Metrics& m, const TrackCandidates& cands, size_t icnd) {
+  return same(m.predictedX1, cands.predictedX1[icnd]) && same(m.predictedY1, cands.predictedY1[icnd]) &&
+         same(m.deltaX1, cands.deltaX1[icnd]) && same(m.deltaY1, cands.deltaY1[icnd]) &&
+         same(m.deltaX2, cands.deltaX2[icnd]) && same(m.deltaY2, cands.deltaY2[icnd]) &&
+         same(m.dotProductCos, cands.dotProductCos[icnd]);
+}
+
+// Hits of one CRT at z.
+void makeHits(std::mt19937& rng, size_t nhit, double z, HitCollection& hits) {
+  std::uniform_real_distribution<double> pos(-400.0, 600.0);
+  std::uniform_real_distribution<double> dz(-5.0, 5.0);
+  hits.clear();
+  for ( size_t ihit=0; ihit<nhit; ++ihit ) {
+    hits.x.push_back(pos(rng));
+    hits.y.push_back(pos(rng));
+    hits.z.push_back(z + dz(rng));
+    hits.timeAvg.push_back(ihit);
+    for ( auto pv : {&hits.moduleX, &hits.moduleY, &hits.stripX, &hits.stripY, &hits.adcX,
+                     &hits.adcY, &hits.trigNumberX, &hits.trigNumberY} ) pv->push_back(ihit);
+  }
+}
+
+Vec3 randomPoint(std::mt19937& rng, double zmin, double zmax) {
+  std::uniform_real_distribution<double> x(-360.0, 360.0);
+  std::uniform_real_distribution<double> y(0.0, 600.0);
+  std::uniform_real_distribution<double> z(zmin, zmax);
+  return Vec3{x(rng), y(rng), z(rng)};
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_TrackMetrics(size_t ntrk, size_t nhit) {
+  const string myname = "test_TrackMetrics: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(20190117);
+  HitCollection front, back;
+  makeHits(rng, nhit, -900.0, front);
+  makeHits(rng, nhit, 1200.0, back);
+  const CRT::Window frontWindow{-200, 580, -50, 620};
+
+  cout << myname << line << endl;
+  cout << myname << "Single CRT: " << ntrk << " tracks and " << nhit << " hits." << endl;
+  TrackCandidates cands;
+  size_t nmatch = 0;
+  for ( size_t itrk=0; itrk<ntrk; ++itrk ) {
+    Vec3 start = randomPoint(rng, 0.0, 50.0);
+    Vec3 end = itrk%10 == 0 ? start : randomPoint(rng, 90.0, 660.0);
+    cands.clear();
+    for ( size_t ihit=0; ihit<nhit; ++ihit ) {
+      // the modules shift the track in x by a different amount for each hit
+      double xOffset = 0.01*ihit;
+      cands.Add(start.fX - xOffset, start.fY, start.fZ, end.fX - xOffset, end.fY, end.fZ, xOffset, ihit);
+    }
+    CRT::EvaluateSingle(front, cands);
+    double min_delta = DBL_MAX;
+    size_t bestOld = TrackCandidates::none;
+    for ( size_t ihit=0; ihit<nhit; ++ihit ) {
+      Vec3 trackStart{cands.startX[ihit], cands.startY[ihit], cands.startZ[ihit]};
+      Vec3 trackEnd{cands.endX[ihit], cands.endY[ihit], cands.endZ[ihit]};
+      Metrics m = oldSingle(trackStart, trackEnd, front.x[ihit], front.y[ihit], front.z[ihit]);
+      assert( sameMetrics(m, cands, ihit) );
+      assert( same(cands.deltaSum[ihit], std::abs(m.deltaX1) + std::abs(m.deltaY1)) );
+      if (m.predictedX1<-200 || m.predictedX1>580 || m.predictedY1<-50 || m.predictedY1>620) continue;
+      if (min_delta > std::abs(m.deltaX1) + std::abs(m.deltaY1)) {
+        min_delta = std::abs(m.deltaX1) + std::abs(m.deltaY1);
+        bestOld = ihit;
+      }
+    }
+    assert( CRT::BestCandidate(cands, &frontWindow) == bestOld );
+    if ( bestOld != TrackCandidates::none ) ++nmatch;
+  }
+  cout << myname << "Tracks with a best hit: " << nmatch << endl;
+  assert( nmatch > 0 );
+
+  cout << myname << line << endl;
+  cout << myname << "Two CRTs: " << ntrk << " tracks and " << nhit << " hits." << endl;
+  double dtold = 0.0;
+  double dtnew = 0.0;
+  size_t ncand = 0;
+  for ( size_t itrk=0; itrk<ntrk; ++itrk ) {
+    Vec3 start = randomPoint(rng, -10.0, 50.0);
+    Vec3 end = randomPoint(rng, 660.0, 700.0);
+    cands.clear();
+    for ( size_t ihf=0; ihf<nhit; ++ihf ) {
+      for ( size_t ihb=0; ihb<nhit; ++ihb ) {
+        if ( (ihf + ihb)%3 == 0 ) continue;  // as if out of time
+        cands.Add(start.fX, start.fY, start.fZ, end.fX, end.fY, end.fZ, 0.0, ihf, ihb);
+      }
+    }
+    ncand += cands.size();
+    auto t0 = Clock::now();
+    CRT::EvaluatePair(front, back, cands);
+    size_t bestNew = CRT::BestCandidate(cands);
+    dtnew += std::chrono::duration<double>(Clock::now() - t0).count();
+    vector<Metrics> ms;
+    ms.reserve(cands.size());
+    double min_delta = DBL_MAX;
+    size_t bestOld = TrackCandidates::none;
+    t0 = Clock::now();
+    for ( size_t icnd=0; icnd<cands.size(); ++icnd ) {
+      size_t ihf = cands.hit1[icnd];
+      size_t ihb = cands.hit2[icnd];
+      Metrics m = oldPair(start, end, Vec3{front.x[ihf], front.y[ihf], front.z[ihf]},
+                          Vec3{back.x[ihb], back.y[ihb], back.z[ihb]});
+      ms.push_back(m);
+      if (min_delta > std::abs(m.deltaX1)+std::abs(m.deltaX2) + std::abs(m.deltaY1)+std::abs(m.deltaY2)) {
+        min_delta = std::abs(m.deltaX1)+std::abs(m.deltaX2) + std::abs(m.deltaY1)+std::abs(m.deltaY2);
+        bestOld = icnd;
+      }
+    }
+    dtold += std::chrono::duration<double>(Clock::now() - t0).count();
+    for ( size_t icnd=0; icnd<cands.size(); ++icnd ) assert( sameMetrics(ms[icnd], cands, icnd) );
+    assert( bestNew == bestOld );
+    assert( bestNew != TrackCandidates::none );
+  }
+  cout << myname << line << endl;
+  cout << myname << "  TVector3: " << 1.e9*dtold/ncand << " ns/candidate" << endl;
+  cout << myname << "       alg: " << 1.e9*dtnew/ncand << " ns/candidate" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Front-back pairs in time." << endl;
+  {
+    std::uniform_int_distribution<int> time(-2000, 2000);
+    for ( size_t ihit=0; ihit<nhit; ++ihit ) {
+      front.timeAvg[ihit] = (time(rng) + time(rng))/2.0;
+      back.timeAvg[ihit] = (time(rng) + time(rng))/2.0;
+    }
+    back.timeAvg[nhit/2] = front.timeAvg[0] + 100;
+    const int fFronttoBackTimingCut = 100;
+    vector<std::pair<size_t, size_t>> pairsOld, pairsNew;
+    for (unsigned int f = 0; f < front.size(); f++) {
+      for (unsigned int b = 0; b < back.size(); b++) {
+        if (fabs(front.timeAvg[f]-back.timeAvg[b])>fFronttoBackTimingCut) continue;
+        pairsOld.emplace_back(f, b);
+      }
+    }
+    CRT::FrontBackPairs(front, back, fFronttoBackTimingCut, pairsNew);
+    cout << myname << "Pairs: " << pairsNew.size() << endl;
+    assert( pairsNew == pairsOld );
+    assert( ! pairsNew.empty() );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "No candidates." << endl;
+  cands.clear();
+  CRT::EvaluatePair(front, back, cands);
+  assert( cands.deltaSum.empty() );
+  assert( CRT::BestCandidate(cands) == TrackCandidates::none );
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t ntrk = 200;
+  size_t nhit = 60;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NTRK [NHIT]]" << endl;
+      cout << "  NTRK [200]: Number of tracks." << endl;
+      cout << "  NHIT [60]: Number of 2D hits in each CRT." << endl;
+      return 0;
+    }
+    ntrk = std::max(size_t(1), size_t(std::stoul(sarg)));
+  }
+  if ( argc > 2 ) nhit = std::max(size_t(1), size_t(std::stoul(argv[2])));
+  return test_TrackMetrics(ntrk, nhit);
+}
+
+//**********************************************************************
@@ -50,6 +50,9 @@ namespace {
   template <typename T>
   inline T sqr(T v) { return v*v; }
 
+  // Slope of the Sternheimer delta in log10(p/m).
+  const double kTwoLogTen = 2. * std::log(10.);
+
 } // local namespace
 namespace spdp{
   //--------------------------------------------------------------------
@@ -103,6 +106,7 @@ namespace spdp{
       {
         fTemperature = 87.65;
       }
+      UpdateDerivedQuantities();
     }
 
 
@@ -115,15 +119,10 @@ namespace spdp{
     bool retVal=false;
 
     if(fGetReadOutWindowSizefromMetaData){
-      art::ServiceHandle<ifdh_ns::IFDH> ifdh;
-      auto metadata=ifdh->getMetadata(filename);
+      auto const& metadata=Metadata(filename);
       retVal = true;
-      std::string window_str="DUNE_data.readout_window: ";
-      if(metadata.find(window_str)!=std::string::npos){
-        int n1 = metadata.find(window_str);
-        n1 += window_str.length();
-        int n2 = metadata.find("\n", n1);
-        double window=std::stod(metadata.substr(n1, n2-n1)); //milliseconds
+      if(metadata.hasReadoutWindow){
+        double window=std::stod(metadata.readoutWindow); //milliseconds
         double ticks=window*1000/(clockData.TPCClock().TickPeriod()); //sampling rate 2Mhz
         fNumberTimeSamples=ticks;
         fReadOutWindowSize=ticks;
@@ -153,26 +152,16 @@ namespace spdp{
     if(fGetHVDriftfromMetaData){
       retVal = true;
 
-      art::ServiceHandle<ifdh_ns::IFDH> ifdh;
-      auto metadata=ifdh->getMetadata(filename);
+      auto const& metadata=Metadata(filename);
 
       int run = 0;
-      std::string run_str="Runs: ";
-      if(metadata.find(run_str)!=std::string::npos){
-        int n1 = metadata.find(run_str);
-        n1 += run_str.length();
-        int n2 = metadata.find(".", n1);
-        run = std::stoi(metadata.substr(n1, n2-n1));
+      if(metadata.hasRun){
+        run = std::stoi(metadata.run);
         std::cout<<"Run number from metadata: "<<run<<std::endl;
       }
 
-      std::string hv_str="detector.hv_value: ";
-      if(metadata.find(hv_str)!=std::string::npos){
-        int n1 = metadata.find(hv_str);
-        n1 += hv_str.length();
-        int n2 = metadata.find("\n", n1);
-
-        fHV_cath=std::stod(metadata.substr(n1, n2-n1));
+      if(metadata.hasHV){
+        fHV_cath=std::stod(metadata.hv);
         std::cout<<"Using HV on cathode as: "<<fHV_cath<<"KV,  Value retreived from samweb MetaData"<<std::endl;
       }
       else{
@@ -209,14 +198,62 @@ namespace spdp{
         }
       }
       std::cout<<"Calculated E field in 4 plane gaps as: "<<fEfield[0]<<","<<fEfield[1]<<","<<fEfield[2]<<","<<fEfield[3]<<std::endl;
+      UpdateDerivedQuantities();
     }//End GetHVDriftfrom MetaData if
 
 
     return retVal;
   }
 
+  //--------------------------------------------------------------------
+  FileMetadata const& DetectorPropertiesProtoDUNEsp::Metadata(std::string const& filename)
+  {
+    return fMetadata.Get(filename, [](std::string const& name) {
+        art::ServiceHandle<ifdh_ns::IFDH> ifdh;
+        return ifdh->getMetadata(name);
+      });
+  }
 
+  //--------------------------------------------------------------------
+  void DetectorPropertiesProtoDUNEsp::UpdateDerivedQuantities()
+  {
+    fHasDriftVelocity = false;
+    fDriftVelocityTable.Clear();
+    if(!fEfield.empty()){
+      fDriftVelocityEfield = Efield();
+      CheckDriftVelocityRange(fDriftVelocityEfield, fTemperature);
+      fDriftVelocity = DriftVelocityParameterization(fDriftVelocityEfield, fTemperature);
+      fHasDriftVelocity = true;
+    }
+    if(fDriftVelocityTableStep > 0.)
+      fDriftVelocityTable.Build(fTemperature, 4.0, fDriftVelocityTableStep);
+
+    double Wion = 1000./util::kGeVToElectrons;        // 23.6 eV = 1e, Wion in MeV/e
+    fBirksA = util::kRecombA/Wion;
+    fBirksK = util::kRecombk/Density();
+    if(fLP){
+      double K = 0.307075;     // 4 pi N_A r_e^2 m_e c^2 (MeV cm^2/mol).
+      fElossDensityKZ = Density() * K*fLP->AtomicNumber();
+      fElossI2 = 1.e-12 * sqr(fLP->ExcitationEnergy());
+    }
+  }
 
+  //--------------------------------------------------------------------
+  void DetectorPropertiesProtoDUNEsp::CheckDriftVelocityRange(double efield, double temperature) const
+  {
+    if(efield > 4.0)
+      mf::LogWarning("DetectorPropertiesStandard") << "DriftVelocity Warning! : E-field value of "
+                                                   << efield
+                                                   << " kV/cm is outside of range covered by drift"
+                                                   << " velocity parameterization. Returned value"
+                                                   << " may not be correct";
+    if(temperature < 87.0 || temperature > 94.0)
+      mf::LogWarning("DetectorPropertiesStandard") << "DriftVelocity Warning! : Temperature value of "
+                                                   << temperature
+                                                   << " K is outside of range covered by drift velocity"
+                                                   << " parameterization. Returned value may not be"
+                                                   << " correct";
+  }
 
   //--------------------------------------------------------------------
   detinfo::DetectorPropertiesData
@@ -250,6 +287,10 @@ namespace spdp{
     fSternheimerParameters.x1   = config.SternheimerX1();
     fSternheimerParameters.cbar = config.SternheimerCbar();
     fSimpleBoundary = config.SimpleBoundary();
+    fMetadata.SetLocalDir(config.MetadataDir());
+    fDriftVelocityTableStep = config.DriftVelocityTableStep();
+
+    UpdateDerivedQuantities();
 
   } // DetectorPropertiesStandard::Configure()
 
@@ -332,9 +373,9 @@ namespace spdp{
   //
   double DetectorPropertiesProtoDUNEsp::Eloss(double mom, double mass, double tcut) const
   {
-    // Some constants.
+    // Some constants. The density and material terms are set in
+    // UpdateDerivedQuantities().
 
-    double K = 0.307075;     // 4 pi N_A r_e^2 m_e c^2 (MeV cm^2/mol).
     double me = 0.510998918; // Electron mass (MeV/c^2).
 
     // Calculate kinematic quantities.
@@ -355,14 +396,14 @@ namespace spdp{
     double x = std::log10(bg);
     double delta = 0.;
     if(x >= fSternheimerParameters.x0) {
-      delta = 2. * std::log(10.) * x - fSternheimerParameters.cbar;
+      delta = kTwoLogTen * x - fSternheimerParameters.cbar;
       if(x < fSternheimerParameters.x1)
         delta += fSternheimerParameters.a * std::pow(fSternheimerParameters.x1 - x, fSternheimerParameters.k);
     }
 
     // Calculate stopping number.
 
-    double B = 0.5 * std::log(2.*me*bg*bg*tcut / (1.e-12 * sqr(fLP->ExcitationEnergy())))
+    double B = 0.5 * std::log(2.*me*bg*bg*tcut / fElossI2)
       - 0.5 * beta*beta * (1. + tcut / tmax) - 0.5 * delta;
 
     // Don't let the stopping number become negative.
@@ -372,7 +413,7 @@ namespace spdp{
 
     // Calculate dE/dx.
 
-    double dedx = Density() * K*fLP->AtomicNumber()*B / (fLP->AtomicMass() * beta*beta);
+    double dedx = fElossDensityKZ*B / (fLP->AtomicMass() * beta*beta);
 
     // Done.
 
@@ -408,66 +449,18 @@ namespace spdp{
     // Default Efield, use internal value.
     if(efield == 0.)
       efield = Efield();
-    //
-    if(efield > 4.0)
-      mf::LogWarning("DetectorPropertiesStandard") << "DriftVelocity Warning! : E-field value of "
-                                                   << efield
-                                                   << " kV/cm is outside of range covered by drift"
-                                                   << " velocity parameterization. Returned value"
-                                                   << " may not be correct";
     // Default temperature use internal value.
     if(temperature == 0.)
       temperature = Temperature();
-    if(temperature < 87.0 || temperature > 94.0)
-      mf::LogWarning("DetectorPropertiesStandard") << "DriftVelocity Warning! : Temperature value of "
-                                                   << temperature
-                                                   << " K is outside of range covered by drift velocity"
-                                                   << " parameterization. Returned value may not be"
-                                                   << " correct";
-    double tshift = -87.203+temperature;
-    double xFit = 0.0938163-0.0052563*tshift-0.0001470*tshift*tshift;
-    double uFit = 5.18406+0.01448*tshift-0.003497*tshift*tshift-0.000516*tshift*tshift*tshift;
+    // The configured field and temperature: computed when they are set
+    if(fHasDriftVelocity && efield == fDriftVelocityEfield && temperature == fTemperature)
+      return fDriftVelocity;
+    // Other fields (e.g. with space charge): interpolated in the table
     double vd;
-    // Icarus Parameter Set, use as default
-    double  P1 = -0.04640; // K^-1
-    double  P2 = 0.01712;  // K^-1
-    double  P3 = 1.88125;   // (kV/cm)^-1
-    double  P4 =  0.99408;    // kV/cm
-    double  P5 =  0.01172;   // (kV/cm)^-P6
-    double  P6 =  4.20214;
-    double  T0 =  105.749;  // K
-    // Walkowiak Parameter Set
-    double    P1W = -0.01481; // K^-1
-    double  P2W = -0.0075;  // K^-1
-    double   P3W =  0.141;   // (kV/cm)^-1
-    double   P4W =  12.4;    // kV/cm
-    double   P5W =  1.627;   // (kV/cm)^-P6
-    double   P6W =  0.317;
-    double   T0W =  90.371;  // K
-    // From Craig Thorne . . . currently not documented
-    // smooth transition from linear at small fields to
-    //     icarus fit at most fields to Walkowiak at very high fields
-    if (efield < xFit) vd=efield*uFit;
-    else if (efield<0.619) {
-      vd = ((P1*(temperature-T0)+1)
-            *(P3*efield*std::log(1+P4/efield) + P5*std::pow(efield,P6))
-            +P2*(temperature-T0));
-    }
-    else if (efield<0.699) {
-      vd = 12.5*(efield-0.619)*((P1W*(temperature-T0W)+1)
-                                *(P3W*efield*std::log(1+P4W/efield) + P5W*std::pow(efield,P6W))
-                                +P2W*(temperature-T0W))+
-        12.5*(0.699-efield)*((P1*(temperature-T0)+1)
-                             *(P3*efield*std::log(1+P4/efield) + P5*std::pow(efield,P6))
-                             +P2*(temperature-T0));
-    }
-    else {
-      vd = ((P1W*(temperature-T0W)+1)
-            *(P3W*efield*std::log(1+P4W/efield) + P5W*std::pow(efield,P6W))
-            +P2W*(temperature-T0W));
-    }
-    vd /= 10.;
-    return vd; // in cm/us
+    if(temperature == fDriftVelocityTable.Temperature() && fDriftVelocityTable.Find(efield, vd))
+      return vd;
+    CheckDriftVelocityRange(efield, temperature);
+    return DriftVelocityParameterization(efield, temperature); // in cm/us
   }
   //----------------------------------------------------------------------------------
   // The below function assumes that the user has applied the lifetime correction and
@@ -488,12 +481,8 @@ namespace spdp{
     // Correction for charge quenching using parameterization from
     // S.Amoruso et al., NIM A 523 (2004) 275
 
-    double  A3t    = util::kRecombA;
-    double  K3t    = util::kRecombk;                     // in KV/cm*(g/cm^2)/MeV
-    double  rho    = Density();                    // LAr density in g/cm^3
-    double Wion    = 1000./util::kGeVToElectrons;        // 23.6 eV = 1e, Wion in MeV/e
-    K3t           /= rho;                                // KV/MeV
-    double dEdx    = dQdx/(A3t/Wion-K3t/E_field*dQdx);    //MeV/cm
+    // A3t/Wion and K3t/rho (KV/MeV) are set in UpdateDerivedQuantities()
+    double dEdx    = dQdx/(fBirksA-fBirksK/E_field*dQdx);    //MeV/cm
 
     return dEdx;
   }
@@ -47,7 +47,8 @@
 
 
 
-#include "duneprototypes/Protodune/singlephase/DetectorServices/Providers/DetectorPropertiesProtoDUNEsp.h"
+#include "duneprototypes/Protodune/singlephase/DetectorServices/Providers/DriftVelocityTable.h"
+#include "duneprototypes/Protodune/singlephase/DetectorServices/Providers/FileMetadataCache.h"
 
 
 
@@ -83,6 +84,12 @@ namespace spdp{
           Comment("option to get ReadoutWindowSize and NumberTimeSamples from MetaData")
         };
 
+          fhicl::Atom<std::string > MetadataDir{
+          Name("MetadataDir"),
+          Comment("directory with <file name>.metadata copies of the samweb metadata, used instead of samweb for the files found there"),
+          ""
+        };
+
           fhicl::Atom<bool        > fUseRunDependentTemperature{
           Name("UseRunDependentTemperature"),
           Comment("option to update temperature based on run number, used for Data")
@@ -153,6 +160,11 @@ namespace spdp{
           Comment("parameter cbar of Sternheimer correction delta = 2log(10) x - cbar + { a (x_1-x)^k } theta(x1-x), x = log10(p/m)")
         };
         fhicl::Atom<bool> SimpleBoundary { Name("SimpleBoundaryProcess" ), Comment("") };
+        fhicl::Atom<double      > DriftVelocityTableStep   {
+          Name("DriftVelocityTableStep"),
+          Comment("field step [kV/cm] of the drift velocity table used for fields other than the configured one; 0 to always evaluate the parameterization"),
+          1.e-4
+        };
 
       }; // Configuration_t
 
@@ -231,7 +243,7 @@ namespace spdp{
       void Setup(providers_type providers);
 
       void SetGeometry(const geo::GeometryCore* g) { fGeo = g; }
-      void SetLArProperties(const detinfo::LArProperties* lp) { fLP = lp; }
+      void SetLArProperties(const detinfo::LArProperties* lp) { fLP = lp; UpdateDerivedQuantities(); }
       void SetNumberTimeSamples(unsigned int nsamp) { fNumberTimeSamples=nsamp;}
       // Accessors.
       virtual double Efield(unsigned int planegap=0) const override; ///< kV/cm
@@ -350,6 +362,29 @@ namespace spdp{
       SternheimerParameters_t fSternheimerParameters; ///< Sternheimer parameters
 
       bool fSimpleBoundary;
+
+      FileMetadataCache fMetadata;                ///< samweb metadata of the input files
+      double       fDriftVelocityTableStep = 0.;  ///< kV/cm, 0 for no table
+      DriftVelocityTable fDriftVelocityTable;     ///< drift velocity at fTemperature
+      bool         fHasDriftVelocity = false;     ///< whether fDriftVelocity is set
+      double       fDriftVelocityEfield = 0.;     ///< kV/cm, Efield() for fDriftVelocity
+      double       fDriftVelocity = 0.;           ///< cm/us at Efield() and fTemperature
+      double       fBirksA = 0.;                  ///< kRecombA/Wion
+      double       fBirksK = 0.;                  ///< kRecombk/density
+      double       fElossDensityKZ = 0.;          ///< density*K*Z in Eloss
+      double       fElossI2 = 0.;                 ///< 1e-12*I^2 in Eloss
+
+      /// Metadata of the input file filename, fetched once per file.
+      FileMetadata const& Metadata(std::string const& filename);
+
+      /// Recomputes the quantities derived from the field, the temperature
+      /// and the argon properties; called whenever one of them changes.
+      void UpdateDerivedQuantities();
+
+      /// Warns if the field or temperature is outside the drift velocity
+      /// parameterization.
+      void CheckDriftVelocityRange(double efield, double temperature) const;
+
       /// Checks the configuration of time offsets.
       std::string CheckTimeOffsetConfigurationAfterSetup() const;
 
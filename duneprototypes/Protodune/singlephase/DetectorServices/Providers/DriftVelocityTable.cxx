@@ -0,0 +1,130 @@
+/**
+ * @file DriftVelocityTable.cxx
+ * @brief Drift velocity parameterization and its table, see DriftVelocityTable.h
+ */
+
+#include "DriftVelocityTable.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+  // Temperature dependence of the linear low-field piece.
+  void lowFieldFit(double temperature, double& xFit, double& uFit) {
+    double tshift = -87.203+temperature;
+    xFit = 0.0938163-0.0052563*tshift-0.0001470*tshift*tshift;
+    uFit = 5.18406+0.01448*tshift-0.003497*tshift*tshift-0.000516*tshift*tshift*tshift;
+  }
+
+} // local namespace
+
+namespace spdp {
+
+  //--------------------------------------------------------------------
+  double DriftVelocityParameterization(double efield, double temperature) {
+    double xFit, uFit;
+    lowFieldFit(temperature, xFit, uFit);
+    double vd;
+    // Icarus Parameter Set, use as default
+    double  P1 = -0.04640; // K^-1
+    double  P2 = 0.01712;  // K^-1
+    double  P3 = 1.88125;   // (kV/cm)^-1
+    double  P4 =  0.99408;    // kV/cm
+    double  P5 =  0.01172;   // (kV/cm)^-P6
+    double  P6 =  4.20214;
+    double  T0 =  105.749;  // K
+    // Walkowiak Parameter Set
+    double    P1W = -0.01481; // K^-1
+    double  P2W = -0.0075;  // K^-1
+    double   P3W =  0.141;   // (kV/cm)^-1
+    double   P4W =  12.4;    // kV/cm
+    double   P5W =  1.627;   // (kV/cm)^-P6
+    double   P6W =  0.317;
+    double   T0W =  90.371;  // K
+    // From Craig Thorne . . . currently not documented
+    // smooth transition from linear at small fields to
+    //     icarus fit at most fields to Walkowiak at very high fields
+    if (efield < xFit) vd=efield*uFit;
+    else if (efield<0.619) {
+      vd = ((P1*(temperature-T0)+1)
+            *(P3*efield*std::log(1+P4/efield) + P5*std::pow(efield,P6))
+            +P2*(temperature-T0));
+    }
+    else if (efield<0.699) {
+      vd = 12.5*(efield-0.619)*((P1W*(temperature-T0W)+1)
+                                *(P3W*efield*std::log(1+P4W/efield) + P5W*std::pow(efield,P6W))
+                                +P2W*(temperature-T0W))+
+        12.5*(0.699-efield)*((P1*(temperature-T0)+1)
+                             *(P3*efield*std::log(1+P4/efield) + P5*std::pow(efield,P6))
+                             +P2*(temperature-T0));
+    }
+    else {
+      vd = ((P1W*(temperature-T0W)+1)
+            *(P3W*efield*std::log(1+P4W/efield) + P5W*std::pow(efield,P6W))
+            +P2W*(temperature-T0W));
+    }
+    vd /= 10.;
+    return vd; // in cm/us
+  }
+
+  //--------------------------------------------------------------------
+  void DriftVelocityTable::Build(double temperature, double emax, double step) {
+    Clear();
+    fTemperature = temperature;
+    lowFieldFit(temperature, fLowField, fLowSlope);
+    if (!(step > 0.) || !(emax > fLowField)) return;
+    // Pieces of the parameterization above the linear one.
+    std::vector<double> ends;
+    for (double end : {0.619, 0.699}) {
+      if (end > fLowField && end < emax) ends.push_back(end);
+    }
+    ends.push_back(emax);
+    double start = fLowField;
+    for (double end : ends) {
+      size_t nstep = std::max<size_t>(1, size_t(std::ceil((end - start)/step)));
+      double pstep = (end - start)/nstep;
+      fPieceStart.push_back(start);
+      fPieceEnd.push_back(end);
+      fPieceInvStep.push_back(1./pstep);
+      fPieceFirst.push_back(fVelocities.size());
+      fPieceSteps.push_back(nstep);
+      for (size_t istep = 0; istep <= nstep; ++istep) {
+        // The last node is evaluated just inside the piece, on the side
+        // the parameterization uses for the fields below it.
+        double efield = istep == nstep ? std::nextafter(end, start) : start + istep*pstep;
+        fVelocities.push_back(DriftVelocityParameterization(efield, temperature));
+      }
+      start = end;
+    }
+  }
+
+  //--------------------------------------------------------------------
+  void DriftVelocityTable::Clear() {
+    fPieceStart.clear();
+    fPieceEnd.clear();
+    fPieceInvStep.clear();
+    fPieceFirst.clear();
+    fPieceSteps.clear();
+    fVelocities.clear();
+  }
+
+  //--------------------------------------------------------------------
+  bool DriftVelocityTable::Find(double efield, double& vd) const {
+    if (fVelocities.empty() || !(efield >= 0.) || efield > fPieceEnd.back()) return false;
+    if (efield < fLowField) {
+      vd = efield*fLowSlope;
+      vd /= 10.;
+      return true;
+    }
+    size_t ipc = 0;
+    while (ipc + 1 < fPieceEnd.size() && efield >= fPieceEnd[ipc]) ++ipc;
+    double u = (efield - fPieceStart[ipc])*fPieceInvStep[ipc];
+    size_t istep = size_t(u);
+    if (istep >= fPieceSteps[ipc]) istep = fPieceSteps[ipc] - 1;
+    double w = u - istep;
+    const double* v = &fVelocities[fPieceFirst[ipc] + istep];
+    vd = v[0] + w*(v[1] - v[0]);
+    return true;
+  }
+
+} // namespace spdp
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////
+// \file DriftVelocityTable.h
+//
+// \brief Electron drift velocity in LAr as a function of field and
+//        temperature, and a table of it at fixed temperature
+//
+// DriftVelocityParameterization is the parameterization used by
+// DetectorPropertiesProtoDUNEsp::DriftVelocity (W. Walkowiak, NIM A 449
+// (2000) 288-294, with the ICARUS fit at lower fields).  It evaluates
+// log and pow, and callers that ask for the velocity at the local field
+// of every hit or step can use a DriftVelocityTable instead, which
+// interpolates linearly between nodes spaced by Step() in field.  The
+// parameterization has kinks at the ends of the ICARUS/Walkowiak
+// transition, so the nodes include them and a field is only
+// interpolated between nodes of its own piece.  In the linear low-field
+// piece the velocity is exact.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef DRIFTVELOCITYTABLE_PROTODUNESP_H
+#define DRIFTVELOCITYTABLE_PROTODUNESP_H
+
+#include <vector>
+#include <cstddef>
+
+namespace spdp {
+
+  /// Drift velocity [cm/us] for field [kV/cm] and temperature [K].
+  double DriftVelocityParameterization(double efield, double temperature);
+
+  class DriftVelocityTable {
+  public:
+
+    /// Tabulate the velocity at temperature for fields up to emax [kV/cm]
+    /// with nodes spaced by at most step [kV/cm].
+    void Build(double temperature, double emax =4.0, double step =1.e-4);
+
+    void Clear();
+
+    bool empty() const { return fVelocities.empty(); }
+    double Temperature() const { return fTemperature; }
+    double MaxField() const { return fPieceEnd.empty() ? 0. : fPieceEnd.back(); }
+
+    /// Set vd to the velocity at efield and return true if efield is
+    /// covered by the table.
+    bool Find(double efield, double& vd) const;
+
+  private:
+
+    double fTemperature = 0.;
+    double fLowField = 0.;                 ///< end of the linear piece
+    double fLowSlope = 0.;                 ///< slope of the linear piece
+    std::vector<double> fPieceStart;       ///< lower field of each tabulated piece
+    std::vector<double> fPieceEnd;         ///< upper field of each tabulated piece
+    std::vector<double> fPieceInvStep;     ///< inverse of the node spacing in each piece
+    std::vector<size_t> fPieceFirst;       ///< first node of each piece
+    std::vector<size_t> fPieceSteps;       ///< number of node intervals in each piece
+    std::vector<double> fVelocities;       ///< velocity at each node
+
+  };
+
+} // namespace spdp
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file FileMetadataCache.cxx
+ * @brief Samweb metadata of the input files, see FileMetadataCache.h
+ */
+
+#include "FileMetadataCache.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+  // Text after key up to (not including) end, or to the end of metadata.
+  bool findField(std::string const& metadata, std::string const& key,
+                 std::string const& end, std::string& value) {
+    auto n1 = metadata.find(key);
+    if (n1 == std::string::npos) return false;
+    n1 += key.length();
+    auto n2 = metadata.find(end, n1);
+    value = metadata.substr(n1, n2 == std::string::npos ? std::string::npos : n2 - n1);
+    return true;
+  }
+
+} // local namespace
+
+namespace spdp {
+
+  //--------------------------------------------------------------------
+  FileMetadata FileMetadataCache::Parse(std::string const& metadata) {
+    FileMetadata md;
+    md.hasReadoutWindow = findField(metadata, "DUNE_data.readout_window: ", "\n", md.readoutWindow);
+    md.hasRun = findField(metadata, "Runs: ", ".", md.run);
+    md.hasHV = findField(metadata, "detector.hv_value: ", "\n", md.hv);
+    return md;
+  }
+
+  //--------------------------------------------------------------------
+  FileMetadata const& FileMetadataCache::Get(std::string const& filename, Fetcher const& fetch) {
+    auto ifil = fFiles.find(filename);
+    if (ifil != fFiles.end()) {
+      ++fHits;
+      return ifil->second;
+    }
+    std::string metadata;
+    bool local = false;
+    if (!fLocalDir.empty()) {
+      std::ifstream fin(fLocalDir + "/" + filename + ".metadata");
+      if (fin) {
+        std::ostringstream sin;
+        sin << fin.rdbuf();
+        metadata = sin.str();
+        local = true;
+      }
+    }
+    if (local) {
+      ++fLocalReads;
+    }
+    else {
+      metadata = fetch(filename);
+      ++fFetches;
+    }
+    return fFiles[filename] = Parse(metadata);
+  }
+
+} // namespace spdp
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////
+// \file FileMetadataCache.h
+//
+// \brief Samweb metadata of the input files, fetched once per file
+//
+// DetectorPropertiesProtoDUNEsp reads the readout window, the run and
+// the cathode HV from the samweb metadata of each input file.  The cache
+// fetches the metadata text of a file once (through the fetch function,
+// ifdh in the provider), splits out the fields it uses and keeps them
+// for the following requests for that file.
+//
+// If a local directory is configured, the metadata of a file is read
+// from <directory>/<file name>.metadata when that exists, e.g. from
+//
+//   samweb get-metadata <file name> > <directory>/<file name>.metadata
+//
+// so jobs can run without access to samweb.  Files not found there are
+// fetched as usual.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef FILEMETADATACACHE_PROTODUNESP_H
+#define FILEMETADATACACHE_PROTODUNESP_H
+
+#include <string>
+#include <map>
+#include <functional>
+
+namespace spdp {
+
+  /// Fields of the metadata text, as text.  A field is empty if the
+  /// metadata does not have it.
+  struct FileMetadata {
+    std::string readoutWindow;   ///< DUNE_data.readout_window [ms]
+    std::string run;             ///< run number, from Runs:
+    std::string hv;              ///< detector.hv_value [kV]
+    bool hasReadoutWindow = false;
+    bool hasRun = false;
+    bool hasHV = false;
+  };
+
+  class FileMetadataCache {
+  public:
+
+    using Fetcher = std::function<std::string(std::string const&)>;
+
+    explicit FileMetadataCache(std::string const& localDir = "") : fLocalDir(localDir) { }
+
+    void SetLocalDir(std::string const& localDir) { fLocalDir = localDir; }
+    std::string const& LocalDir() const { return fLocalDir; }
+
+    /// Metadata for file filename, read from the local directory, from
+    /// the cache or with fetch.
+    FileMetadata const& Get(std::string const& filename, Fetcher const& fetch);
+
+    /// Split the fields out of metadata text.
+    static FileMetadata Parse(std::string const& metadata);
+
+    /// Number of files fetched, read from the local directory and found
+    /// in the cache.
+    unsigned int Fetches() const { return fFetches; }
+    unsigned int LocalReads() const { return fLocalReads; }
+    unsigned int Hits() const { return fHits; }
+
+  private:
+
+    std::string fLocalDir;
+    std::map<std::string, FileMetadata> fFiles;
+    unsigned int fFetches = 0;
+    unsigned int fLocalReads = 0;
+    unsigned int fHits = 0;
+
+  };
+
+} // namespace spdp
+
+#endif
@@ -0,0 +1,114 @@
+// test_DriftVelocityTable.cxx
+//
+// Check the accuracy of DriftVelocityTable against the analytic drift
+// velocity parameterization over the ProtoDUNE temperatures, with fields
+// on either side of the pieces of the parameterization.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/DetectorServices/Providers/DriftVelocityTable.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using spdp::DriftVelocityTable;
+using spdp::DriftVelocityParameterization;
+
+//**********************************************************************
+
+int test_DriftVelocityTable(size_t npt) {
+  const string myname = "test_DriftVelocityTable: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(2019);
+  std::uniform_real_distribution<double> fieldDist(0.0, 4.0);
+  std::uniform_real_distribution<double> nearDist(-1.e-3, 1.e-3);
+  const double maxRelErr = 2.e-7;
+
+  cout << myname << line << endl;
+  cout << myname << "Empty table." << endl;
+  {
+    DriftVelocityTable tab;
+    double vd = 0.0;
+    assert( tab.empty() );
+    assert( !tab.Find(0.5, vd) );
+  }
+
+  for ( double temp : {87.36, 87.65, 87.68, 89.0} ) {
+    cout << myname << line << endl;
+    cout << myname << "Temperature " << temp << " K." << endl;
+    DriftVelocityTable tab;
+    tab.Build(temp);
+    assert( !tab.empty() );
+    assert( tab.Temperature() == temp );
+    assert( tab.MaxField() == 4.0 );
+    double maxerr = 0.0;
+    double vd = 0.0;
+    for ( size_t ipt=0; ipt<npt; ++ipt ) {
+      double efield = fieldDist(rng);
+      // Some fields close to the kinks.
+      if ( ipt%4 == 1 ) efield = 0.619 + nearDist(rng);
+      if ( ipt%4 == 2 ) efield = 0.699 + nearDist(rng);
+      assert( tab.Find(efield, vd) );
+      double vdExact = DriftVelocityParameterization(efield, temp);
+      double err = std::abs(vd - vdExact)/vdExact;
+      if ( err > maxerr ) maxerr = err;
+    }
+    cout << myname << "Maximum relative error: " << maxerr << endl;
+    assert( maxerr < maxRelErr );
+    // Piece edges and the nominal fields.
+    for ( double efield : {0.05, 0.4867, 0.4995, 0.5, 0.619, 0.699, 1.0, 4.0} ) {
+      assert( tab.Find(efield, vd) );
+      double vdExact = DriftVelocityParameterization(efield, temp);
+      assert( std::abs(vd - vdExact) < maxRelErr*vdExact );
+    }
+    // Outside the table.
+    assert( !tab.Find(4.0001, vd) );
+    assert( !tab.Find(-0.1, vd) );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Linear piece is exact." << endl;
+  {
+    DriftVelocityTable tab;
+    tab.Build(87.65);
+    for ( double efield : {0.0, 0.01, 0.05} ) {
+      double vd = -1.0;
+      assert( tab.Find(efield, vd) );
+      assert( vd == DriftVelocityParameterization(efield, 87.65) );
+    }
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t npt = 200000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NPT]" << endl;
+      cout << "  NPT [200000]: Number of fields to check at each temperature." << endl;
+      return 0;
+    }
+    npt = std::stoul(sarg);
+  }
+  return test_DriftVelocityTable(npt);
+}
+
+//**********************************************************************
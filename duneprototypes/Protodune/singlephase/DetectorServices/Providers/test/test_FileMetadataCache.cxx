@@ -0,0 +1,119 @@
+// test_FileMetadataCache.cxx
+//
+// Test FileMetadataCache: the fields split out of samweb metadata text,
+// one fetch per file and the local directory stand-in.
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+#include "duneprototypes/Protodune/singlephase/DetectorServices/Providers/FileMetadataCache.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using spdp::FileMetadata;
+using spdp::FileMetadataCache;
+
+//**********************************************************************
+
+int test_FileMetadataCache() {
+  const string myname = "test_FileMetadataCache: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+
+  const string metadata =
+    "File Name: np04_raw_run005387_0041_dl7.root\n"
+    "File Type: detector\n"
+    "Runs: 5387.1 (protodune-sp)\n"
+    "DUNE_data.readout_window: 3.0\n"
+    "detector.hv_value: 180\n";
+
+  cout << myname << line << endl;
+  cout << myname << "Parse." << endl;
+  {
+    FileMetadata md = FileMetadataCache::Parse(metadata);
+    assert( md.hasRun && md.run == "5387" );
+    assert( md.hasReadoutWindow && md.readoutWindow == "3.0" );
+    assert( md.hasHV && md.hv == "180" );
+    md = FileMetadataCache::Parse("Runs: 6725.1 (protodune-sp)\ndetector.hv_value: 120.5");
+    assert( md.hasRun && md.run == "6725" );
+    assert( !md.hasReadoutWindow );
+    assert( md.hasHV && md.hv == "120.5" );
+    md = FileMetadataCache::Parse("");
+    assert( !md.hasRun && !md.hasReadoutWindow && !md.hasHV );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Fetch once per file." << endl;
+  unsigned int nfetch = 0;
+  auto fetch = [&nfetch, &metadata](string const& fname) {
+    ++nfetch;
+    return fname == "missing.root" ? string() : metadata;
+  };
+  {
+    FileMetadataCache cache;
+    assert( cache.Get("a.root", fetch).run == "5387" );
+    assert( cache.Get("a.root", fetch).hv == "180" );
+    assert( !cache.Get("missing.root", fetch).hasHV );
+    assert( !cache.Get("missing.root", fetch).hasRun );
+    assert( nfetch == 2 );
+    assert( cache.Fetches() == 2 );
+    assert( cache.Hits() == 2 );
+    assert( cache.LocalReads() == 0 );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Local directory." << endl;
+  {
+    char dirTemplate[] = "/tmp/test_FileMetadataCacheXXXXXX";
+    string dir = mkdtemp(dirTemplate);
+    string fpath = dir + "/b.root.metadata";
+    {
+      std::ofstream fout(fpath);
+      fout << "Runs: 7000.2 (protodune-sp)\nDUNE_data.readout_window: 5.0\n";
+    }
+    nfetch = 0;
+    FileMetadataCache cache(dir);
+    assert( cache.LocalDir() == dir );
+    FileMetadata const& md = cache.Get("b.root", fetch);
+    assert( md.run == "7000" );
+    assert( md.readoutWindow == "5.0" );
+    assert( !md.hasHV );
+    assert( nfetch == 0 );
+    assert( cache.LocalReads() == 1 );
+    // Not in the directory: fetched.
+    assert( cache.Get("a.root", fetch).run == "5387" );
+    assert( nfetch == 1 );
+    assert( cache.Fetches() == 1 );
+    std::remove(fpath.c_str());
+    rmdir(dir.c_str());
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << endl;
+      return 0;
+    }
+  }
+  return test_FileMetadataCache();
+}
+
+//**********************************************************************
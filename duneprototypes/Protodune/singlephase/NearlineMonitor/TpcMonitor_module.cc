@@ -33,7 +33,11 @@
 #include "canvas/Persistency/Common/FindManyP.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "duneprototypes/Protodune/singlephase/NearlineMonitor/TpcSpectrumEngine.h"
 #include "dunepdlegacy/Services/ChannelMap/PdspChannelMapService.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
 
 // ROOT includes.
 #include "TH1.h"
@@ -56,6 +60,7 @@
 #include <string>
 #include <sstream>
 #include <cmath>
+#include <memory>
 
 #ifdef __MAKECINT__
 #pragma link C++ class vector<vector<int> >+;
@@ -173,16 +178,53 @@ namespace tpc_monitor{
     
     // Profiled fft by fiber
     std::vector<TProfile*> fFFT_by_Fiber_pfx;
+
+    // Noise spectra, summed and added to the FFT histograms above at end of
+    // job or every fSpectrumFillInterval events.  The index vectors give the
+    // engine index of each histogram.
+    std::unique_ptr<TpcSpectrumEngine> fSpectra;
+    int fSpectrumFillInterval;
+    unsigned int fNSpectrumEvents;
+    std::vector<size_t> fSpecChanFFTU;
+    std::vector<size_t> fSpecChanFFTV;
+    std::vector<size_t> fSpecChanFFTZ;
+    std::vector<size_t> fSpecPersistentFFT_by_APA;
+    std::vector<size_t> fSpecFFT_by_Fiber_pfx;
+
+    // Results for one channel of an event.  The channel loop computes these
+    // for all channels, on fMaxConcurrency threads, before any histogram is
+    // filled.  The spectra go to the engine of the thread.
+    struct ChannelSummary {
+      uint32_t chan;
+      unsigned int apa;
+      geo::View_t view;
+      int xBin;                    // bin in fAllChanMean
+      int yBin;
+      int SlotID;
+      uint32_t SlotChannelNumber;
+      size_t iPersistent;          // engine indices
+      size_t iFiber;
+      bool hasChanFFT;
+      size_t iChanFFT;
+      int nSamples;
+      float mean;
+      float rms;
+      float fracstuckoff;
+      float fracstuckon;
+      unsigned int nBit[12];       // samples with bit mm 0 or 1
+      unsigned int nBitOn[12];     // samples with bit mm 1
+    };
+    std::vector<ChannelSummary> fChannelSummaries;
+
+    // Channels processed in parallel: 1 = serial, 0 = no limit
+    int fMaxConcurrency;
+    // spectrum engines of the worker threads, cloned from fSpectra
+    tbb::enumerable_thread_specific<std::unique_ptr<TpcSpectrumEngine>> fThreadSpectra;
     	
     // Rebin factor
     int fRebinX;
     int fRebinY; 
 
-    // define nADC counts for uncompressed vs compressed
-    unsigned int nADC_comp;
-    unsigned int nADC_uncomp;
-    unsigned int nADC_uncompPed;
-
     TH1F *fNTicksTPC;
 
     // Noise level cut parameters
@@ -214,8 +256,11 @@ namespace tpc_monitor{
     // define functions
     float rmsADC(std::vector< short > & uncompressed);
     float meanADC(std::vector< short > & uncompressed);
-    void calculateFFT(TH1D* hist_waveform, TH1D* graph_frequency);
     void FillChannelHistos(TProfile* h1, double mean, double sigma, int& ndeadchannels, int& nnoisychannels_sigma, int& nnoisychannels_counts);
+    void processChannel(const raw::RawDigit& digit, TpcSpectrumEngine& spectra, ChannelSummary& sum);
+    TpcSpectrumEngine& threadSpectra();
+    void flushSpectra();
+    void fillBitValue(TProfile2D* h, double x, double y, double n, double nOn);
     geo::GeometryCore const * fGeom = &*(art::ServiceHandle<geo::Geometry>());
 
     std::vector<unsigned int> fApaLabelNum;
@@ -226,7 +271,7 @@ namespace tpc_monitor{
   //-----------------------------------------------------------------------
 
   TpcMonitor::TpcMonitor(fhicl::ParameterSet const& parameterSet)
-    : EDAnalyzer(parameterSet), fRebinX(1), fRebinY(1), fApaLabelNum{3,5,2,6,1,4} {
+    : EDAnalyzer(parameterSet), fRebinX(1), fRebinY(1), fNSpectrumEvents(0), fApaLabelNum{3,5,2,6,1,4} {
     this->reconfigure(parameterSet);
   }
 
@@ -240,6 +285,7 @@ namespace tpc_monitor{
   
   void TpcMonitor::beginJob() {
     art::ServiceHandle<art::TFileService> tfs;
+    fSpectra.reset(new TpcSpectrumEngine(fBinWidth));
     unsigned int UChMin;
     unsigned int UChMax;
     unsigned int VChMin;
@@ -357,6 +403,9 @@ namespace tpc_monitor{
 	fChanFFTU[i]->Rebin2D(fRebinX, fRebinY);
 	fChanFFTV[i]->Rebin2D(fRebinX, fRebinY);
 	fChanFFTZ[i]->Rebin2D(fRebinX, fRebinY);
+	fSpecChanFFTU.push_back(fSpectra->AddChannelMap(fChanFFTU[i]));
+	fSpecChanFFTV.push_back(fSpectra->AddChannelMap(fChanFFTV[i]));
+	fSpecChanFFTZ.push_back(fSpectra->AddChannelMap(fChanFFTZ[i]));
       }
     
     //All in one view
@@ -416,6 +465,7 @@ namespace tpc_monitor{
       // still keep the profiled FFT's by FEMB
       fFFT_by_Fiber_pfx.push_back(tfs->make<TProfile>(Form("Profiled_FFT_FEMB_%d", imb), Form("Profiled FFT FEMB_%d WIB%d", imb, ( (i/4) %5)+1), fNticks/2, 0, fNticks/2*fBinWidth, -100, 50));
       fFFT_by_Fiber_pfx[i]->GetXaxis()->SetTitle("Frequency [kHz]"); fFFT_by_Fiber_pfx[i]->GetYaxis()->SetTitle("Amplitude [dB]"); 
+      fSpecFFT_by_Fiber_pfx.push_back(fSpectra->AddProfile(fFFT_by_Fiber_pfx[i]));
     }
     // persistent FFT now by APA
     for (int i=0;i<6;++i)
@@ -423,6 +473,7 @@ namespace tpc_monitor{
 	fPersistentFFT_by_APA.push_back(tfs->make<TH2F>(Form("Persistent_FFT_APA_%d", fApaLabelNum[i]), Form("FFT APA%d ", fApaLabelNum[i]), fNticks/2, 0, fNticks/2*fBinWidth, 150, -100, 50));
         fPersistentFFT_by_APA[i]->GetXaxis()->SetTitle("Frequency [kHz]"); 
 	fPersistentFFT_by_APA[i]->GetYaxis()->SetTitle("Amplitude [dB]"); 
+	fSpecPersistentFFT_by_APA.push_back(fSpectra->AddPersistent(fPersistentFFT_by_APA[i]));
       }
 
     fNTicksTPC = tfs->make<TH1F>("NTicksTPC","NTicks in TPC Channels",100,0,20000);
@@ -502,6 +553,8 @@ namespace tpc_monitor{
     fNoiseLevelMinNCountsV = p.get<int>("NoiseLevelMinNCountsV");
     fNoiseLevelMinNCountsZ = p.get<int>("NoiseLevelMinNCountsZ");
     fNoiseLevelNSigma     = p.get<double>("NoiseLevelNSigma");
+    fSpectrumFillInterval = p.get<int>("SpectrumFillInterval", 0);
+    fMaxConcurrency = p.get<int>("MaxConcurrency", 1);
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataForJob(clockData);
     fNticks         = detProp.NumberTimeSamples();
@@ -564,73 +617,24 @@ namespace tpc_monitor{
 	//std::cout << "RDStatus:  Status Word " << rdstatus.GetStatWord() << std::endl; 
       }
 
-    // Loop over all RawRCEDigits (entire channels)                                                                                                        
-    for(auto const & dptr : RawDigits) {
-      const raw::RawDigit & digit = *dptr;
-      
-      // Get the channel number for this digit
-      uint32_t chan = digit.Channel();
-      // number of samples in uncompressed ADC
-      int nSamples = digit.Samples();
-      fNTicksTPC->Fill(nSamples);
-      unsigned int apa = std::floor( chan/fChansPerAPA );	  
-      //int pedestal = (int)digit.GetPedestal();
-      int pedestal = 0;  
-
-      std::vector<short> uncompressed(nSamples);
-      // with pedestal	  
-      raw::Uncompress(digit.ADCs(), uncompressed, pedestal, digit.Compression());
-
-      // number of compressed ADCs
-      nADC_comp=digit.NADC();
-      // number of ADC uncompressed
-      nADC_uncomp=uncompressed.size();	  
-      // subtract pedestals
-      std::vector<short> uncompPed(nSamples);
-
-      int nstuckoff=0;
-      int nstuckon=0;
-      for (int i=0; i<nSamples; i++) 
-	{ 
-	  auto adc=uncompressed.at(i);
-	  auto adcl6b = adc & 0x3F;
-	  if (adcl6b == 0) ++nstuckoff;
-	  if (adcl6b == 0x3F) ++nstuckon;
-	  uncompPed.at(i) = adc - pedestal;
-        }
-      float fracstuckoff = ((float) nstuckoff)/((float) nSamples);
-      float fracstuckon = ((float) nstuckon)/((float) nSamples);
+    // Channel information from the geometry and channel map
+    fChannelSummaries.resize(RawDigits.size());
+    for (size_t idig=0; idig<RawDigits.size(); ++idig) {
+      ChannelSummary& sum = fChannelSummaries[idig];
+      uint32_t chan = RawDigits[idig]->Channel();
+      unsigned int apa = std::floor( chan/fChansPerAPA );
+      sum.chan = chan;
+      sum.apa = apa;
+      sum.view = fGeom->View(chan);
 
-      // number of ADC uncompressed without pedestal
-      nADC_uncompPed=uncompPed.size();	 
-      
-      // wavefrom histogram   
       int FiberID = channelMap->FiberIdFromOfflineChannel(chan);
-      TH1D* histwav=new TH1D(Form("wav%d",(int)chan),Form("wav%d",(int)chan),nSamples,0,nSamples); 
-      
-      for(int k=0;k<(int)nADC_uncompPed;k++) {
-	histwav->SetBinContent(k+1, uncompPed.at(k));
-	// Fill Persistent waveform by fiber -- skip as it takes too much RAM
-	//fPersistentWav_by_Fiber.at(FiberID)->Fill(k+1, uncompPed.at(k));
-      }
-	    
-      // Do FFT for single waveforms
-      TH1D* histfft=new TH1D(Form("fft%d",(int)chan),Form("fft%d",(int)chan),nSamples,0,nSamples*fBinWidth); 
-      calculateFFT(histwav, histfft);
-      // Fill persistent/overlay FFT for each fiber/FEMB
-      for(int k=0;k<(int)nADC_uncompPed/2;k++) {
-	fPersistentFFT_by_APA.at(apa)->Fill((k+0.5)*fBinWidth, histfft->GetBinContent(k+1));    // offline apa number.  Plot labels are online
-	fFFT_by_Fiber_pfx.at(FiberID % 120)->Fill((k+0.5)*fBinWidth, histfft->GetBinContent(k+1));
-      }
-
-      // summary stuck code fraction distributions by APA -- here the APA is the offline APA number.  The plot labels contain the mapping
-
-      fStuckCodeOffFrac[apa]->Fill(fracstuckoff);
-      fStuckCodeOnFrac[apa]->Fill(fracstuckon);
- 
-      // Mean and RMS
-      float mean = meanADC(uncompPed);
-      float rms = rmsADC(uncompPed);
+      sum.iPersistent = fSpecPersistentFFT_by_APA.at(apa);
+      sum.iFiber = fSpecFFT_by_Fiber_pfx.at(FiberID % 120);
+      sum.hasChanFFT = true;
+      if (sum.view == geo::kU) sum.iChanFFT = fSpecChanFFTU[apa];
+      else if (sum.view == geo::kV) sum.iChanFFT = fSpecChanFFTV[apa];
+      else if (sum.view == geo::kZ) sum.iChanFFT = fSpecChanFFTZ[apa];
+      else sum.hasChanFFT = false;
 
       //get ready to fill the summary plots
       //get the channel's FEMB and WIB
@@ -640,99 +644,198 @@ namespace tpc_monitor{
       int iFEMB = ((WIB*4)+(FEMB-1)); //index of the FEMB 0-19
       //Get the location of any FEMBchan in the hitogram
       //put as a function for clenliness.
-      int xBin = ((FEMBchanToHistogramMap(FEMBchan,0))+(iFEMB*4)+xEdgeAPA[apa]); // (fembchan location on histogram) + shift from mobo + shift from apa
-      int yBin = ((FEMBchanToHistogramMap(FEMBchan,1))+yEdgeAPA[(apa%2)]); //(fembchan location on histogram) + shift from apa 
-
-      fAllChanMean->Fill(xBin,yBin,mean); //histogram the mean
-      fAllChanRMS->Fill(xBin,yBin,rms); //histogram the rms
-
-      for (int i=0; i<nSamples; i++) //histogram the 12 bits
-	{ 
-	  auto adc=uncompressed.at(i);
-	  int bitstring = adc;
-	  for(int mm=0;mm<12;mm++)
-	    {
-	      // get the bit value from the adc
-	      int bit = (bitstring%2);
-	      fBitValue[mm]->Fill(xBin,yBin,bit);
-	      bitstring = (bitstring/2);
-	    }
-	}
+      sum.xBin = ((FEMBchanToHistogramMap(FEMBchan,0))+(iFEMB*4)+xEdgeAPA[apa]); // (fembchan location on histogram) + shift from mobo + shift from apa
+      sum.yBin = ((FEMBchanToHistogramMap(FEMBchan,1))+yEdgeAPA[(apa%2)]); //(fembchan location on histogram) + shift from apa 
+
+      // Mean/RMS by slot
+      sum.SlotID = channelMap->SlotIdFromOfflineChannel(chan);
+      int FiberNumber = FEMB - 1;
+      int FiberChannelNumber = FEMBchan;
+      sum.SlotChannelNumber = FiberNumber*128 + FiberChannelNumber; //128 channels per fiber
+    }
+
+    // Loop over all RawRCEDigits (entire channels)
+    if (fMaxConcurrency == 1 || RawDigits.size() < 2) {
+      for (size_t idig=0; idig<RawDigits.size(); ++idig) {
+        processChannel(*RawDigits[idig], *fSpectra, fChannelSummaries[idig]);
+      }
+    } else {
+      // 0 means use the scheduler's own limit
+      int nthread = fMaxConcurrency > 0 ? fMaxConcurrency : tbb::task_arena::automatic;
+      tbb::task_arena arena(nthread);
+      arena.execute([&] {
+          tbb::parallel_for(size_t(0), RawDigits.size(),
+                            [&](size_t idig) { processChannel(*RawDigits[idig], threadSpectra(), fChannelSummaries[idig]); });
+        });
+    }
+
+    // Fill the histograms in channel order.
+    for (const ChannelSummary& sum : fChannelSummaries) {
+      uint32_t chan = sum.chan;
+      unsigned int apa = sum.apa;
+      float mean = sum.mean;
+      float rms = sum.rms;
+      float fracstuckoff = sum.fracstuckoff;
+      float fracstuckon = sum.fracstuckon;
+
+      fNTicksTPC->Fill(sum.nSamples);
+
+      // summary stuck code fraction distributions by APA -- here the APA is the offline APA number.  The plot labels contain the mapping
+
+      fStuckCodeOffFrac[apa]->Fill(fracstuckoff);
+      fStuckCodeOnFrac[apa]->Fill(fracstuckon);
+
+      fAllChanMean->Fill(sum.xBin,sum.yBin,mean); //histogram the mean
+      fAllChanRMS->Fill(sum.xBin,sum.yBin,rms); //histogram the rms
+
+      //histogram the 12 bits
+      for(int mm=0;mm<12;mm++) fillBitValue(fBitValue[mm], sum.xBin, sum.yBin, sum.nBit[mm], sum.nBitOn[mm]);
 
-	     
       // U View, induction Plane	  
-      if( fGeom->View(chan) == geo::kU){	
+      if( sum.view == geo::kU){	
 	fChanMeanU_pfx[apa]->Fill(chan, mean, 1);
 	fChanRMSU_pfx[apa]->Fill(chan, rms, 1);
 	fChanMeanDistU[apa]->Fill(mean);
 	fChanRMSDistU[apa]->Fill(rms);
 	fChanStuckCodeOffFracU[apa]->Fill(chan,fracstuckoff,1);
 	fChanStuckCodeOnFracU[apa]->Fill(chan,fracstuckon,1);
-	      
-	//fft
-	for(int l=0;l<nSamples/2;l++) { 
-	  //for the 2D histos
-	  fChanFFTU[apa]->Fill(chan, (l+0.5)*fBinWidth, histfft->GetBinContent(l+1));
-	}
-
       }// end of U View
 
       // V View, induction Plane
-      if( fGeom->View(chan) == geo::kV){
+      if( sum.view == geo::kV){
         fChanRMSV_pfx[apa]->Fill(chan, rms, 1);
 	fChanMeanV_pfx[apa]->Fill(chan, mean, 1);
 	fChanMeanDistV[apa]->Fill(mean);
 	fChanRMSDistV[apa]->Fill(rms);
 	fChanStuckCodeOffFracV[apa]->Fill(chan,fracstuckoff,1);
 	fChanStuckCodeOnFracV[apa]->Fill(chan,fracstuckon,1);
-	      
-	//fft
-	for(int l=0;l<nSamples/2;l++) { 
-	  //for the 2D histos
-	  fChanFFTV[apa]->Fill(chan, (l+0.5)*fBinWidth, histfft->GetBinContent(l+1));
-	}
-
       }// end of V View               
 
       // Z View, collection Plane
-      if( fGeom->View(chan) == geo::kZ){
+      if( sum.view == geo::kZ){
 	fChanMeanZ_pfx[apa]->Fill(chan, mean, 1);
 	fChanRMSZ_pfx[apa]->Fill(chan, rms, 1);
 	fChanMeanDistZ[apa]->Fill(mean);
 	fChanRMSDistZ[apa]->Fill(rms);
 	fChanStuckCodeOffFracZ[apa]->Fill(chan,fracstuckoff,1);
 	fChanStuckCodeOnFracZ[apa]->Fill(chan,fracstuckon,1);
-	      
-	//fft
-	for(int l=0;l<nSamples/2;l++) {
-	  //for the 2D histos
-	  fChanFFTZ[apa]->Fill(chan, (l+0.5)*fBinWidth, histfft->GetBinContent(l+1));
-	}
-
       }// end of Z View
       
       // Mean/RMS by slot
-      int SlotID = channelMap->SlotIdFromOfflineChannel(chan);
-      int FiberNumber = channelMap->FEMBFromOfflineChannel(chan) - 1;
-      int FiberChannelNumber = channelMap->FEMBChannelFromOfflineChannel(chan);
-      uint32_t SlotChannelNumber = FiberNumber*128 + FiberChannelNumber; //128 channels per fiber
-      fSlotChanMean_pfx.at(SlotID)->Fill(SlotChannelNumber, mean, 1);
-      fSlotChanRMS_pfx.at(SlotID)->Fill(SlotChannelNumber, rms, 1);
-      
-      // FFT by slot
-      for(int l=0;l<nSamples/2;l++) {
-	//for the 2D histos
-	// fSlotChanFFT.at(SlotID)->Fill(SlotChannelNumber, (l+0.5)*fBinWidth, histfft->GetBinContent(l+1));
-      }
-      
-      histwav->Delete(); 
-      histfft->Delete();                                                                                                                    
+      fSlotChanMean_pfx.at(sum.SlotID)->Fill(sum.SlotChannelNumber, mean, 1);
+      fSlotChanRMS_pfx.at(sum.SlotID)->Fill(sum.SlotChannelNumber, rms, 1);
       
     } // RawDigits
+
+    if (fSpectrumFillInterval > 0 && ++fNSpectrumEvents % fSpectrumFillInterval == 0) flushSpectra();
     
     return;
   }
   
+  //-----------------------------------------------------------------------
+  // Uncompress one channel, sum its spectrum and fill in the rest of its
+  // summary.  Writes only sum and spectra, so different channels may be
+  // processed concurrently.
+  void TpcMonitor::processChannel(const raw::RawDigit& digit, TpcSpectrumEngine& spectra, ChannelSummary& sum) {
+    // number of samples in uncompressed ADC
+    int nSamples = digit.Samples();
+    //int pedestal = (int)digit.GetPedestal();
+    int pedestal = 0;  
+
+    std::vector<short> uncompressed(nSamples);
+    // with pedestal	  
+    raw::Uncompress(digit.ADCs(), uncompressed, pedestal, digit.Compression());
+
+    // subtract pedestals
+    std::vector<short> uncompPed(nSamples);
+
+    int nstuckoff=0;
+    int nstuckon=0;
+    for (int i=0; i<nSamples; i++) 
+      { 
+	auto adc=uncompressed[i];
+	auto adcl6b = adc & 0x3F;
+	if (adcl6b == 0) ++nstuckoff;
+	if (adcl6b == 0x3F) ++nstuckon;
+	uncompPed[i] = adc - pedestal;
+      }
+    sum.nSamples = nSamples;
+    sum.fracstuckoff = ((float) nstuckoff)/((float) nSamples);
+    sum.fracstuckon = ((float) nstuckon)/((float) nSamples);
+
+    // Do FFT for single waveforms: amplitude in dB for nSamples/2 frequencies
+    const std::vector<double>& fft = spectra.Transform(uncompPed);
+    // Fill persistent/overlay FFT for each fiber/FEMB
+    spectra.FillPersistent(sum.iPersistent, fft);    // offline apa number.  Plot labels are online
+    spectra.FillProfile(sum.iFiber, fft);
+    if (sum.hasChanFFT) spectra.FillChannelMap(sum.iChanFFT, sum.chan, fft);
+
+    // Mean and RMS
+    sum.mean = meanADC(uncompPed);
+    sum.rms = rmsADC(uncompPed);
+
+    // Count the 12 bits.  A negative ADC gives bit values -1, which are
+    // outside the limits of fBitValue and were never filled.
+    for(int mm=0;mm<12;mm++) { sum.nBit[mm] = 0; sum.nBitOn[mm] = 0; }
+    for (int i=0; i<nSamples; i++)
+      { 
+	int bitstring = uncompressed[i];
+	for(int mm=0;mm<12;mm++)
+	  {
+	    // get the bit value from the adc
+	    int bit = (bitstring%2);
+	    if (bit >= 0) { ++sum.nBit[mm]; sum.nBitOn[mm] += bit; }
+	    bitstring = (bitstring/2);
+	  }
+      }
+  }
+
+  //-----------------------------------------------------------------------
+  // Spectrum engine of the calling worker thread.
+  TpcSpectrumEngine& TpcMonitor::threadSpectra() {
+    std::unique_ptr<TpcSpectrumEngine>& spectra = fThreadSpectra.local();
+    if (!spectra) spectra = fSpectra->Clone();
+    return *spectra;
+  }
+
+  //-----------------------------------------------------------------------
+  // Add the noise spectra summed by all the engines to the histograms.
+  void TpcMonitor::flushSpectra() {
+    fSpectra->Flush();
+    for (std::unique_ptr<TpcSpectrumEngine>& spectra : fThreadSpectra) {
+      if (spectra) spectra->Flush();
+    }
+  }
+
+  //-----------------------------------------------------------------------
+  // Fill a bit value profile at (x, y) with n values 0 or 1, nOn of them 1.
+  // Makes the bin sums, entries and statistics of n calls to Fill.
+  void TpcMonitor::fillBitValue(TProfile2D* h, double x, double y, double n, double nOn) {
+    if (n == 0) return;
+    // before the contents change: GetStats may recompute from them
+    double stats[9];
+    h->GetStats(stats);
+    int binx = h->GetXaxis()->FindFixBin(x);
+    int biny = h->GetYaxis()->FindFixBin(y);
+    int bin = h->GetBin(binx, biny);
+    h->GetW()[bin] += nOn;
+    h->GetW2()[bin] += nOn;
+    h->GetB()[bin] += n;
+    if (h->GetB2() != nullptr) h->GetB2()[bin] += n;
+    h->SetEntries(h->GetEntries() + n);
+    if (binx < 1 || binx > h->GetNbinsX() || biny < 1 || biny > h->GetNbinsY()) return;
+    stats[0] += n;
+    stats[1] += n;
+    stats[2] += n*x;
+    stats[3] += n*x*x;
+    stats[4] += n*y;
+    stats[5] += n*y*y;
+    stats[6] += n*x*y;
+    stats[7] += nOn;
+    stats[8] += nOn;
+    h->PutStats(stats);
+  }
+
   //-----------------------------------------------------------------------   
   // define RMS
   float TpcMonitor::rmsADC(std::vector< short > &uncomp)
@@ -764,35 +867,6 @@ namespace tpc_monitor{
     return sum / n;
   }
   
-  //-----------------------------------------------------------------------  
-  //calculate FFT
-  void TpcMonitor::calculateFFT(TH1D* hist_waveform, TH1D* hist_frequency) {
-  
-    int n_bins = hist_waveform->GetNbinsX();
-    TH1* hist_transform = 0;
-
-    // Create hist_transform from the input hist_waveform
-    hist_transform = hist_waveform->FFT(hist_transform, "MAG");
-    hist_transform -> Scale (1.0 / float(n_bins));
-    int nFFT=hist_transform->GetNbinsX();
-  
-    double frequency;
-    double amplitude;
-    double amplitudeLog;
-  
-    // Loop on the hist_transform to fill the hist_transform_frequency                                                                                        
-    for (int k = 0; k < nFFT/2; k++){
-
-      frequency =  (k+0.5)*fBinWidth; // kHz
-      amplitude = hist_transform->GetBinContent(k+1); 
-      amplitudeLog = 20*log10(amplitude); // dB
-      hist_frequency->Fill(frequency, amplitudeLog);
-    }
-
-    hist_transform->Delete();
-  
-  }
-  
   //-----------------------------------------------------------------------
   // Fill dead/noisy channels tree
   void TpcMonitor::FillChannelHistos(TProfile* h1, double mean, double sigma, int& ndeadchannels, int& nnoisychannels_sigma, int& nnoisychannels_counts){
@@ -883,6 +957,9 @@ namespace tpc_monitor{
   //-----------------------------------------------------------------------  
   void TpcMonitor::endJob() {
 
+    // Add the remaining noise spectra to the histograms.
+    flushSpectra();
+
     // Find dead/noisy channels. Do this separately for each APA and for each view.
     std::vector<double> fURMS_mean; std::vector<double> fURMS_sigma;
     std::vector<double> fVRMS_mean; std::vector<double> fVRMS_sigma;
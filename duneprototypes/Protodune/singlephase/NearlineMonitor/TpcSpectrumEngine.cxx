@@ -0,0 +1,304 @@
+// TpcSpectrumEngine.cxx
+
+#include "TpcSpectrumEngine.h"
+
+#include "cetlib_except/exception.h"
+
+#include "TAxis.h"
+#include "TH2.h"
+#include "TProfile.h"
+#include "TVirtualFFT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+using tpc_monitor::TpcSpectrumEngine;
+
+namespace {
+  // The FFTW planner and ROOT's plugin lookup are not thread safe.
+  std::mutex planMutex;
+}
+
+//-----------------------------------------------------------------------
+
+TpcSpectrumEngine::TpcSpectrumEngine(float binWidth) : fBinWidth(binWidth) { }
+
+//-----------------------------------------------------------------------
+
+TpcSpectrumEngine::~TpcSpectrumEngine() = default;
+
+//-----------------------------------------------------------------------
+
+const std::vector<double> & TpcSpectrumEngine::Transform(const short * adcs, size_t n)
+{
+  fDb.clear();
+  if (n < 2) return fDb;
+  std::unique_ptr<TVirtualFFT> & plan = fPlans[n];
+  if (!plan) {
+    // planning is done once per length, so let FFTW measure
+    int ni = n;
+    std::lock_guard<std::mutex> lock(planMutex);
+    plan.reset(TVirtualFFT::FFT(1, &ni, "R2C M K"));
+    if (!plan) {
+      fPlans.erase(n);
+      throw cet::exception("TpcSpectrumEngine")
+        << "Unable to create an FFT of length " << n << ".\n";
+    }
+  }
+  fIn.assign(adcs, adcs + n);
+  plan->SetPoints(fIn.data());
+  plan->Transform();
+  fRe.resize(n/2 + 1);
+  fIm.resize(n/2 + 1);
+  plan->GetPointsComplex(fRe.data(), fIm.data());
+  const double scale = 1.0/n;
+  fDb.resize(n/2);
+  for (size_t k = 0; k < n/2; ++k) {
+    double amplitude = std::sqrt(fRe[k]*fRe[k] + fIm[k]*fIm[k])*scale;
+    fDb[k] = 20*std::log10(amplitude);
+  }
+  return fDb;
+}
+
+//-----------------------------------------------------------------------
+
+std::unique_ptr<TpcSpectrumEngine> TpcSpectrumEngine::Clone() const
+{
+  std::unique_ptr<TpcSpectrumEngine> eng(new TpcSpectrumEngine(fBinWidth));
+  for (const ChannelMap & acc : fMaps) eng->AddChannelMap(acc.h);
+  for (const Profile & acc : fProfiles) eng->AddProfile(acc.h);
+  for (const Persistent & acc : fPersistents) eng->AddPersistent(acc.h);
+  return eng;
+}
+
+//-----------------------------------------------------------------------
+
+size_t TpcSpectrumEngine::AddChannelMap(TH2 * h)
+{
+  fMaps.push_back(ChannelMap{h, {}, {}, {}, {0, 0, 0, 0, 0, 0, 0}, 0});
+  return fMaps.size() - 1;
+}
+
+//-----------------------------------------------------------------------
+
+size_t TpcSpectrumEngine::AddProfile(TProfile * h)
+{
+  fProfiles.push_back(Profile{h, h->GetYmin(), h->GetYmax(), {}, {}, {}});
+  return fProfiles.size() - 1;
+}
+
+//-----------------------------------------------------------------------
+
+size_t TpcSpectrumEngine::AddPersistent(TH2 * h)
+{
+  fPersistents.push_back(Persistent{h, h->GetNbinsY(), {}, {}, {}, {}});
+  return fPersistents.size() - 1;
+}
+
+//-----------------------------------------------------------------------
+
+void TpcSpectrumEngine::FillChannelMap(size_t imap, unsigned int chan, const std::vector<double> & db)
+{
+  ChannelMap & acc = fMaps.at(imap);
+  TH2 * h = acc.h;
+  size_t nk = db.size();
+  for (size_t k = acc.ybins.size(); k < nk; ++k) {
+    acc.ybins.push_back(h->GetYaxis()->FindFixBin(Frequency(k)));
+  }
+  if (acc.sumw.empty()) {
+    acc.sumw.assign(h->GetNcells(), 0.0);
+    acc.sumw2.assign(h->GetNcells(), 0.0);
+  }
+  double x = chan;
+  int xbin = h->GetXaxis()->FindFixBin(x);
+  bool xin = xbin >= 1 && xbin <= h->GetNbinsX();
+  int ny = h->GetNbinsY();
+  int bin0 = h->GetBin(xbin, 0);
+  int ystride = h->GetBin(0, 1);
+  // sums over the in-range frequencies for the statistics
+  double sw = 0, sw2 = 0, swy = 0, swy2 = 0;
+  for (size_t k = 0; k < nk; ++k) {
+    double w = db[k];
+    int ybin = acc.ybins[k];
+    int bin = bin0 + ybin*ystride;
+    acc.sumw[bin] += w;
+    acc.sumw2[bin] += w*w;
+    if (!xin || ybin < 1 || ybin > ny) continue;
+    double y = Frequency(k);
+    sw += w;
+    sw2 += w*w;
+    swy += w*y;
+    swy2 += w*y*y;
+  }
+  acc.stats[0] += sw;
+  acc.stats[1] += sw2;
+  acc.stats[2] += sw*x;
+  acc.stats[3] += sw*x*x;
+  acc.stats[4] += swy;
+  acc.stats[5] += swy2;
+  acc.stats[6] += swy*x;
+  acc.nfill += nk;
+}
+
+//-----------------------------------------------------------------------
+
+void TpcSpectrumEngine::FillProfile(size_t iprof, const std::vector<double> & db)
+{
+  Profile & acc = fProfiles.at(iprof);
+  size_t nk = db.size();
+  if (acc.count.size() < nk) {
+    acc.count.resize(nk, 0);
+    acc.sumy.resize(nk, 0.0);
+    acc.sumy2.resize(nk, 0.0);
+  }
+  bool limited = acc.ymin != acc.ymax;
+  for (size_t k = 0; k < nk; ++k) {
+    double y = db[k];
+    // TProfile::Fill drops values outside the y limits
+    if (limited && !(y >= acc.ymin && y <= acc.ymax)) continue;
+    ++acc.count[k];
+    acc.sumy[k] += y;
+    acc.sumy2[k] += y*y;
+  }
+}
+
+//-----------------------------------------------------------------------
+
+void TpcSpectrumEngine::FillPersistent(size_t ipers, const std::vector<double> & db)
+{
+  Persistent & acc = fPersistents.at(ipers);
+  size_t nk = db.size();
+  size_t nyb = acc.ny + 2;
+  if (acc.count.size() < nk) {
+    acc.counts.resize(nk*nyb, 0);
+    acc.count.resize(nk, 0);
+    acc.sumy.resize(nk, 0.0);
+    acc.sumy2.resize(nk, 0.0);
+  }
+  const TAxis * yaxis = acc.h->GetYaxis();
+  for (size_t k = 0; k < nk; ++k) {
+    double y = db[k];
+    int ybin = yaxis->FindFixBin(y);
+    ++acc.counts[k*nyb + ybin];
+    if (ybin < 1 || ybin > acc.ny) continue;
+    ++acc.count[k];
+    acc.sumy[k] += y;
+    acc.sumy2[k] += y*y;
+  }
+}
+
+//-----------------------------------------------------------------------
+
+void TpcSpectrumEngine::Flush()
+{
+  for (ChannelMap & acc : fMaps) Flush(acc);
+  for (Profile & acc : fProfiles) Flush(acc);
+  for (Persistent & acc : fPersistents) Flush(acc);
+}
+
+//-----------------------------------------------------------------------
+
+void TpcSpectrumEngine::Flush(ChannelMap & acc) const
+{
+  if (acc.nfill == 0) return;
+  TH2 * h = acc.h;
+  // TH2::Fill with a weight other than one turns on the sum of squares
+  if (h->GetSumw2N() == 0) h->Sumw2();
+  // before the contents change: GetStats may recompute from them
+  double stats[7];
+  h->GetStats(stats);
+  double * sumw2 = h->GetSumw2()->fArray;
+  for (size_t bin = 0; bin < acc.sumw.size(); ++bin) {
+    if (acc.sumw2[bin] == 0) continue;
+    h->AddBinContent(bin, acc.sumw[bin]);
+    sumw2[bin] += acc.sumw2[bin];
+  }
+  for (int i = 0; i < 7; ++i) stats[i] += acc.stats[i];
+  h->PutStats(stats);
+  h->SetEntries(h->GetEntries() + acc.nfill);
+  std::fill(acc.sumw.begin(), acc.sumw.end(), 0.0);
+  std::fill(acc.sumw2.begin(), acc.sumw2.end(), 0.0);
+  std::fill(acc.stats, acc.stats + 7, 0.0);
+  acc.nfill = 0;
+}
+
+//-----------------------------------------------------------------------
+
+void TpcSpectrumEngine::Flush(Profile & acc) const
+{
+  if (acc.count.empty()) return;
+  TProfile * h = acc.h;
+  double * w = h->GetW();
+  double * w2 = h->GetW2();
+  double * b = h->GetB();
+  double * b2 = h->GetB2();
+  int nbx = h->GetNbinsX();
+  double stats[6];
+  h->GetStats(stats);
+  double nent = 0;
+  for (size_t k = 0; k < acc.count.size(); ++k) {
+    double n = acc.count[k];
+    if (n == 0) continue;
+    double x = Frequency(k);
+    int bin = h->GetXaxis()->FindFixBin(x);
+    w[bin] += acc.sumy[k];
+    w2[bin] += acc.sumy2[k];
+    b[bin] += n;
+    if (b2 != nullptr) b2[bin] += n;
+    nent += n;
+    if (bin < 1 || bin > nbx) continue;
+    stats[0] += n;
+    stats[1] += n;
+    stats[2] += n*x;
+    stats[3] += n*x*x;
+    stats[4] += acc.sumy[k];
+    stats[5] += acc.sumy2[k];
+  }
+  h->PutStats(stats);
+  h->SetEntries(h->GetEntries() + nent);
+  acc.count.clear();
+  acc.sumy.clear();
+  acc.sumy2.clear();
+}
+
+//-----------------------------------------------------------------------
+
+void TpcSpectrumEngine::Flush(Persistent & acc) const
+{
+  if (acc.count.empty()) return;
+  TH2 * h = acc.h;
+  double * sumw2 = h->GetSumw2N() ? h->GetSumw2()->fArray : nullptr;
+  int nbx = h->GetNbinsX();
+  size_t nyb = acc.ny + 2;
+  double stats[7];
+  h->GetStats(stats);
+  double nent = 0;
+  for (size_t k = 0; k < acc.count.size(); ++k) {
+    double x = Frequency(k);
+    int xbin = h->GetXaxis()->FindFixBin(x);
+    for (size_t ybin = 0; ybin < nyb; ++ybin) {
+      double n = acc.counts[k*nyb + ybin];
+      if (n == 0) continue;
+      int bin = h->GetBin(xbin, ybin);
+      h->AddBinContent(bin, n);
+      if (sumw2 != nullptr) sumw2[bin] += n;
+      nent += n;
+    }
+    double n = acc.count[k];
+    if (n == 0 || xbin < 1 || xbin > nbx) continue;
+    stats[0] += n;
+    stats[1] += n;
+    stats[2] += n*x;
+    stats[3] += n*x*x;
+    stats[4] += acc.sumy[k];
+    stats[5] += acc.sumy2[k];
+    stats[6] += x*acc.sumy[k];
+  }
+  h->PutStats(stats);
+  h->SetEntries(h->GetEntries() + nent);
+  acc.counts.clear();
+  acc.count.clear();
+  acc.sumy.clear();
+  acc.sumy2.clear();
+}
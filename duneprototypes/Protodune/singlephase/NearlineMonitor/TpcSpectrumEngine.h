@@ -0,0 +1,132 @@
+// TpcSpectrumEngine.h
+//
+// Noise spectra for the TPC monitors (TpcMonitor, IcebergTpcMonitor).
+//
+// Transform() returns the amplitude spectrum in dB, 20 log10(|X_k|/n) for
+// k = 0 .. n/2-1, of a waveform of n ADC samples -- the values the monitors
+// took from TH1::FFT(..., "MAG").  One real-to-complex FFTW plan (ROOT
+// TVirtualFFT) is made per waveform length and kept for the job, instead of
+// a plan and two histograms per channel and event.
+//
+// The spectra are summed into flat arrays registered against the monitor
+// histograms:
+//   channel maps  TH2 of channel vs. frequency with the dB value as weight
+//   profiles      TProfile of dB vs. frequency
+//   persistent    TH2 of frequency vs. dB
+// Flush() adds the sums to the histograms -- contents, errors, entries and
+// statistics as if each value had been filled -- and clears them.  The
+// monitors call it at end of job or every N events.  The channel map sums
+// have the binning of the (rebinned) histogram, so they take about the
+// memory of the histogram itself.
+//
+// The frequency of point k is (k + 0.5)*binWidth, binWidth in kHz.
+//
+// An engine is not thread safe.  A monitor filling spectra from several
+// threads gives each thread a Clone(), with the same registrations and its
+// own sums and plans, and flushes all of them.  Only the plan creation is
+// serialized between engines.
+
+#ifndef TpcSpectrumEngine_H
+#define TpcSpectrumEngine_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+class TH2;
+class TProfile;
+class TVirtualFFT;
+
+namespace tpc_monitor {
+
+  class TpcSpectrumEngine {
+
+  public:
+
+    explicit TpcSpectrumEngine(float binWidth);
+    ~TpcSpectrumEngine();
+    TpcSpectrumEngine(const TpcSpectrumEngine &) = delete;
+    TpcSpectrumEngine & operator=(const TpcSpectrumEngine &) = delete;
+
+    // Spectrum of a waveform in dB, n/2 values.  Valid until the next call.
+    const std::vector<double> & Transform(const short * adcs, size_t n);
+    const std::vector<double> & Transform(const std::vector<short> & adcs) {
+      return Transform(adcs.data(), adcs.size());
+    }
+
+    // New engine with the same bin width and histograms and no sums.
+    std::unique_ptr<TpcSpectrumEngine> Clone() const;
+
+    // Register a histogram and return the index used to fill it.
+    size_t AddChannelMap(TH2 * h);
+    size_t AddProfile(TProfile * h);
+    size_t AddPersistent(TH2 * h);
+
+    // Sum a spectrum.
+    void FillChannelMap(size_t imap, unsigned int chan, const std::vector<double> & db);
+    void FillProfile(size_t iprof, const std::vector<double> & db);
+    void FillPersistent(size_t ipers, const std::vector<double> & db);
+
+    // Add the sums to the histograms and clear them.
+    void Flush();
+
+    size_t NPlans() const { return fPlans.size(); }
+    float BinWidth() const { return fBinWidth; }
+
+  private:
+
+    // sums of weights and of squared weights by histogram bin, the y bin of
+    // each frequency, the statistics of the in-range fills and the number
+    // of fills
+    struct ChannelMap {
+      TH2 * h;
+      std::vector<int> ybins;
+      std::vector<double> sumw;
+      std::vector<double> sumw2;
+      double stats[7];
+      double nfill;
+    };
+
+    // in-range values by frequency
+    struct Profile {
+      TProfile * h;
+      double ymin;
+      double ymax;
+      std::vector<unsigned int> count;
+      std::vector<double> sumy;
+      std::vector<double> sumy2;
+    };
+
+    // counts by frequency and dB bin (with under/overflow), index
+    // k*(ny + 2) + ybin, and the in-range values by frequency
+    struct Persistent {
+      TH2 * h;
+      int ny;
+      std::vector<unsigned int> counts;
+      std::vector<unsigned int> count;
+      std::vector<double> sumy;
+      std::vector<double> sumy2;
+    };
+
+    double Frequency(size_t k) const { return (k + 0.5)*fBinWidth; }
+
+    void Flush(ChannelMap & acc) const;
+    void Flush(Profile & acc) const;
+    void Flush(Persistent & acc) const;
+
+    float fBinWidth;
+    std::map<size_t, std::unique_ptr<TVirtualFFT>> fPlans;
+    std::vector<double> fIn;
+    std::vector<double> fRe;
+    std::vector<double> fIm;
+    std::vector<double> fDb;
+    std::vector<ChannelMap> fMaps;
+    std::vector<Profile> fProfiles;
+    std::vector<Persistent> fPersistents;
+
+  };
+
+}
+
+#endif
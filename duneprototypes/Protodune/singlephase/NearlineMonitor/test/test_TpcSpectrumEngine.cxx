@@ -0,0 +1,269 @@
+// test_TpcSpectrumEngine.cxx
+//
+// Test TpcSpectrumEngine against the way the TPC monitors made their noise
+// spectra: a waveform histogram and TH1::FFT per channel, with each dB value
+// filled into a channel map, a profile and a persistent spectrum.  Synthetic
+// waveforms (noise plus a few lines) of two lengths are used.  The
+// histograms filled both ways are compared, with one intermediate flush,
+// and the time per channel is reported for each.  The fill is repeated with
+// clones of the engine on several threads, as the monitors do when run with
+// MaxConcurrency != 1.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include "duneprototypes/Protodune/singlephase/NearlineMonitor/TpcSpectrumEngine.h"
+#include "TH1D.h"
+#include "TH2F.h"
+#include "TProfile.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using tpc_monitor::TpcSpectrumEngine;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// frequency bin in kHz for 6000 ticks of 500 ns, as the monitors compute it
+const float binWidth = 1.0/(6000*500*1.0e-6);
+
+struct Hists {
+  TH2F* map;
+  TProfile* prof;
+  TH2F* pers;
+};
+
+Hists makeHists(string pre, unsigned int nch, unsigned int nticks) {
+  Hists hs;
+  // the last channel is in the overflow
+  hs.map = new TH2F((pre + "map").c_str(), "map", nch - 1, -0.5, nch - 1.5, nticks/2, 0, nticks/2*binWidth);
+  hs.map->Rebin2D(1, 10);
+  hs.prof = new TProfile((pre + "prof").c_str(), "prof", nticks/2, 0, nticks/2*binWidth, -100, 50);
+  hs.pers = new TH2F((pre + "pers").c_str(), "pers", nticks/2, 0, nticks/2*binWidth, 150, -100, 50);
+  return hs;
+}
+
+vector<short> waveform(std::mt19937& rng, unsigned int ich, unsigned int nticks) {
+  std::normal_distribution<double> noise(0.0, 3.0 + ich%5);
+  vector<short> adcs(nticks);
+  for ( unsigned int it=0; it<nticks; ++it ) {
+    double val = 900 + noise(rng) + 20*std::sin(0.01*it*(1 + ich%7)) + 5*std::sin(1.3*it);
+    adcs[it] = short(std::lround(val));
+  }
+  return adcs;
+}
+
+// The monitor calculation, TpcMonitor::calculateFFT and its callers.
+void fillOld(const Hists& hs, unsigned int chan, const vector<short>& adcs) {
+  int nSamples = adcs.size();
+  TH1D* histwav = new TH1D("wav", "wav", nSamples, 0, nSamples);
+  for ( int k=0; k<nSamples; ++k ) histwav->SetBinContent(k+1, adcs[k]);
+  TH1D* histfft = new TH1D("fft", "fft", nSamples, 0, nSamples*binWidth);
+  TH1* hist_transform = histwav->FFT(nullptr, "MAG");
+  hist_transform->Scale(1.0/float(nSamples));
+  int nFFT = hist_transform->GetNbinsX();
+  for ( int k=0; k<nFFT/2; ++k ) {
+    histfft->Fill((k+0.5)*binWidth, 20*log10(hist_transform->GetBinContent(k+1)));
+  }
+  delete hist_transform;
+  for ( int k=0; k<nSamples/2; ++k ) {
+    hs.pers->Fill((k+0.5)*binWidth, histfft->GetBinContent(k+1));
+    hs.prof->Fill((k+0.5)*binWidth, histfft->GetBinContent(k+1));
+    hs.map->Fill(chan, (k+0.5)*binWidth, histfft->GetBinContent(k+1));
+  }
+  delete histwav;
+  delete histfft;
+}
+
+bool close(double x1, double x2, double tol) {
+  if ( std::isinf(x1) || std::isinf(x2) ) return x1 == x2;
+  return std::fabs(x1 - x2) <= tol*(1.0 + std::fabs(x1) + std::fabs(x2));
+}
+
+// Compare contents, errors, entries and statistics.
+bool sameHist(const TH1* h1, const TH1* h2, double tol) {
+  if ( h1->GetNcells() != h2->GetNcells() ) return false;
+  if ( h1->GetEntries() != h2->GetEntries() ) return false;
+  for ( int bin=0; bin<h1->GetNcells(); ++bin ) {
+    if ( ! close(h1->GetBinContent(bin), h2->GetBinContent(bin), tol) ) {
+      cout << "  Content differs in bin " << bin << ": " << h1->GetBinContent(bin)
+           << " != " << h2->GetBinContent(bin) << endl;
+      return false;
+    }
+    if ( ! close(h1->GetBinError(bin), h2->GetBinError(bin), tol) ) {
+      cout << "  Error differs in bin " << bin << ": " << h1->GetBinError(bin)
+           << " != " << h2->GetBinError(bin) << endl;
+      return false;
+    }
+  }
+  for ( int iaxis=1; iaxis<=h1->GetDimension(); ++iaxis ) {
+    if ( ! close(h1->GetMean(iaxis), h2->GetMean(iaxis), tol) ) return false;
+    if ( ! close(h1->GetStdDev(iaxis), h2->GetStdDev(iaxis), tol) ) return false;
+  }
+  return true;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_TpcSpectrumEngine(unsigned int nevt, unsigned int nch, unsigned int nthr) {
+  const string myname = "test_TpcSpectrumEngine: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  TH1::AddDirectory(false);
+  const unsigned int nticks = 6000;
+
+  cout << myname << line << endl;
+  cout << myname << "Check the spectrum." << endl;
+  TpcSpectrumEngine eng(binWidth);
+  assert( eng.NPlans() == 0 );
+  assert( eng.Transform(vector<short>(1, 5)).empty() );
+  {
+    // constant: DC term only
+    const vector<double>& db = eng.Transform(vector<short>(8, 4));
+    assert( db.size() == 4 );
+    assert( close(db[0], 20*std::log10(4.0), 1.e-12) );
+    for ( size_t k=1; k<db.size(); ++k ) assert( db[k] < -200 );
+    // one line in bin 2 of 16 samples
+    vector<short> adcs(16);
+    for ( size_t it=0; it<adcs.size(); ++it ) adcs[it] = std::lround(100*std::cos(2*M_PI*2*it/16.0));
+    const vector<double>& db2 = eng.Transform(adcs);
+    assert( db2.size() == 8 );
+    assert( close(db2[2], 20*std::log10(50.0), 1.e-3) );
+    assert( eng.NPlans() == 2 );
+    eng.Transform(vector<short>(8, 1));
+    assert( eng.NPlans() == 2 );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Fill " << nevt << " events of " << nch << " channels." << endl;
+  std::mt19937 rng(20180201);
+  vector<vector<vector<short>>> evts(nevt);
+  for ( auto& evt : evts ) {
+    for ( unsigned int ich=0; ich<nch; ++ich ) {
+      // a few channels are one tick short
+      evt.push_back(waveform(rng, ich, ich%50 == 7 ? nticks - 1 : nticks));
+    }
+  }
+  Hists hold = makeHists("old", nch, nticks);
+  Hists hnew = makeHists("new", nch, nticks);
+  size_t imap = eng.AddChannelMap(hnew.map);
+  size_t iprof = eng.AddProfile(hnew.prof);
+  size_t ipers = eng.AddPersistent(hnew.pers);
+  auto t0 = Clock::now();
+  for ( const auto& evt : evts ) {
+    for ( unsigned int ich=0; ich<nch; ++ich ) fillOld(hold, ich, evt[ich]);
+  }
+  double dtold = std::chrono::duration<double>(Clock::now() - t0).count();
+  t0 = Clock::now();
+  for ( unsigned int ievt=0; ievt<nevt; ++ievt ) {
+    for ( unsigned int ich=0; ich<nch; ++ich ) {
+      const vector<double>& db = eng.Transform(evts[ievt][ich]);
+      eng.FillChannelMap(imap, ich, db);
+      eng.FillProfile(iprof, db);
+      eng.FillPersistent(ipers, db);
+    }
+    if ( ievt == nevt/2 ) eng.Flush();
+  }
+  eng.Flush();
+  double dtnew = std::chrono::duration<double>(Clock::now() - t0).count();
+  assert( eng.NPlans() == 4 );
+
+  cout << myname << line << endl;
+  cout << myname << "Compare histograms." << endl;
+  assert( hnew.pers->GetEntries() == hold.pers->GetEntries() );
+  assert( sameHist(hold.pers, hnew.pers, 1.e-6) );
+  assert( sameHist(hold.prof, hnew.prof, 1.e-6) );
+  assert( sameHist(hold.map, hnew.map, 1.e-5) );
+  // a second flush adds nothing
+  double nent = hnew.map->GetEntries();
+  eng.Flush();
+  assert( hnew.map->GetEntries() == nent );
+
+  cout << myname << line << endl;
+  cout << myname << "Fill with " << nthr << " clones on separate threads." << endl;
+  Hists hthr = makeHists("thr", nch, nticks);
+  TpcSpectrumEngine engthr(binWidth);
+  assert( engthr.AddChannelMap(hthr.map) == imap );
+  assert( engthr.AddProfile(hthr.prof) == iprof );
+  assert( engthr.AddPersistent(hthr.pers) == ipers );
+  vector<std::unique_ptr<TpcSpectrumEngine>> clones;
+  for ( unsigned int ithr=0; ithr<nthr; ++ithr ) {
+    clones.push_back(engthr.Clone());
+    assert( clones.back()->NPlans() == 0 );
+    assert( clones.back()->BinWidth() == binWidth );
+  }
+  t0 = Clock::now();
+  vector<std::thread> threads;
+  for ( unsigned int ithr=0; ithr<nthr; ++ithr ) {
+    threads.emplace_back([&, ithr] {
+      TpcSpectrumEngine& cln = *clones[ithr];
+      for ( const auto& evt : evts ) {
+        for ( unsigned int ich=ithr; ich<nch; ich+=nthr ) {
+          const vector<double>& db = cln.Transform(evt[ich]);
+          cln.FillChannelMap(imap, ich, db);
+          cln.FillProfile(iprof, db);
+          cln.FillPersistent(ipers, db);
+        }
+      }
+    });
+  }
+  for ( std::thread& thr : threads ) thr.join();
+  for ( auto& cln : clones ) cln->Flush();
+  double dtthr = std::chrono::duration<double>(Clock::now() - t0).count();
+  // nothing was summed by the original
+  engthr.Flush();
+  assert( engthr.NPlans() == 0 );
+  assert( sameHist(hold.pers, hthr.pers, 1.e-6) );
+  assert( sameHist(hold.prof, hthr.prof, 1.e-6) );
+  assert( sameHist(hold.map, hthr.map, 1.e-5) );
+
+  size_t nchan = nevt*nch;
+  cout << myname << line << endl;
+  cout << myname << "   TH1::FFT: " << 1.e6*dtold/nchan << " us/channel" << endl;
+  cout << myname << "     engine: " << 1.e6*dtnew/nchan << " us/channel" << endl;
+  cout << myname << "  " << nthr << " clones: " << 1.e6*dtthr/nchan << " us/channel" << endl;
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  unsigned int nevt = 4;
+  unsigned int nch = 200;
+  unsigned int nthr = 4;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NEVT [NCHAN [NTHREAD]]]" << endl;
+      cout << "  NEVT [4]: Number of events (at least 2)." << endl;
+      cout << "  NCHAN [200]: Channels per event (at least 10)." << endl;
+      cout << "  NTHREAD [4]: Threads filling clones of the engine (at least 1)." << endl;
+      return 0;
+    }
+    nevt = std::max(2ul, std::stoul(sarg));
+  }
+  if ( argc > 2 ) nch = std::max(10ul, std::stoul(argv[2]));
+  if ( argc > 3 ) nthr = std::max(1ul, std::stoul(argv[3]));
+  return test_TpcSpectrumEngine(nevt, nch, nthr);
+}
+
+//**********************************************************************
@@ -27,11 +27,20 @@
 
 #include <memory>
 #include <cmath>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
 
 // ROOT includes
 #include "TH1.h"
 #include "TStyle.h"
 #include "TMath.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/RawDigitCompressor.h"
 
 // artdaq and dunepdlegacy includes
 #include "dunepdlegacy/Overlays/RceFragment.hh"
@@ -134,6 +143,8 @@ private:
   bool          _compress_Huffman;
   bool          _print_coldata_convert_count;
 
+  int           _max_concurrency;  // fragments decoded and digits compressed in parallel: 1 = serial, 0 = no limit
+
   //declare histogram data memebers
   bool	_make_histograms;
   unsigned int 	duplicate_channels;
@@ -160,24 +171,91 @@ private:
   bool          _DiscardedCorruptData;
   bool          _KeptCorruptData;
 
+  // What decoding one fragment does to the event, recorded in order:
+  // warnings and printout, status flags, counters, stream tick counts and
+  // digits.  Decoding only reads the configuration, so fragments can be
+  // decoded concurrently.  _applyFragment replays the steps against the
+  // event state, making the same-tick-count and duplicate-channel checks
+  // there, so a fragment stops at the same place and the products are the
+  // same as when each fragment is decoded and applied in turn.
+
+  struct FragmentDecode {
+    enum StepType { kWarning, kPrint, kDiscarded, kKept, kDiscardEvent, kError, kIncorrectTicks,
+                    kChannels, kTickCount, kDigit, kReturn };
+
+    struct Step {
+      StepType type;
+      size_t value = 0;          // channel count, tick count, digit index or return value
+      uint64_t timestamp = 0;    // digits
+      unsigned int crate = 0;    // digits, for the duplicate channel warning
+      unsigned int slot = 0;
+      unsigned int fiber = 0;
+      unsigned int ich = 0;
+      const char * category = "";
+      std::string text;
+    };
+
+    // Streams the text of a step; the text is stored when the builder goes away.
+    class Text {
+    public:
+      explicit Text(std::string & dest) : fDest(dest) { }
+      ~Text() { fDest = fStream.str(); }
+      template <class T> Text & operator<<(const T & val) { fStream << val; return *this; }
+    private:
+      std::string & fDest;
+      std::ostringstream fStream;
+    };
+
+    bool felix = false;
+    std::vector<Step> steps;
+    std::vector<raw::RawDigit> digits;
+
+    Step & Add(StepType type, size_t value=0) { steps.emplace_back(); steps.back().type = type; steps.back().value = value; return steps.back(); }
+    Text Warn(const char * category) { Step & step = Add(kWarning); step.category = category; return Text(step.text); }
+    Text Print() { return Text(Add(kPrint).text); }
+    void Discarded() { Add(kDiscarded); }
+    void Kept() { Add(kKept); }
+    void DiscardEvent() { Add(kDiscardEvent); }
+    void Error() { Add(kError); }
+    void IncorrectTicks() { Add(kIncorrectTicks); }
+    void Channels(size_t n) { Add(kChannels, n); }
+    void TickCount(size_t n_ticks) { Add(kTickCount, n_ticks); }
+    bool Return(bool value) { Add(kReturn, value); return value; }
+    void Digit(uint64_t timestamp, unsigned int crate, unsigned int slot, unsigned int fiber, unsigned int ich)
+    {
+      Step & step = Add(kDigit, digits.size()-1);
+      step.timestamp = timestamp;
+      step.crate = crate;
+      step.slot = slot;
+      step.fiber = fiber;
+      step.ich = ich;
+    }
+  };
+
   // internal methods
 
   bool _processRCE(art::Event &evt, RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm);
   bool _rceProcContNCFrags(art::Handle<artdaq::Fragments> frags, size_t &n_rce_frags, bool is_container, 
 			   art::Event &evt, RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm);
-  bool _process_RCE_AUX(const artdaq::Fragment& frag, RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm, size_t ntickscheck);
+  bool _process_RCE_AUX(const artdaq::Fragment& frag, dune::PdspChannelMapService * channelMap, FragmentDecode &out, size_t ntickscheck) const;
   void _process_RCE_nticksvf(const artdaq::Fragment& frag, std::vector<size_t> &nticksvec);
 
   bool _processFELIX(art::Event &evt, RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm);
   bool _felixProcContNCFrags(art::Handle<artdaq::Fragments> frags, size_t &n_felix_frags, bool is_container, art::Event &evt, RawDigits& raw_digits,
 			     RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm);
-  bool _process_FELIX_AUX(const artdaq::Fragment& frag, RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm);
+  bool _process_FELIX_AUX(const artdaq::Fragment& frag, dune::PdspChannelMapService * channelMap, FragmentDecode &out) const;
 
-  void computeMedianSigma(raw::RawDigit::ADCvector_t &v_adc, float &median, float &sigma);
+  void _decodeFragments(const std::vector<const artdaq::Fragment*> &blocks, bool felix, size_t ntickscheck, size_t &n_frags,
+			RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm);
+  bool _applyFragment(FragmentDecode &dec, RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm);
 
-  std::vector<int16_t> _buffer;
+  static void computeMedianSigma(raw::RawDigit::ADCvector_t &v_adc, float &median, float &sigma);
 };
 
+// The blocks of a container fragment are unpacked into fragments of their
+// own; they are kept until the fragments of a handle are decoded.
+using ContainerBlock = decltype(std::declval<artdaq::ContainerFragment&>()[0]);
+
 
 PDSPTPCRawDecoder::PDSPTPCRawDecoder(fhicl::ParameterSet const & p) : EDProducer{p}
 {
@@ -246,6 +324,7 @@ PDSPTPCRawDecoder::PDSPTPCRawDecoder(fhicl::ParameterSet const & p) : EDProducer
 
   _compress_Huffman = p.get<bool>("CompressHuffman",false);
   _print_coldata_convert_count = p.get<bool>("PrintColdataConvertCount",false);
+  _max_concurrency = p.get<int>("MaxConcurrency",1);
 
   _min_offline_channel = p.get<long int>("MinOfflineChannel",-1);
   _max_offline_channel = p.get<long int>("MaxOfflineChannel",-1);
@@ -369,6 +448,12 @@ void PDSPTPCRawDecoder::produce(art::Event &e)
     }
   else
     {
+      // compress the kept digits together, on up to _max_concurrency threads
+      if (_compress_Huffman)
+	{
+	  dune::RawDigitCompressor(raw::kHuffman,_max_concurrency).Compress(raw_digits);
+	}
+
       RDStatuses statuses;
       unsigned int statword=0;
       if (_DiscardedCorruptData) statword |= 1;
@@ -513,7 +598,10 @@ bool PDSPTPCRawDecoder::_rceProcContNCFrags(art::Handle<artdaq::Fragments> frags
   size_t nticksmedian = TMath::Median(nticksvec.size(),nticksvec.data()) + 0.01;  // returns a double -- want to make sure it gets truncated to the right integer
 
 
-  // actually process the 
+  // actually process the fragments.  Collect the ones to decode, then decode them together
+
+  std::vector<const artdaq::Fragment*> blocks;
+  std::vector<ContainerBlock> cont_blocks;
   for (auto const& frag : *frags)
     {
       //std::cout << "RCE fragment size bytes: " << frag.sizeBytes() << std::endl; 
@@ -523,6 +611,7 @@ bool PDSPTPCRawDecoder::_rceProcContNCFrags(art::Handle<artdaq::Fragments> frags
 	{
 	  if ( _drop_events_with_small_rce_frags )
 	    { 
+	      _decodeFragments(blocks, false, nticksmedian, n_rce_frags, raw_digits, timestamps, tsassocs, rdpm, tspm);
 	      MF_LOG_WARNING("_process_RCE:") << " Small RCE fragment size: " << frag.sizeBytes() << " Discarding Event on request.";
 	      _discard_data = true; 
 	      _DiscardedCorruptData = true;
@@ -544,15 +633,17 @@ bool PDSPTPCRawDecoder::_rceProcContNCFrags(art::Handle<artdaq::Fragments> frags
 	      artdaq::ContainerFragment cont_frag(frag);
 	      for (size_t ii = 0; ii < cont_frag.block_count(); ++ii)
 		{
-		  if (_process_RCE_AUX(*cont_frag[ii], raw_digits, timestamps, tsassocs, rdpm, tspm, nticksmedian)) ++n_rce_frags;
+		  cont_blocks.push_back(cont_frag[ii]);
+		  blocks.push_back(&*cont_blocks.back());
 		}
 	    }
 	  else
 	    {
-	      if (_process_RCE_AUX(frag, raw_digits, timestamps,tsassocs, rdpm, tspm, nticksmedian)) ++n_rce_frags;
+	      blocks.push_back(&frag);
 	    }
 	}
     }
+  _decodeFragments(blocks, false, nticksmedian, n_rce_frags, raw_digits, timestamps, tsassocs, rdpm, tspm);
   frags.removeProduct();
   return true;
 }
@@ -646,26 +737,23 @@ void PDSPTPCRawDecoder::_process_RCE_nticksvf(
 
 bool PDSPTPCRawDecoder::_process_RCE_AUX(
 					 const artdaq::Fragment& frag, 
-					 RawDigits& raw_digits,
-					 RDTimeStamps &timestamps,
-					 RDTsAssocs &tsassocs,
-					 RDPmkr &rdpm, TSPmkr &tspm,
+					 dune::PdspChannelMapService * channelMap,
+					 FragmentDecode &out,
 					 size_t ntickscheck
-					 )
+					 ) const
 {
 
   if (_rce_enforce_fragment_type_match && (frag.type() != _rce_fragment_type)) 
     {
-      MF_LOG_WARNING("_process_RCE_AUX:") << " RCE fragment type " << (int) frag.type() << " doesn't match expected value: " << _rce_fragment_type << " Discarding RCE fragment";
-      _DiscardedCorruptData = true;
-      return false;
+      out.Warn("_process_RCE_AUX:") << " RCE fragment type " << (int) frag.type() << " doesn't match expected value: " << _rce_fragment_type << " Discarding RCE fragment";
+      out.Discarded();
+      return out.Return(false);
     }
   //MF_LOG_INFO("_Process_RCE_AUX")
   //<< "   SequenceID = " << frag.sequenceID()
   //<< "   fragmentID = " << frag.fragmentID()
   //<< "   fragmentType = " << (unsigned)frag.type()
   //<< "   Timestamp =  " << frag.timestamp();
-  art::ServiceHandle<dune::PdspChannelMapService> channelMap;
 
   dune::RceFragment rce(frag);
   artdaq::Fragment cfragloc(frag);
@@ -677,17 +765,18 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
   bool isOkay = RceFragmentUnpack::isOkay(cdptr,cdsize);
   if (!isOkay)
     {
-      MF_LOG_WARNING("_process_RCE_AUX:") << "RCE Fragment isOkay failed: " << cdsize << " Discarding this fragment"; 
-      error_counter++;
-      _DiscardedCorruptData = true;
-      return false; 
+      out.Warn("_process_RCE_AUX:") << "RCE Fragment isOkay failed: " << cdsize << " Discarding this fragment"; 
+      out.Error();
+      out.Discarded();
+      return out.Return(false); 
     }
 
   //DataFragmentUnpack df(cdptr);
   //std::cout << "isTPpcNormal: " << df.isTpcNormal() << " isTpcDamaged: " << df.isTpcDamaged() << " isTpcEmpty: " << df.isTpcEmpty() << std::endl;
 
+  // unpacking buffer, one per thread
+  static thread_local std::vector<int16_t> buffer;
 
-  uint32_t ch_counter = 0;
   for (int i = 0; i < rce.size(); ++i)
     {
       auto const * rce_stream = rce.get_stream(i);
@@ -719,7 +808,7 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
 	}
       if (!apafound) 
 	{
-	  return false;
+	  return out.Return(false);
 	}
 
       // check for bad crate numbers -- default empty list of APAs to check, default check is on, and if crate number isn't
@@ -728,21 +817,21 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
 
       if ( (crateNumber == 0 || crateNumber > 6) && _rce_drop_frags_with_badc && adsiz == 0)
 	{
-	  MF_LOG_WARNING("_process_RCE:") << "Bad crate number, discarding fragment on request: " 
-					  << (int) crateNumber;
-	  return false;
+	  out.Warn("_process_RCE:") << "Bad crate number, discarding fragment on request: " 
+				    << (int) crateNumber;
+	  return out.Return(false);
 	}
 
       if (slotNumber > 4 || fiberNumber == 0 || fiberNumber > 4)
 	{
 	  if (_rce_drop_frags_with_badsf)
 	    {
-	      MF_LOG_WARNING("_process_RCE:") << "Bad  slot, fiber number, discarding fragment on request: " 
-					      << " " << slotNumber << " " << fiberNumber;
-              _DiscardedCorruptData = true;
-	      return false;
+	      out.Warn("_process_RCE:") << "Bad  slot, fiber number, discarding fragment on request: " 
+					<< " " << slotNumber << " " << fiberNumber;
+              out.Discarded();
+	      return out.Return(false);
 	    }
-	  _KeptCorruptData = true;
+	  out.Kept();
 	}
 
       if (_print_coldata_convert_count)
@@ -768,7 +857,7 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
 		  auto const &colddata = wf->getColdData ();
 		  auto cvt0 = colddata[0].getConvertCount ();
 		  //auto cvt1 = colddata[1].getConvertCount ();
-		  std::cout << "RCE coldata convert count: " << cvt0 << std::endl;
+		  out.Print() << "RCE coldata convert count: " << cvt0 << "\n";
 		  printed = true;
 		  ++wf;  // in case we were looping over WIB frames, but let's stop at the first
 		  break;
@@ -781,7 +870,7 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
       if(_make_histograms)
 	{
 	  //log the participating RCE channels
-	  rcechans=rcechans+n_ch;
+	  out.Channels(n_ch);
 	}
 
       // check the number of ticks and allow FEMB302 to have 10% fewer
@@ -794,96 +883,74 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
 	    )
 	  )
 	{
-	  MF_LOG_WARNING("_process_RCE_AUX:") << "Nticks differs from median or FEMB302 nticks not expected: " << n_ticks << " " 
-					      << ntickscheck << " Discarding this fragment";
-	  _DiscardedCorruptData = true;
-	  return false;
+	  out.Warn("_process_RCE_AUX:") << "Nticks differs from median or FEMB302 nticks not expected: " << n_ticks << " " 
+					<< ntickscheck << " Discarding this fragment";
+	  out.Discarded();
+	  return out.Return(false);
 	} 
 
       if (n_ticks != _full_tick_count)
 	{
 	  if (_enforce_full_tick_count)
 	    {
-	      MF_LOG_WARNING("_process_RCE_AUX:") << "Nticks not the required value: " << n_ticks << " " 
-						  << _full_tick_count << " Discarding Data";
-	      error_counter++;
-	      incorrect_ticks++;
-	      _discard_data = true;
-              _DiscardedCorruptData = true;
-	      return false; 
-	    }
-	  _KeptCorruptData = true;
-	}
-
-      if (!_initialized_tick_count_this_event)
-	{
-	  _initialized_tick_count_this_event = true;
-	  _tick_count_this_event = n_ticks;
-	}
-      else
-	{
-	  if (n_ticks != _tick_count_this_event)
-	    {
-	      if (_enforce_same_tick_count)
-		{
-		  MF_LOG_WARNING("_process_RCE_AUX:") << "Nticks different for two channel streams: " << n_ticks 
-						      << " vs " << _tick_count_this_event << " Discarding Data";
-		  error_counter++;
-		  _discard_data = true;
-		  _DiscardedCorruptData = true;
-		  return false;
-		}
+	      out.Warn("_process_RCE_AUX:") << "Nticks not the required value: " << n_ticks << " " 
+					    << _full_tick_count << " Discarding Data";
+	      out.Error();
+	      out.IncorrectTicks();
+	      out.DiscardEvent();
+              out.Discarded();
+	      return out.Return(false); 
 	    }
-	  _KeptCorruptData = true;
+	  out.Kept();
 	}
 
+      // compared with the other streams of the event in _applyFragment
+      out.TickCount(n_ticks);
 
       //MF_LOG_INFO("_Process_RCE_AUX")
       //<< "RceFragment timestamp: " << rce_stream->getTimeStamp()
       //<< ", NChannels: " << n_ch
       //<< ", NTicks: " << n_ticks;
 
-      // TODO -- speed this up!!  Remove one buffer copy
-
       size_t buffer_size = n_ch * n_ticks;
 
       if (buffer_size > _rce_buffer_size_checklimit)
 	{
 	  if (_rce_check_buffer_size)
 	    {
-	      MF_LOG_WARNING("_process_RCE_AUX:") << "n_ch*nticks too large: " << n_ch << " * " << n_ticks << " = " << 
+	      out.Warn("_process_RCE_AUX:") << "n_ch*nticks too large: " << n_ch << " * " << n_ticks << " = " << 
 		buffer_size << " larger than: " <<  _rce_buffer_size_checklimit << ".  Discarding this fragment";
-	      _DiscardedCorruptData = true;
-	      return false;
+	      out.Discarded();
+	      return out.Return(false);
 	    }
 	  else
 	    {
-	      _KeptCorruptData = true;
+	      out.Kept();
 	    }
 	}
 
-      if (_buffer.capacity() < buffer_size)
+      if (buffer.capacity() < buffer_size)
 	{
 	  //  MF_LOG_INFO("_process_RCE_AUX")
-	  //<< "Increase buffer size from " << _buffer.capacity()
+	  //<< "Increase buffer size from " << buffer.capacity()
 	  //<< " to " << buffer_size;
 
-	  _buffer.reserve(buffer_size);
+	  buffer.reserve(buffer_size);
 	}
 
-      int16_t* adcs = _buffer.data();
+      int16_t* adcs = buffer.data();
       bool sgmcdretcode = rce_stream->getMultiChannelData(adcs);
       if (!sgmcdretcode)
 	{
 	  if (_enforce_error_free)
 	    {
-	      MF_LOG_WARNING("_process_RCE_AUX:") << "getMutliChannelData returns error flag: " 
-						  << " c:s:f:ich: " << crateNumber << " " << slotNumber << " " << fiberNumber << " Discarding Data";
-	      error_counter++;
-              _DiscardedCorruptData = true;
-	      return false;
+	      out.Warn("_process_RCE_AUX:") << "getMutliChannelData returns error flag: " 
+					    << " c:s:f:ich: " << crateNumber << " " << slotNumber << " " << fiberNumber << " Discarding Data";
+	      out.Error();
+              out.Discarded();
+	      return out.Return(false);
 	    }
-	  _KeptCorruptData = true;
+	  out.Kept();
 	}
 
       //std::cout << "RCE raw decoder trj: " << crateNumber << " " << slotNumber << " " << fiberNumber << std::endl;
@@ -892,6 +959,7 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
       unsigned int crateloc = crateNumber;
       if (crateNumber == 0 || crateNumber > 6) crateloc = _default_crate_if_unexpected;
 
+      out.digits.reserve(out.digits.size() + n_ch);
       raw::RawDigit::ADCvector_t v_adc;
       for (size_t i_ch = 0; i_ch < n_ch; i_ch++)
 	{
@@ -902,54 +970,18 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
 	  if (_max_offline_channel >= 0 && _min_offline_channel >= 0 && _max_offline_channel >= _min_offline_channel && 
 	      (offlineChannel < (size_t) _min_offline_channel || offlineChannel > (size_t) _max_offline_channel) ) continue;
  
-	  v_adc.clear();
-
 	  if (_rce_fix110 && crateNumber == 1 && slotNumber == 0 && fiberNumber == 1 && channelMap->ChipFromOfflineChannel(offlineChannel) == 4 && n_ticks > _rce_fix110_nticks)
 	    {
-	      for (size_t i_tick = 0; i_tick < n_ticks-_rce_fix110_nticks; i_tick++)
-		{
-		  v_adc.push_back(adcs[i_tick+_rce_fix110_nticks]);
-		}
-	      for (size_t i_tick=0; i_tick<_rce_fix110_nticks; ++i_tick)
-		{
-		  v_adc.push_back(v_adc.back());
-		}
-	      
+	      v_adc.assign(adcs + _rce_fix110_nticks, adcs + n_ticks);
+	      const raw::RawDigit::ADCvector_t::value_type last = v_adc.back();
+	      v_adc.resize(n_ticks, last);
 	    }
 	  else
 	    {
-	      for (size_t i_tick = 0; i_tick < n_ticks; i_tick++)
-		{
-		  v_adc.push_back(adcs[i_tick]);
-		}
+	      v_adc.assign(adcs, adcs + n_ticks);
 	    }
 	  adcs += n_ticks;
 
-	  ch_counter++;
-
-	  if (offlineChannel < _duplicate_channel_checklist_size)
-	    {
-	      if (_duplicate_channel_checklist[offlineChannel])
-		{
-		  if(_make_histograms)
-		    {
-		      duplicate_channels++;
-		    }
-
-		  if (_enforce_no_duplicate_channels)
-		    {
-		      MF_LOG_WARNING("_process_RCE_AUX:") << "Duplicate Channel: " << offlineChannel
-							  << " c:s:f:ich: " << crateNumber << " " << slotNumber << " " << fiberNumber << " " << i_ch << " Discarding Data";
-		      error_counter++;
-		      _discard_data = true;
-		      _DiscardedCorruptData = true;
-		      return false;
-		    }
-		  _KeptCorruptData = true;
-		}
-	      _duplicate_channel_checklist[offlineChannel] = true;
-	    }
-	  
 	  float median=0;
 	  float sigma=0;
 	  computeMedianSigma(v_adc,median,sigma);
@@ -958,28 +990,17 @@ bool PDSPTPCRawDecoder::_process_RCE_AUX(
 
 	  auto uncompressed_nticks = v_adc.size();  // can be different from n_ticks due to padding of FEMB 302
 
-	  raw::Compress_t cflag=raw::kNone;
-	  if (_compress_Huffman)
-	    {
-	      cflag = raw::kHuffman;
-	      raw::Compress(v_adc,cflag);
-	    }
-	  // here n_ticks is the uncompressed size as required by the constructor
-	  raw::RawDigit raw_digit(offlineChannel, uncompressed_nticks, v_adc, cflag);
-	  raw_digit.SetPedestal(median,sigma);
-	  raw_digits.push_back(raw_digit);  
-
-	  raw::RDTimeStamp rdtimestamp(rce_stream->getTimeStamp(),offlineChannel);
-	  timestamps.push_back(rdtimestamp);
-
-	  //associate the raw digit and the timestamp data products
-	  auto const rawdigitptr = rdpm(raw_digits.size()-1);
-	  auto const rdtimestampptr = tspm(timestamps.size()-1);
-	  tsassocs.addSingle(rawdigitptr,rdtimestampptr);            
+	  // compressed in produce if requested
+	  out.digits.emplace_back(offlineChannel, uncompressed_nticks, std::move(v_adc), raw::kNone);
+	  out.digits.back().SetPedestal(median,sigma);
+	  v_adc.clear();
+
+	  // checked for duplicates in _applyFragment
+	  out.Digit(rce_stream->getTimeStamp(), crateNumber, slotNumber, fiberNumber, i_ch);
 	}
     }
 
-  return true;
+  return out.Return(true);
 }
 
 
@@ -1089,6 +1110,10 @@ bool PDSPTPCRawDecoder::_felixProcContNCFrags(art::Handle<artdaq::Fragments> fra
       fFragSizeFELIX->Fill(felixbytes);
     }
     
+  // collect the fragments to decode, then decode them together
+
+  std::vector<const artdaq::Fragment*> blocks;
+  std::vector<ContainerBlock> cont_blocks;
   for (auto const& frag : *frags)
     {
       //std::cout << "FELIX fragment size bytes: " << frag.sizeBytes() << std::endl; 
@@ -1098,6 +1123,7 @@ bool PDSPTPCRawDecoder::_felixProcContNCFrags(art::Handle<artdaq::Fragments> fra
 	{
 	  if ( _drop_events_with_small_felix_frags )
 	    { 
+	      _decodeFragments(blocks, true, 0, n_felix_frags, raw_digits, timestamps, tsassocs, rdpm, tspm);
 	      MF_LOG_WARNING("_process_FELIX:") << " Small FELIX fragment size: " << frag.sizeBytes() << " Discarding Event on request.";
 	      _discard_data = true; 
 	      _DiscardedCorruptData = true;
@@ -1119,24 +1145,25 @@ bool PDSPTPCRawDecoder::_felixProcContNCFrags(art::Handle<artdaq::Fragments> fra
 	      artdaq::ContainerFragment cont_frag(frag);
 	      for (size_t ii = 0; ii < cont_frag.block_count(); ++ii)
 		{
-		  if (_process_FELIX_AUX(*cont_frag[ii], raw_digits, timestamps, tsassocs, rdpm, tspm)) ++n_felix_frags;
+		  cont_blocks.push_back(cont_frag[ii]);
+		  blocks.push_back(&*cont_blocks.back());
 		}
 	    }
 	  else
 	    {
-	      if (_process_FELIX_AUX(frag, raw_digits, timestamps,tsassocs, rdpm, tspm)) ++n_felix_frags;
+	      blocks.push_back(&frag);
 	    }
 	}
     }
+  _decodeFragments(blocks, true, 0, n_felix_frags, raw_digits, timestamps, tsassocs, rdpm, tspm);
   frags.removeProduct();
   return true;
 }
 
 
-bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigits& raw_digits,
-					   RDTimeStamps &timestamps,
-					   RDTsAssocs &tsassocs,
-					   RDPmkr &rdpm, TSPmkr &tspm)
+bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag,
+					   dune::PdspChannelMapService * channelMap,
+					   FragmentDecode &out) const
 {
 
   //std::cout 
@@ -1147,15 +1174,13 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
 
   if (_felix_hex_dump)
     {
-      std::ios oldState(nullptr);
-      oldState.copyfmt(std::cout);
-
-      std::cout << "FELIX Fragment: all numbers in hex "  << std::hex
-		<< "   SequenceID = " << frag.sequenceID()
-		<< "   fragmentID = " << frag.fragmentID()
-		<< "   fragmentType = " << (unsigned)frag.type()
-		<< "   Timestamp =  " << frag.timestamp() << std::endl;
-      std::cout << "Offset      Data";
+      std::ostringstream dump;
+      dump << "FELIX Fragment: all numbers in hex "  << std::hex
+	   << "   SequenceID = " << frag.sequenceID()
+	   << "   fragmentID = " << frag.fragmentID()
+	   << "   fragmentType = " << (unsigned)frag.type()
+	   << "   Timestamp =  " << frag.timestamp() << std::endl;
+      dump << "Offset      Data";
       artdaq::Fragment fragloc(frag);
       unsigned char *dbegin = reinterpret_cast<unsigned char *>(fragloc.dataAddress());
       size_t dsize = fragloc.dataSizeBytes();
@@ -1164,26 +1189,24 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
 	{
 	  if ( (offcounter % 8) == 0 )
 	    {
-	      std::cout << std::endl << std::hex << std::setfill('0') << std::setw(8) << offcounter << " ";
+	      dump << std::endl << std::hex << std::setfill('0') << std::setw(8) << offcounter << " ";
 	    }
-	  std::cout << std::hex << std::setfill('0') << std::setw(2) << (int) *dbegin << " ";
+	  dump << std::hex << std::setfill('0') << std::setw(2) << (int) *dbegin << " ";
 	  dbegin++;
 	  offcounter++;
 	}
-      std::cout << std::endl;
-      std::cout.copyfmt(oldState);
+      dump << std::endl;
+      out.Print() << dump.str();
     }
 
   // check against _felix_fragment_type
   if ( _felix_enforce_fragment_type_match && (frag.type() != _felix_fragment_type) )
     {
-      _DiscardedCorruptData = true;
-      MF_LOG_WARNING("_process_FELIX_AUX:") << " FELIX fragment type " << (int) frag.type() << " doesn't match expected value: " << _felix_fragment_type << " Discarding FELIX fragment";
-      return false;
+      out.Discarded();
+      out.Warn("_process_FELIX_AUX:") << " FELIX fragment type " << (int) frag.type() << " doesn't match expected value: " << _felix_fragment_type << " Discarding FELIX fragment";
+      return out.Return(false);
     }
 
-  art::ServiceHandle<dune::PdspChannelMapService> channelMap;
-
   //Load overlay class.
   dune::FelixFragment felix(frag);
 
@@ -1212,7 +1235,7 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
     }
   if (!apafound) 
     {
-      return false;
+      return out.Return(false);
     }
 
   // check for bad crate numbers -- default empty list of APAs to check, default check is on, and if crate number isn't
@@ -1220,26 +1243,26 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
  
   if ( (crate == 0 || crate > 6) && _felix_drop_frags_with_badc && adsiz == 0)
     {
-      MF_LOG_WARNING("_process_FELIX:") << "Bad crate number, discarding fragment on request: " 
-					<< (int) crate;
-      return false;
+      out.Warn("_process_FELIX:") << "Bad crate number, discarding fragment on request: " 
+				  << (int) crate;
+      return out.Return(false);
     }
 
   if ( slot > 4) 
     {
       if (_felix_drop_frags_with_badsf)  // we'll check the fiber later
 	{
-	  _DiscardedCorruptData = true;
-	  MF_LOG_WARNING("_process_FELIX_AUX:") << "Invalid slot:  s=" << (int) slot << " discarding FELIX data.";
-	  return false;
+	  out.Discarded();
+	  out.Warn("_process_FELIX_AUX:") << "Invalid slot:  s=" << (int) slot << " discarding FELIX data.";
+	  return out.Return(false);
 	}
-      _KeptCorruptData = true;
+      out.Kept();
     }
 
   if (_print_coldata_convert_count)
     {
       uint16_t first_coldata_convert_count = felix.coldata_convert_count(0,0);
-      std::cout << "FELIX Coldata convert count: " << (int) first_coldata_convert_count << std::endl;
+      out.Print() << "FELIX Coldata convert count: " << (int) first_coldata_convert_count << "\n";
     }
 
   //std::cout << "FELIX raw decoder trj: " << (int) crate << " " << (int) slot << " " << (int) fiber << std::endl;
@@ -1247,7 +1270,7 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
   const unsigned n_frames = felix.total_frames(); // One frame contains 25 felix (20 ns-long) ticks.  A "frame" is an offline tick
   //std::cout<<" Nframes = "<<n_frames<<std::endl;
   //_h_nframes->Fill(n_frames);
-  if (n_frames == 0) return true;
+  if (n_frames == 0) return out.Return(true);
   const unsigned n_channels = dune::FelixFrame::num_ch_per_frame;// should be 256
 
 
@@ -1255,20 +1278,20 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
     {
       if (_felix_check_buffer_size)
 	{
-	  MF_LOG_WARNING("_process_FELIX_AUX:") << "n_channels*n_frames too large: " << n_channels << " * " << n_frames << " = " << 
+	  out.Warn("_process_FELIX_AUX:") << "n_channels*n_frames too large: " << n_channels << " * " << n_frames << " = " << 
 	    n_frames*n_channels << " larger than: " <<  _felix_buffer_size_checklimit << ".  Discarding this fragment";
-	  _DiscardedCorruptData = true;
-	  return false;
+	  out.Discarded();
+	  return out.Return(false);
 	}
       else
 	{
-	  _KeptCorruptData = true;
+	  out.Kept();
 	}
     }
 
   if(_make_histograms)
     {
-      felixchans=felixchans+n_channels;
+      out.Channels(n_channels);
     }
 
   for (unsigned int iframe=0; iframe<n_frames; ++iframe)
@@ -1277,23 +1300,20 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
 	{
 	  if (_enforce_error_free )
 	    {
-	      _DiscardedCorruptData = true;
-	      MF_LOG_WARNING("_process_FELIX_AUX:") << "WIB Errors on frame: " << iframe << " : " << felix.wib_errors(iframe)
-						    << " Discarding Data";
-	      error_counter++;
+	      out.Discarded();
+	      out.Warn("_process_FELIX_AUX:") << "WIB Errors on frame: " << iframe << " : " << felix.wib_errors(iframe)
+					      << " Discarding Data";
+	      out.Error();
 	      // drop just this fragment
 	      //_discard_data = true;
-	      return true;
+	      return out.Return(true);
 	    }
-	  _KeptCorruptData = true;
+	  out.Kept();
 	}
     }
 
-  // check optimization of this -- size not reserved
-
   raw::RawDigit::ADCvector_t v_adc;
-  //v_adc.reserve(n_frames*n_channels);
-  // Fill the adc vector.  
+  out.digits.reserve(n_channels);
 
   for(unsigned ch = 0; ch < n_channels; ++ch) {
 
@@ -1310,13 +1330,13 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
       }
     else
       {
-	MF_LOG_WARNING("_process_FELIX_AUX:") << " Fiber number " << (int) fiber << " is expected to be 1 or 2 -- revisit logic";
+	out.Warn("_process_FELIX_AUX:") << " Fiber number " << (int) fiber << " is expected to be 1 or 2 -- revisit logic";
 	fiberloc = 1;
-	error_counter++;
+	out.Error();
 	if (_felix_drop_frags_with_badsf) 
 	  {
-	    MF_LOG_WARNING("_process_FELIX_AUX:") << " Dropping FELIX Data";
-	    return false;
+	    out.Warn("_process_FELIX_AUX:") << " Dropping FELIX Data";
+	    return out.Return(false);
 	  }
       }
 
@@ -1338,192 +1358,202 @@ bool PDSPTPCRawDecoder::_process_FELIX_AUX(const artdaq::Fragment& frag, RawDigi
     if (_max_offline_channel >= 0 && _min_offline_channel >= 0 && _max_offline_channel >= _min_offline_channel && 
 	(offlineChannel < (size_t) _min_offline_channel || offlineChannel > (size_t) _max_offline_channel) ) continue;
 
-    v_adc.clear();
     //std::cout<<"crate:slot:fiber = "<<crate<<", "<<slot<<", "<<fiber<<std::endl;
     std::vector<dune::adc_t> waveform( felix.get_ADCs_by_channel(ch) );
-    for(unsigned int nframe=0;nframe<waveform.size();nframe++){
-      // if(ch==0 && nframe<100) {
-      //  if(nframe==0) std::cout<<"Print the first 100 ADCs of Channel#1"<<std::endl;  
-      //  std::cout<<waveform.at(nframe)<<"  ";
-      //  if(nframe==99) std::cout<<std::endl;
-      // }
-      v_adc.push_back(waveform.at(nframe));  
-    }
+    v_adc.assign(waveform.begin(), waveform.end());
 
     if ( v_adc.size() != _full_tick_count)
       {
 	if (_enforce_full_tick_count)
 	  {
-	    MF_LOG_WARNING("_process_FELIX_AUX:") << "Nticks not the required value: " << v_adc.size() << " " 
-						  << _full_tick_count << " Discarding Data";
-	    error_counter++;
-	    incorrect_ticks++;
-	    _discard_data = true;
-	    _DiscardedCorruptData = true;
-	    return true; 
-	  }
-	_KeptCorruptData = true;
-      }
-
-    if (!_initialized_tick_count_this_event)
-      {
-	_initialized_tick_count_this_event = true;
-	_tick_count_this_event = v_adc.size();
-      }
-    else
-      {
-	if (_enforce_same_tick_count)
-	  {
-	    if (v_adc.size() != _tick_count_this_event)
-	      {
-		MF_LOG_WARNING("_process_FELIX_AUX:") << "Nticks different for two channel streams: " << v_adc.size() 
-						      << " vs " << _tick_count_this_event << " Discarding Data";
-		error_counter++;
-		_discard_data = true;
-		_DiscardedCorruptData = true;
-		return true;
-	      }
-	    _KeptCorruptData = true;
+	    out.Warn("_process_FELIX_AUX:") << "Nticks not the required value: " << v_adc.size() << " " 
+					    << _full_tick_count << " Discarding Data";
+	    out.Error();
+	    out.IncorrectTicks();
+	    out.DiscardEvent();
+	    out.Discarded();
+	    return out.Return(true); 
 	  }
+	out.Kept();
       }
 
-    if (offlineChannel < _duplicate_channel_checklist_size)
-      {
-	if (_duplicate_channel_checklist[offlineChannel])
-	  {
-	    if(_make_histograms)
-	      {
-		duplicate_channels++;
-	      }
-	    if (_enforce_no_duplicate_channels)
-	      {
-		MF_LOG_WARNING("_process_FELIX_AUX:") << "Duplicate Channel: " << offlineChannel
-						      << " c:s:f:ich: " << (int) crate << " " << (int) slot << " " << (int) fiber << " " << (int) ch << " Discarding Data";
-		error_counter++;
-		_discard_data = true;
-		_DiscardedCorruptData = true;
-		return true;
-	      }
-	    _KeptCorruptData = true;	    
-	  }
-	_duplicate_channel_checklist[offlineChannel] = true;
-      }
+    // compared with the other channels of the event in _applyFragment
+    out.TickCount(v_adc.size());
 
     float median=0;
     float sigma=0;
     computeMedianSigma(v_adc,median,sigma);
 
     auto n_ticks = v_adc.size();
-    raw::Compress_t cflag=raw::kNone;
-    if (_compress_Huffman)
-      {
-	cflag = raw::kHuffman;
-	raw::Compress(v_adc,cflag);
-      }
-    // here n_ticks is the uncompressed size as required by the constructor
-    raw::RawDigit raw_digit(offlineChannel, n_ticks, v_adc, cflag);
-    raw_digit.SetPedestal(median,sigma);
-    raw_digits.push_back(raw_digit);
-
-    raw::RDTimeStamp rdtimestamp(felix.timestamp(),offlineChannel);
-    timestamps.push_back(rdtimestamp);
-
-    //associate the raw digit and the timestamp data products
-    auto const rawdigitptr = rdpm(raw_digits.size()-1);
-    auto const rdtimestampptr = tspm(timestamps.size()-1);
-    tsassocs.addSingle(rawdigitptr,rdtimestampptr);
+    // compressed in produce if requested
+    out.digits.emplace_back(offlineChannel, n_ticks, std::move(v_adc), raw::kNone);
+    out.digits.back().SetPedestal(median,sigma);
+    v_adc.clear();
+
+    // checked for duplicates in _applyFragment
+    out.Digit(felix.timestamp(), crate, slot, fiber, ch);
   }
-  return true;
+  return out.Return(true);
 }
 
 
-// compute median and sigma.  Sigma is half the distance between the upper and lower bounds of the
-// 68% region where 34% is above the median and 34% is below ("centered" on the median).
+// Decode the fragments of one handle and apply them to the event in order.
 
-void PDSPTPCRawDecoder::computeMedianSigma(raw::RawDigit::ADCvector_t &v_adc, float &median, float &sigma)
+void PDSPTPCRawDecoder::_decodeFragments(const std::vector<const artdaq::Fragment*> &blocks, bool felix, size_t ntickscheck, size_t &n_frags,
+					 RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm)
 {
-  size_t asiz = v_adc.size();
-  int imed=0;
-  if (asiz == 0)
+  dune::PdspChannelMapService * channelMap = &*art::ServiceHandle<dune::PdspChannelMapService>();
+  std::vector<FragmentDecode> decodes(blocks.size());
+
+  auto decode = [&](size_t i)
+    {
+      decodes[i].felix = felix;
+      if (felix) _process_FELIX_AUX(*blocks[i], channelMap, decodes[i]);
+      else _process_RCE_AUX(*blocks[i], channelMap, decodes[i], ntickscheck);
+    };
+
+  if (_max_concurrency == 1 || blocks.size() < 2)
     {
-      median = 0;
-      sigma = 0;
+      for (size_t i = 0; i < blocks.size(); ++i)
+	{
+	  decode(i);
+	  if (_applyFragment(decodes[i], raw_digits, timestamps, tsassocs, rdpm, tspm)) ++n_frags;
+	  decodes[i] = FragmentDecode();
+	}
+      return;
     }
-  else
+
+  // 0 means use the scheduler's own limit
+  int nthread = _max_concurrency > 0 ? _max_concurrency : tbb::task_arena::automatic;
+  tbb::task_arena arena(nthread);
+  arena.execute([&] {
+      tbb::parallel_for(size_t(0), blocks.size(), decode);
+    });
+
+  size_t ndigit = raw_digits.size();
+  for (const auto & dec : decodes) ndigit += dec.digits.size();
+  raw_digits.reserve(ndigit);
+  timestamps.reserve(ndigit);
+  for (auto & dec : decodes)
     {
-      // this is actually faster than the code below by about one second per event.
-      // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
+      if (_applyFragment(dec, raw_digits, timestamps, tsassocs, rdpm, tspm)) ++n_frags;
+      dec = FragmentDecode();
+    }
+}
 
-      imed = TMath::Median(asiz,v_adc.data()) + 0.01;  // add an offset to make sure the floor gets the right integer
-      median = imed;
-      sigma = TMath::RMS(asiz,v_adc.data());
+// Replay the steps of a decoded fragment.  Returns what the fragment
+// returns; a fragment that fails the tick count or duplicate channel
+// checks stops there, RCE fragments returning false and FELIX ones true.
 
-      // add in a correction suggested by David Adams, May 6, 2019
+bool PDSPTPCRawDecoder::_applyFragment(FragmentDecode &dec, RawDigits& raw_digits, RDTimeStamps &timestamps, RDTsAssocs &tsassocs, RDPmkr &rdpm, TSPmkr &tspm)
+{
+  const char * auxname = dec.felix ? "_process_FELIX_AUX:" : "_process_RCE_AUX:";
 
-      size_t s1 = 0;
-      size_t sm = 0;
-      for (size_t i=0; i<asiz; ++i)
-	{
-	  if (v_adc[i] < imed) s1++;
-	  if (v_adc[i] == imed) sm++;
-	}
-      if (sm > 0)
+  for (auto & step : dec.steps)
+    {
+      switch (step.type)
 	{
-	  float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
-	  //if (std::abs(mcorr)>1.0) std::cout << "mcorr: " << mcorr << std::endl;
-	  median += mcorr;
+	case FragmentDecode::kWarning:
+	  MF_LOG_WARNING(step.category) << step.text;
+	  break;
+	case FragmentDecode::kPrint:
+	  std::cout << step.text << std::flush;
+	  break;
+	case FragmentDecode::kDiscarded:
+	  _DiscardedCorruptData = true;
+	  break;
+	case FragmentDecode::kKept:
+	  _KeptCorruptData = true;
+	  break;
+	case FragmentDecode::kDiscardEvent:
+	  _discard_data = true;
+	  break;
+	case FragmentDecode::kError:
+	  error_counter++;
+	  break;
+	case FragmentDecode::kIncorrectTicks:
+	  incorrect_ticks++;
+	  break;
+	case FragmentDecode::kChannels:
+	  if (dec.felix) felixchans += step.value;
+	  else rcechans += step.value;
+	  break;
+	case FragmentDecode::kTickCount:
+	  if (!_initialized_tick_count_this_event)
+	    {
+	      _initialized_tick_count_this_event = true;
+	      _tick_count_this_event = step.value;
+	    }
+	  else if (!dec.felix || _enforce_same_tick_count)
+	    {
+	      if (step.value != _tick_count_this_event && _enforce_same_tick_count)
+		{
+		  MF_LOG_WARNING(auxname) << "Nticks different for two channel streams: " << step.value 
+					  << " vs " << _tick_count_this_event << " Discarding Data";
+		  error_counter++;
+		  _discard_data = true;
+		  _DiscardedCorruptData = true;
+		  return dec.felix;
+		}
+	      _KeptCorruptData = true;
+	    }
+	  break;
+	case FragmentDecode::kDigit:
+	  {
+	    raw::RawDigit & raw_digit = dec.digits[step.value];
+	    unsigned int offlineChannel = raw_digit.Channel();
+	    if (offlineChannel < _duplicate_channel_checklist_size)
+	      {
+		if (_duplicate_channel_checklist[offlineChannel])
+		  {
+		    if(_make_histograms)
+		      {
+			duplicate_channels++;
+		      }
+		    if (_enforce_no_duplicate_channels)
+		      {
+			MF_LOG_WARNING(auxname) << "Duplicate Channel: " << offlineChannel
+						<< " c:s:f:ich: " << step.crate << " " << step.slot << " " << step.fiber << " " << step.ich << " Discarding Data";
+			error_counter++;
+			_discard_data = true;
+			_DiscardedCorruptData = true;
+			return dec.felix;
+		      }
+		    _KeptCorruptData = true;
+		  }
+		_duplicate_channel_checklist[offlineChannel] = true;
+	      }
+
+	    raw_digits.push_back(std::move(raw_digit));
+	    timestamps.emplace_back(step.timestamp, offlineChannel);
+
+	    //associate the raw digit and the timestamp data products
+	    auto const rawdigitptr = rdpm(raw_digits.size()-1);
+	    auto const rdtimestampptr = tspm(timestamps.size()-1);
+	    tsassocs.addSingle(rawdigitptr,rdtimestampptr);
+	  }
+	  break;
+	case FragmentDecode::kReturn:
+	  return step.value != 0;
 	}
     }
+  return true;
+}
 
 
+// compute median and sigma.
 
-  // never do this, but keep the code around in case we want it later
+void PDSPTPCRawDecoder::computeMedianSigma(raw::RawDigit::ADCvector_t &v_adc, float &median, float &sigma)
+{
+  // the RMS includes tails from bad samples and signals and may not be the best RMS calc.
 
-  // if (asiz > 100000000)
-  //   {
-  //     size_t mednum = asiz/2;
-  //     size_t m1snum = mednum - ( (float) asiz )*0.34;
-  //     size_t p1snum = mednum + ( (float) asiz )*0.34;
+  dune::PedestalEstimator & ped = dune::PedestalEstimator::ThreadInstance();
+  ped.Fill(v_adc);
 
-  //     std::map<size_t,size_t> adcmap;
-  //     for (auto const adc : v_adc)
-  // 	{
-  // 	  auto mapiter = adcmap.find(adc);
-  // 	  if (mapiter != adcmap.end())
-  // 	    {
-  // 	      mapiter->second ++;
-  // 	    }
-  // 	  else
-  // 	    {
-  // 	      adcmap[adc] = 1;
-  // 	    }
-  // 	}
+  // integer median plus a correction suggested by David Adams, May 6, 2019
 
-  //     // find quantiles, -1 sigma, median, plus 1 sigma
-  //     size_t sum = 0;
-  //     size_t m1s = 0;
-  //     size_t p1s = 0;
-  //     size_t m = 0;
-  //     for (auto const &mv : adcmap)
-  // 	{
-  // 	  sum += mv.second;
-  // 	  if (m1s == 0 && sum >= m1snum) 
-  // 	    {
-  // 	      m1s = mv.first;
-  // 	    }
-  // 	  if (m == 0 && sum >= mednum)
-  // 	    {
-  // 	      m = mv.first;
-  // 	    }
-  // 	  if (p1s == 0 && sum >= p1snum)
-  // 	    {
-  // 	      p1s = mv.first;
-  // 	      break;
-  // 	    }
-  // 	}
-  //     median = (float) m;
-  //     sigma = ((float) (p1s - m1s))/2.0;
-  //   }
+  median = ped.CorrectedMedian();
+  sigma = ped.RMS();
 }
 
 DEFINE_ART_MODULE(PDSPTPCRawDecoder)
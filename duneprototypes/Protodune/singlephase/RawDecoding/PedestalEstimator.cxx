@@ -0,0 +1,202 @@
+// PedestalEstimator.cxx
+
+#include "PedestalEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+//-----------------------------------------------------------------------
+
+dune::PedestalEstimator::PedestalEstimator()
+  : fCounts(kNBins, 0), fUseSorted(false), fN(0), fMin(0), fMax(-1), fSum(0)
+{
+}
+
+//-----------------------------------------------------------------------
+
+dune::PedestalEstimator & dune::PedestalEstimator::ThreadInstance()
+{
+  thread_local PedestalEstimator est;
+  return est;
+}
+
+//-----------------------------------------------------------------------
+
+void dune::PedestalEstimator::ClearHistogram()
+{
+  if (fMax >= fMin) std::fill(fCounts.begin() + fMin, fCounts.begin() + fMax + 1, 0);
+  fMin = kNBins;
+  fMax = -1;
+}
+
+//-----------------------------------------------------------------------
+
+void dune::PedestalEstimator::Fill(const short * adcs, size_t n)
+{
+  ClearHistogram();
+  fSorted.clear();
+  fUseSorted = false;
+  fN = n;
+  fSum = 0;
+
+  uint32_t * counts = fCounts.data();
+  int vmin = kNBins;
+  int vmax = -1;
+  int64_t sum = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      int val = adcs[i];
+      if ((unsigned int) val >= (unsigned int) kNBins)
+        {
+          // out of the histogram range: sort a copy instead
+          fMin = vmin;
+          fMax = vmax;
+          ClearHistogram();
+          fSorted.assign(adcs, adcs + n);
+          std::sort(fSorted.begin(), fSorted.end());
+          fUseSorted = true;
+          for (short s : fSorted) fSum += s;
+          return;
+        }
+      ++counts[val];
+      vmin = std::min(vmin, val);
+      vmax = std::max(vmax, val);
+      sum += val;
+    }
+  fMin = vmin;
+  fMax = vmax;
+  fSum = sum;
+}
+
+//-----------------------------------------------------------------------
+
+int dune::PedestalEstimator::OrderStat(size_t k) const
+{
+  if (fUseSorted) return fSorted[k];
+  size_t cum = 0;
+  for (int val = fMin; val < fMax; ++val)
+    {
+      cum += fCounts[val];
+      if (cum > k) return val;
+    }
+  return fMax;
+}
+
+//-----------------------------------------------------------------------
+
+void dune::PedestalEstimator::CountAround(int value, size_t & nbelow, size_t & nat) const
+{
+  if (fUseSorted)
+    {
+      auto range = std::equal_range(fSorted.begin(), fSorted.end(), (short) value);
+      nbelow = range.first - fSorted.begin();
+      nat = range.second - range.first;
+      return;
+    }
+  nbelow = 0;
+  nat = 0;
+  for (int val = fMin; val <= fMax && val < value; ++val) nbelow += fCounts[val];
+  if (value >= fMin && value <= fMax) nat = fCounts[value];
+}
+
+//-----------------------------------------------------------------------
+
+void dune::PedestalEstimator::Moments(int lo, int hi, double center,
+                                      size_t & n, double & sum, double & sumsq) const
+{
+  n = 0;
+  sum = 0;
+  sumsq = 0;
+  if (fUseSorted)
+    {
+      auto first = std::lower_bound(fSorted.begin(), fSorted.end(), lo);
+      auto last = std::upper_bound(fSorted.begin(), fSorted.end(), hi);
+      for (auto it = first; it != last; ++it)
+        {
+          double dx = *it - center;
+          sum += dx;
+          sumsq += dx*dx;
+        }
+      n = last - first;
+      return;
+    }
+  lo = std::max(lo, fMin);
+  hi = std::min(hi, fMax);
+  for (int val = lo; val <= hi; ++val)
+    {
+      uint32_t cnt = fCounts[val];
+      if (cnt == 0) continue;
+      double dx = val - center;
+      n += cnt;
+      sum += cnt*dx;
+      sumsq += cnt*dx*dx;
+    }
+}
+
+//-----------------------------------------------------------------------
+
+double dune::PedestalEstimator::Median() const
+{
+  if (fN == 0) return 0;
+  if (fN%2 == 1) return OrderStat(fN/2);
+  return 0.5*(OrderStat(fN/2 - 1) + OrderStat(fN/2));
+}
+
+//-----------------------------------------------------------------------
+
+int dune::PedestalEstimator::IntegerMedian() const
+{
+  // add an offset to make sure the floor gets the right integer
+  return Median() + 0.01;
+}
+
+//-----------------------------------------------------------------------
+
+float dune::PedestalEstimator::MedianCorrection() const
+{
+  if (fN == 0) return 0;
+  size_t s1 = 0;
+  size_t sm = 0;
+  CountAround(IntegerMedian(), s1, sm);
+  if (sm == 0) return 0;
+  return (-0.5 + (0.5*(float) fN - (float) s1)/ ((float) sm) );
+}
+
+//-----------------------------------------------------------------------
+
+float dune::PedestalEstimator::CorrectedMedian() const
+{
+  float median = IntegerMedian();
+  median += MedianCorrection();
+  return median;
+}
+
+//-----------------------------------------------------------------------
+
+double dune::PedestalEstimator::RMS() const
+{
+  if (fN < 2) return 0;
+  double mean = double(fSum)/double(fN);
+  size_t n = 0;
+  double sum = 0;
+  double sumsq = 0;
+  Moments(fUseSorted ? fSorted.front() : fMin, fUseSorted ? fSorted.back() : fMax, mean, n, sum, sumsq);
+  return std::sqrt(sumsq/(fN - 1));
+}
+
+//-----------------------------------------------------------------------
+
+double dune::PedestalEstimator::TruncatedRMS(double halfwidth) const
+{
+  if (fN < 2) return 0;
+  int imed = IntegerMedian();
+  int lo = std::ceil(imed - halfwidth);
+  int hi = std::floor(imed + halfwidth);
+  size_t n = 0;
+  double sum = 0;
+  double sumsq = 0;
+  Moments(lo, hi, imed, n, sum, sumsq);
+  if (n < 2) return 0;
+  double var = (sumsq - sum*sum/n)/(n - 1);
+  return var > 0 ? std::sqrt(var) : 0;
+}
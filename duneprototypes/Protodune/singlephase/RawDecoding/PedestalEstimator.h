@@ -0,0 +1,80 @@
+// PedestalEstimator.h
+//
+// Pedestal and noise estimate for a raw waveform, shared by the TPC
+// decoders.  The samples are counted into a fixed histogram with one bin
+// per ADC value (14-bit, 16384 bins) in a single pass; the median, the
+// median correction and the RMS are then read off the histogram without
+// sorting or allocating.
+//
+// The values are the ones the decoders computed before:
+//   Median()          same as TMath::Median (mean of the two middle
+//                     samples for an even count)
+//   CorrectedMedian() the integer median, int(Median() + 0.01), plus the
+//                     correction suggested by David Adams, May 6, 2019
+//   RMS()             same as TMath::RMS (standard deviation, n-1)
+// TruncatedRMS(w) is the RMS of the samples within w counts of the
+// integer median, which excludes signals and bad samples.
+//
+// A waveform with a sample outside [0, 16384) is sorted instead, with the
+// same results.  One estimator is not thread safe; use ThreadInstance()
+// from code that runs in parallel.
+
+#ifndef PedestalEstimator_H
+#define PedestalEstimator_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dune {
+
+  class PedestalEstimator {
+
+  public:
+
+    static constexpr int kNBins = 16384;
+
+    PedestalEstimator();
+
+    // Replace the contents with a new waveform.
+    void Fill(const short * adcs, size_t n);
+    void Fill(const std::vector<short> & adcs) { Fill(adcs.data(), adcs.size()); }
+
+    size_t Size() const { return fN; }
+
+    double Median() const;
+    int IntegerMedian() const;
+    float MedianCorrection() const;
+    float CorrectedMedian() const;
+    double RMS() const;
+    double TruncatedRMS(double halfwidth) const;
+
+    // Estimator owned by the calling thread.
+    static PedestalEstimator & ThreadInstance();
+
+  private:
+
+    // k-th smallest sample, k = 0 .. n-1
+    int OrderStat(size_t k) const;
+
+    // number of samples below and at value
+    void CountAround(int value, size_t & nbelow, size_t & nat) const;
+
+    // count, sum and sum of squares about center of samples in [lo, hi]
+    void Moments(int lo, int hi, double center, size_t & n, double & sum, double & sumsq) const;
+
+    void ClearHistogram();
+
+    std::vector<uint32_t> fCounts;
+    std::vector<short> fSorted;     // only used for out-of-range waveforms
+    bool fUseSorted;
+    size_t fN;
+    int fMin;
+    int fMax;
+    int64_t fSum;
+
+  };
+
+}
+
+#endif
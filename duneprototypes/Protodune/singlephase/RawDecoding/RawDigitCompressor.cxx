@@ -0,0 +1,39 @@
+// RawDigitCompressor.cxx
+
+#include "RawDigitCompressor.h"
+
+#include <utility>
+
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
+
+namespace dune {
+
+RawDigitCompressor::RawDigitCompressor(raw::Compress_t compression, int maxConcurrency)
+  : fCompression(compression), fMaxConcurrency(maxConcurrency) { }
+
+void RawDigitCompressor::Compress(raw::RawDigit & digit) const {
+  if ( fCompression == raw::kNone || digit.Compression() != raw::kNone ) return;
+  raw::RawDigit::ADCvector_t adcs(digit.ADCs());
+  raw::Compress(adcs, fCompression);
+  const float pedestal = digit.GetPedestal();
+  const float sigma = digit.GetSigma();
+  digit = raw::RawDigit(digit.Channel(), digit.Samples(), std::move(adcs), fCompression);
+  digit.SetPedestal(pedestal, sigma);
+}
+
+void RawDigitCompressor::Compress(std::vector<raw::RawDigit> & digits) const {
+  if ( fCompression == raw::kNone ) return;
+  if ( fMaxConcurrency == 1 || digits.size() < 2 ) {
+    for ( raw::RawDigit & digit : digits ) Compress(digit);
+    return;
+  }
+  // 0 means use the scheduler's own limit
+  int nthread = fMaxConcurrency > 0 ? fMaxConcurrency : tbb::task_arena::automatic;
+  tbb::task_arena arena(nthread);
+  arena.execute([&] {
+    tbb::parallel_for(size_t(0), digits.size(), [&](size_t i) { Compress(digits[i]); });
+  });
+}
+
+}
@@ -0,0 +1,49 @@
+// RawDigitCompressor.h
+//
+// Compresses the ADCs of an event's RawDigits in one batch after decoding,
+// instead of channel by channel inside the decode loop.  Each digit is
+// compressed with raw::Compress and rebuilt in place with the same
+// channel, sample count, pedestal and sigma, so the output is identical to
+// compressing in the decoder.  Digits that are already compressed are left
+// alone, as is everything when the compression is raw::kNone.
+//
+// The digits are independent, so with a concurrency other than 1 they are
+// compressed on a TBB arena of at most that many threads (0: no limit
+// beyond the scheduler).  The order of the collection is unchanged.
+
+#ifndef RawDigitCompressor_H
+#define RawDigitCompressor_H
+
+#include <vector>
+
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/RawData/raw.h"
+
+namespace dune {
+
+  class RawDigitCompressor {
+
+  public:
+
+    explicit RawDigitCompressor(raw::Compress_t compression =raw::kHuffman,
+                                int maxConcurrency =1);
+
+    raw::Compress_t Compression() const { return fCompression; }
+    int MaxConcurrency() const { return fMaxConcurrency; }
+
+    // Compress one digit in place.
+    void Compress(raw::RawDigit & digit) const;
+
+    // Compress all the digits in place.
+    void Compress(std::vector<raw::RawDigit> & digits) const;
+
+  private:
+
+    raw::Compress_t fCompression;
+    int fMaxConcurrency;
+
+  };
+
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
 #include "dunepdlegacy/Services/ChannelMap/PdspChannelMapService.h"
+#include "duneprototypes/Protodune/singlephase/RawDecoding/SSPWaveformStats.h"
 
 // artdaq and dunepdlegacy includes
 #include "dunepdlegacy/Overlays/SSPFragment.hh"
@@ -40,6 +41,7 @@
 // C++ Includes
 #include <memory>
 #include <map>
+#include <vector>
 
 namespace dune {
   class SSPRawDecoder;
@@ -92,6 +94,7 @@ public:
   void beginEvent(art::EventNumber_t eventNumber);
 
   void setRootObjects();
+  void writeTriggerTypes();
 
   recob::OpHit ConstructOpHit(detinfo::DetectorClocksData const& clockData,
                               trig_variables &trig, unsigned int channel);
@@ -106,6 +109,7 @@ private:
   std::string fIntTrigOutputLabel;
   bool fUseChannelMap;
   bool fDebug;
+  bool fDiagnostics;                        ///< fill the diagnostic histograms
   raw::Compress_t        fCompression;      ///< compression type to use
   unsigned int           fZeroThreshold;    ///< Zero suppression threshold
 
@@ -140,6 +144,7 @@ private:
   //const uint32_t spillsamptime_ = 720000000; //~4.8 sec beam spill time
   
   int number_of_packets = 12;  // 12 channels per SSP
+  unsigned int last_packets_ = 0;  // packets in the previous event
   
   //mapping for SSPs to simple array
   std::map<int,int> ssp_map_ =
@@ -168,7 +173,11 @@ private:
       {63,22},
       {64,23} };
 
-  std::map<size_t,TH1D*> trigger_type_; // internal vs. external  (16 internal, 48 external)
+  // Packets per channel: all, internal (16) and external (48) triggers.
+  // Written to the trigger type histograms at endJob.
+  std::vector<unsigned long> trig_count_;
+  std::vector<unsigned long> int_trig_count_;
+  std::vector<unsigned long> ext_trig_count_;
 
   //int smooth; // unused
   
@@ -208,6 +217,7 @@ void dune::SSPRawDecoder::reconfigure(fhicl::ParameterSet const& pset) {
   fUseChannelMap = pset.get<bool>("UseChannelMap");
   number_of_packets=pset.get<int>("number_of_packets");
   fDebug = pset.get<bool>("Debug");
+  fDiagnostics = pset.get<bool>("Diagnostics", true);
   fZeroThreshold=0;
   fCompression=raw::kNone;
 
@@ -266,6 +276,7 @@ void dune::SSPRawDecoder::printParameterSet(){
 }
 
 void dune::SSPRawDecoder::setRootObjects(){
+  if (!fDiagnostics) return;
   art::ServiceHandle<art::TFileService> tFileService;
 
   n_event_packets_ = tFileService->make<TH1D>("ssp_n_event_packets","SSP: n_event_packets",960,-0.5,959.5);  
@@ -352,7 +363,7 @@ void dune::SSPRawDecoder::getFragments(art::Event &evt, std::vector<artdaq::Frag
           for (size_t ii = 0; ii < contf.block_count(); ++ii)
             {
               size_t fragSize = contf.fragSize(ii);
-              frag_sizes_->Fill(fragSize);
+              if (fDiagnostics) frag_sizes_->Fill(fragSize);
               //artdaq::Fragment thisfrag;
               //thisfrag.resizeBytes(fragSize);
             
@@ -423,19 +434,33 @@ void dune::SSPRawDecoder::beginEvent(art::EventNumber_t /*eventNumber*/)
 }
 
 void dune::SSPRawDecoder::endJob(){
+  writeTriggerTypes();
+}
+
+void dune::SSPRawDecoder::writeTriggerTypes(){
+  if (!fDiagnostics) return;
+  art::ServiceHandle<art::TFileService> tFileService;
 
+  for (size_t channel = 0; channel < trig_count_.size(); ++channel) {
+    if (trig_count_[channel] == 0) continue;
+    TH1D* tth = tFileService->make<TH1D>(Form("trigger_type_channel_%zu",channel),Form("trigger_type_channel_%zu",channel),4,0,3);
+    tth->SetTitle(Form("Trigger type - Channel %zu",channel));
+    tth->GetXaxis()->SetTitle("Trigger type");
+    tth->GetXaxis()->SetBinLabel(2,"Internal (16)");
+    tth->GetXaxis()->SetBinLabel(3,"External (48)");
+    tth->SetBinContent(2, int_trig_count_[channel]);
+    tth->SetBinContent(3, ext_trig_count_[channel]);
+    tth->ResetStats();
+  }
 }
 
 void dune::SSPRawDecoder::produce(art::Event & evt){
 
-  art::ServiceHandle<art::TFileService> tFileService;
   art::ServiceHandle<dune::PdspChannelMapService> channelMap;
 
   //MF_LOG_INFO("SSPRawDecoder") << "-------------------- SSP RawDecoder -------------------";
   // Implementation of required member function here.
 
-  art::EventNumber_t eventNumber = evt.event();  
-  
   /// Get the fragments (Container or Raw)
   std::vector<artdaq::Fragment> fragments;
   getFragments(evt,&fragments);
@@ -454,10 +479,23 @@ void dune::SSPRawDecoder::produce(art::Event & evt){
   hits.clear();
   int_hits.clear();
   ext_hits.clear();
+
+  // The event usually has as many packets as the last one.
+  if (!fSplitTriggers) {
+    waveforms.reserve(last_packets_);
+    hits.reserve(last_packets_);
+  }
+  else {
+    ext_waveforms.reserve(last_packets_);
+    ext_hits.reserve(last_packets_);
+    int_waveforms.reserve(last_packets_);
+    int_hits.reserve(last_packets_);
+  }
   
   /// Process all packets:
   
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
+  SSPWaveformStats wfstats(long(i1), long(i2), long(m1), long(m2));
   for(auto const& frag: fragments){
     if((unsigned)frag.type() != 3) continue;
  
@@ -503,43 +541,34 @@ void dune::SSPRawDecoder::produce(art::Event & evt){
           if(verb_meta_) std::cout << "SSP: " << ssptrigtime << std::endl; 
         }
         
-        intreftime_[ssp_map_[trig.module_id]] = trig.internal_timestamp;  
-        extreftime_[ssp_map_[trig.module_id]] = trig.timestamp_nova; 
-        if(int_ireftime_[ssp_map_[trig.module_id]] == 0) int_ireftime_[ssp_map_[trig.module_id]] = trig.internal_timestamp;
-        if(ext_ireftime_[ssp_map_[trig.module_id]] == 0) ext_ireftime_[ssp_map_[trig.module_id]] = trig.timestamp_nova;  
+        int issp = ssp_map_[trig.module_id];
+        intreftime_[issp] = trig.internal_timestamp;  
+        extreftime_[issp] = trig.timestamp_nova; 
+        if(int_ireftime_[issp] == 0) int_ireftime_[issp] = trig.internal_timestamp;
+        if(ext_ireftime_[issp] == 0) ext_ireftime_[issp] = trig.timestamp_nova;  
       }
      
-      // Trigger type histogram
-      if (trigger_type_.find(channel) == trigger_type_.end())
-        {
-          TH1D* tth = tFileService->make<TH1D>(Form("trigger_type_channel_%d",channel),Form("trigger_type_channel_%d",channel),4,0,3);
-          tth->SetTitle(Form("Trigger type - Channel %d",channel));
-          tth->GetXaxis()->SetTitle("Trigger type");
-          tth->GetXaxis()->SetBinLabel(2,"Internal (16)");
-          tth->GetXaxis()->SetBinLabel(3,"External (48)");
-          trigger_type_[channel] = tth;
+      // Trigger type counts, histogrammed at endJob
+      if (fDiagnostics) {
+        if (channel >= trig_count_.size()) {
+          trig_count_.resize(channel+1, 0);
+          int_trig_count_.resize(channel+1, 0);
+          ext_trig_count_.resize(channel+1, 0);
         }
-      
-      if ( trig.type == 16 ) trigger_type_[channel]->Fill(1);
-      if ( trig.type == 48 ) trigger_type_[channel]->Fill(2);
+        ++trig_count_[channel];
+        if ( trig.type == 16 ) ++int_trig_count_[channel];
+        if ( trig.type == 48 ) ++ext_trig_count_[channel];
+      }
       
       ///> increment the data pointer past the packet header
       dataPointer+=sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int);
       
-      //>get the information from the data
-      bool verb_values = false;
-      
       ///> get the number of ADC values in the packet
       unsigned int nADC=(trig.length-sizeof(SSPDAQ::EventHeader)/sizeof(unsigned int))*2;
       
       ///> get a pointer to the first ADC value
       const unsigned short* adcPointer=reinterpret_cast<const unsigned short*>(dataPointer);
       
-      char histname[100];
-      sprintf(histname,"evt%i_frag%d_wav%d",eventNumber, frag.fragmentID(), packetsProcessed);
-      
-      TH1D* hist=new TH1D("hist","hist",nADC,0,nADC);
-      
       // map the channel number to offline if requested
       
       unsigned int mappedchannel = channel;
@@ -551,38 +580,17 @@ void dune::SSPRawDecoder::produce(art::Event & evt){
       raw::OpDetWaveform Waveform(time, OpChannel, nADC);
       
       //calculating relevant values in decoder because what comes out of the trigger header seems incorrect-Bryan Ramson
-      unsigned long calbasesum = 0;
-      unsigned short maxadc = 0;
-      unsigned long calintsum = 0;
-      unsigned short  calpeaktime = 0;
-      unsigned int calpeaksum =0;
+      wfstats.Fill(adcPointer, nADC);
+      unsigned long calbasesum = wfstats.BaselineSum();
+      unsigned short maxadc = wfstats.MaxADC();
+      unsigned long calintsum = wfstats.IntSum();
+      unsigned short  calpeaktime = wfstats.PeakTime();
+      unsigned int calpeaksum = wfstats.PeakSum();
       ///> copy the waveforms
-      for(size_t idata = 0; idata < nADC; idata++) {
-        ///> get the 'idata-th' ADC value
-        const unsigned short* adc = adcPointer + idata;
-        if(idata < i1) calbasesum +=  static_cast<unsigned long>(*adc); //added by Bryan Ramson
-        if(idata > i1+m1 && idata <= i2+i1+m1) calintsum += static_cast<unsigned long>(*adc); //added by Bryan Ramson
-        if(idata >= i1+m1+m2 && idata <= i1+2*m1+m2) calpeaksum += static_cast<unsigned int>(*adc); //added by Bryan Ramson
-        
-        maxadc = std::max(maxadc,*adc); //added by Bryan Ramson
-        if(maxadc == *adc) calpeaktime = idata; //added by Bryan Ramson
-        Waveform.push_back(*adc); //added by Jingbo
-        waveform_counter++;
-        
-        n_adc_counter_++;
-        adc_cumulative_ += (uint64_t)(*adc);
-        
-        ///> Waveform 
-        hist->SetBinContent(idata+1,*adc);
-        
-        if (idata >= verb_adcs_) verb_values = false;
-        
-        verb_values = false; //don't print adc. Added by J.Wang
-        if(verb_values) {
-          if(idata == 0&&verb_adcs_>0) std::cout << "Printing the " << nADC << " ADC values saved with the packet:" << std::endl;
-          std::cout << *adc << " ";
-        }
-      }// idata
+      Waveform.assign(adcPointer, adcPointer + nADC); //added by Jingbo
+      waveform_counter += nADC;
+      n_adc_counter_ += nADC;
+      adc_cumulative_ += wfstats.ADCSum();
 
       // pedestal, area and peak (according to the Register table, the  SSP User Manual has i1 and i2 inverted)
       double pedestal = calbasesum / ((double)i1);    
@@ -631,16 +639,16 @@ void dune::SSPRawDecoder::produce(art::Event & evt){
       // Put waveform and ophit into collections
       // Split into internal and external triggers if that has been set.
       if (!fSplitTriggers) {
-        waveforms.emplace_back( Waveform );
+        waveforms.emplace_back( std::move(Waveform) );
         hits.emplace_back( ConstructOpHit(clockData, trig, mappedchannel) );
       }
       else{
         if (trig.type == 48 ) {
-          ext_waveforms.emplace_back( Waveform );
+          ext_waveforms.emplace_back( std::move(Waveform) );
           ext_hits.emplace_back( ConstructOpHit(clockData, trig, mappedchannel) );
         }
         else if (trig.type == 16) {
-          int_waveforms.emplace_back( Waveform );
+          int_waveforms.emplace_back( std::move(Waveform) );
           int_hits.emplace_back( ConstructOpHit(clockData, trig, mappedchannel) );
         }
         else {
@@ -648,8 +656,6 @@ void dune::SSPRawDecoder::produce(art::Event & evt){
         }
       }
 
-      hist->Delete();
-    
       ++packetsProcessed; // packets
     }
     
@@ -657,7 +663,8 @@ void dune::SSPRawDecoder::produce(art::Event & evt){
     allPacketsProcessed += packetsProcessed;
   }//frag: fragments
   
-  n_event_packets_->Fill(allPacketsProcessed);
+  if (fDiagnostics) n_event_packets_->Fill(allPacketsProcessed);
+  last_packets_ = allPacketsProcessed;
   
   if (!fSplitTriggers) {
     evt.put(std::make_unique<decltype(waveforms)>(std::move(waveforms)), fOutputDataLabel);
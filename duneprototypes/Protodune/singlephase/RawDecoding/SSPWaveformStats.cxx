@@ -0,0 +1,64 @@
+// SSPWaveformStats.cxx
+
+#include "SSPWaveformStats.h"
+
+#include <algorithm>
+
+namespace {
+
+  // Window [begin, end) clipped to non-negative sample numbers.
+  size_t clip(long i) { return i < 0 ? 0 : size_t(i); }
+
+  // Samples summed in 32 bits at a time: 65537 samples of 0xffff still fit.
+  constexpr size_t kBlock = 65536;
+
+  // Sum of the samples in [begin, min(end, n)).
+  uint64_t sumRange(const unsigned short * adcs, size_t n, size_t begin, size_t end)
+  {
+    end = std::min(end, n);
+    uint64_t sum = 0;
+    for (size_t b = begin; b < end; b += kBlock) {
+      const size_t e = std::min(end, b + kBlock);
+      uint32_t blocksum = 0;
+      for (size_t i = b; i < e; ++i) blocksum += adcs[i];
+      sum += blocksum;
+    }
+    return sum;
+  }
+
+}
+
+//-----------------------------------------------------------------------
+
+dune::SSPWaveformStats::SSPWaveformStats(long i1, long i2, long m1, long m2)
+  : fBaseEnd(clip(i1)),
+    fIntBegin(clip(i1 + m1 + 1)), fIntEnd(clip(i1 + m1 + i2 + 1)),
+    fPeakBegin(clip(i1 + m1 + m2)), fPeakEnd(clip(i1 + 2*m1 + m2 + 1)),
+    fBaselineSum(0), fIntSum(0), fPeakSum(0), fMaxADC(0), fPeakTime(0), fADCSum(0)
+{
+}
+
+//-----------------------------------------------------------------------
+
+void dune::SSPWaveformStats::Fill(const unsigned short * adcs, size_t n)
+{
+  uint64_t adcsum = 0;
+  unsigned short maxadc = 0;
+  for (size_t b = 0; b < n; b += kBlock) {
+    const size_t e = std::min(n, b + kBlock);
+    uint32_t blocksum = 0;
+    for (size_t i = b; i < e; ++i) {
+      blocksum += adcs[i];
+      maxadc = adcs[i] > maxadc ? adcs[i] : maxadc;
+    }
+    adcsum += blocksum;
+  }
+  size_t peaktime = n;
+  while (peaktime > 0 && adcs[peaktime - 1] != maxadc) --peaktime;
+  fBaselineSum = sumRange(adcs, n, 0, fBaseEnd);
+  fIntSum = sumRange(adcs, n, fIntBegin, fIntEnd);
+  fPeakSum = sumRange(adcs, n, fPeakBegin, fPeakEnd);
+  fADCSum = adcsum;
+  fMaxADC = maxadc;
+  fPeakTime = peaktime > 0 ? peaktime - 1 : 0;
+}
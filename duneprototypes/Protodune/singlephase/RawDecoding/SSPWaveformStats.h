@@ -0,0 +1,63 @@
+// SSPWaveformStats.h
+//
+// Sums the SSP decoder computes from the ADC samples of a packet, in
+// place of the values in the packet header (see SSPRawDecoder).  With the
+// SSP_i1, SSP_i2, SSP_m1 and SSP_m2 windows of the decoder:
+//   BaselineSum()  samples i <  i1
+//   IntSum()       samples i1+m1 < i <= i1+m1+i2
+//   PeakSum()      samples i1+m1+m2 <= i <= i1+2*m1+m2
+//   MaxADC()       largest sample
+//   PeakTime()     last sample equal to MaxADC() (0 for no samples)
+//   ADCSum()       all samples
+//
+// The total and the maximum are taken in one plain loop over the samples
+// and each window is summed over its own range, clipped to the packet, so
+// the loops have no per-sample window tests and vectorize.  The sums are
+// accumulated in 32 bits per block of 65536 samples.  The peak time is
+// then found by searching back from the end for the maximum.
+
+#ifndef SSPWaveformStats_H
+#define SSPWaveformStats_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dune {
+
+  class SSPWaveformStats {
+
+  public:
+
+    SSPWaveformStats(long i1, long i2, long m1, long m2);
+
+    // Replace the sums with those of a new packet.
+    void Fill(const unsigned short * adcs, size_t n);
+
+    unsigned long BaselineSum() const { return fBaselineSum; }
+    unsigned long IntSum() const { return fIntSum; }
+    unsigned int PeakSum() const { return fPeakSum; }
+    unsigned short MaxADC() const { return fMaxADC; }
+    unsigned short PeakTime() const { return fPeakTime; }
+    uint64_t ADCSum() const { return fADCSum; }
+
+  private:
+
+    // [begin, end) sample ranges of the windows
+    size_t fBaseEnd;
+    size_t fIntBegin;
+    size_t fIntEnd;
+    size_t fPeakBegin;
+    size_t fPeakEnd;
+
+    unsigned long fBaselineSum;
+    unsigned long fIntSum;
+    unsigned int fPeakSum;
+    unsigned short fMaxADC;
+    unsigned short fPeakTime;
+    uint64_t fADCSum;
+
+  };
+
+}
+
+#endif
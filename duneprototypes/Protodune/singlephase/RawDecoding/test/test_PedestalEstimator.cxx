@@ -0,0 +1,191 @@
+// test_PedestalEstimator.cxx
+//
+// Test PedestalEstimator against the TMath::Median, TMath::RMS and
+// median-correction code the decoders used before, on random waveforms
+// with signals, odd and even lengths, constant and tiny waveforms and
+// samples outside the 14-bit range.  Reports the time per waveform for
+// both.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/PedestalEstimator.h"
+#include "TMath.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::PedestalEstimator;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// The decoder code this replaces.
+void referenceMedianSigma(const vector<short>& v_adc, float& median, float& sigma) {
+  size_t asiz = v_adc.size();
+  int imed=0;
+  if ( asiz == 0 ) {
+    median = 0;
+    sigma = 0;
+    return;
+  }
+  imed = TMath::Median(asiz,v_adc.data()) + 0.01;
+  median = imed;
+  sigma = TMath::RMS(asiz,v_adc.data());
+  size_t s1 = 0;
+  size_t sm = 0;
+  for ( size_t i=0; i<asiz; ++i ) {
+    if ( v_adc[i] < imed ) s1++;
+    if ( v_adc[i] == imed ) sm++;
+  }
+  if ( sm > 0 ) {
+    float mcorr = (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
+    median += mcorr;
+  }
+}
+
+// Pedestal with gaussian noise, a few pulses and an occasional bad sample.
+void makeWaveform(vector<short>& adcs, size_t n, double ped, double noise,
+                  std::mt19937& rng, short badval =0) {
+  std::normal_distribution<double> noisedist(ped, noise);
+  std::uniform_int_distribution<size_t> posdist(0, n ? n - 1 : 0);
+  adcs.resize(n);
+  for ( short& adc : adcs ) adc = std::lround(noisedist(rng));
+  if ( n < 100 ) return;
+  for ( int ipul=0; ipul<5; ++ipul ) {
+    size_t i0 = posdist(rng);
+    for ( size_t i=i0; i<std::min(n, i0 + 30); ++i ) adcs[i] += short(400*std::exp(-double(i - i0)/8.0));
+  }
+  if ( badval ) adcs[posdist(rng)] = badval;
+}
+
+void check(const vector<short>& adcs, PedestalEstimator& est) {
+  float refmed = 0;
+  float refsig = 0;
+  referenceMedianSigma(adcs, refmed, refsig);
+  est.Fill(adcs);
+  assert( est.Size() == adcs.size() );
+  assert( est.Median() == TMath::Median(adcs.size(), adcs.data()) );
+  assert( est.CorrectedMedian() == refmed );
+  float sig = est.RMS();
+  assert( std::abs(sig - refsig) <= 1.e-5*refsig );
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_PedestalEstimator(size_t nrep =2000) {
+  const string myname = "test_PedestalEstimator: ";
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(20190506);
+  PedestalEstimator est;
+  vector<short> adcs;
+
+  cout << myname << line << endl;
+  cout << myname << "Check small and degenerate waveforms." << endl;
+  for ( size_t n=0; n<10; ++n ) {
+    makeWaveform(adcs, n, 900, 3, rng);
+    check(adcs, est);
+  }
+  adcs.assign(6000, 2048);
+  check(adcs, est);
+  assert( est.MedianCorrection() == 0.0 );
+  assert( est.RMS() == 0.0 );
+  adcs = {0, 16383, 0, 16383};
+  check(adcs, est);
+
+  cout << myname << line << endl;
+  cout << myname << "Check random waveforms." << endl;
+  std::uniform_int_distribution<size_t> lendist(5000, 6001);
+  std::uniform_real_distribution<double> peddist(300, 3000);
+  std::uniform_real_distribution<double> noisedist(0.3, 30);
+  for ( size_t iwf=0; iwf<nrep; ++iwf ) {
+    makeWaveform(adcs, lendist(rng), peddist(rng), noisedist(rng), rng);
+    check(adcs, est);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Check waveforms with samples outside the histogram." << endl;
+  for ( short bad : {short(-5), short(16384), short(32767), short(-32768)} ) {
+    makeWaveform(adcs, 6000, 900, 4, rng, bad);
+    check(adcs, est);
+    // the next in-range waveform is back on the histogram
+    makeWaveform(adcs, 6000, 1200, 4, rng);
+    check(adcs, est);
+  }
+  makeWaveform(adcs, 101, -20, 3, rng);
+  check(adcs, est);
+
+  cout << myname << line << endl;
+  cout << myname << "Check truncated RMS." << endl;
+  makeWaveform(adcs, 6000, 900, 4, rng);
+  est.Fill(adcs);
+  double trms = est.TruncatedRMS(20);
+  cout << myname << "  RMS: " << est.RMS() << ", truncated RMS: " << trms << endl;
+  assert( trms > 3.5 && trms < 4.5 );
+  assert( trms < est.RMS() );
+  assert( std::abs(est.TruncatedRMS(1.e6) - est.RMS()) < 1.e-6*est.RMS() );
+
+  cout << myname << line << endl;
+  cout << myname << "Time " << nrep << " waveforms." << endl;
+  vector<vector<short>> wfs(100);
+  for ( auto& wf : wfs ) makeWaveform(wf, 6000, peddist(rng), 5, rng);
+  double sumref = 0;
+  double sumest = 0;
+  double sigref = 0;
+  double sigest = 0;
+  auto t0 = Clock::now();
+  for ( size_t irep=0; irep<nrep; ++irep ) {
+    float med, sig;
+    referenceMedianSigma(wfs[irep%wfs.size()], med, sig);
+    sumref += med;
+    sigref += sig;
+  }
+  auto t1 = Clock::now();
+  for ( size_t irep=0; irep<nrep; ++irep ) {
+    est.Fill(wfs[irep%wfs.size()]);
+    sumest += est.CorrectedMedian();
+    sigest += est.RMS();
+  }
+  auto t2 = Clock::now();
+  assert( sumref == sumest );
+  assert( std::abs(sigref - sigest) < 1.e-5*sigref );
+  cout << myname << "  TMath: " << 1.e6*std::chrono::duration<double>(t1 - t0).count()/nrep << " us/waveform" << endl;
+  cout << myname << "   hist: " << 1.e6*std::chrono::duration<double>(t2 - t1).count()/nrep << " us/waveform" << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nrep = 2000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NREP]" << endl;
+      cout << "  NREP [2000]: Number of random waveforms checked and timed." << endl;
+      return 0;
+    }
+    nrep = std::stoul(sarg);
+  }
+  return test_PedestalEstimator(nrep);
+}
+
+//**********************************************************************
@@ -0,0 +1,167 @@
+// test_RawDigitCompressor.cxx
+//
+// Test RawDigitCompressor against compressing channel by channel in the
+// decode loop, serially and in parallel, and report the compression rate
+// in channels/s and the compression ratio.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/RawDigitCompressor.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::RawDigitCompressor;
+using RawDigits = vector<raw::RawDigit>;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// Noise around a pedestal with an occasional pulse.
+void makeWaveform(raw::RawDigit::ADCvector_t& adcs, size_t nticks, std::mt19937& rng) {
+  std::normal_distribution<double> noise(0., 3.);
+  std::uniform_real_distribution<double> flat(0., 1.);
+  double ped = 500. + 400.*flat(rng);
+  adcs.resize(nticks);
+  for ( short& adc : adcs ) adc = short(ped + noise(rng));
+  if ( flat(rng) < 0.3 && nticks > 0 ) {
+    size_t pos = size_t(flat(rng)*nticks);
+    double amp = 1000.*flat(rng);
+    for ( size_t i=pos; i<nticks && i<pos+50; ++i ) {
+      adcs[i] += short(amp*std::exp(-double(i - pos)/10.));
+    }
+  }
+}
+
+// The uncompressed digits the decoders make.
+RawDigits makeDigits(size_t nchan, size_t nticks, std::mt19937& rng) {
+  RawDigits digits;
+  digits.reserve(nchan);
+  raw::RawDigit::ADCvector_t adcs;
+  for ( size_t ich=0; ich<nchan; ++ich ) {
+    makeWaveform(adcs, ich%97 == 5 ? nticks/2 : nticks, rng);
+    digits.emplace_back(ich, adcs.size(), adcs, raw::kNone);
+    digits.back().SetPedestal(adcs.front() + 0.25, 2.5);
+  }
+  return digits;
+}
+
+// Compression inside the decode loop.
+RawDigits referenceDigits(const RawDigits& digits) {
+  RawDigits out;
+  for ( const raw::RawDigit& dig : digits ) {
+    raw::RawDigit::ADCvector_t v_adc(dig.ADCs());
+    raw::Compress_t cflag = raw::kHuffman;
+    raw::Compress(v_adc, cflag);
+    raw::RawDigit raw_digit(dig.Channel(), dig.Samples(), v_adc, cflag);
+    raw_digit.SetPedestal(dig.GetPedestal(), dig.GetSigma());
+    out.push_back(raw_digit);
+  }
+  return out;
+}
+
+bool same(const raw::RawDigit& lhs, const raw::RawDigit& rhs) {
+  return lhs.Channel() == rhs.Channel() &&
+         lhs.Samples() == rhs.Samples() &&
+         lhs.Compression() == rhs.Compression() &&
+         lhs.GetPedestal() == rhs.GetPedestal() &&
+         lhs.GetSigma() == rhs.GetSigma() &&
+         lhs.ADCs() == rhs.ADCs();
+}
+
+bool same(const RawDigits& lhs, const RawDigits& rhs) {
+  if ( lhs.size() != rhs.size() ) return false;
+  for ( size_t i=0; i<lhs.size(); ++i ) {
+    if ( ! same(lhs[i], rhs[i]) ) return false;
+  }
+  return true;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_RawDigitCompressor(size_t nchan, size_t nticks) {
+  const string myname = "test_RawDigitCompressor: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(15360);
+
+  cout << myname << line << endl;
+  cout << myname << "Make " << nchan << " channels of " << nticks << " ticks." << endl;
+  const RawDigits digits = makeDigits(nchan, nticks, rng);
+  const RawDigits ref = referenceDigits(digits);
+
+  cout << myname << line << endl;
+  cout << myname << "Compare with compressing in the decode loop." << endl;
+  for ( int ncon : {1, 2, 4, 0} ) {
+    RawDigitCompressor comp(raw::kHuffman, ncon);
+    RawDigits out = digits;
+    Clock::time_point t0 = Clock::now();
+    comp.Compress(out);
+    double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+    assert( same(out, ref) );
+    size_t nin = 0;
+    size_t nout = 0;
+    for ( size_t i=0; i<out.size(); ++i ) {
+      nin += digits[i].ADCs().size();
+      nout += out[i].ADCs().size();
+    }
+    cout << myname << "  MaxConcurrency " << ncon << ": "
+         << (sec > 0 ? nchan/sec : 0.) << " channels/s, compression ratio "
+         << (nout > 0 ? double(nin)/nout : 0.) << endl;
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Compressed digits and kNone are left alone." << endl;
+  {
+    RawDigits out = ref;
+    RawDigitCompressor(raw::kHuffman, 0).Compress(out);
+    assert( same(out, ref) );
+    out = digits;
+    RawDigitCompressor(raw::kNone, 0).Compress(out);
+    assert( same(out, digits) );
+    RawDigits empty;
+    RawDigitCompressor(raw::kHuffman, 0).Compress(empty);
+    assert( empty.empty() );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nchan = 2560;
+  size_t nticks = 6000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NCHAN [NTICK]]" << endl;
+      cout << "  NCHAN [2560]: Number of channels (15360 for the full detector)." << endl;
+      cout << "  NTICK [6000]: Ticks per channel." << endl;
+      return 0;
+    }
+    nchan = std::stoul(sarg);
+  }
+  if ( argc > 2 ) nticks = std::stoul(argv[2]);
+  return test_RawDigitCompressor(nchan, nticks);
+}
+
+//**********************************************************************
@@ -0,0 +1,163 @@
+// test_SSPWaveformStats.cxx
+//
+// Test SSPWaveformStats against the per-sample loop SSPRawDecoder used
+// before, with the production windows and with windows that run past the
+// end of the packet, on random packets, flat packets, packets with
+// repeated maxima and empty packets.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include "duneprototypes/Protodune/singlephase/RawDecoding/SSPWaveformStats.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::SSPWaveformStats;
+
+//**********************************************************************
+
+namespace {
+
+struct Reference {
+  unsigned long calbasesum = 0;
+  unsigned short maxadc = 0;
+  unsigned long calintsum = 0;
+  unsigned short calpeaktime = 0;
+  unsigned int calpeaksum = 0;
+  uint64_t adc_cumulative = 0;
+};
+
+// The decoder loop this replaces (the windows were doubles there).
+Reference reference(const vector<unsigned short>& adcs, double i1, double i2, double m1, double m2) {
+  Reference ref;
+  for ( size_t idata = 0; idata < adcs.size(); idata++ ) {
+    const unsigned short* adc = adcs.data() + idata;
+    if(idata < i1) ref.calbasesum +=  static_cast<unsigned long>(*adc);
+    if(idata > i1+m1 && idata <= i2+i1+m1) ref.calintsum += static_cast<unsigned long>(*adc);
+    if(idata >= i1+m1+m2 && idata <= i1+2*m1+m2) ref.calpeaksum += static_cast<unsigned int>(*adc);
+    ref.maxadc = std::max(ref.maxadc,*adc);
+    if(ref.maxadc == *adc) ref.calpeaktime = idata;
+    ref.adc_cumulative += (uint64_t)(*adc);
+  }
+  return ref;
+}
+
+void check(const vector<unsigned short>& adcs, long i1, long i2, long m1, long m2) {
+  SSPWaveformStats stats(i1, i2, m1, m2);
+  stats.Fill(adcs.data(), adcs.size());
+  Reference ref = reference(adcs, i1, i2, m1, m2);
+  assert( stats.BaselineSum() == ref.calbasesum );
+  assert( stats.IntSum() == ref.calintsum );
+  assert( stats.PeakSum() == ref.calpeaksum );
+  assert( stats.MaxADC() == ref.maxadc );
+  assert( stats.PeakTime() == ref.calpeaktime );
+  assert( stats.ADCSum() == ref.adc_cumulative );
+}
+
+// Baseline with noise and a scintillation pulse.
+void makePacket(vector<unsigned short>& adcs, size_t n, std::mt19937& rng) {
+  std::normal_distribution<double> noise(1500., 3.);
+  std::uniform_int_distribution<size_t> posdist(0, n ? n - 1 : 0);
+  std::uniform_real_distribution<double> ampdist(0., 2000.);
+  adcs.resize(n);
+  for ( unsigned short& adc : adcs ) adc = (unsigned short) noise(rng);
+  if ( n == 0 ) return;
+  size_t pos = posdist(rng);
+  double amp = ampdist(rng);
+  for ( size_t i=pos; i<n && i<pos+200; ++i ) {
+    adcs[i] += (unsigned short) (amp*std::exp(-double(i - pos)/30.));
+  }
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_SSPWaveformStats(size_t npacket) {
+  const string myname = "test_SSPWaveformStats: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(2018);
+  vector<unsigned short> adcs;
+
+  cout << myname << line << endl;
+  cout << myname << "Random packets." << endl;
+  std::uniform_int_distribution<size_t> lendist(0, 2100);
+  for ( size_t ipkt=0; ipkt<npacket; ++ipkt ) {
+    size_t n = ipkt%10 == 0 ? 2000 : lendist(rng);
+    makePacket(adcs, n, rng);
+    check(adcs, 40, 1200, 10, 10);
+    check(adcs, 100, 500, 5, 20);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Flat, repeated maxima and empty packets." << endl;
+  {
+    adcs.assign(500, 1500);
+    check(adcs, 40, 1200, 10, 10);
+    adcs.assign(500, 0);
+    check(adcs, 40, 1200, 10, 10);
+    adcs.assign(500, 1500);
+    adcs[100] = adcs[300] = adcs[301] = 4000;
+    check(adcs, 40, 1200, 10, 10);
+    adcs.back() = 4000;
+    check(adcs, 40, 1200, 10, 10);
+    adcs.clear();
+    check(adcs, 40, 1200, 10, 10);
+    adcs.assign(1, 7);
+    check(adcs, 40, 1200, 10, 10);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Short and empty windows." << endl;
+  {
+    makePacket(adcs, 300, rng);
+    check(adcs, 0, 0, 0, 0);
+    check(adcs, 0, 10, 0, 0);
+    check(adcs, 280, 1200, 10, 10);
+    check(adcs, 400, 10, 10, 10);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Long packets at full scale." << endl;
+  {
+    adcs.assign(140000, 0xffff);
+    check(adcs, 100000, 70000, 10, 10);
+    adcs[65536] = 0;
+    check(adcs, 65536, 65537, 0, 0);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t npacket = 10000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NPACKET]" << endl;
+      cout << "  NPACKET [10000]: Number of random packets." << endl;
+      return 0;
+    }
+    npacket = std::stoul(sarg);
+  }
+  return test_SSPWaveformStats(npacket);
+}
+
+//**********************************************************************
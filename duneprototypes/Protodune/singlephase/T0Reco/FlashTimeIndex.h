@@ -0,0 +1,92 @@
+// FlashTimeIndex.h
+//
+// Per-event index of the selected optical flashes for matching tracks to
+// flashes in time, shared by T0RecoSCECalibrations and
+// T0RecoAnodePiercers.
+//
+// The modules used to scan all the selected flashes for every track.  The
+// index sorts the flash times once; a query is a lower_bound on the track
+// time and a check of the equally close flashes on either side of it.  The
+// match is the one the scan made: the flash with the smallest |t - t_reco|
+// below the cut, and on ties the flash added first (the scan kept the first
+// minimum).  Each flash is added with the time the module compares, e.g.
+// with its scale factor and offset already applied, so |t - t_reco| is
+// computed exactly as in the scan.  Flashes with a NaN time never matched
+// and are not indexed.
+
+#ifndef FlashTimeIndex_H
+#define FlashTimeIndex_H
+
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace dune {
+
+  class FlashTimeIndex {
+
+  public:
+
+    static constexpr size_t kNoMatch = std::numeric_limits<size_t>::max();
+
+    void Clear() { fEntries.clear(); fNAdded = 0; }
+
+    // Add a flash with its matching time and index in the flash collection,
+    // in the order the flashes were scanned.  Call Build after the last one.
+    void Add(double time, size_t flash_index) {
+      if ( ! std::isnan(time) ) fEntries.push_back({time, fNAdded, flash_index});
+      ++fNAdded;
+    }
+
+    void Build() {
+      std::sort(fEntries.begin(), fEntries.end(),
+                [](const Entry & lhs, const Entry & rhs) { return lhs.time < rhs.time; });
+    }
+
+    // Number of flashes added.
+    size_t size() const { return fNAdded; }
+
+    // Index in the flash collection of the flash closest to reco_time with
+    // |t - reco_time| < dt_cut, or kNoMatch.  If dt is given, it is set to
+    // |t - reco_time| of the match, or dt_cut if there is none.
+    size_t Match(double reco_time, double dt_cut, double * dt =nullptr) const {
+      if ( dt != nullptr ) *dt = dt_cut;
+      auto first = std::lower_bound(fEntries.begin(), fEntries.end(), reco_time,
+                                    [](const Entry & ent, double t) { return ent.time < t; });
+      auto absdt = [reco_time](const Entry & ent) { return std::fabs(ent.time - reco_time); };
+      double dt_min = dt_cut;
+      if ( first != fEntries.begin() ) dt_min = std::min(dt_min, absdt(*(first - 1)));
+      if ( first != fEntries.end() ) dt_min = std::min(dt_min, absdt(*first));
+      if ( ! (dt_min < dt_cut) ) return kNoMatch;
+
+      // The closest flashes are the ones next to reco_time.  Rounding can
+      // make several of them equally close; take the first added.
+      const Entry * best = nullptr;
+      for ( auto it = first; it != fEntries.begin() && absdt(*(it - 1)) == dt_min; --it ) {
+        if ( best == nullptr || (it - 1)->order < best->order ) best = &*(it - 1);
+      }
+      for ( auto it = first; it != fEntries.end() && absdt(*it) == dt_min; ++it ) {
+        if ( best == nullptr || it->order < best->order ) best = &*it;
+      }
+      if ( dt != nullptr ) *dt = dt_min;
+      return best->flash_index;
+    }
+
+  private:
+
+    struct Entry {
+      double time;
+      size_t order;        // position in the order of Add
+      size_t flash_index;
+    };
+
+    std::vector<Entry> fEntries;
+    size_t fNAdded = 0;
+
+  };
+
+}
+
+#endif
@@ -32,6 +32,7 @@
 #include "lardataobj/RecoBase/OpFlash.h"
 #include "lardataobj/AnalysisBase/T0.h"
 #include "lardata/Utilities/AssociationUtil.h"
+#include "duneprototypes/Protodune/singlephase/T0Reco/FlashTimeIndex.h"
 //#include "duneprototypes/Protodune/singlephase/DataUtils/ProtoDUNEPFParticleUtils.h"
 //#include "duneprototypes/Protodune/singlephase/DataUtils/ProtoDUNETrackUtils.h"
 
@@ -67,7 +68,7 @@ class T0RecoAnodePiercers : public art::EDProducer {
 
     	void   SortTrackPoints	(const recob::Track& track, std::vector<TVector3>& sorted_trk);
 
-    	size_t FlashMatch		(const double reco_time, std::vector<double> op_times_v);
+    	size_t FlashMatch		(const double reco_time) const;
 
     	// Declare member data here
 
@@ -106,9 +107,7 @@ class T0RecoAnodePiercers : public art::EDProducer {
     	double 		det_back;
     	double 		det_width; // [cm]
 	
-    	std::vector<double> 	op_times;
-
-    	std::vector<size_t> 	flash_id_v;
+    	dune::FlashTimeIndex	corrected_op_times;	// corrected flash times, sorted for FlashMatch
     	art::Handle<std::vector<recob::OpFlash> > 	flash_h;
 
     	bool		MC;
@@ -262,8 +261,7 @@ void T0RecoAnodePiercers::produce(art::Event& event){
 		<< det_top << "\nBottom: " << det_bottom << "\nFront: " << det_front 
 		<< "\nBack: " << det_back << "\nEdge width: " << fEdgeWidth << std::endl;  
 
-	op_times.clear();
-	flash_id_v.clear();
+	corrected_op_times.Clear();
 	flash_h.clear();
 
 	//Set flash producer to MC or data
@@ -331,15 +329,15 @@ void T0RecoAnodePiercers::produce(art::Event& event){
 			double op_flash_time;
 			if(!MC) op_flash_time = flash.Time() - trigger_time;
 			if(MC) op_flash_time = flash.Time() - trigger_time - TPC_trigger_offset;
-      		op_times.push_back(op_flash_time);
-			flash_id_v.push_back(flash_ctr);
+			corrected_op_times.Add(op_flash_time*fFlashScaleFactor + fFlashTPCOffset, flash_ctr);
 			if (fDebug) std::cout << "\t Flash: " << flash_ctr << " has time : " 
 			<< op_flash_time << ", PE : " << flash.TotalPE() << std::endl;
 			}
 		flash_ctr++;
 		} // for all flashes
+	corrected_op_times.Build();
 
-	if(fDebug) std::cout << "Selected a total of " << op_times.size() << " OpFlashes" << std::endl;
+	if(fDebug) std::cout << "Selected a total of " << corrected_op_times.size() << " OpFlashes" << std::endl;
 
 	// LOOP THROUGH RECONSTRUCTED PFPARTICLES
 
@@ -371,8 +369,9 @@ void T0RecoAnodePiercers::produce(art::Event& event){
 
                 //Replacing this with the hardcoded method to remove util dependency
 		//const std::vector<const recob::Hit*>& hit_v = trackUtil.GetRecoTrackHits(*track,event,fTrackProducer);
-                std::vector<art::Ptr<recob::Hit>> inputHits = findHits.at(track->ID());
+                const std::vector<art::Ptr<recob::Hit>>& inputHits = findHits.at(track->ID());
                 std::vector<const recob::Hit*> hit_v;
+                hit_v.reserve(inputHits.size());
                 for(const art::Ptr<recob::Hit> hit : inputHits){
                   hit_v.push_back(hit.get());
                 }
@@ -531,7 +530,7 @@ void T0RecoAnodePiercers::produce(art::Event& event){
 
 		// FLASH MATCHING
 
-		size_t op_match_result = FlashMatch((anode_rc_time),op_times);
+		size_t op_match_result = FlashMatch(anode_rc_time);
 
 		if(op_match_result==99999) {
 			if(fDebug) std::cout << "Unable to match flash to track." << std::endl;
@@ -645,23 +644,13 @@ void	T0RecoAnodePiercers::SortTrackPoints(const recob::Track& track, std::vector
 	sorted_trk.push_back(track_end);
 	}
 
-size_t  T0RecoAnodePiercers::FlashMatch(const double reco_time, std::vector<double> op_times_v)
+size_t  T0RecoAnodePiercers::FlashMatch(const double reco_time) const
 {
-	// loop through all reco'd flash times and see if one matches
-	// the time from the track/particle
+	// find the corrected flash time closest to the time from the track/particle
 
 	double dt_min = 9999999.; 
-	size_t matched_op_id = 99999;
-
-	for (size_t i=0; i < op_times_v.size(); i++){
-		double op_time_i = op_times_v[i];
-		double corrected_op_time_i = op_time_i*fFlashScaleFactor + fFlashTPCOffset;
-		double corrected_flash_reco_time_diff = corrected_op_time_i - reco_time;
-		if (fabs(corrected_flash_reco_time_diff) < dt_min){
-			dt_min  = fabs(corrected_flash_reco_time_diff);
-			matched_op_id = flash_id_v[i];
-			}
-		}
+	size_t matched_op_id = corrected_op_times.Match(reco_time, dt_min);
+	if (matched_op_id == dune::FlashTimeIndex::kNoMatch) matched_op_id = 99999;
 
 	return matched_op_id;
 	}
@@ -36,6 +36,8 @@
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "lardata/Utilities/AssociationUtil.h"
 
+#include "duneprototypes/Protodune/singlephase/T0Reco/FlashTimeIndex.h"
+
 // ROOT
 #include "TVector3.h"
 #include <TTree.h>
@@ -85,8 +87,7 @@ private:
         
   double TOP, BOTTOM, FRONT, BACK, det_width; // [cm]
         
-  std::vector<double> flash_times;
-  std::vector<size_t> flash_idx_v;
+  dune::FlashTimeIndex flash_times;  // selected flashes, sorted for FlashMatch
         
   double fTimeRes;
         
@@ -308,8 +309,7 @@ void T0RecoSCECalibrations::analyze(art::Event const & e){
   if (_debug) std::cout << "top: " << TOP << "\nbottom: " << BOTTOM << "\nfront: " << FRONT << "\nback: " << BACK << std::endl;  
   
   
-  flash_times.clear();
-  flash_idx_v.clear();
+  flash_times.Clear();
         
   // load Flash
   if (_debug) { std::cout << "loading flash from producer " << fFlashProducer << std::endl; }
@@ -381,12 +381,12 @@ void T0RecoSCECalibrations::analyze(art::Event const & e){
     size_t flash_ctr = 0;
     for (auto const& flash : *flash_h){
       if (flash.TotalPE() > fPEmin){
-        flash_times.push_back( flash.Time() - trigger_time);
-        flash_idx_v.push_back(flash_ctr);
+        flash_times.Add( flash.Time() - trigger_time, flash_ctr);
         if (_debug) std::cout << "\t flash time : " << flash.Time() - trigger_time << ", PE : " << flash.TotalPE() << std::endl;
       }
       flash_ctr += 1;
     }// for all flashes
+    flash_times.Build();
   
     if (_debug) { std::cout << "Selected a total of " << flash_times.size() << " OpFlashes" << std::endl; }
   }
@@ -864,19 +864,10 @@ double T0RecoSCECalibrations::MatchTracks(std::vector<TVector3>& sorted_trk, std
   
 std::pair<double,size_t> T0RecoSCECalibrations::FlashMatch(const double reco_time){
   
-  // loop through all reco'd flash times and see if one matches
-  // the reco time from the track
+  // find the reco'd flash time closest to the reco time from the track
   double dt_min = 8000.; // us
-  size_t idx_min = flash_times.size();
-
-  for (size_t i=0; i < flash_times.size(); i++){
-    auto const& time = flash_times[i];
-    double dt = fabs(time - reco_time);
-    if (dt < dt_min){
-      dt_min  = dt;
-      idx_min = flash_idx_v[i];
-    }
-  }
+  size_t idx_min = flash_times.Match(reco_time, dt_min, &dt_min);
+  if (idx_min == dune::FlashTimeIndex::kNoMatch) idx_min = flash_times.size();
 
   std::pair<double,size_t> ret(dt_min,idx_min);
   return ret;
@@ -0,0 +1,221 @@
+// test_FlashTimeIndex.cxx
+//
+// Test FlashTimeIndex against the flash scans T0RecoSCECalibrations and
+// T0RecoAnodePiercers used before, on random events with hundreds of
+// flashes and tracks, on flashes with repeated times and times equally
+// far from the track, and with NaN times.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include "duneprototypes/Protodune/singlephase/T0Reco/FlashTimeIndex.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::FlashTimeIndex;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// Selected flashes of an event: times and indices in the flash collection.
+struct Flashes {
+  vector<double> times;
+  vector<size_t> idx;
+};
+
+// The scan in T0RecoSCECalibrations::FlashMatch.
+std::pair<double,size_t> sceScan(const Flashes& fl, double reco_time) {
+  double dt_min = 8000.;
+  size_t idx_min = fl.times.size();
+  for ( size_t i=0; i<fl.times.size(); i++ ) {
+    double dt = fabs(fl.times[i] - reco_time);
+    if ( dt < dt_min ) {
+      dt_min  = dt;
+      idx_min = fl.idx[i];
+    }
+  }
+  return std::pair<double,size_t>(dt_min, idx_min);
+}
+
+// The scan in T0RecoAnodePiercers::FlashMatch.
+size_t anodeScan(const Flashes& fl, double reco_time, double scale, double offset) {
+  double dt_min = 9999999.;
+  size_t matched_op_id = 99999;
+  for ( size_t i=0; i<fl.times.size(); i++ ) {
+    double corrected = fl.times[i]*scale + offset;
+    double diff = corrected - reco_time;
+    if ( fabs(diff) < dt_min ) {
+      dt_min  = fabs(diff);
+      matched_op_id = fl.idx[i];
+    }
+  }
+  return matched_op_id;
+}
+
+// The modules' FlashMatch with the index.
+std::pair<double,size_t> sceIndex(const FlashTimeIndex& index, double reco_time) {
+  double dt_min = 8000.;
+  size_t idx_min = index.Match(reco_time, dt_min, &dt_min);
+  if ( idx_min == FlashTimeIndex::kNoMatch ) idx_min = index.size();
+  return std::pair<double,size_t>(dt_min, idx_min);
+}
+
+size_t anodeIndex(const FlashTimeIndex& index, double reco_time) {
+  size_t matched_op_id = index.Match(reco_time, 9999999.);
+  if ( matched_op_id == FlashTimeIndex::kNoMatch ) matched_op_id = 99999;
+  return matched_op_id;
+}
+
+// Check all the tracks of an event with both matchings.
+size_t checkEvent(const Flashes& fl, const vector<double>& reco_times, double scale, double offset) {
+  FlashTimeIndex sce;
+  FlashTimeIndex anode;
+  for ( size_t i=0; i<fl.times.size(); ++i ) {
+    sce.Add(fl.times[i], fl.idx[i]);
+    anode.Add(fl.times[i]*scale + offset, fl.idx[i]);
+  }
+  sce.Build();
+  anode.Build();
+  size_t nmatch = 0;
+  for ( double reco_time : reco_times ) {
+    std::pair<double,size_t> ref = sceScan(fl, reco_time);
+    std::pair<double,size_t> res = sceIndex(sce, reco_time);
+    assert( res.second == ref.second );
+    assert( res.first == ref.first );
+    size_t aref = anodeScan(fl, reco_time, scale, offset);
+    assert( anodeIndex(anode, reco_time) == aref );
+    if ( ref.second < fl.times.size() ) ++nmatch;
+  }
+  return nmatch;
+}
+
+// Flashes over the drift window, with a PE cut dropping some of them.
+Flashes makeFlashes(size_t nflash, std::mt19937& rng) {
+  std::uniform_real_distribution<double> tdist(-2500., 2500.);
+  std::uniform_real_distribution<double> flat(0., 1.);
+  Flashes fl;
+  for ( size_t i=0; i<nflash; ++i ) {
+    if ( flat(rng) < 0.2 ) continue;
+    fl.times.push_back(tdist(rng));
+    fl.idx.push_back(i);
+  }
+  return fl;
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_FlashTimeIndex(size_t nevent, size_t nflash, size_t ntrack) {
+  const string myname = "test_FlashTimeIndex: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(2019);
+  std::uniform_real_distribution<double> tdist(-3000., 3000.);
+  std::uniform_int_distribution<size_t> pick(0, 1000000);
+
+  cout << myname << line << endl;
+  cout << myname << "Random events." << endl;
+  size_t nmatch = 0;
+  for ( size_t ievt=0; ievt<nevent; ++ievt ) {
+    Flashes fl = makeFlashes(nflash, rng);
+    vector<double> reco_times;
+    for ( size_t itrk=0; itrk<ntrack; ++itrk ) {
+      // some tracks exactly at a flash time
+      if ( itrk%5 == 0 && ! fl.times.empty() ) reco_times.push_back(fl.times[pick(rng)%fl.times.size()]);
+      else reco_times.push_back(tdist(rng));
+    }
+    nmatch += checkEvent(fl, reco_times, 1.0, 0.0);
+    nmatch += checkEvent(fl, reco_times, 1.0, -6.0);
+    nmatch += checkEvent(fl, reco_times, -0.5, 100.0);
+  }
+  cout << myname << "  Matched " << nmatch << " tracks." << endl;
+
+  cout << myname << line << endl;
+  cout << myname << "Ties, NaN times, zero scale and empty events." << endl;
+  {
+    Flashes fl;
+    fl.times = {10., 5., 10., 15., 5., 15., 0.1 + 0.2, 0.3, 1.e16, 1.e16 + 2.};
+    fl.idx = {0, 2, 3, 4, 7, 8, 9, 11, 12, 13};
+    vector<double> reco_times = {10., 7.5, 12.5, 5., 15., 0.3, 0.30000000000000004,
+                                 1.e16 + 1., 1.e16, -7990., 8100., 9000., 1.e20};
+    checkEvent(fl, reco_times, 1.0, 0.0);
+    checkEvent(fl, reco_times, 0.0, 3.0);
+    checkEvent(fl, reco_times, -1.0, 0.0);
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    fl.times[3] = nan;
+    reco_times.push_back(nan);
+    checkEvent(fl, reco_times, 1.0, 0.0);
+    checkEvent(Flashes(), reco_times, 1.0, 0.0);
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Timing, " << nflash << " flashes and " << ntrack << " tracks." << endl;
+  {
+    Flashes fl = makeFlashes(nflash, rng);
+    vector<double> reco_times;
+    for ( size_t itrk=0; itrk<ntrack; ++itrk ) reco_times.push_back(tdist(rng));
+    size_t nrep = 200;
+    size_t sum = 0;
+    Clock::time_point t0 = Clock::now();
+    for ( size_t irep=0; irep<nrep; ++irep ) {
+      for ( double reco_time : reco_times ) sum += sceScan(fl, reco_time).second;
+    }
+    Clock::time_point t1 = Clock::now();
+    for ( size_t irep=0; irep<nrep; ++irep ) {
+      FlashTimeIndex index;
+      for ( size_t i=0; i<fl.times.size(); ++i ) index.Add(fl.times[i], fl.idx[i]);
+      index.Build();
+      for ( double reco_time : reco_times ) sum -= sceIndex(index, reco_time).second;
+    }
+    Clock::time_point t2 = Clock::now();
+    assert( sum == 0 );
+    double tscan = std::chrono::duration<double, std::micro>(t1 - t0).count()/nrep;
+    double tindex = std::chrono::duration<double, std::micro>(t2 - t1).count()/nrep;
+    cout << myname << "  Scan: " << tscan << " us/event, index: " << tindex << " us/event" << endl;
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t nevent = 200;
+  size_t nflash = 300;
+  size_t ntrack = 300;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NEVENT [NFLASH [NTRACK]]]" << endl;
+      cout << "  NEVENT [200]: Number of random events." << endl;
+      cout << "  NFLASH [300]: Flashes per event before the PE cut." << endl;
+      cout << "  NTRACK [300]: Tracks per event." << endl;
+      return 0;
+    }
+    nevent = std::stoul(sarg);
+  }
+  if ( argc > 2 ) nflash = std::stoul(argv[2]);
+  if ( argc > 3 ) ntrack = std::stoul(argv[3]);
+  return test_FlashTimeIndex(nevent, nflash, ntrack);
+}
+
+//**********************************************************************
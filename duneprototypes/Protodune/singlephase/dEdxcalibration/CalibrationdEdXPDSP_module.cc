@@ -33,6 +33,8 @@
 #include "larevt/SpaceCharge/SpaceCharge.h"
 #include "larevt/SpaceChargeServices/SpaceChargeService.h"
 
+#include "CorrectionGrid.h"
+
 #include "TH2F.h"
 #include "TH1F.h"
 #include "TFile.h"
@@ -61,6 +63,7 @@ public:
 
   // Selected optional functions.
   void beginJob() override;
+  void beginRun(art::Run & r) override;
 
 private:
 
@@ -91,7 +94,34 @@ private:
   bool first;
 
   TH1D *hdRR[3];
-  
+
+  // Tables of the X and YZ corrections (YZ for each drift side) over the
+  // detector, set up at the first event of each run and filled cell by
+  // cell as points are looked up. Off by default (spacing zero). They are
+  // only exact if every bin of the XYZCalib X and YZ maps is at least as
+  // wide as CorrectionGridSpacing; XYZCalib does not expose its binning,
+  // so this cannot be checked here and the spacing must be chosen for the
+  // calibration in use.
+  double fCorrectionGridSpacing; // [cm]
+  std::vector<double> fCorrectionGridX, fCorrectionGridY, fCorrectionGridZ; // [cm]
+  bool fBuildGrids;
+  dune::CorrectionGrid fXGrid[3];
+  dune::CorrectionGrid fYZGrid[3][2];
+
+  // Per-point corrections of the calorimetry object being calibrated.
+  std::vector<double> fXCorr, fYZCorr, fEfield;
+
+  void BuildCorrectionGrids(calib::XYZCalib *xyzcalib);
+  double XCorrection(calib::XYZCalib *xyzcalib, unsigned int plane, double x);
+  double YZCorrection(calib::XYZCalib *xyzcalib, unsigned int plane, const geo::Point_t & xyz);
+  void CalibratePoints(detinfo::DetectorPropertiesData const & detProp,
+                       spacecharge::SpaceCharge const * sce,
+                       calib::XYZCalib *xyzcalib,
+                       anab::Calorimetry const & calo,
+                       std::vector<art::Ptr<recob::Hit>> const & hitlist,
+                       double normcorrection, bool applyX, bool applyYZ, bool applyLifetime,
+                       std::vector<float> & vdQdx, std::vector<float> & vdEdx);
+
   void CorrectResidualRange(double endx, double endy, double endz, std::vector<float> &vresRange, std::vector<geo::Point_t> vXYZ, int plane);
 };
 
@@ -120,7 +150,16 @@ dune::CalibrationdEdXPDSP::CalibrationdEdXPDSP(fhicl::ParameterSet const & p)
   , fShowerRecombFactor(p.get<double>("ShowerRecombFactor", 1.))
   , fUseLifetimeFromDatabase(p.get< bool >("UseLifetimeFromDatabase"))
   , fReferencedQdx         (p.get<std::vector<double>>("ReferencedQdx"))
+  , fCorrectionGridSpacing (p.get<double>("CorrectionGridSpacing", 0.))
+  , fCorrectionGridX       (p.get<std::vector<double>>("CorrectionGridX", {-370., 370.}))
+  , fCorrectionGridY       (p.get<std::vector<double>>("CorrectionGridY", {-10., 620.}))
+  , fCorrectionGridZ       (p.get<std::vector<double>>("CorrectionGridZ", {-10., 710.}))
+  , fBuildGrids            (true)
 {
+  if (fCorrectionGridX.size()!=2 || fCorrectionGridY.size()!=2 || fCorrectionGridZ.size()!=2){
+    throw art::Exception(art::errors::Configuration)
+      <<"CorrectionGridX, CorrectionGridY and CorrectionGridZ must each be [min, max]";
+  }
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService>()->DataForJob();
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService>()->DataForJob(clockData);
   vDrift = detProp.DriftVelocity(); //cm/us
@@ -181,6 +220,11 @@ void dune::CalibrationdEdXPDSP::produce(art::Event & evt)
   //Spacecharge services provider
   auto const* sce = lar::providerFrom<spacecharge::SpaceChargeService>();
 
+  if (fBuildGrids){
+    BuildCorrectionGrids(xyzcalib);
+    fBuildGrids = false;
+  }
+
   //create anab::Calorimetry objects and make association with recob::Track
   std::unique_ptr< std::vector<anab::Calorimetry> > calorimetrycol(new std::vector<anab::Calorimetry>);
   std::unique_ptr< art::Assns<recob::Track, anab::Calorimetry> > assn(new art::Assns<recob::Track, anab::Calorimetry>);
@@ -256,63 +300,21 @@ void dune::CalibrationdEdXPDSP::produce(art::Event & evt)
             throw art::Exception(art::errors::Configuration)
               <<"Hit plane = "<<hit->WireID().Plane<<" calo plane = "<<planeID.Plane;
           }
-          double normcorrection = 1;
-          if (fApplyNormCorrection){
-            normcorrection = xyzcalib->GetNormCorr(planeID.Plane);
-            if (normcorrection) normcorrection = fReferencedQdx[planeID.Plane]/normcorrection;
-            if (!normcorrection) normcorrection = 1.;
-          }
-          double xcorrection = 1;
-          if (fApplyXCorrection){
-            xcorrection = xyzcalib->GetXCorr(planeID.Plane, vXYZ[j].X());
-            if (!xcorrection) xcorrection = 1.;
-          }
-          double yzcorrection = 1;
-          if (fApplyYZCorrection){
-            yzcorrection = xyzcalib->GetYZCorr(planeID.Plane, vXYZ[j].X()>0, vXYZ[j].Y(), vXYZ[j].Z());
-            if (!yzcorrection) yzcorrection = 1.;
-          }
-          if (fApplyLifetimeCorrection){
-            xcorrection *= exp((xAnode-std::abs(vXYZ[j].X()))/(fLifetime*vDrift));
-          }
-          //if (planeID.Plane == 2 && tracklist[trkIter]->ID() == 0) std::cout<<"plane = "<<planeID.Plane<<" x = "<<vXYZ[j].X()<<" y = "<<vXYZ[j].Y()<<" z = "<<vXYZ[j].Z()<<" normcorrection = "<<normcorrection<<" xcorrection = "<<xcorrection<<" yzcorrection = "<<yzcorrection<<" "<<vdQdx[j]<<std::endl;
-
-          vdQdx[j] = normcorrection*xcorrection*yzcorrection*vdQdx[j];
-
-
-          //set time to be trgger time so we don't do lifetime correction
-          //we will turn off lifetime correction in caloAlg, this is just to be double sure
-          //vdEdx[j] = caloAlg.dEdx_AREA(vdQdx[j], detProp.TriggerOffset(), planeID.Plane, 0);
-
-
-          //Calculate dE/dx uisng the new recombination constants
-          double dQdx_e = caloAlg.ElectronsFromADCArea(vdQdx[j], planeID.Plane);
-          double rho = detProp.Density();                       // LAr density in g/cm^3
-          double Wion = 1000./util::kGeVToElectrons;    // 23.6 eV = 1e, Wion in MeV/e
-          double E_field_nominal = detProp.Efield();   // Electric Field in the drift region in KV/cm
-
-          //correct Efield for SCE
-          geo::Vector_t E_field_offsets = {0., 0., 0.};
-
-          if(sce->EnableCalEfieldSCE()&&fSCE) E_field_offsets = sce->GetCalEfieldOffsets(geo::Point_t{vXYZ[j].X(), vXYZ[j].Y(), vXYZ[j].Z()},hit->WireID().TPC);
+        }
 
-          TVector3 E_field_vector = {E_field_nominal*(1 + E_field_offsets.X()), E_field_nominal*E_field_offsets.Y(), E_field_nominal*E_field_offsets.Z()};
-          double E_field = E_field_vector.Mag();
+        double normcorrection = 1;
+        if (fApplyNormCorrection){
+          normcorrection = xyzcalib->GetNormCorr(planeID.Plane);
+          if (normcorrection) normcorrection = fReferencedQdx[planeID.Plane]/normcorrection;
+          if (!normcorrection) normcorrection = 1.;
+        }
 
-          //calculate recombination factors
-          double Beta = fModBoxB / (rho * E_field);
-          double Alpha = fModBoxA;
-          //double old_vdEdx = vdEdx[j];
-          vdEdx[j] = (exp(Beta * Wion * dQdx_e) - Alpha) / Beta;
-          //if (planeID.Plane == 2 && tracklist[trkIter]->ID() == 1) std::cout<<calo->dQdx()[j]<<" "<<vdEdx[j]<<" "<<vdQdx[j]<<" "<<vresRange[j]<<" "<<E_field<<" "<<rho<<" "<<Beta<<" "<<Alpha<<" "<<E_field_nominal<<" "<<E_field<<" "<<E_field_offsets.X()<<" "<<E_field_offsets.Y()<<" "<<E_field_offsets.Z()<<" "<<vXYZ[j].X()<<" "<<vXYZ[j].Y()<<" "<<vXYZ[j].Z()<<" "<<hit->WireID().TPC<<" "<<fHitIndex[j]<<" "<<normcorrection<<" "<<xcorrection<<" "<<yzcorrection<<std::endl;
+        //correct dQdx and calculate dE/dx using the new recombination constants
+        CalibratePoints(detProp, sce, xyzcalib, *calo, hitlist, normcorrection,
+                        fApplyXCorrection, fApplyYZCorrection, fApplyLifetimeCorrection,
+                        vdQdx, vdEdx);
 
-         /*if (planeID.Plane==2){
-         std::cout << sce->EnableCalEfieldSCE() << " " << fSCE << std::endl;
-         std::cout << E_field << " " << E_field_nominal << std::endl;
-         std::cout << vdQdx[j] << " " << dQdx_e << std::endl;
-         std::cout << old_vdEdx << " " << vdEdx[j] << std::endl;
-         std::cout << rho << " " << Wion << " " << Beta << "\n" << std::endl; }
-         */
+        for (size_t j = 0; j<vdQdx.size(); ++j){
           //update kinetic energy calculation
           if (j>=1) {
             if ( (vresRange[j] < 0) || (vresRange[j-1] < 0) ) continue;
@@ -428,73 +430,34 @@ void dune::CalibrationdEdXPDSP::produce(art::Event & evt)
             throw art::Exception(art::errors::Configuration) <<"Hit plane = " <<
                   hit->WireID().Plane<<" calo plane = "<<planeID.Plane;
           }
+        }
 
-          double normcorrection = 1;
-          if (fApplyNormCorrectionShower) {
-            normcorrection = xyzcalib->GetNormCorr(planeID.Plane);
-            if (normcorrection) {
-              normcorrection = fReferencedQdx[planeID.Plane]/normcorrection;
-            }
-            else {
-              normcorrection = 1.;
-            }
-          }
-
-          double xcorrection = 1;
-          if (fApplyXCorrectionShower) {
-            xcorrection = xyzcalib->GetXCorr(planeID.Plane, vXYZ[j].X());
-            if (!xcorrection) xcorrection = 1.;
-          }
-
-          double yzcorrection = 1;
-          if (fApplyYZCorrectionShower) {
-            yzcorrection = xyzcalib->GetYZCorr(planeID.Plane, (vXYZ[j].X()>0),
-                                               vXYZ[j].Y(), vXYZ[j].Z());
-            if (!yzcorrection) yzcorrection = 1.;
+        double normcorrection = 1;
+        if (fApplyNormCorrectionShower) {
+          normcorrection = xyzcalib->GetNormCorr(planeID.Plane);
+          if (normcorrection) {
+            normcorrection = fReferencedQdx[planeID.Plane]/normcorrection;
           }
-
-          if (fApplyLifetimeCorrectionShower){
-            xcorrection *= exp((xAnode-std::abs(vXYZ[j].X()))/(fLifetime*vDrift));
+          else {
+            normcorrection = 1.;
           }
+        }
 
-          vdQdx[j] = normcorrection*xcorrection*yzcorrection*vdQdx[j];
-
-
-          //Calculate dE/dx uisng the new recombination constants
-          double dQdx_e = caloAlg.ElectronsFromADCArea(vdQdx[j], planeID.Plane);
-          double rho = detProp.Density();                       // LAr density in g/cm^3
-          double Wion = 1000./util::kGeVToElectrons;    // 23.6 eV = 1e, Wion in MeV/e
-          double E_field_nominal = detProp.Efield();   // Electric Field in the drift region in KV/cm
-
-          //correct Efield for SCE
-          geo::Vector_t E_field_offsets = {0., 0., 0.};
-
-          if (sce->EnableCalEfieldSCE() && fSCE)
-            E_field_offsets = sce->GetCalEfieldOffsets(
-                geo::Point_t{vXYZ[j].X(), vXYZ[j].Y(), vXYZ[j].Z()},
-                hit->WireID().TPC);
-
-          TVector3 E_field_vector = {
-            E_field_nominal*(1 + E_field_offsets.X()),
-            E_field_nominal*E_field_offsets.Y(),
-            E_field_nominal*E_field_offsets.Z()
-          };
-
-          double E_field = E_field_vector.Mag();
-
-          //calculate recombination factors
-          double Beta = fModBoxB / (rho * E_field);
-          double Alpha = fModBoxA;
-          //double old_vdEdx = vdEdx[j];
-          vdEdx[j] = (exp(Beta * Wion * dQdx_e) - Alpha) / Beta;
-
+        //correct dQdx and calculate dE/dx using the new recombination constants
+        CalibratePoints(detProp, sce, xyzcalib, *calo, hitlist, normcorrection,
+                        fApplyXCorrectionShower, fApplyYZCorrectionShower,
+                        fApplyLifetimeCorrectionShower, vdQdx, vdEdx);
 
+        double Wion = 1000./util::kGeVToElectrons;    // 23.6 eV = 1e, Wion in MeV/e
+        double calconst = caloAlg.ElectronsFromADCArea(1., planeID.Plane); //Returns 1./calib_factor
+        for (size_t j = 0; j < vdQdx.size(); ++j) {
+          auto & hit = hitlist[fHitIndex[j]];
           double hit_energy = hit->Integral();
           hit_energy *= normcorrection;
           hit_energy *= Wion/*23.6e-6*/;
-          hit_energy *= caloAlg.ElectronsFromADCArea(1., planeID.Plane); //Returns 1./calib_factor
-          hit_energy *= xcorrection;
-          hit_energy *= yzcorrection;
+          hit_energy *= calconst;
+          hit_energy *= fXCorr[j];
+          hit_energy *= fYZCorr[j];
           hit_energy /= fShowerRecombFactor;
 
           EkinNew += hit_energy;
@@ -530,6 +493,120 @@ void dune::CalibrationdEdXPDSP::beginJob(){
     hdRR[i]->Sumw2();
   }
 }
+
+void dune::CalibrationdEdXPDSP::beginRun(art::Run &){
+  //the calibration providers are updated for the new run at its first event
+  fBuildGrids = true;
+}
+
+void dune::CalibrationdEdXPDSP::BuildCorrectionGrids(calib::XYZCalib *xyzcalib){
+
+  bool useX = fApplyXCorrection || fApplyXCorrectionShower;
+  bool useYZ = fApplyYZCorrection || fApplyYZCorrectionShower;
+  for (unsigned int plane = 0; plane<3; ++plane){
+    fXGrid[plane].Clear();
+    for (int side = 0; side<2; ++side) fYZGrid[plane][side].Clear();
+    if (fCorrectionGridSpacing <= 0) continue;
+    if (useX){
+      fXGrid[plane].Build(fCorrectionGridX[0], fCorrectionGridX[1], 0., 0., fCorrectionGridSpacing,
+                          [xyzcalib, plane](float x, float){
+                            double xcorrection = xyzcalib->GetXCorr(plane, x);
+                            if (!xcorrection) xcorrection = 1.;
+                            return xcorrection;
+                          });
+      std::cout<<"Plane "<<plane<<" X correction grid: "<<fXGrid[plane].size()<<" cells of "<<fCorrectionGridSpacing<<" cm"<<std::endl;
+    }
+    if (useYZ){
+      for (int side = 0; side<2; ++side){
+        fYZGrid[plane][side].Build(fCorrectionGridY[0], fCorrectionGridY[1],
+                                   fCorrectionGridZ[0], fCorrectionGridZ[1], fCorrectionGridSpacing,
+                                   [xyzcalib, plane, side](float y, float z){
+                                     double yzcorrection = xyzcalib->GetYZCorr(plane, side, y, z);
+                                     if (!yzcorrection) yzcorrection = 1.;
+                                     return yzcorrection;
+                                   });
+        std::cout<<"Plane "<<plane<<" side "<<side<<" YZ correction grid: "<<fYZGrid[plane][side].size()<<" cells of "<<fCorrectionGridSpacing<<" cm"<<std::endl;
+      }
+    }
+  }
+}
+
+double dune::CalibrationdEdXPDSP::XCorrection(calib::XYZCalib *xyzcalib, unsigned int plane, double x){
+  double xcorrection = 1;
+  if (fXGrid[plane].Find(x, 0., xcorrection)) return xcorrection;
+  xcorrection = xyzcalib->GetXCorr(plane, x);
+  if (!xcorrection) xcorrection = 1.;
+  return xcorrection;
+}
+
+double dune::CalibrationdEdXPDSP::YZCorrection(calib::XYZCalib *xyzcalib, unsigned int plane, const geo::Point_t & xyz){
+  double yzcorrection = 1;
+  if (fYZGrid[plane][xyz.X()>0].Find(xyz.Y(), xyz.Z(), yzcorrection)) return yzcorrection;
+  yzcorrection = xyzcalib->GetYZCorr(plane, xyz.X()>0, xyz.Y(), xyz.Z());
+  if (!yzcorrection) yzcorrection = 1.;
+  return yzcorrection;
+}
+
+void dune::CalibrationdEdXPDSP::CalibratePoints(detinfo::DetectorPropertiesData const & detProp,
+                                                spacecharge::SpaceCharge const * sce,
+                                                calib::XYZCalib *xyzcalib,
+                                                anab::Calorimetry const & calo,
+                                                std::vector<art::Ptr<recob::Hit>> const & hitlist,
+                                                double normcorrection, bool applyX, bool applyYZ, bool applyLifetime,
+                                                std::vector<float> & vdQdx, std::vector<float> & vdEdx){
+
+  const auto & vXYZ      = calo.XYZ();
+  const auto & fHitIndex = calo.TpIndices();
+  unsigned int plane     = calo.PlaneID().Plane;
+  size_t npt = vdQdx.size();
+
+  //position dependent corrections, from the grids where possible
+  fXCorr.assign(npt, 1.);
+  fYZCorr.assign(npt, 1.);
+  if (applyX){
+    for (size_t j = 0; j<npt; ++j) fXCorr[j] = XCorrection(xyzcalib, plane, vXYZ[j].X());
+  }
+  if (applyYZ){
+    for (size_t j = 0; j<npt; ++j) fYZCorr[j] = YZCorrection(xyzcalib, plane, vXYZ[j]);
+  }
+  if (applyLifetime){
+    double lambda = fLifetime*vDrift;
+    for (size_t j = 0; j<npt; ++j) fXCorr[j] *= exp((xAnode-std::abs(vXYZ[j].X()))/lambda);
+  }
+  for (size_t j = 0; j<npt; ++j){
+    vdQdx[j] = normcorrection*fXCorr[j]*fYZCorr[j]*vdQdx[j];
+  }
+
+  double rho = detProp.Density();                       // LAr density in g/cm^3
+  double Wion = 1000./util::kGeVToElectrons;    // 23.6 eV = 1e, Wion in MeV/e
+  double E_field_nominal = detProp.Efield();   // Electric Field in the drift region in KV/cm
+
+  //correct Efield for SCE
+  auto efieldMag = [E_field_nominal](geo::Vector_t const & E_field_offsets){
+    double ex = E_field_nominal*(1 + E_field_offsets.X());
+    double ey = E_field_nominal*E_field_offsets.Y();
+    double ez = E_field_nominal*E_field_offsets.Z();
+    return std::sqrt(ex*ex + ey*ey + ez*ez);
+  };
+  if (sce->EnableCalEfieldSCE()&&fSCE){
+    fEfield.resize(npt);
+    for (size_t j = 0; j<npt; ++j){
+      fEfield[j] = efieldMag(sce->GetCalEfieldOffsets(geo::Point_t{vXYZ[j].X(), vXYZ[j].Y(), vXYZ[j].Z()},
+                                                      hitlist[fHitIndex[j]]->WireID().TPC));
+    }
+  }
+  else{
+    fEfield.assign(npt, efieldMag(geo::Vector_t{0., 0., 0.}));
+  }
+
+  //calculate recombination factors
+  double Alpha = fModBoxA;
+  for (size_t j = 0; j<npt; ++j){
+    double dQdx_e = caloAlg.ElectronsFromADCArea(vdQdx[j], plane);
+    double Beta = fModBoxB / (rho * fEfield[j]);
+    vdEdx[j] = (exp(Beta * Wion * dQdx_e) - Alpha) / Beta;
+  }
+}
   
   
 
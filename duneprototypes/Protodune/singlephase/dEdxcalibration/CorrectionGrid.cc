@@ -0,0 +1,78 @@
+// CorrectionGrid.cc
+
+#include "CorrectionGrid.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+using std::vector;
+using dune::CorrectionGrid;
+
+//**********************************************************************
+
+void CorrectionGrid::MakeEdges(double x1, double x2, double dx, vector<float>& edges) {
+  edges.clear();
+  edges.push_back(x1);
+  if ( !(x2 > x1) || !(dx > 0.0) ) return;
+  size_t ncel = size_t(std::ceil((x2 - x1)/dx));
+  for ( size_t icel=1; icel<=ncel; ++icel ) {
+    float edge = x1 + icel*dx;
+    if ( edge > edges.back() ) edges.push_back(edge);
+  }
+}
+
+//**********************************************************************
+
+void CorrectionGrid::Build(double x1, double x2, double y1, double y2, double dx,
+                           const Function& f) {
+  Clear();
+  MakeEdges(x1, x2, dx, fXEdges);
+  MakeEdges(y1, y2, dx, fYEdges);
+  if ( fXEdges.size() < 2 ) {
+    Clear();
+    return;
+  }
+  size_t ncel = (fXEdges.size() - 1)*std::max<size_t>(fYEdges.size() - 1, 1);
+  fFunction = f;
+  fVals.resize(ncel, 0.0);
+  fState.resize(ncel, kUnknown);
+}
+
+//**********************************************************************
+
+void CorrectionGrid::Fill(size_t ix, size_t iy, size_t icel) {
+  // Cell corners: lower edge and the float below the upper edge.
+  const bool is2d = fYEdges.size() > 1;
+  float xcors[2] = {fXEdges[ix], Below(fXEdges[ix + 1])};
+  float ycors[2] = {fYEdges[iy], is2d ? Below(fYEdges[iy + 1]) : fYEdges[iy]};
+  double val = fFunction(xcors[0], ycors[0]);
+  ++fNEval;
+  bool uniform = true;
+  for ( size_t icor=1; uniform && icor<(is2d ? 4 : 2); ++icor ) {
+    uniform = fFunction(xcors[icor%2], ycors[icor/2]) == val;
+    ++fNEval;
+  }
+  fVals[icel] = val;
+  fState[icel] = uniform ? kUniform : kMixed;
+  if ( uniform ) ++fNUniform;
+}
+
+//**********************************************************************
+
+float CorrectionGrid::Below(float x) {
+  return std::nextafter(x, -std::numeric_limits<float>::infinity());
+}
+
+//**********************************************************************
+
+void CorrectionGrid::Clear() {
+  fXEdges.clear();
+  fYEdges.clear();
+  fFunction = nullptr;
+  fVals.clear();
+  fState.clear();
+  fNUniform = 0;
+  fNEval = 0;
+}
+
+//**********************************************************************
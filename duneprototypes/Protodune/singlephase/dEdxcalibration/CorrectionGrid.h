@@ -0,0 +1,119 @@
+// CorrectionGrid.h
+//
+// Table of a calibration correction over a regular grid of cells in one
+// or two coordinates, set up once (e.g. per run) so that the lookup for
+// each calorimetry point is an index calculation instead of a call to the
+// calibration provider.
+//
+// The corrections (XYZCalib X and YZ maps) are constant over the bins of
+// a histogram.  A cell is filled the first time a point is looked up in
+// it: the correction is evaluated at its corners, [x1, x2] with x2 the
+// float just below the upper edge, and the value is kept if all corners
+// agree.  Only the cells that are used cost provider calls, 2 per cell in
+// 1D and 4 in 2D.
+//
+// The result is exact only if no bin of the correction is narrower than
+// the cell spacing: a narrower bin inside a cell is not seen at the
+// corners.  The grid cannot check this, so the caller must only use a
+// spacing that is known to be finer than the calibration binning.  Find
+// returns false for cells that straddle a bin edge with different values
+// on either side and for points outside the grid, and the caller
+// evaluates the correction directly there.
+//
+// The cell edges are float values and a point is only looked up if both
+// its double and float values lie inside the corners of its cell, so the
+// result does not depend on whether the provider takes float or double.
+
+#ifndef CorrectionGrid_H
+#define CorrectionGrid_H
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+namespace dune {
+
+class CorrectionGrid {
+
+public:
+
+  using Function = std::function<double(float, float)>;
+
+  // Set up the cells for f(x, y) with x in [x1, x2) and y in [y1, y2),
+  // both with spacing dx.  For a 1D grid, pass y1 = y2 and an f that
+  // ignores y.  f is copied and called by Find.
+  void Build(double x1, double x2, double y1, double y2, double dx, const Function& f);
+
+  // Remove the table.
+  void Clear();
+
+  bool empty() const { return fVals.empty(); }
+
+  // Number of cells, of cells filled so far with a value and of calls
+  // made to f.
+  size_t size() const { return fVals.size(); }
+  size_t Uniform() const { return fNUniform; }
+  size_t Evaluations() const { return fNEval; }
+
+  // Set val to the correction at (x, y) and return true if that point is
+  // in a cell with a value.  Fills the cell if it is the first lookup.
+  bool Find(double x, double y, double& val) {
+    if ( fVals.empty() ) return false;
+    size_t ix, iy;
+    if ( !Locate(fXEdges, x, ix) ) return false;
+    if ( !Locate(fYEdges, y, iy) ) return false;
+    size_t icel = iy*(fXEdges.size() - 1) + ix;
+    if ( fState[icel] == kUnknown ) Fill(ix, iy, icel);
+    if ( fState[icel] != kUniform ) return false;
+    val = fVals[icel];
+    return true;
+  }
+
+private:
+
+  // Set edges to n+1 edges from x1 with spacing dx covering [x1, x2).
+  static void MakeEdges(double x1, double x2, double dx, std::vector<float>& edges);
+
+  // Set i to the cell holding x and return true if x and float(x) are
+  // inside the corners of that cell.
+  static bool Locate(const std::vector<float>& edges, double x, size_t& i) {
+    if ( edges.size() == 1 ) {
+      i = 0;
+      return true;
+    }
+    if ( !(x >= edges.front() && x < edges.back()) ) return false;
+    double dx = double(edges[1]) - double(edges.front());
+    long il = long((x - edges.front())/dx);
+    long ncel = long(edges.size()) - 1;
+    if ( il < 0 ) il = 0;
+    if ( il >= ncel ) il = ncel - 1;
+    while ( il > 0 && x < edges[il] ) --il;
+    while ( il + 1 < ncel && x >= edges[il + 1] ) ++il;
+    float xf = x;
+    if ( xf >= edges[il + 1] ) return false;
+    if ( x > Below(edges[il + 1]) ) return false;
+    i = il;
+    return true;
+  }
+
+  // Largest float below x.
+  static float Below(float x);
+
+  // Evaluate f at the corners of cell (ix, iy).
+  void Fill(size_t ix, size_t iy, size_t icel);
+
+  enum State : char { kUnknown, kUniform, kMixed };
+
+  Function fFunction;
+  std::vector<float> fXEdges;
+  std::vector<float> fYEdges;
+  std::vector<double> fVals;
+  std::vector<char> fState;
+  size_t fNUniform =0;
+  size_t fNEval =0;
+
+};
+
+}  // end namespace dune
+
+#endif
@@ -0,0 +1,232 @@
+// test_CorrectionGrid.cxx
+//
+// Test CorrectionGrid with binned corrections like those of XYZCalib:
+// every value found in the grid must be what the correction returns for
+// the point converted to float.
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <utility>
+#include "duneprototypes/Protodune/singlephase/dEdxcalibration/CorrectionGrid.h"
+
+#undef NDEBUG
+#include <cassert>
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::vector;
+using dune::CorrectionGrid;
+using Clock = std::chrono::steady_clock;
+
+//**********************************************************************
+
+namespace {
+
+// Histogram-like correction: bins of width wid from x0, values from a
+// table, 1 outside the histogram.
+struct Binned {
+  double x0;
+  double wid;
+  vector<double> vals;
+  int Bin(float x) const {
+    int ibin = int(std::floor((x - x0)/wid));
+    if ( ibin < 0 || ibin >= int(vals.size()) ) return -1;
+    return ibin;
+  }
+  double operator()(float x) const {
+    int ibin = Bin(x);
+    return ibin < 0 ? 1.0 : vals[ibin];
+  }
+};
+
+vector<double> randomValues(size_t n, std::mt19937& rng) {
+  std::uniform_real_distribution<double> unif(0.8, 1.2);
+  vector<double> vals;
+  for ( size_t i=0; i<n; ++i ) {
+    // Some neighbours are equal.
+    if ( i && unif(rng) < 0.85 ) vals.push_back(vals.back());
+    else vals.push_back(float(unif(rng)));
+  }
+  return vals;
+}
+
+// Look up the centre of every cell of a grid with spacing 1 from (x1, y1),
+// which fills them all.
+void fillAll(CorrectionGrid& grid, double x1, size_t nx, double y1, size_t ny) {
+  double val = 0.0;
+  for ( size_t iy=0; iy<ny; ++iy ) {
+    for ( size_t ix=0; ix<nx; ++ix ) grid.Find(x1 + ix + 0.5, ny > 1 ? y1 + iy + 0.5 : y1, val);
+  }
+}
+
+}  // end unnamed namespace
+
+//**********************************************************************
+
+int test_CorrectionGrid(size_t npt) {
+  const string myname = "test_CorrectionGrid: ";
+  cout << myname << "Starting test" << endl;
+#ifdef NDEBUG
+  cout << myname << "NDEBUG must be off." << endl;
+  abort();
+#endif
+  string line = "-----------------------------";
+  std::mt19937 rng(2017);
+
+  cout << myname << line << endl;
+  cout << myname << "Empty grid." << endl;
+  {
+    CorrectionGrid grid;
+    double val = 0.0;
+    assert( grid.empty() );
+    assert( !grid.Find(1.0, 0.0, val) );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "1D grid." << endl;
+  {
+    Binned fx{-362.5, 5.0, randomValues(145, rng)};
+    CorrectionGrid grid;
+    grid.Build(-370., 370., 0., 0., 1., [&fx](float x, float) { return fx(x); });
+    assert( grid.size() == 740 );
+    assert( grid.Uniform() == 0 && grid.Evaluations() == 0 );
+    std::uniform_real_distribution<double> xdist(-380., 380.);
+    size_t nfound = 0;
+    for ( size_t ipt=0; ipt<npt; ++ipt ) {
+      double x = xdist(rng);
+      if ( ipt%10 == 0 ) x = std::round(x);   // on cell edges
+      if ( ipt%10 == 1 ) x = -362.5 + 5.0*std::round((x + 362.5)/5.0);  // on bin edges
+      double val = 0.0;
+      if ( grid.Find(x, 0.0, val) ) {
+        assert( val == fx(float(x)) );
+        ++nfound;
+      }
+    }
+    cout << myname << "Found " << nfound << " of " << npt << " points." << endl;
+    assert( nfound > npt/2 );
+    fillAll(grid, -370., 740, 0., 1);
+    assert( grid.Uniform() > 600 && grid.Uniform() < grid.size() );
+    assert( grid.Evaluations() > grid.size() && grid.Evaluations() <= 2*grid.size() );
+    double val = 0.0;
+    assert( !grid.Find(370., 0.0, val) );
+    assert( !grid.Find(-370.5, 0.0, val) );
+    assert( grid.Find(-370., 0.0, val) && val == 1.0 );
+    // Bins aligned with the cells: every cell has a value except [-1, 0),
+    // where the floats just below zero are in the bin above.
+    Binned fxa{-360., 5.0, randomValues(144, rng)};
+    grid.Build(-370., 370., 0., 0., 1., [&fxa](float x, float) { return fxa(x); });
+    fillAll(grid, -370., 740, 0., 1);
+    assert( grid.Uniform() == grid.size() - 1 );
+    assert( !grid.Find(-0.5, 0.0, val) );
+    assert( grid.Find(-355.01, 0.0, val) && val == fxa.vals[0] );
+    assert( !grid.Find(-355.000001, 0.0, val) );   // -355 as a float
+    assert( grid.Find(-355., 0.0, val) && val == fxa.vals[1] );
+    grid.Clear();
+    assert( grid.empty() );
+    assert( !grid.Find(0.0, 0.0, val) );
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "2D grid." << endl;
+  {
+    Binned fy{0., 5.0, vector<double>(122, 1.0)};
+    Binned fz{-2.5, 5.0, vector<double>(140, 1.0)};
+    vector<double> vals = randomValues(fy.vals.size()*fz.vals.size(), rng);
+    for ( size_t ival=0; ival<vals.size(); ival += 97 ) vals[ival] = 1.0;
+    auto fyz = [&](float y, float z) {
+      int iy = fy.Bin(y);
+      int iz = fz.Bin(z);
+      if ( iy < 0 || iz < 0 ) return 1.0;
+      return vals[iy*fz.vals.size() + iz];
+    };
+    CorrectionGrid grid;
+    grid.Build(-10., 620., -10., 710., 1., fyz);
+    assert( grid.size() == 630*720 );
+    std::uniform_real_distribution<double> ydist(-20., 630.);
+    std::uniform_real_distribution<double> zdist(-20., 720.);
+    size_t nfound = 0;
+    for ( size_t ipt=0; ipt<npt; ++ipt ) {
+      double y = ydist(rng);
+      double z = zdist(rng);
+      if ( ipt%10 == 0 ) y = std::round(y);
+      if ( ipt%10 == 1 ) z = -2.5 + 5.0*std::round((z + 2.5)/5.0);
+      double val = 0.0;
+      if ( grid.Find(y, z, val) ) {
+        assert( val == fyz(y, z) );
+        ++nfound;
+      }
+    }
+    cout << myname << "Found " << nfound << " of " << npt << " points." << endl;
+    assert( nfound > npt/2 );
+
+    // Cost of the corrections for npt points: the provider for every
+    // point, the lazily filled grid, and filling every cell of the grid
+    // as the grid built at each run did before.
+    // The points are on straight tracks with 0.5 cm steps.
+    vector<std::pair<double, double>> pts;
+    std::uniform_real_distribution<double> phidist(0., 2.*M_PI);
+    while ( pts.size() < npt ) {
+      double y = ydist(rng);
+      double z = zdist(rng);
+      double phi = phidist(rng);
+      for ( size_t istp=0; istp<400 && pts.size()<npt; ++istp ) {
+        pts.emplace_back(y, z);
+        y += 0.5*std::cos(phi);
+        z += 0.5*std::sin(phi);
+      }
+    }
+    size_t ncall = 0;
+    auto fcount = [&](float y, float z) { ++ncall; return fyz(y, z); };
+    double sum = 0.0;
+    Clock::time_point t0 = Clock::now();
+    for ( const auto& pt : pts ) sum += fcount(pt.first, pt.second);
+    Clock::time_point t1 = Clock::now();
+    CorrectionGrid lazy;
+    lazy.Build(-10., 620., -10., 710., 1., fcount);
+    for ( const auto& pt : pts ) {
+      double val = 0.0;
+      if ( !lazy.Find(pt.first, pt.second, val) ) val = fcount(pt.first, pt.second);
+      sum -= val;
+    }
+    Clock::time_point t2 = Clock::now();
+    size_t nlazy = ncall - npt;
+    CorrectionGrid full;
+    full.Build(-10., 620., -10., 710., 1., fyz);
+    fillAll(full, -10., 630, -10., 720);
+    Clock::time_point t3 = Clock::now();
+    assert( std::abs(sum) < 1.e-6*npt );
+    cout << myname << "Provider per point: " << npt << " calls, "
+         << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms" << endl;
+    cout << myname << "Lazy grid: " << nlazy << " calls, "
+         << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms" << endl;
+    cout << myname << "Full grid: " << full.Evaluations() << " calls, "
+         << std::chrono::duration<double, std::milli>(t3 - t2).count() << " ms" << endl;
+  }
+
+  cout << myname << line << endl;
+  cout << myname << "Done." << endl;
+  return 0;
+}
+
+//**********************************************************************
+
+int main(int argc, char* argv[]) {
+  size_t npt = 200000;
+  if ( argc > 1 ) {
+    string sarg(argv[1]);
+    if ( sarg == "-h" ) {
+      cout << "Usage: " << argv[0] << " [NPT]" << endl;
+      cout << "  NPT [200000]: Number of points to check in each grid." << endl;
+      return 0;
+    }
+    npt = std::stoul(sarg);
+  }
+  return test_CorrectionGrid(npt);
+}
+
+//**********************************************************************